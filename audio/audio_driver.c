@@ -394,6 +394,15 @@ bool audio_driver_find_driver(
  * Writes audio samples to audio driver's output.
  * Will first perform DSP processing (if enabled) and resampling.
  *
+ * DSP, resampling and mixing all work on float. When the driver
+ * takes s16 samples and neither a DSP filter nor the mixer is
+ * active, a resampler with a process_s16 callback converts on
+ * its own input and output instead, skipping \c input_data.
+ * Otherwise the samples are converted from s16 to float into
+ * \c input_data on the way in, and from float back to s16 in place
+ * in \c output_samples_buf on the way out, unless the driver
+ * takes float samples.
+ *
  * @param audio_st The overall state of the audio driver.
  * @param slowmotion_ratio The factor by which slow motion extends the core's runtime
  * (e.g. a value of 2 means the core is running at half speed).
@@ -415,13 +424,24 @@ static void audio_driver_flush(
          (audio_fastforward_mute && is_fastforward))
                ? 0.0f
                : audio_st->volume_gain;
+   bool use_s16                      =
+         !(audio_st->flags & AUDIO_FLAG_USE_FLOAT)
+      && audio_st->resampler->process_s16
+#ifdef HAVE_DSP_FILTER
+      && !audio_st->dsp
+#endif
+#ifdef HAVE_AUDIOMIXER
+      && !(audio_st->flags & AUDIO_FLAG_MIXER_ACTIVE)
+#endif
+      ;
 
    src_data.data_out                 = NULL;
    src_data.output_frames            = 0;
    /* We'll assign a proper output to the resampler later in this function */
 
-   convert_s16_to_float(audio_st->input_data, data, samples,
-         audio_volume_gain);
+   if (!use_s16)
+      convert_s16_to_float(audio_st->input_data, data, samples,
+            audio_volume_gain);
    /* The resampler operates on floating-point frames,
     * so we gotta convert the input first */
 
@@ -529,6 +549,26 @@ static void audio_driver_flush(
       audio_st->last_flush_time = flush_time;
    }
 
+   if (use_s16)
+   {
+      struct resampler_data_s16 s16_data;
+
+      s16_data.data_in               = data;
+      s16_data.data_out              = (int16_t*)audio_st->output_samples_buf;
+      s16_data.input_frames          = samples >> 1;
+      s16_data.output_frames         = 0;
+      s16_data.ratio                 = src_data.ratio;
+      s16_data.gain                  = audio_volume_gain;
+
+      audio_st->resampler->process_s16(
+            audio_st->resampler_data, &s16_data);
+
+      audio_st->current_audio->write(audio_st->context_audio_data,
+            s16_data.data_out,
+            s16_data.output_frames * 2 * sizeof(int16_t));
+      return;
+   }
+
    audio_st->resampler->process(
          audio_st->resampler_data, &src_data);
 
@@ -561,10 +601,14 @@ static void audio_driver_flush(
          output_frames       *= sizeof(float); /* Unit: bytes */
       else
       {
-         convert_float_to_s16(audio_st->output_samples_conv_buf,
-               (const float*)output_data, output_frames * 2);
+         /* This is the only place the pipeline leaves float.
+          * Convert in place: every converter walks forward and
+          * each 16-bit sample is stored at or before the float
+          * it came from, so nothing is overwritten before it is
+          * read and no second output buffer needs to be touched. */
+         convert_float_to_s16((int16_t*)audio_st->output_samples_buf,
+               audio_st->output_samples_buf, output_frames * 2);
 
-         output_data          = audio_st->output_samples_conv_buf;
          output_frames       *= sizeof(int16_t);  /* Unit: bytes */
       }
 
@@ -613,7 +657,8 @@ bool audio_driver_init_internal(
 #endif
    /* Accommodate rewind since at some point we might have two full buffers. */
    size_t outsamples_max          = AUDIO_CHUNK_SIZE_NONBLOCKING * 2 * AUDIO_MAX_RATIO * slowmotion_ratio;
-   int16_t *out_conv_buf          = (int16_t*)memalign_alloc(64, outsamples_max * sizeof(int16_t));
+   /* Only ever holds one chunk of per-sample input now. */
+   int16_t *out_conv_buf          = (int16_t*)memalign_alloc(64, AUDIO_CHUNK_SIZE_NONBLOCKING * sizeof(int16_t));
    size_t audio_buf_length        = AUDIO_CHUNK_SIZE_NONBLOCKING * 2 * sizeof(float);
    float *audio_buf               = (float*)memalign_alloc(64, audio_buf_length);
    bool verbosity_enabled         = verbosity_is_enabled();
@@ -629,7 +674,7 @@ bool audio_driver_init_internal(
    audio_driver_st.input_data                     = audio_buf;
    audio_driver_st.input_data_length              = audio_buf_length;
    audio_driver_st.output_samples_conv_buf        = out_conv_buf;
-   audio_driver_st.output_samples_conv_buf_length = outsamples_max * sizeof(int16_t);
+   audio_driver_st.output_samples_conv_buf_length = AUDIO_CHUNK_SIZE_NONBLOCKING * sizeof(int16_t);
    audio_driver_st.chunk_block_size               = AUDIO_CHUNK_SIZE_BLOCKING;
    audio_driver_st.chunk_nonblock_size            = AUDIO_CHUNK_SIZE_NONBLOCKING;
    audio_driver_st.chunk_size                     = audio_driver_st.chunk_block_size;
@@ -811,43 +856,26 @@ error:
 
 void audio_driver_sample(int16_t left, int16_t right)
 {
-   uint32_t runloop_flags;
    audio_driver_state_t *audio_st  = &audio_driver_st;
-   recording_state_t *recording_st = NULL;
-   if (audio_st->flags & AUDIO_FLAG_SUSPENDED)
-      return;
-   audio_st->output_samples_conv_buf[audio_st->data_ptr++] = left;
-   audio_st->output_samples_conv_buf[audio_st->data_ptr++] = right;
+   int16_t *buf;
 
-   if (audio_st->data_ptr < audio_st->chunk_size)
+   if (audio_st->flags & AUDIO_FLAG_SUSPENDED)
       return;
 
-   runloop_flags                   = runloop_get_flags();
-   recording_st                    = recording_state_get_ptr();
-
-   if (  recording_st->data     &&
-         recording_st->driver   &&
-         recording_st->driver->push_audio)
-   {
-      struct record_audio_data ffemu_data;
-
-      ffemu_data.data                    = audio_st->output_samples_conv_buf;
-      ffemu_data.frames                  = audio_st->data_ptr / 2;
+   /* Cores without audio_sample_batch call this for every
+    * frame, so keep it to a plain append. Full chunks are
+    * handed to the batch path, which does the recording,
+    * conversion and flush exactly once per chunk. */
+   buf                             = audio_st->output_samples_conv_buf
+                                   + audio_st->data_ptr;
+   buf[0]                          = left;
+   buf[1]                          = right;
 
-      recording_st->driver->push_audio(recording_st->data, &ffemu_data);
-   }
-
-   if (!(    (runloop_flags   & RUNLOOP_FLAG_PAUSED)
-         || !(audio_st->flags & AUDIO_FLAG_ACTIVE)
-         || !(audio_st->output_samples_buf)))
-      audio_driver_flush(audio_st,
-            config_get_ptr()->floats.slowmotion_ratio,
-            config_get_ptr()->bools.audio_fastforward_mute,
-            audio_st->output_samples_conv_buf,
-            audio_st->data_ptr,
-            (runloop_flags & RUNLOOP_FLAG_SLOWMOTION) ? true : false,
-            (runloop_flags & RUNLOOP_FLAG_FASTMOTION) ? true : false);
+   if ((audio_st->data_ptr += 2) < audio_st->chunk_size)
+      return;
 
+   audio_driver_sample_batch(audio_st->output_samples_conv_buf,
+         audio_st->data_ptr >> 1);
    audio_st->data_ptr = 0;
 }
 
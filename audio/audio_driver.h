@@ -177,9 +177,9 @@ typedef struct
    struct string_list *devices_list;
 
    /**
-    * A scratch buffer for audio output to be processed,
-    * up to (but excluding) the point where it's converted to 16-bit audio
-    * to give to the driver.
+    * A scratch buffer for audio output to be processed.
+    * For drivers that don't take float samples it is converted
+    * to 16-bit audio in place, right before it's given to the driver.
     */
    float *output_samples_buf;
    size_t output_samples_buf_length;
@@ -188,8 +188,8 @@ typedef struct
 #endif
 
    /**
-    * A scratch buffer for processed audio output to be converted to 16-bit,
-    * so that it can be sent to the driver.
+    * Accumulates one chunk of 16-bit frames from cores that
+    * submit audio through the per-sample callback.
     */
    int16_t *output_samples_conv_buf;
    size_t output_samples_conv_buf_length;
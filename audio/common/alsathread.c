@@ -16,6 +16,15 @@
 
 #include "alsathread.h"
 
+void alsa_thread_wake(alsa_thread_info_t *info)
+{
+   /* Taking the lock orders this after the waiter's last
+    * look at the buffer, so the wakeup can't be lost. */
+   slock_lock(info->cond_lock);
+   scond_signal(info->cond);
+   slock_unlock(info->cond_lock);
+}
+
 void alsa_thread_free_info_members(alsa_thread_info_t *info)
 {
    if (info)
@@ -28,11 +37,9 @@ void alsa_thread_free_info_members(alsa_thread_info_t *info)
          sthread_join(info->worker_thread);
       }
       if (info->buffer)
-         fifo_free(info->buffer);
+         fifo_spsc_free(info->buffer);
       if (info->cond)
          scond_free(info->cond);
-      if (info->fifo_lock)
-         slock_free(info->fifo_lock);
       if (info->cond_lock)
          slock_free(info->cond_lock);
       if (info->pcm)
@@ -26,15 +26,21 @@
 typedef struct alsa_thread_info
 {
    snd_pcm_t *pcm;
-   fifo_buffer_t *buffer;
+   /* Shared between the worker thread and the driver, lock-free. */
+   fifo_spsc_t *buffer;
    sthread_t *worker_thread;
-   slock_t *fifo_lock;
+   /* Only used to sleep while the buffer is full or empty. */
    scond_t *cond;
    slock_t *cond_lock;
    alsa_stream_info_t stream_info;
    volatile bool thread_dead;
 } alsa_thread_info_t;
 
+/**
+ * Wakes up the other side after the buffer changed.
+ **/
+void alsa_thread_wake(alsa_thread_info_t *info);
+
 void alsa_thread_free_info_members(alsa_thread_info_t *info);
 
 #endif
@@ -543,5 +543,6 @@ retro_resampler_t CC_resampler = {
    resampler_CC_free,
    RESAMPLER_API_VERSION,
    "CC",
-   "cc"
+   "cc",
+   NULL
 };
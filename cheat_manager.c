@@ -775,6 +775,63 @@ void cheat_manager_alloc_if_empty(void)
       cheat_manager_new(0);
 }
 
+static unsigned cheat_manager_num_items(const cheat_manager_t *cheat_st)
+{
+   return (unsigned)(((uint64_t)cheat_st->total_memory_size * 8)
+         >> cheat_st->search_bit_size);
+}
+
+/**
+ * cheat_manager_reset_matches:
+ *
+ * Lays out the match bits for the current search size
+ * and marks every item as a match.
+ **/
+static bool cheat_manager_reset_matches(cheat_manager_t *cheat_st)
+{
+   unsigned num_items = cheat_manager_num_items(cheat_st);
+   size_t   num_words = num_items / CHEAT_SEARCH_GROUP_SIZE + 1;
+
+   if (cheat_st->matches)
+      free(cheat_st->matches);
+
+   cheat_st->matches     = (uint64_t*)malloc(num_words * sizeof(uint64_t));
+   cheat_st->num_matches = 0;
+
+   if (!cheat_st->matches)
+      return false;
+
+   memset(cheat_st->matches, 0xFF, num_words * sizeof(uint64_t));
+   /* No bits past the last item */
+   cheat_st->matches[num_words - 1] = ((uint64_t)1 <<
+         (num_items % CHEAT_SEARCH_GROUP_SIZE)) - 1;
+
+   cheat_st->matches_items    = num_items;
+   cheat_st->matches_bit_size = cheat_st->search_bit_size;
+   cheat_st->num_matches      = num_items;
+
+   return true;
+}
+
+/**
+ * cheat_manager_sync_matches:
+ *
+ * The search size can be changed from the menu and the memory
+ * map by the core at any time; whenever the match bits no
+ * longer fit, start over from every item.
+ **/
+static bool cheat_manager_sync_matches(cheat_manager_t *cheat_st)
+{
+   if (!cheat_st->matches)
+      return false;
+
+   if (     cheat_st->matches_bit_size == cheat_st->search_bit_size
+         && cheat_st->matches_items    == cheat_manager_num_items(cheat_st))
+      return true;
+
+   return cheat_manager_reset_matches(cheat_st);
+}
+
 int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool wraparound)
 {
    unsigned i;
@@ -867,7 +924,11 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool w
 
    }
 
-   cheat_st->num_matches = (cheat_st->total_memory_size * 8) / (1 << cheat_st->search_bit_size);
+   /* Keep the match bits in step with the memory map */
+   if (cheat_st->matches)
+      cheat_manager_sync_matches(cheat_st);
+   else
+      cheat_st->num_matches = cheat_manager_num_items(cheat_st);
 
 #if 0
    /* Ensure we're aligned on 4-byte boundary */
@@ -892,16 +953,7 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool w
          return 0;
       }
 
-      if (cheat_st->matches)
-      {
-         free(cheat_st->matches);
-         cheat_st->matches = NULL;
-      }
-
-      cheat_st->matches = (uint8_t*)calloc(
-            cheat_st->total_memory_size, sizeof(uint8_t));
-
-      if (!cheat_st->matches)
+      if (!cheat_manager_reset_matches(cheat_st))
       {
          free(cheat_st->prev_memory_buf);
          cheat_st->prev_memory_buf = NULL;
@@ -909,8 +961,6 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, size_t idx, bool w
          return 0;
       }
 
-      memset(cheat_st->matches, 0xFF, cheat_st->total_memory_size);
-
       offset = 0;
 
       for (i = 0; i < cheat_st->num_memory_buffers; i++)
@@ -957,6 +1007,105 @@ static unsigned translate_address(unsigned address, unsigned char **curr)
    return offset;
 }
 
+/* Byte address and mask of a search item, as used by cheat codes */
+static unsigned cheat_manager_item_address(const cheat_manager_t *cheat_st,
+      unsigned item, unsigned *address_mask)
+{
+   unsigned bits = 1 << cheat_st->search_bit_size;
+
+   if (bits < 8)
+   {
+      unsigned per_byte = 8 / bits;
+      *address_mask     = ((1 << bits) - 1) << ((item % per_byte) * bits);
+      return item / per_byte;
+   }
+
+   *address_mask = 0xFF;
+   return item * (bits / 8);
+}
+
+/* Reads a value from current or previous memory; bytes
+ * past the end of memory read as zero. */
+static unsigned cheat_manager_read_value(const cheat_manager_t *cheat_st,
+      bool from_prev, unsigned address, unsigned bytes_per_item)
+{
+   unsigned i;
+   uint8_t data[4];
+
+   for (i = 0; i < bytes_per_item; i++)
+   {
+      unsigned char *curr = NULL;
+      unsigned offset;
+
+      data[i] = 0;
+
+      if (address + i >= cheat_st->total_memory_size)
+         continue;
+
+      if (from_prev)
+      {
+         data[i] = cheat_st->prev_memory_buf[address + i];
+         continue;
+      }
+
+      offset = translate_address(address + i, &curr);
+      if (curr)
+         data[i] = curr[address + i - offset];
+   }
+
+   return cheat_search_read(data, bytes_per_item, cheat_st->big_endian);
+}
+
+/**
+ * cheat_manager_search_span:
+ * @start             : offset into the combined memory.
+ * @len               : number of bytes wanted, at most
+ *                      4 * CHEAT_SEARCH_GROUP_SIZE.
+ * @buf               : cursor into the memory buffer list.
+ * @buf_start         : offset of the buffer at the cursor.
+ * @scratch           : space for spans crossing buffers.
+ *
+ * Spans must be requested in increasing order, so that walking
+ * the whole memory only walks the buffer list once.
+ *
+ * Returns: pointer to @len contiguous bytes of current memory.
+ **/
+static const uint8_t *cheat_manager_search_span(
+      const cheat_manager_t *cheat_st,
+      unsigned start, unsigned len,
+      unsigned *buf, unsigned *buf_start, uint8_t *scratch)
+{
+   unsigned i, pos, copied;
+
+   while (     *buf + 1 < cheat_st->num_memory_buffers
+         && start >= *buf_start + cheat_st->memory_size_list[*buf])
+   {
+      *buf_start += cheat_st->memory_size_list[*buf];
+      (*buf)++;
+   }
+
+   if (start + len <= *buf_start + cheat_st->memory_size_list[*buf])
+      return cheat_st->memory_buf_list[*buf] + (start - *buf_start);
+
+   /* Crosses into the next buffer */
+   for (i = *buf, pos = *buf_start, copied = 0;
+         copied < len && i < cheat_st->num_memory_buffers; i++)
+   {
+      unsigned from = start + copied - pos;
+
+      if (from < cheat_st->memory_size_list[i])
+      {
+         unsigned n = MIN(cheat_st->memory_size_list[i] - from, len - copied);
+         memcpy(scratch + copied, cheat_st->memory_buf_list[i] + from, n);
+         copied += n;
+      }
+
+      pos += cheat_st->memory_size_list[i];
+   }
+
+   return scratch;
+}
+
 static void cheat_manager_setup_search_meta(
       unsigned int bitsize,
       unsigned int *bytes_per_item,
@@ -1001,22 +1150,23 @@ static void cheat_manager_setup_search_meta(
 static int cheat_manager_search(enum cheat_search_type search_type)
 {
    char msg[100];
+   uint8_t scratch[CHEAT_SEARCH_GROUP_SIZE * 4];
+   struct cheat_search_params params;
    cheat_manager_t   *cheat_st = &cheat_manager_state;
-   unsigned char *curr         = cheat_st->curr_memory_buf;
    unsigned char *prev         = cheat_st->prev_memory_buf;
-   unsigned int idx            = 0;
-   unsigned int curr_val       = 0;
-   unsigned int prev_val       = 0;
-   unsigned int mask           = 0;
-   unsigned int bytes_per_item = 1;
-   unsigned int bits           = 8;
+   unsigned int word           = 0;
+   unsigned int num_words      = 0;
+   unsigned int buf            = 0;
+   unsigned int buf_start      = 0;
    unsigned int offset         = 0;
    unsigned int i              = 0;
 #ifdef HAVE_MENU
    struct menu_state *menu_st  = menu_state_get_ptr();
 #endif
 
-   if (cheat_st->num_memory_buffers == 0 || !prev || !cheat_st->matches)
+   if (     cheat_st->num_memory_buffers == 0
+         || !prev
+         || !cheat_manager_sync_matches(cheat_st))
    {
       runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_NOT_INITIALIZED),
             1, 180, true, NULL,
@@ -1024,97 +1174,50 @@ static int cheat_manager_search(enum cheat_search_type search_type)
       return 0;
    }
 
-   cheat_manager_setup_search_meta(cheat_st->search_bit_size, &bytes_per_item, &mask, &bits);
+   params.type       = search_type;
+   params.bits       = 1 << cheat_st->search_bit_size;
+   params.big_endian = cheat_st->big_endian;
 
-   /* little endian FF000000 = 256 */
-   for (idx = 0; idx < cheat_st->total_memory_size; idx = idx + bytes_per_item)
+   switch (search_type)
    {
-      unsigned byte_part;
-
-      offset = translate_address(idx, &curr);
-
-      switch (bytes_per_item)
-      {
-         case 2:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-            prev_val = cheat_st->big_endian ?
-               (*(prev + idx) * 256) + *(prev + idx + 1) :
-               *(prev + idx) + (*(prev + idx + 1) * 256);
-            break;
-         case 4:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-            prev_val = cheat_st->big_endian ?
-               (*(prev + idx) * 256 * 256 * 256) + (*(prev + idx + 1) * 256 * 256) + (*(prev + idx + 2) * 256) + *(prev + idx + 3) :
-               *(prev + idx) + (*(prev + idx + 1) * 256) + (*(prev + idx + 2) * 256 * 256) + (*(prev + idx + 3) * 256 * 256 * 256);
-            break;
-         case 1:
-         default:
-            curr_val = *(curr - offset + idx);
-            prev_val = *(prev + idx);
-            break;
-      }
+      case CHEAT_SEARCH_TYPE_EXACT:
+         params.value = cheat_st->search_exact_value;
+         break;
+      case CHEAT_SEARCH_TYPE_EQPLUS:
+         params.value = cheat_st->search_eqplus_value;
+         break;
+      case CHEAT_SEARCH_TYPE_EQMINUS:
+         params.value = cheat_st->search_eqminus_value;
+         break;
+      default:
+         params.value = 0;
+         break;
+   }
 
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
-      {
-         unsigned int curr_subval = (curr_val >> (byte_part * bits)) & mask;
-         unsigned int prev_subval = (prev_val >> (byte_part * bits)) & mask;
-         unsigned int prev_match;
+   num_words = cheat_st->matches_items / CHEAT_SEARCH_GROUP_SIZE + 1;
 
-         if (bits < 8)
-            prev_match = *(cheat_st->matches + idx) & (mask << (byte_part * bits));
-         else
-            prev_match = *(cheat_st->matches + idx);
+   /* Compare a group of items at a time, skipping
+    * groups that have no matches left. */
+   for (word = 0; word < num_words; word++)
+   {
+      uint64_t hits;
+      uint64_t live  = cheat_st->matches[word];
+      unsigned first = word * CHEAT_SEARCH_GROUP_SIZE;
+      unsigned count = MIN(cheat_st->matches_items - first,
+            CHEAT_SEARCH_GROUP_SIZE);
+      unsigned start = (unsigned)(((uint64_t)first * params.bits) / 8);
+      unsigned len   = (count * params.bits + 7) / 8;
+
+      if (!live)
+         continue;
 
-         if (prev_match > 0)
-         {
-            bool match = false;
-            switch (search_type)
-            {
-               case CHEAT_SEARCH_TYPE_EXACT:
-                  match = (curr_subval == cheat_st->search_exact_value);
-                  break;
-               case CHEAT_SEARCH_TYPE_LT:
-                  match = (curr_subval < prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_GT:
-                  match = (curr_subval > prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_LTE:
-                  match = (curr_subval <= prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_GTE:
-                  match = (curr_subval >= prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQ:
-                  match = (curr_subval == prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_NEQ:
-                  match = (curr_subval != prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQPLUS:
-                  match = (curr_subval == prev_subval + cheat_st->search_eqplus_value);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQMINUS:
-                  match = (curr_subval == prev_subval - cheat_st->search_eqminus_value);
-                  break;
-            }
+      hits = cheat_search_compare(&params,
+            cheat_manager_search_span(cheat_st, start, len,
+               &buf, &buf_start, scratch),
+            prev + start, count);
 
-            if (!match)
-            {
-               if (bits < 8)
-                  *(cheat_st->matches + idx) = *(cheat_st->matches + idx) &
-                     ((~(mask << (byte_part * bits))) & 0xFF);
-               else
-                  memset(cheat_st->matches + idx, 0, bytes_per_item);
-               if (cheat_st->num_matches > 0)
-                  cheat_st->num_matches--;
-            }
-         }
-      }
+      cheat_st->num_matches  -= cheat_search_count(live & ~hits);
+      cheat_st->matches[word] = live & hits;
    }
 
    offset = 0;
@@ -1210,19 +1313,22 @@ int cheat_manager_add_matches(const char *path,
       const char *label, unsigned type, size_t menuidx, size_t entry_idx)
 {
    char msg[100];
-   unsigned          byte_part = 0;
-   unsigned            int idx = 0;
+   unsigned           int word = 0;
+   unsigned      int num_words = 0;
    unsigned           int mask = 0;
    unsigned int bytes_per_item = 1;
    unsigned           int bits = 8;
-   unsigned       int curr_val = 0;
-   unsigned         int offset = 0;
    cheat_manager_t   *cheat_st = &cheat_manager_state;
-   unsigned char         *curr = cheat_st->curr_memory_buf;
 #ifdef HAVE_MENU
    struct menu_state *menu_st  = menu_state_get_ptr();
 #endif
 
+   if (!cheat_manager_sync_matches(cheat_st))
+   {
+      runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_NOT_INITIALIZED), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+      return 0;
+   }
+
    if (cheat_st->num_matches + cheat_st->size > 100)
    {
       runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_TOO_MANY), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
@@ -1230,58 +1336,28 @@ int cheat_manager_add_matches(const char *path,
    }
    cheat_manager_setup_search_meta(cheat_st->search_bit_size, &bytes_per_item, &mask, &bits);
 
-   for (idx = 0; idx < cheat_st->total_memory_size; idx = idx + bytes_per_item)
+   num_words = cheat_st->matches_items / CHEAT_SEARCH_GROUP_SIZE + 1;
+
+   for (word = 0; word < num_words; word++)
    {
-      offset = translate_address(idx, &curr);
+      uint64_t live = cheat_st->matches[word];
 
-      switch (bytes_per_item)
+      for (; live; live &= live - 1)
       {
-         case 2:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-            break;
-         case 4:
-            curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-            break;
-         case 1:
-         default:
-            curr_val = *(curr - offset + idx);
-            break;
-      }
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
-      {
-         unsigned int prev_match;
-
-         if (bits < 8)
+         unsigned address_mask;
+         unsigned item    = word * CHEAT_SEARCH_GROUP_SIZE +
+            cheat_search_nth(live, 0);
+         unsigned idx     = cheat_manager_item_address(cheat_st,
+               item, &address_mask);
+         unsigned curr_val = cheat_manager_read_value(cheat_st,
+               false, idx, bytes_per_item);
+
+         if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, address_mask,
+                  cheat_st->big_endian, curr_val))
          {
-            prev_match = *(cheat_st->matches + idx) & (mask << (byte_part * bits));
-            if (prev_match)
-            {
-               if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, (mask << (byte_part * bits)),
-                        cheat_st->big_endian, curr_val))
-               {
-                  runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                  return 0;
-               }
-            }
+            runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+            return 0;
          }
-         else
-         {
-            prev_match = *(cheat_st->matches + idx);
-            if (prev_match)
-            {
-               if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, 0xFF,
-                        cheat_st->big_endian, curr_val))
-               {
-                  runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                  return 0;
-               }
-            }
-         }
-
       }
    }
 
@@ -1584,19 +1660,20 @@ void cheat_manager_apply_retro_cheats(void)
 void cheat_manager_match_action(enum cheat_match_action_type match_action, unsigned int target_match_idx, unsigned int *address, unsigned int *address_mask,
       unsigned int *prev_value, unsigned int *curr_value)
 {
-   unsigned int byte_part;
    unsigned int idx;
-   unsigned int start_idx;
+   unsigned int bit;
+   unsigned int item;
+   unsigned int item_mask;
+   unsigned int word           = 0;
+   unsigned int num_words      = 0;
+   unsigned int target         = target_match_idx;
    unsigned int           mask = 0;
    unsigned int bytes_per_item = 1;
    unsigned int           bits = 8;
    unsigned int       curr_val = 0;
    unsigned int       prev_val = 0;
-   unsigned int         offset = 0;
    cheat_manager_t   *cheat_st = &cheat_manager_state;
-   unsigned char         *curr = cheat_st->curr_memory_buf;
    unsigned char         *prev = cheat_st->prev_memory_buf;
-   unsigned int curr_match_idx = 0;
 
    if (target_match_idx > cheat_st->num_matches - 1)
       return;
@@ -1607,137 +1684,65 @@ void cheat_manager_match_action(enum cheat_match_action_type match_action, unsig
    cheat_manager_setup_search_meta(cheat_st->search_bit_size, &bytes_per_item, &mask, &bits);
 
    if (match_action == CHEAT_MATCH_ACTION_TYPE_BROWSE)
-      start_idx = *address;
-   else
-      start_idx = 0;
-
-   for (idx = start_idx; idx < cheat_st->total_memory_size; idx = idx + bytes_per_item)
    {
-      offset = translate_address(idx, &curr);
+      if (*address >= cheat_st->total_memory_size)
+         return;
 
-      switch (bytes_per_item)
-      {
-      case 2:
-         curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-         if (prev)
-            prev_val = cheat_st->big_endian ?
-                  (*(prev + idx) * 256) + *(prev + idx + 1) :
-                  *(prev + idx) + (*(prev + idx + 1) * 256);
-         break;
-      case 4:
-         curr_val = cheat_st->big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-         if (prev)
-            prev_val = cheat_st->big_endian ?
-                  (*(prev + idx) * 256 * 256 * 256) + (*(prev + idx + 1) * 256 * 256) + (*(prev + idx + 2) * 256) + *(prev + idx + 3) :
-                  *(prev + idx) + (*(prev + idx + 1) * 256) + (*(prev + idx + 2) * 256 * 256) + (*(prev + idx + 3) * 256 * 256 * 256);
-         break;
-      case 1:
-      default:
-         curr_val = *(curr + idx - offset);
-         if (prev)
-            prev_val = *(prev + idx);
-         break;
-      }
+      *curr_value = cheat_manager_read_value(cheat_st, false,
+            *address, bytes_per_item);
+      *prev_value = prev ? cheat_manager_read_value(cheat_st, true,
+            *address, bytes_per_item) : 0;
+      return;
+   }
 
-      if (match_action == CHEAT_MATCH_ACTION_TYPE_BROWSE)
-      {
-         *curr_value = curr_val;
-         *prev_value = prev_val;
-         return;
-      }
+   if (!prev || !cheat_manager_sync_matches(cheat_st))
+      return;
+
+   /* Find the group holding the wanted match, then the match itself */
+   num_words = cheat_st->matches_items / CHEAT_SEARCH_GROUP_SIZE + 1;
 
-      if (!prev)
+   for (word = 0; ; word++)
+   {
+      unsigned in_word;
+
+      if (word >= num_words)
          return;
 
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
-      {
-         unsigned int prev_match;
+      in_word = cheat_search_count(cheat_st->matches[word]);
+      if (target < in_word)
+         break;
+      target -= in_word;
+   }
 
-         if (bits < 8)
-         {
-            prev_match = *(cheat_st->matches + idx) & (mask << (byte_part * bits));
-            if (prev_match)
-            {
-               if (target_match_idx == curr_match_idx)
-               {
-                  switch (match_action)
-                  {
-                  case CHEAT_MATCH_ACTION_TYPE_BROWSE:
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_VIEW:
-                     *address = idx;
-                     *address_mask = (mask << (byte_part * bits));
-                     *curr_value = curr_val;
-                     *prev_value = prev_val;
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_COPY:
-                     if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, (mask << (byte_part * bits)),
-                           cheat_st->big_endian, curr_val))
-                        runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     else
-                        runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_DELETE:
-                     if (bits < 8)
-                        *(cheat_st->matches + idx) = *(cheat_st->matches + idx) &
-                              ((~(mask << (byte_part * bits))) & 0xFF);
-                     else
-                        memset(cheat_st->matches + idx, 0, bytes_per_item);
-                     if (cheat_st->num_matches > 0)
-                        cheat_st->num_matches--;
-                     runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_DELETE_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     return;
-                  }
-                  return;
-               }
-               curr_match_idx++;
-            }
-         }
-         else
-         {
-            prev_match = *(cheat_st->matches + idx);
-            if (prev_match)
-            {
-               if (target_match_idx == curr_match_idx)
-               {
-                  switch (match_action)
-                  {
-                  case CHEAT_MATCH_ACTION_TYPE_BROWSE:
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_VIEW:
-                     *address = idx;
-                     *address_mask = 0xFF;
-                     *curr_value = curr_val;
-                     *prev_value = prev_val;
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_COPY:
-                     if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, 0xFF,
-                           cheat_st->big_endian, curr_val))
-                        runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     else
-                        runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_DELETE:
-                     if (bits < 8)
-                        *(cheat_st->matches + idx) = *(cheat_st->matches + idx) &
-                              ((~(mask << (byte_part * bits))) & 0xFF);
-                     else
-                        memset(cheat_st->matches + idx, 0, bytes_per_item);
-                     if (cheat_st->num_matches > 0)
-                        cheat_st->num_matches--;
-                     runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_DELETE_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     return;
-                  }
-               }
+   bit      = cheat_search_nth(cheat_st->matches[word], target);
+   item     = word * CHEAT_SEARCH_GROUP_SIZE + bit;
+   idx      = cheat_manager_item_address(cheat_st, item, &item_mask);
+   curr_val = cheat_manager_read_value(cheat_st, false, idx, bytes_per_item);
+   prev_val = cheat_manager_read_value(cheat_st, true,  idx, bytes_per_item);
 
-               curr_match_idx++;
-            }
-         }
-      }
+   switch (match_action)
+   {
+      case CHEAT_MATCH_ACTION_TYPE_VIEW:
+         *address      = idx;
+         *address_mask = item_mask;
+         *curr_value   = curr_val;
+         *prev_value   = prev_val;
+         break;
+      case CHEAT_MATCH_ACTION_TYPE_COPY:
+         if (!cheat_manager_add_new_code(cheat_st->search_bit_size, idx, item_mask,
+               cheat_st->big_endian, curr_val))
+            runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         else
+            runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         break;
+      case CHEAT_MATCH_ACTION_TYPE_DELETE:
+         cheat_st->matches[word] &= ~((uint64_t)1 << bit);
+         if (cheat_st->num_matches > 0)
+            cheat_st->num_matches--;
+         runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_DELETE_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         break;
+      default:
+         break;
    }
 }
 
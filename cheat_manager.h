@@ -21,6 +21,7 @@
 #include <retro_common_api.h>
 
 #include "../setting_list.h"
+#include "cheat_search.h"
 
 RETRO_BEGIN_DECLS
 
@@ -43,19 +44,6 @@ enum cheat_type
    CHEAT_TYPE_RUN_NEXT_IF_GT
 };
 
-enum cheat_search_type
-{
-   CHEAT_SEARCH_TYPE_EXACT = 0,
-   CHEAT_SEARCH_TYPE_LT,
-   CHEAT_SEARCH_TYPE_LTE,
-   CHEAT_SEARCH_TYPE_GT,
-   CHEAT_SEARCH_TYPE_GTE,
-   CHEAT_SEARCH_TYPE_EQ,
-   CHEAT_SEARCH_TYPE_NEQ,
-   CHEAT_SEARCH_TYPE_EQPLUS,
-   CHEAT_SEARCH_TYPE_EQMINUS
-};
-
 enum cheat_match_action_type
 {
    CHEAT_MATCH_ACTION_TYPE_VIEW = 0,
@@ -161,7 +149,8 @@ struct cheat_manager
    struct item_cheat *cheats;
    uint8_t *curr_memory_buf;
    uint8_t *prev_memory_buf;
-   uint8_t *matches;
+   /* One bit per search item, CHEAT_SEARCH_GROUP_SIZE items per word */
+   uint64_t *matches;
    uint8_t **memory_buf_list;
    unsigned *memory_size_list;
    unsigned int delete_state;
@@ -180,6 +169,9 @@ struct cheat_manager
    unsigned search_eqplus_value;
    unsigned search_eqminus_value;
    unsigned num_matches;
+   /* Item count and search size the match bits were laid out for */
+   unsigned matches_items;
+   unsigned matches_bit_size;
    unsigned browse_address;
    char working_desc[CHEAT_DESC_SCRATCH_SIZE];
    char working_code[CHEAT_CODE_SCRATCH_SIZE];
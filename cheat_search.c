@@ -0,0 +1,405 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <retro_inline.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "cheat_search.h"
+
+unsigned cheat_search_read(const uint8_t *data, unsigned bytes,
+      bool big_endian)
+{
+   switch (bytes)
+   {
+      case 2:
+         return big_endian
+            ? ((unsigned)data[0] << 8) | data[1]
+            : data[0] | ((unsigned)data[1] << 8);
+      case 4:
+         return big_endian
+            ? ((unsigned)data[0] << 24) | ((unsigned)data[1] << 16)
+            | ((unsigned)data[2] << 8)  | data[3]
+            : data[0] | ((unsigned)data[1] << 8)
+            | ((unsigned)data[2] << 16) | ((unsigned)data[3] << 24);
+      default:
+         break;
+   }
+
+   return data[0];
+}
+
+unsigned cheat_search_count(uint64_t word)
+{
+#if defined(__GNUC__)
+   return (unsigned)__builtin_popcountll(word);
+#else
+   word = word - ((word >> 1) & 0x5555555555555555ULL);
+   word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+   word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+   return (unsigned)((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+unsigned cheat_search_nth(uint64_t word, unsigned n)
+{
+   unsigned pos = 0;
+
+   /* Skip whole bytes first */
+   for (;;)
+   {
+      unsigned in_byte = cheat_search_count(word & 0xFF);
+      if (n < in_byte)
+         break;
+      n    -= in_byte;
+      word >>= 8;
+      pos  += 8;
+   }
+
+   for (;; word >>= 1, pos++)
+      if ((word & 1) && n-- == 0)
+         return pos;
+}
+
+static INLINE bool cheat_search_match(
+      const struct cheat_search_params *params,
+      unsigned curr, unsigned prev)
+{
+   switch (params->type)
+   {
+      case CHEAT_SEARCH_TYPE_EXACT:
+         return curr == params->value;
+      case CHEAT_SEARCH_TYPE_LT:
+         return curr < prev;
+      case CHEAT_SEARCH_TYPE_GT:
+         return curr > prev;
+      case CHEAT_SEARCH_TYPE_LTE:
+         return curr <= prev;
+      case CHEAT_SEARCH_TYPE_GTE:
+         return curr >= prev;
+      case CHEAT_SEARCH_TYPE_EQ:
+         return curr == prev;
+      case CHEAT_SEARCH_TYPE_NEQ:
+         return curr != prev;
+      case CHEAT_SEARCH_TYPE_EQPLUS:
+         return curr == prev + params->value;
+      case CHEAT_SEARCH_TYPE_EQMINUS:
+         return curr == prev - params->value;
+   }
+
+   return false;
+}
+
+uint64_t cheat_search_compare_scalar(const struct cheat_search_params *params,
+      const uint8_t *curr, const uint8_t *prev, unsigned count)
+{
+   unsigned i;
+   uint64_t hits = 0;
+
+   if (params->bits < 8)
+   {
+      unsigned per_byte = 8 / params->bits;
+      unsigned mask     = (1 << params->bits) - 1;
+
+      for (i = 0; i < count; i++)
+      {
+         unsigned shift = (i % per_byte) * params->bits;
+         unsigned c     = (curr[i / per_byte] >> shift) & mask;
+         unsigned p     = (prev[i / per_byte] >> shift) & mask;
+
+         if (cheat_search_match(params, c, p))
+            hits |= (uint64_t)1 << i;
+      }
+   }
+   else
+   {
+      unsigned bytes = params->bits / 8;
+
+      for (i = 0; i < count; i++, curr += bytes, prev += bytes)
+      {
+         unsigned c = cheat_search_read(curr, bytes, params->big_endian);
+         unsigned p = cheat_search_read(prev, bytes, params->big_endian);
+
+         if (cheat_search_match(params, c, p))
+            hits |= (uint64_t)1 << i;
+      }
+   }
+
+   return hits;
+}
+
+/* 1-bit items: each byte holds eight of them, so the whole
+ * group is a single 64-bit word and every search is a
+ * handful of bitwise operations. */
+static uint64_t cheat_search_compare_1(const struct cheat_search_params *params,
+      const uint8_t *curr, const uint8_t *prev)
+{
+   unsigned i;
+   uint64_t c = 0;
+   uint64_t p = 0;
+
+   for (i = 0; i < 8; i++)
+   {
+      c |= (uint64_t)curr[i] << (i * 8);
+      p |= (uint64_t)prev[i] << (i * 8);
+   }
+
+   switch (params->type)
+   {
+      case CHEAT_SEARCH_TYPE_EXACT:
+         return params->value ? c : ~c;
+      case CHEAT_SEARCH_TYPE_LT:
+         return ~c & p;
+      case CHEAT_SEARCH_TYPE_GT:
+         return c & ~p;
+      case CHEAT_SEARCH_TYPE_LTE:
+         return ~c | p;
+      case CHEAT_SEARCH_TYPE_GTE:
+         return c | ~p;
+      case CHEAT_SEARCH_TYPE_NEQ:
+         return c ^ p;
+      case CHEAT_SEARCH_TYPE_EQPLUS:
+         /* 0 + 1 is the only way up */
+         return params->value ? c & ~p : ~(c ^ p);
+      case CHEAT_SEARCH_TYPE_EQMINUS:
+         return params->value ? ~c & p : ~(c ^ p);
+      default:
+         break;
+   }
+
+   return ~(c ^ p);
+}
+
+#if defined(__SSE2__)
+/* Lane-width dispatch for the SSE2 kernel. The kernel is only
+ * ever instantiated with a constant width, so every one of
+ * these folds down to a single instruction. */
+static INLINE __m128i cheat_search_set1_sse2(unsigned value, unsigned bits)
+{
+   switch (bits)
+   {
+      case 8:
+         return _mm_set1_epi8((char)value);
+      case 16:
+         return _mm_set1_epi16((short)value);
+   }
+   return _mm_set1_epi32((int)value);
+}
+
+static INLINE __m128i cheat_search_cmpeq_sse2(__m128i a, __m128i b,
+      unsigned bits)
+{
+   switch (bits)
+   {
+      case 8:
+         return _mm_cmpeq_epi8(a, b);
+      case 16:
+         return _mm_cmpeq_epi16(a, b);
+   }
+   return _mm_cmpeq_epi32(a, b);
+}
+
+/* Signed compare; callers bias both sides for unsigned results */
+static INLINE __m128i cheat_search_cmpgt_sse2(__m128i a, __m128i b,
+      unsigned bits)
+{
+   switch (bits)
+   {
+      case 8:
+         return _mm_cmpgt_epi8(a, b);
+      case 16:
+         return _mm_cmpgt_epi16(a, b);
+   }
+   return _mm_cmpgt_epi32(a, b);
+}
+
+static INLINE __m128i cheat_search_add_sse2(__m128i a, __m128i b,
+      unsigned bits)
+{
+   switch (bits)
+   {
+      case 8:
+         return _mm_add_epi8(a, b);
+      case 16:
+         return _mm_add_epi16(a, b);
+   }
+   return _mm_add_epi32(a, b);
+}
+
+static INLINE __m128i cheat_search_sub_sse2(__m128i a, __m128i b,
+      unsigned bits)
+{
+   switch (bits)
+   {
+      case 8:
+         return _mm_sub_epi8(a, b);
+      case 16:
+         return _mm_sub_epi16(a, b);
+   }
+   return _mm_sub_epi32(a, b);
+}
+
+static INLINE __m128i cheat_search_swap_sse2(__m128i a, unsigned bits)
+{
+   if (bits == 32)
+      a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(a,
+               _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+   return _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+}
+
+/* One bit per lane */
+static INLINE unsigned cheat_search_movemask_sse2(__m128i a, unsigned bits)
+{
+   switch (bits)
+   {
+      case 8:
+         return (unsigned)_mm_movemask_epi8(a);
+      case 16:
+         return (unsigned)_mm_movemask_epi8(_mm_packs_epi16(a, a)) & 0xFF;
+   }
+   return (unsigned)_mm_movemask_ps(_mm_castsi128_ps(a));
+}
+
+static INLINE uint64_t cheat_search_compare_sse2(
+      const struct cheat_search_params *params,
+      const uint8_t *curr, const uint8_t *prev, const unsigned bits)
+{
+   unsigned i;
+   uint64_t hits        = 0;
+   const unsigned lanes = 128 / bits;
+   const unsigned max   = (bits == 32) ? 0xFFFFFFFF : (1U << bits) - 1;
+   const __m128i ones   = _mm_set1_epi32(-1);
+   const __m128i bias   = cheat_search_set1_sse2(1U << (bits - 1), bits);
+   const __m128i value  = cheat_search_set1_sse2(params->value, bits);
+   /* EQPLUS and EQMINUS must not wrap below 32 bits: the scalar
+    * search computes prev +/- value in unsigned int. */
+   const __m128i limit  = _mm_xor_si128(cheat_search_set1_sse2(
+            params->type == CHEAT_SEARCH_TYPE_EQPLUS
+            ? max - params->value : params->value, bits), bias);
+   const bool check_wrap = bits < 32 &&
+         (params->type == CHEAT_SEARCH_TYPE_EQPLUS ||
+          params->type == CHEAT_SEARCH_TYPE_EQMINUS);
+
+   for (i = 0; i < CHEAT_SEARCH_GROUP_SIZE; i += lanes)
+   {
+      __m128i ref, m;
+      __m128i c = _mm_loadu_si128((const __m128i*)(curr + i * bits / 8));
+      __m128i p = _mm_loadu_si128((const __m128i*)(prev + i * bits / 8));
+
+      if (bits > 8 && params->big_endian)
+      {
+         c = cheat_search_swap_sse2(c, bits);
+         p = cheat_search_swap_sse2(p, bits);
+      }
+
+      switch (params->type)
+      {
+         case CHEAT_SEARCH_TYPE_EXACT:
+            ref = value;
+            break;
+         case CHEAT_SEARCH_TYPE_EQPLUS:
+            ref = cheat_search_add_sse2(p, value, bits);
+            break;
+         case CHEAT_SEARCH_TYPE_EQMINUS:
+            ref = cheat_search_sub_sse2(p, value, bits);
+            break;
+         default:
+            ref = p;
+            break;
+      }
+
+      switch (params->type)
+      {
+         case CHEAT_SEARCH_TYPE_LT:
+         case CHEAT_SEARCH_TYPE_GTE:
+            m = cheat_search_cmpgt_sse2(_mm_xor_si128(ref, bias),
+                  _mm_xor_si128(c, bias), bits);
+            if (params->type == CHEAT_SEARCH_TYPE_GTE)
+               m = _mm_xor_si128(m, ones);
+            break;
+         case CHEAT_SEARCH_TYPE_GT:
+         case CHEAT_SEARCH_TYPE_LTE:
+            m = cheat_search_cmpgt_sse2(_mm_xor_si128(c, bias),
+                  _mm_xor_si128(ref, bias), bits);
+            if (params->type == CHEAT_SEARCH_TYPE_LTE)
+               m = _mm_xor_si128(m, ones);
+            break;
+         case CHEAT_SEARCH_TYPE_NEQ:
+            m = _mm_xor_si128(cheat_search_cmpeq_sse2(c, ref, bits), ones);
+            break;
+         default:
+            m = cheat_search_cmpeq_sse2(c, ref, bits);
+            break;
+      }
+
+      if (check_wrap)
+      {
+         /* EQPLUS needs prev <= max - value, EQMINUS prev >= value */
+         __m128i wrapped = (params->type == CHEAT_SEARCH_TYPE_EQPLUS)
+            ? cheat_search_cmpgt_sse2(_mm_xor_si128(p, bias), limit, bits)
+            : cheat_search_cmpgt_sse2(limit, _mm_xor_si128(p, bias), bits);
+         m = _mm_andnot_si128(wrapped, m);
+      }
+
+      hits |= (uint64_t)cheat_search_movemask_sse2(m, bits) << i;
+   }
+
+   return hits;
+}
+#endif
+
+uint64_t cheat_search_compare(const struct cheat_search_params *params,
+      const uint8_t *curr, const uint8_t *prev, unsigned count)
+{
+   unsigned max = (params->bits >= 32) ? 0xFFFFFFFF
+      : (1U << params->bits) - 1;
+
+   /* An operand wider than the item can never match */
+   switch (params->type)
+   {
+      case CHEAT_SEARCH_TYPE_EXACT:
+      case CHEAT_SEARCH_TYPE_EQPLUS:
+      case CHEAT_SEARCH_TYPE_EQMINUS:
+         if (params->value > max)
+            return 0;
+         break;
+      default:
+         break;
+   }
+
+   if (count == CHEAT_SEARCH_GROUP_SIZE)
+   {
+      switch (params->bits)
+      {
+         case 1:
+            return cheat_search_compare_1(params, curr, prev);
+#if defined(__SSE2__)
+         case 8:
+            return cheat_search_compare_sse2(params, curr, prev, 8);
+         case 16:
+            return cheat_search_compare_sse2(params, curr, prev, 16);
+         case 32:
+            return cheat_search_compare_sse2(params, curr, prev, 32);
+#endif
+         default:
+            break;
+      }
+   }
+
+   return cheat_search_compare_scalar(params, curr, prev, count);
+}
@@ -0,0 +1,110 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CHEAT_SEARCH_H
+#define __CHEAT_SEARCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Number of items compared per call; one bit each in a match word */
+#define CHEAT_SEARCH_GROUP_SIZE 64
+
+enum cheat_search_type
+{
+   CHEAT_SEARCH_TYPE_EXACT = 0,
+   CHEAT_SEARCH_TYPE_LT,
+   CHEAT_SEARCH_TYPE_LTE,
+   CHEAT_SEARCH_TYPE_GT,
+   CHEAT_SEARCH_TYPE_GTE,
+   CHEAT_SEARCH_TYPE_EQ,
+   CHEAT_SEARCH_TYPE_NEQ,
+   CHEAT_SEARCH_TYPE_EQPLUS,
+   CHEAT_SEARCH_TYPE_EQMINUS
+};
+
+struct cheat_search_params
+{
+   enum cheat_search_type type;
+   /* Operand of EXACT, EQPLUS and EQMINUS searches */
+   unsigned value;
+   /* Item width in bits: 1, 2, 4, 8, 16 or 32 */
+   unsigned bits;
+   bool big_endian;
+};
+
+/**
+ * cheat_search_compare:
+ * @params            : search to run.
+ * @curr              : current memory, starting at the byte
+ *                      holding the first item.
+ * @prev              : memory as of the previous search,
+ *                      laid out the same way.
+ * @count             : number of items, at most CHEAT_SEARCH_GROUP_SIZE.
+ *
+ * Compares a run of consecutive items. Items narrower than a byte
+ * are numbered from the least significant bits of each byte up.
+ *
+ * Returns: bit N set if item N satisfies the search.
+ **/
+uint64_t cheat_search_compare(const struct cheat_search_params *params,
+      const uint8_t *curr, const uint8_t *prev, unsigned count);
+
+/**
+ * cheat_search_compare_scalar:
+ *
+ * Plain C version of cheat_search_compare(), one item at a time.
+ * Used for partial groups and as the reference for the SIMD kernels.
+ **/
+uint64_t cheat_search_compare_scalar(const struct cheat_search_params *params,
+      const uint8_t *curr, const uint8_t *prev, unsigned count);
+
+/**
+ * cheat_search_read:
+ * @data              : first byte of the value.
+ * @bytes             : size of the value; 1, 2 or 4.
+ * @big_endian        : whether the value is stored big-endian.
+ *
+ * Returns: the value at @data.
+ **/
+unsigned cheat_search_read(const uint8_t *data, unsigned bytes,
+      bool big_endian);
+
+/**
+ * cheat_search_count:
+ *
+ * Returns: number of set bits in @word.
+ **/
+unsigned cheat_search_count(uint64_t word);
+
+/**
+ * cheat_search_nth:
+ * @word              : match word.
+ * @n                 : zero-based index among the set bits.
+ *
+ * Returns: position of the @n-th set bit of @word;
+ * @n must be lower than cheat_search_count(@word).
+ **/
+unsigned cheat_search_nth(uint64_t word, unsigned n);
+
+RETRO_END_DECLS
+
+#endif
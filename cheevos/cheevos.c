@@ -26,6 +26,7 @@
 #include <formats/m3u_file.h>
 #include <compat/strl.h>
 #include <retro_miscellaneous.h>
+#include <retro_inline.h>
 #include <retro_math.h>
 #include <retro_timers.h>
 #include <net/net_http.h>
@@ -90,6 +91,7 @@ static rcheevos_locals_t rcheevos_locals =
    {0},  /* game */
 #endif
    {{0}},/* memory */
+   {0},  /* pages */
 #ifdef HAVE_THREADS
    CMD_EVENT_NONE, /* queued_command */
    false, /* game_placard_requested */
@@ -133,6 +135,11 @@ rcheevos_locals_t* get_rcheevos_locals(void)
 
 #define CHEEVOS_MB(x)   ((x) * 1024 * 1024)
 
+/* Memory page table bounds: 256 byte pages at least,
+ * and no more than 64K pages in the table */
+#define RCHEEVOS_PAGE_SHIFT_MIN 8
+#define RCHEEVOS_PAGES_MAX      0x10000
+
 /*****************************************************************************
 Supporting functions.
 *****************************************************************************/
@@ -203,6 +210,87 @@ static void rcheevos_get_core_memory_info(uint32_t id,
    }
 }
 
+static void rcheevos_free_memory_pages(rcheevos_memory_pages_t* pages)
+{
+   if (pages->data)
+      free(pages->data);
+   pages->data  = NULL;
+   pages->count = 0;
+}
+
+/* Achievement sets read thousands of addresses each frame, and walking
+ * the region list for every one of them adds up. Map each page that
+ * sits entirely inside one region straight to its host memory; pages
+ * straddling two regions, or backed by no memory, keep using
+ * rc_libretro_memory_read(). */
+static void rcheevos_init_memory_pages(rcheevos_memory_pages_t* pages,
+      const rc_libretro_memory_regions_t* regions)
+{
+   unsigned i;
+   size_t total      = 0;
+   size_t start      = 0;
+   uint32_t shift    = RCHEEVOS_PAGE_SHIFT_MIN;
+   uint32_t count;
+   uint32_t direct   = 0;
+
+   rcheevos_free_memory_pages(pages);
+
+   for (i = 0; i < regions->count; i++)
+      total += regions->size[i];
+   if (total == 0)
+      return;
+
+   /* Small pages keep tiny regions (and odd-sized ones) addressable
+    * directly; grow them for large address spaces to cap the table */
+   while (((total + ((size_t)1 << shift) - 1) >> shift) > RCHEEVOS_PAGES_MAX)
+      shift++;
+   count = (uint32_t)((total + ((size_t)1 << shift) - 1) >> shift);
+
+   if (!(pages->data = (uint8_t**)calloc(count, sizeof(*pages->data))))
+      return;
+
+   for (i = 0; i < regions->count; i++)
+   {
+      size_t size  = regions->size[i];
+      size_t first = (start + ((size_t)1 << shift) - 1) >> shift;
+      size_t last  = (start + size) >> shift;
+      size_t page;
+
+      if (regions->data[i])
+      {
+         for (page = first; page < last; page++)
+            pages->data[page] = regions->data[i]
+               + ((page << shift) - start);
+         if (last > first)
+            direct += (uint32_t)(last - first);
+      }
+
+      start += size;
+   }
+
+   pages->count = count;
+   pages->shift = shift;
+
+   CHEEVOS_LOG(RCHEEVOS_TAG "Memory page table: %u pages of %u bytes, %u direct\n",
+         count, 1U << shift, direct);
+}
+
+/* Returns the host address of @num_bytes bytes at @address, or NULL
+ * if they are not all inside one directly mapped page */
+static INLINE uint8_t* rcheevos_memory_page_find(
+      const rcheevos_memory_pages_t* pages,
+      uint32_t address, uint32_t num_bytes)
+{
+   uint32_t page   = address >> pages->shift;
+   uint32_t offset = address & ((1U << pages->shift) - 1);
+
+   if (     page < pages->count
+         && offset + num_bytes <= (1U << pages->shift)
+         && pages->data[page])
+      return pages->data[page] + offset;
+   return NULL;
+}
+
 static int rcheevos_init_memory(rcheevos_locals_t* locals)
 {
    unsigned i;
@@ -242,15 +330,26 @@ static int rcheevos_init_memory(rcheevos_locals_t* locals)
          rcheevos_get_core_memory_info, console_id);
 
    free(descriptors);
+
+   if (result)
+      rcheevos_init_memory_pages(&locals->pages, &locals->memory);
+   else
+      rcheevos_free_memory_pages(&locals->pages);
+
    return result;
 }
 
 uint8_t* rcheevos_patch_address(unsigned address)
 {
+   uint8_t* data;
+
    /* Memory map was not previously initialized
     * (no achievements for this game?), try now */
    if (rcheevos_locals.memory.count == 0)
       rcheevos_init_memory(&rcheevos_locals);
+
+   if ((data = rcheevos_memory_page_find(&rcheevos_locals.pages, address, 1)))
+      return data;
    return rc_libretro_memory_find(&rcheevos_locals.memory, address);
 }
 
@@ -259,9 +358,13 @@ uint8_t* rcheevos_patch_address(unsigned address)
 static uint32_t rcheevos_peek(uint32_t address,
       uint32_t num_bytes, void* ud)
 {
-   uint32_t avail;
-   uint8_t* data = rc_libretro_memory_find_avail(
-         &rcheevos_locals.memory, address, &avail);
+   uint32_t avail = num_bytes;
+   uint8_t* data  = rcheevos_memory_page_find(
+         &rcheevos_locals.pages, address, num_bytes);
+
+   if (!data)
+      data = rc_libretro_memory_find_avail(
+            &rcheevos_locals.memory, address, &avail);
 
    if (data && avail >= num_bytes)
    {
@@ -1311,6 +1414,7 @@ bool rcheevos_unload(void)
 
    if (rcheevos_locals.memory.count > 0)
       rc_libretro_memory_destroy(&rcheevos_locals.memory);
+   rcheevos_free_memory_pages(&rcheevos_locals.pages);
 
    if (was_loaded)
    {
@@ -2004,7 +2108,15 @@ void rcheevos_test(void)
 
 #ifdef HAVE_RC_CLIENT
    if (rcheevos_locals.memory.count != 0)
+   {
+      static struct retro_perf_counter rcheevos_do_frame = {0};
+      bool perfcnt_enable = runloop_state_get_ptr()->perfcnt_enable;
+
+      performance_counter_init(rcheevos_do_frame, "rcheevos_do_frame");
+      performance_counter_start_plus(perfcnt_enable, rcheevos_do_frame);
       rc_client_do_frame(rcheevos_locals.client);
+      performance_counter_stop_plus(perfcnt_enable, rcheevos_do_frame);
+   }
    else
       rc_client_idle(rcheevos_locals.client);
 #else
@@ -2022,8 +2134,16 @@ void rcheevos_test(void)
          return;
    }
 
-   rc_runtime_do_frame(&rcheevos_locals.runtime,
-         &rcheevos_runtime_event_handler, rcheevos_peek, NULL, 0);
+   {
+      static struct retro_perf_counter rcheevos_do_frame = {0};
+      bool perfcnt_enable = runloop_state_get_ptr()->perfcnt_enable;
+
+      performance_counter_init(rcheevos_do_frame, "rcheevos_do_frame");
+      performance_counter_start_plus(perfcnt_enable, rcheevos_do_frame);
+      rc_runtime_do_frame(&rcheevos_locals.runtime,
+            &rcheevos_runtime_event_handler, rcheevos_peek, NULL, 0);
+      performance_counter_stop_plus(perfcnt_enable, rcheevos_do_frame);
+   }
 
  #ifdef HAVE_GFX_WIDGETS
    if (rcheevos_locals.assign_new_trackers)
@@ -2395,6 +2515,27 @@ static void rcheevos_show_game_placard(void)
 static uint32_t rcheevos_client_read_memory(uint32_t address,
    uint8_t* buffer, uint32_t num_bytes, rc_client_t* client)
 {
+   const uint8_t* data = rcheevos_memory_page_find(
+         &rcheevos_locals.pages, address, num_bytes);
+
+   if (data)
+   {
+      switch (num_bytes)
+      {
+         case 1:
+            buffer[0] = data[0];
+            break;
+         case 2:
+            buffer[0] = data[0];
+            buffer[1] = data[1];
+            break;
+         default:
+            memcpy(buffer, data, num_bytes);
+            break;
+      }
+      return num_bytes;
+   }
+
    return rc_libretro_memory_read(&rcheevos_locals.memory, address, buffer, num_bytes);
 }
 
@@ -189,6 +189,16 @@ typedef struct rcheevos_menuitem_t
 
 #endif /* HAVE_RC_CLIENT */
 
+/* Flat page table mapping achievement addresses to host pointers.
+ * Only pages that lie entirely inside one exposed memory region
+ * get an entry; everything else goes through rc_libretro_memory_read. */
+typedef struct rcheevos_memory_pages_t
+{
+   uint8_t** data;                    /* first byte of each page, NULL if not contiguous */
+   uint32_t count;                    /* number of pages */
+   uint32_t shift;                    /* log2 of the page size */
+} rcheevos_memory_pages_t;
+
 typedef struct rcheevos_locals_t
 {
 #ifdef HAVE_RC_CLIENT
@@ -198,6 +208,7 @@ typedef struct rcheevos_locals_t
    rcheevos_game_info_t game;         /* information about the current game */
 #endif
    rc_libretro_memory_regions_t memory;/* achievement addresses to core memory mappings */
+   rcheevos_memory_pages_t pages;     /* direct lookup table built from memory */
 
 #ifdef HAVE_THREADS
    enum event_command queued_command; /* action queued by background thread to be run on main thread */
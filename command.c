@@ -123,8 +123,9 @@ static bool command_get_arg(const char *tok,
          const char *argument = str + strlen(action_map[i].str);
          if (!argument)
             return false;
+         /* Only a prefix of a longer command name */
          if (*argument != ' ' && *argument != '\0')
-            return false;
+            continue;
 
          if (arg)
             *arg = argument + 1;
@@ -192,6 +193,29 @@ static void network_command_reply(
       (struct sockaddr*)&netcmd->cmd_source, netcmd->cmd_source_len);
 }
 
+static size_t network_command_get_target(
+      command_t *cmd, void *target, size_t len)
+{
+   command_network_t *netcmd = (command_network_t*)cmd->userptr;
+   size_t _len               = netcmd->cmd_source_len;
+
+   if (_len > len)
+      return 0;
+   memcpy(target, &netcmd->cmd_source, _len);
+   return _len;
+}
+
+static bool network_command_send_to(
+      command_t *cmd, const void *target, size_t target_len,
+      const char *data, size_t len)
+{
+   command_network_t *netcmd = (command_network_t*)cmd->userptr;
+   /* Dropped datagrams are fine, the next frame sends fresh data */
+   sendto(netcmd->net_fd, data, len, 0,
+         (const struct sockaddr*)target, (socklen_t)target_len);
+   return true;
+}
+
 static void network_command_free(command_t *handle)
 {
    command_network_t *netcmd = (command_network_t*)handle->userptr;
@@ -199,6 +223,7 @@ static void network_command_free(command_t *handle)
    if (netcmd->net_fd >= 0)
       socket_close(netcmd->net_fd);
 
+   command_free_subscriptions(handle);
    free(netcmd);
    free(handle);
 }
@@ -248,6 +273,8 @@ command_t* command_network_new(uint16_t port)
    cmd->poll      = command_network_poll;
    cmd->replier   = network_command_reply;
    cmd->destroy   = network_command_free;
+   cmd->get_target= network_command_get_target;
+   cmd->send_to   = network_command_send_to;
 
    if (!socket_nonblock(netcmd->net_fd))
       goto error;
@@ -433,22 +460,162 @@ bool command_get_config_param(command_t *cmd, const char* arg)
 #if defined(HAVE_LAKKA)
 #include <sys/un.h>
 #define MAX_USER_CONNECTIONS  4
+/* Bytes a client may leave unread before it is disconnected */
+#define UDS_MAX_PENDING       (1024 * 1024)
 typedef struct
 {
+   /* Data the client socket did not accept yet */
+   char *pending;
+   size_t pending_len;
+   size_t pending_cap;
+   /* Client socket */
+   int fd;
+   /* Connection number, so saved reply targets of a closed
+    * client never reach a new one reusing its slot */
+   unsigned serial;
+} command_uds_client_t;
+
+typedef struct
+{
+   /* Reply target saved by subscriptions */
+   unsigned serial;
+   int slot;
+} command_uds_target_t;
+
+typedef struct
+{
+   command_uds_client_t user[MAX_USER_CONNECTIONS];
    /* File descriptor for the domain socket */
    int sfd;
-   /* Client sockets */
-   int userfd[MAX_USER_CONNECTIONS];
-   /* Last received user socket */
-   int last_fd;
+   /* Last received user slot */
+   int last_slot;
+   unsigned next_serial;
 } command_uds_t;
 
+static void uds_command_close(command_uds_t *udscmd, int slot)
+{
+   command_uds_client_t *user = &udscmd->user[slot];
+
+   socket_close(user->fd);
+   free(user->pending);
+   user->pending     = NULL;
+   user->pending_len = 0;
+   user->pending_cap = 0;
+   user->fd          = -1;
+}
+
+/* Writes out as much queued data as the socket takes */
+static bool uds_command_flush(command_uds_t *udscmd, int slot)
+{
+   command_uds_client_t *user = &udscmd->user[slot];
+   ssize_t ret;
+
+   if (!user->pending_len)
+      return true;
+
+   ret = send(user->fd, user->pending, user->pending_len, 0);
+   if (ret < 0)
+      return isagain((int)ret);
+
+   memmove(user->pending, user->pending + ret, user->pending_len - ret);
+   user->pending_len -= ret;
+   return true;
+}
+
+/* Sends to a client socket, queueing whatever it does not accept
+ * right away; replies are never cut short on a stream socket */
+static bool uds_command_send(command_uds_t *udscmd, int slot,
+      const char *data, size_t len)
+{
+   command_uds_client_t *user = &udscmd->user[slot];
+
+   if (user->fd < 0)
+      return false;
+
+   if (!uds_command_flush(udscmd, slot))
+      goto error;
+
+   if (!user->pending_len)
+   {
+      ssize_t ret = send(user->fd, data, len, 0);
+      if (ret < 0)
+      {
+         if (!isagain((int)ret))
+            goto error;
+         ret = 0;
+      }
+      data += ret;
+      len  -= ret;
+   }
+
+   if (!len)
+      return true;
+
+   if (user->pending_len + len > user->pending_cap)
+   {
+      char *pending;
+      size_t cap = user->pending_cap ? user->pending_cap : 4096;
+
+      while (cap < user->pending_len + len)
+         cap *= 2;
+      if (cap > UDS_MAX_PENDING)
+      {
+         RARCH_WARN("[UDS]: Client is not reading, disconnecting.\n");
+         goto error;
+      }
+      if (!(pending = (char*)realloc(user->pending, cap)))
+         goto error;
+      user->pending     = pending;
+      user->pending_cap = cap;
+   }
+
+   memcpy(user->pending + user->pending_len, data, len);
+   user->pending_len += len;
+   return true;
+
+error:
+   uds_command_close(udscmd, slot);
+   return false;
+}
+
 static void uds_command_reply(
       command_t *cmd,
       const char * data, size_t len)
 {
    command_uds_t *subcmd = (command_uds_t*)cmd->userptr;
-   write(subcmd->last_fd, data, len);
+   if (subcmd->last_slot >= 0)
+      uds_command_send(subcmd, subcmd->last_slot, data, len);
+}
+
+static size_t uds_command_get_target(
+      command_t *cmd, void *target, size_t len)
+{
+   command_uds_target_t _target;
+   command_uds_t *subcmd = (command_uds_t*)cmd->userptr;
+
+   if (subcmd->last_slot < 0 || len < sizeof(_target))
+      return 0;
+
+   /* Zero the padding too, targets are compared with memcmp */
+   memset(&_target, 0, sizeof(_target));
+   _target.slot   = subcmd->last_slot;
+   _target.serial = subcmd->user[subcmd->last_slot].serial;
+   memcpy(target, &_target, sizeof(_target));
+   return sizeof(_target);
+}
+
+static bool uds_command_send_to(
+      command_t *cmd, const void *target, size_t target_len,
+      const char *data, size_t len)
+{
+   command_uds_target_t _target;
+   command_uds_t *subcmd = (command_uds_t*)cmd->userptr;
+
+   memcpy(&_target, target, sizeof(_target));
+   if (     subcmd->user[_target.slot].fd < 0
+         || subcmd->user[_target.slot].serial != _target.serial)
+      return false;
+   return uds_command_send(subcmd, _target.slot, data, len);
 }
 
 static void uds_command_free(command_t *handle)
@@ -457,10 +624,11 @@ static void uds_command_free(command_t *handle)
    command_uds_t *udscmd = (command_uds_t*)handle->userptr;
 
    for (i = 0; i < MAX_USER_CONNECTIONS; i++)
-      if (udscmd->userfd[i] >= 0)
-         socket_close(udscmd->userfd[i]);
+      if (udscmd->user[i].fd >= 0)
+         uds_command_close(udscmd, i);
    socket_close(udscmd->sfd);
 
+   command_free_subscriptions(handle);
    free(handle->userptr);
    free(handle);
 }
@@ -481,26 +649,29 @@ static void command_uds_poll(command_t *handle)
    {
       bool err = false;
 
-      fd = udscmd->userfd[i];
+      fd = udscmd->user[i].fd;
       if (fd < 0)
          continue;
 
+      if (!uds_command_flush(udscmd, i))
+      {
+         uds_command_close(udscmd, i);
+         continue;
+      }
+
       ret = socket_receive_all_nonblocking(fd, &err, buf, sizeof(buf) - 1);
       if (!ret)
          continue;
 
       if (!err)
       {
-         buf[ret]        = '\0';
-         udscmd->last_fd = fd;
+         buf[ret]          = '\0';
+         udscmd->last_slot = i;
 
          command_parse_msg(handle, buf);
       }
       else
-      {
-         socket_close(fd);
-         udscmd->userfd[i] = -1;
-      }
+         uds_command_close(udscmd, i);
    }
 
    /* Accepts new connections from clients */
@@ -511,9 +682,10 @@ static void command_uds_poll(command_t *handle)
       {
          for (i = 0; i < MAX_USER_CONNECTIONS; i++)
          {
-            if (udscmd->userfd[i] < 0)
+            if (udscmd->user[i].fd < 0)
             {
-               udscmd->userfd[i] = fd;
+               udscmd->user[i].fd     = fd;
+               udscmd->user[i].serial = ++udscmd->next_serial;
                return;
             }
          }
@@ -554,15 +726,17 @@ command_t* command_uds_new(void)
 
    cmd             = (command_t*)calloc(1, sizeof(command_t));
    subcmd          = (command_uds_t*)calloc(1, sizeof(command_uds_t));
-   subcmd->sfd     = fd;
-   subcmd->last_fd = -1;
+   subcmd->sfd       = fd;
+   subcmd->last_slot = -1;
    for (i = 0; i < MAX_USER_CONNECTIONS; i++)
-      subcmd->userfd[i] = -1;
+      subcmd->user[i].fd = -1;
 
-   cmd->userptr = subcmd;
-   cmd->poll    = command_uds_poll;
-   cmd->replier = uds_command_reply;
-   cmd->destroy = uds_command_free;
+   cmd->userptr    = subcmd;
+   cmd->poll       = command_uds_poll;
+   cmd->replier    = uds_command_reply;
+   cmd->destroy    = uds_command_free;
+   cmd->get_target = uds_command_get_target;
+   cmd->send_to    = uds_command_send_to;
 
    return cmd;
 }
@@ -1033,6 +1207,448 @@ bool command_write_memory(command_t *cmd, const char *arg)
    cmd->replier(cmd, reply, strlen(reply));
    return true;
 }
+
+static uint8_t *command_memory_put32(uint8_t *p, uint32_t v)
+{
+   p[0] = (uint8_t)(v >> 24);
+   p[1] = (uint8_t)(v >> 16);
+   p[2] = (uint8_t)(v >>  8);
+   p[3] = (uint8_t)(v);
+   return p + 4;
+}
+
+/* Parses "<address> <number of bytes> ..." pairs.
+ * Returns the number of ranges, 0 if malformed or over the limits. */
+static unsigned command_memory_parse_ranges(const char *arg,
+      command_memory_range_t *ranges)
+{
+   unsigned num_ranges = 0;
+   size_t total        = 0;
+
+   for (;;)
+   {
+      char *end;
+      unsigned address, len;
+
+      while (*arg == ' ')
+         arg++;
+      if (!*arg)
+         break;
+      if (num_ranges >= COMMAND_MEMORY_MAX_RANGES)
+         return 0;
+
+      address = (unsigned)strtoul(arg, &end, 16);
+      if (end == arg || *end != ' ')
+         return 0;
+      arg     = end;
+      len     = (unsigned)strtoul(arg, &end, 10);
+      if (end == arg || len == 0)
+         return 0;
+      arg     = end;
+
+      total  += len;
+      if (total > COMMAND_MEMORY_MAX_BYTES)
+         return 0;
+
+      ranges[num_ranges].address = address;
+      ranges[num_ranges].len     = len;
+      num_ranges++;
+   }
+
+   return num_ranges;
+}
+
+/* Builds the binary reply of READ_CORE_MEMORY_BATCH and of each
+ * SUBSCRIBE_CORE_MEMORY frame. All fields are in network byte order:
+ *
+ *   "RMEM"
+ *   uint32 subscription id, 0 for READ_CORE_MEMORY_BATCH
+ *   uint32 frame count, high word
+ *   uint32 frame count, low word
+ *   uint32 number of ranges
+ *   for each range:
+ *      uint32 address
+ *      uint32 number of bytes that follow
+ *      bytes
+ *
+ * A range gets fewer bytes than asked for when it runs past the end of
+ * its memory descriptor, and none when the address is not mapped.
+ * Returns a malloc'ed packet and its size in @len. */
+static uint8_t *command_memory_pack(uint32_t id,
+      const command_memory_range_t *ranges, unsigned num_ranges,
+      size_t *len)
+{
+   unsigned i;
+   uint8_t *buf, *p;
+   size_t _len                       = 20;
+   runloop_state_t *runloop_st       = runloop_state_get_ptr();
+   video_driver_state_t *video_st    = video_state_get_ptr();
+   const rarch_system_info_t *sys_info = &runloop_st->system;
+   uint64_t frame                    = video_st->frame_count;
+
+   for (i = 0; i < num_ranges; i++)
+      _len += 8 + ranges[i].len;
+
+   if (!(buf = (uint8_t*)malloc(_len)))
+      return NULL;
+
+   memcpy(buf, "RMEM", 4);
+   p = command_memory_put32(buf + 4, id);
+   p = command_memory_put32(p, (uint32_t)(frame >> 32));
+   p = command_memory_put32(p, (uint32_t)frame);
+   p = command_memory_put32(p, num_ranges);
+
+   for (i = 0; i < num_ranges; i++)
+   {
+      char error[64];
+      unsigned int max_bytes = 0;
+      unsigned int nbytes    = ranges[i].len;
+      const uint8_t *data    = command_memory_get_pointer(
+            sys_info, ranges[i].address, &max_bytes,
+            0, error, sizeof(error));
+
+      if (nbytes > max_bytes)
+         nbytes = max_bytes;
+
+      p = command_memory_put32(p, ranges[i].address);
+      p = command_memory_put32(p, nbytes);
+      if (data)
+         memcpy(p, data, nbytes);
+      p += nbytes;
+   }
+
+   *len = p - buf;
+   return buf;
+}
+
+bool command_read_memory_batch(command_t *cmd, const char *arg)
+{
+   size_t _len;
+   uint8_t *packet;
+   command_memory_range_t ranges[COMMAND_MEMORY_MAX_RANGES];
+   unsigned num_ranges = command_memory_parse_ranges(arg, ranges);
+
+   if (!num_ranges)
+   {
+      static const char reply[] = "READ_CORE_MEMORY_BATCH -1\n";
+      cmd->replier(cmd, reply, STRLEN_CONST(reply));
+      return false;
+   }
+
+   if (!(packet = command_memory_pack(0, ranges, num_ranges, &_len)))
+      return false;
+
+   cmd->replier(cmd, (const char*)packet, _len);
+   free(packet);
+   return true;
+}
+
+/* Builds a change record of a WATCH_CORE_MEMORY subscription. It is
+ * laid out like the packets of command_memory_pack(), with the magic
+ * "RMCH", but each entry is a run of bytes that changed since the
+ * previous record; the first record holds all bytes. Changes less
+ * than 8 bytes apart share a run, as a new entry costs 8 bytes.
+ * Returns NULL when nothing changed. */
+static uint8_t *command_memory_pack_changes(
+      command_memory_subscription_t *s, size_t *len)
+{
+   unsigned i;
+   uint8_t *buf, *p;
+   uint8_t *shadow                   = s->shadow;
+   uint32_t num_runs                 = 0;
+   size_t _len                       = 20;
+   runloop_state_t *runloop_st       = runloop_state_get_ptr();
+   video_driver_state_t *video_st    = video_state_get_ptr();
+   const rarch_system_info_t *sys_info = &runloop_st->system;
+   uint64_t frame                    = video_st->frame_count;
+
+   /* Runs are at least 8 bytes apart, so no range takes more
+    * room than it would in a full packet */
+   for (i = 0; i < s->num_ranges; i++)
+      _len += 8 + s->ranges[i].len;
+
+   if (!(buf = (uint8_t*)malloc(_len)))
+      return NULL;
+
+   memcpy(buf, "RMCH", 4);
+   p = command_memory_put32(buf + 4, s->id);
+   p = command_memory_put32(p, (uint32_t)(frame >> 32));
+   p = command_memory_put32(p, (uint32_t)frame);
+   p += 4;
+
+   for (i = 0; i < s->num_ranges; i++)
+   {
+      char error[64];
+      unsigned j;
+      unsigned int max_bytes = 0;
+      unsigned int nbytes    = s->ranges[i].len;
+      const uint8_t *data    = command_memory_get_pointer(
+            sys_info, s->ranges[i].address, &max_bytes,
+            0, error, sizeof(error));
+
+      if (!data)
+         nbytes = 0;
+      else if (nbytes > max_bytes)
+         nbytes = max_bytes;
+
+      if (!(s->flags & COMMAND_MEMORY_FLAG_PRIMED))
+      {
+         if (nbytes)
+         {
+            p = command_memory_put32(p, s->ranges[i].address);
+            p = command_memory_put32(p, nbytes);
+            memcpy(p, data, nbytes);
+            p += nbytes;
+            num_runs++;
+         }
+      }
+      else if (nbytes && memcmp(data, shadow, nbytes))
+      {
+         for (j = 0; j < nbytes; )
+         {
+            unsigned first, last;
+
+            if (data[j] == shadow[j])
+            {
+               j++;
+               continue;
+            }
+
+            first = last = j++;
+            for (; j < nbytes && j - last <= 8; j++)
+               if (data[j] != shadow[j])
+                  last = j;
+
+            p = command_memory_put32(p, s->ranges[i].address + first);
+            p = command_memory_put32(p, last - first + 1);
+            memcpy(p, data + first, last - first + 1);
+            p += last - first + 1;
+            num_runs++;
+         }
+      }
+
+      if (nbytes)
+         memcpy(shadow, data, nbytes);
+      shadow += s->ranges[i].len;
+   }
+
+   s->flags |= COMMAND_MEMORY_FLAG_PRIMED;
+
+   if (!num_runs)
+   {
+      free(buf);
+      return NULL;
+   }
+
+   command_memory_put32(buf + 16, num_runs);
+   *len = p - buf;
+   return buf;
+}
+
+static void command_memory_remove_subscription(command_t *cmd, unsigned i)
+{
+   free(cmd->subscriptions[i].shadow);
+   cmd->subscriptions[i] = cmd->subscriptions[--cmd->num_subscriptions];
+   /* The moved entry owns its shadow now */
+   memset(&cmd->subscriptions[cmd->num_subscriptions], 0,
+         sizeof(*cmd->subscriptions));
+}
+
+static bool command_memory_subscribe(command_t *cmd, const char *arg,
+      const char *name, bool watch)
+{
+   char reply[64];
+   unsigned i;
+   char *end;
+   uint8_t target[COMMAND_TARGET_SIZE];
+   command_memory_range_t ranges[COMMAND_MEMORY_MAX_RANGES];
+   unsigned num_ranges                  = 0;
+   size_t target_len                    = 0;
+   size_t shadow_size                   = 0;
+   uint8_t *shadow                      = NULL;
+   command_memory_subscription_t *sub   = NULL;
+   unsigned id                          = (unsigned)strtoul(arg, &end, 10);
+   video_driver_state_t *video_st       = video_state_get_ptr();
+
+   if (     end == arg
+         || !cmd->get_target
+         || !(target_len = cmd->get_target(cmd, target, sizeof(target)))
+         || !(num_ranges = command_memory_parse_ranges(end, ranges)))
+      goto error;
+
+   if (watch)
+   {
+      for (i = 0; i < num_ranges; i++)
+         shadow_size += ranges[i].len;
+      if (!(shadow = (uint8_t*)malloc(shadow_size)))
+         goto error;
+   }
+
+   if (!cmd->subscriptions)
+   {
+      if (!(cmd->subscriptions = (command_memory_subscription_t*)calloc(
+            COMMAND_MEMORY_MAX_SUBSCRIPTIONS, sizeof(*cmd->subscriptions))))
+      {
+         free(shadow);
+         goto error;
+      }
+   }
+
+   /* Subscribing again with the same id changes the ranges,
+    * or only renews the subscription when they are the same */
+   for (i = 0; i < cmd->num_subscriptions; i++)
+   {
+      command_memory_subscription_t *s = &cmd->subscriptions[i];
+      if (     s->id         == id
+            && s->target_len == target_len
+            && !memcmp(s->target, target, target_len))
+      {
+         sub = s;
+         break;
+      }
+   }
+
+   if (     sub
+         && sub->num_ranges == num_ranges
+         && (!sub->shadow) == (!shadow)
+         && !memcmp(sub->ranges, ranges, num_ranges * sizeof(*ranges)))
+   {
+      free(shadow);
+      sub->since = video_st->frame_count;
+      goto success;
+   }
+
+   if (!sub)
+   {
+      /* Clients that went away without unsubscribing can't be
+       * detected over UDP; make room by dropping the oldest one */
+      if (cmd->num_subscriptions >= COMMAND_MEMORY_MAX_SUBSCRIPTIONS)
+      {
+         unsigned oldest = 0;
+         for (i = 1; i < cmd->num_subscriptions; i++)
+            if (cmd->subscriptions[i].since < cmd->subscriptions[oldest].since)
+               oldest = i;
+         sub = &cmd->subscriptions[oldest];
+      }
+      else
+         sub = &cmd->subscriptions[cmd->num_subscriptions++];
+   }
+
+   free(sub->shadow);
+   memcpy(sub->ranges, ranges, num_ranges * sizeof(*ranges));
+   memcpy(sub->target, target, target_len);
+   sub->target_len = target_len;
+   sub->num_ranges = num_ranges;
+   sub->shadow     = shadow;
+   sub->flags      = 0;
+   sub->since      = video_st->frame_count;
+   sub->id         = id;
+
+success:
+   snprintf(reply, sizeof(reply), "%s %u %u\n", name, id, num_ranges);
+   cmd->replier(cmd, reply, strlen(reply));
+   return true;
+
+error:
+   snprintf(reply, sizeof(reply), "%s %u -1\n", name, id);
+   cmd->replier(cmd, reply, strlen(reply));
+   return false;
+}
+
+bool command_subscribe_memory(command_t *cmd, const char *arg)
+{
+   return command_memory_subscribe(cmd, arg,
+         "SUBSCRIBE_CORE_MEMORY", false);
+}
+
+bool command_watch_memory(command_t *cmd, const char *arg)
+{
+   return command_memory_subscribe(cmd, arg,
+         "WATCH_CORE_MEMORY", true);
+}
+
+bool command_unsubscribe_memory(command_t *cmd, const char *arg)
+{
+   char reply[64];
+   unsigned i;
+   uint8_t target[COMMAND_TARGET_SIZE];
+   size_t target_len = 0;
+   unsigned id       = (unsigned)strtoul(arg, NULL, 10);
+   int removed       = 0;
+
+   if (cmd->get_target)
+      target_len     = cmd->get_target(cmd, target, sizeof(target));
+
+   for (i = 0; i < cmd->num_subscriptions; )
+   {
+      command_memory_subscription_t *s = &cmd->subscriptions[i];
+      if (     s->id         == id
+            && s->target_len == target_len
+            && !memcmp(s->target, target, target_len))
+      {
+         command_memory_remove_subscription(cmd, i);
+         removed++;
+      }
+      else
+         i++;
+   }
+
+   snprintf(reply, sizeof(reply), "UNSUBSCRIBE_CORE_MEMORY %u %d\n",
+         id, removed ? 0 : -1);
+   cmd->replier(cmd, reply, strlen(reply));
+   return true;
+}
+
+void command_push_memory(command_t *cmd)
+{
+   unsigned i;
+   uint64_t frame_count = video_state_get_ptr()->frame_count;
+
+   for (i = 0; i < cmd->num_subscriptions; )
+   {
+      size_t _len;
+      uint8_t *packet;
+      command_memory_subscription_t *s = &cmd->subscriptions[i];
+
+      /* Not renewed by its client in time */
+      if (frame_count - s->since > COMMAND_MEMORY_SUBSCRIPTION_FRAMES)
+      {
+         command_memory_remove_subscription(cmd, i);
+         continue;
+      }
+
+      if (s->shadow)
+      {
+         /* Nothing changed */
+         if (!(packet = command_memory_pack_changes(s, &_len)))
+         {
+            i++;
+            continue;
+         }
+      }
+      else if (!(packet = command_memory_pack(s->id,
+               s->ranges, s->num_ranges, &_len)))
+         return;
+
+      if (cmd->send_to(cmd, s->target, s->target_len,
+               (const char*)packet, _len))
+         i++;
+      else /* Subscriber is gone */
+         command_memory_remove_subscription(cmd, i);
+
+      free(packet);
+   }
+}
+
+void command_free_subscriptions(command_t *cmd)
+{
+   unsigned i;
+   for (i = 0; i < cmd->num_subscriptions; i++)
+      free(cmd->subscriptions[i].shadow);
+   free(cmd->subscriptions);
+   cmd->subscriptions     = NULL;
+   cmd->num_subscriptions = 0;
+}
 #endif
 
 void command_event_set_volume(
@@ -287,11 +287,55 @@ struct cmd_map
    unsigned id;
 };
 
+/* Largest return address a driver can save for later replies */
+#define COMMAND_TARGET_SIZE               128
+/* Limits of SUBSCRIBE_CORE_MEMORY and READ_CORE_MEMORY_BATCH */
+#define COMMAND_MEMORY_MAX_SUBSCRIPTIONS  8
+#define COMMAND_MEMORY_MAX_RANGES         64
+/* Memory bytes per binary reply, so it fits in one UDP datagram */
+#define COMMAND_MEMORY_MAX_BYTES          60000
+/* Frames a subscription lasts without being renewed. UDP source
+ * addresses can be forged, so a single datagram must not start a
+ * stream that never ends. */
+#define COMMAND_MEMORY_SUBSCRIPTION_FRAMES 600
+
 struct command_handler;
 
 typedef void (*command_poller_t)(struct command_handler *cmd);
 typedef void (*command_replier_t)(struct command_handler *cmd, const char * data, size_t len);
 typedef void (*command_destructor_t)(struct command_handler *cmd);
+typedef size_t (*command_target_getter_t)(struct command_handler *cmd, void *target, size_t len);
+typedef bool (*command_sender_t)(struct command_handler *cmd, const void *target, size_t target_len, const char *data, size_t len);
+
+enum command_memory_flags
+{
+   /* The first change record, holding every byte, was sent */
+   COMMAND_MEMORY_FLAG_PRIMED = (1 << 0)
+};
+
+typedef struct command_memory_range
+{
+   unsigned address;
+   unsigned len;
+} command_memory_range_t;
+
+typedef struct command_memory_subscription
+{
+   command_memory_range_t ranges[COMMAND_MEMORY_MAX_RANGES];
+   /* Driver-specific return address of the subscriber */
+   uint8_t target[COMMAND_TARGET_SIZE];
+   size_t target_len;
+   /* Frame count of the last (re)subscription, the oldest one is
+    * replaced when full and any expires after
+    * COMMAND_MEMORY_SUBSCRIPTION_FRAMES */
+   uint64_t since;
+   /* Bytes sent in the last change record, NULL unless this
+    * is a WATCH_CORE_MEMORY subscription */
+   uint8_t *shadow;
+   unsigned num_ranges;
+   unsigned id;
+   uint8_t flags;
+} command_memory_subscription_t;
 
 struct command_handler
 {
@@ -301,8 +345,16 @@ struct command_handler
    command_replier_t replier;
    /* Interface to delete the underlying command */
    command_destructor_t destroy;
+   /* Interface to save the return address of the current request,
+    * NULL if the driver cannot send data that was not asked for */
+   command_target_getter_t get_target;
+   /* Interface to send data to a saved return address */
+   command_sender_t send_to;
    /* Underlying command storage */
    void *userptr;
+   /* Core memory sent after every frame, see SUBSCRIBE_CORE_MEMORY */
+   command_memory_subscription_t *subscriptions;
+   unsigned num_subscriptions;
    /* State received */
    bool state[RARCH_BIND_LIST_END];
 };
@@ -411,6 +463,18 @@ struct cmd_action_map
    const char *arg_desc;
 };
 
+/**
+ * command_push_memory:
+ * @cmd                  : Command interface.
+ *
+ * Sends the subscribed core memory ranges of every
+ * SUBSCRIBE_CORE_MEMORY client and drops subscriptions
+ * that weren't renewed in time. Called once per frame.
+ **/
+void command_push_memory(command_t *cmd);
+
+void command_free_subscriptions(command_t *cmd);
+
 bool command_version(command_t *cmd, const char* arg);
 bool command_get_status(command_t *cmd, const char* arg);
 bool command_get_config_param(command_t *cmd, const char* arg);
@@ -423,6 +487,10 @@ bool command_write_ram(command_t *cmd, const char *arg);
 #endif
 bool command_read_memory(command_t *cmd, const char *arg);
 bool command_write_memory(command_t *cmd, const char *arg);
+bool command_read_memory_batch(command_t *cmd, const char *arg);
+bool command_subscribe_memory(command_t *cmd, const char *arg);
+bool command_watch_memory(command_t *cmd, const char *arg);
+bool command_unsubscribe_memory(command_t *cmd, const char *arg);
 
 static const struct cmd_action_map action_map[] = {
 #if defined(HAVE_CG) || defined(HAVE_GLSL) || defined(HAVE_SLANG) || defined(HAVE_HLSL)
@@ -440,6 +508,11 @@ static const struct cmd_action_map action_map[] = {
 #endif
    { "READ_CORE_MEMORY", command_read_memory,      "<address> <number of bytes>" },
    { "WRITE_CORE_MEMORY",command_write_memory,     "<address> <byte1> <byte2> ..." },
+   /* Binary replies, see command_memory_pack() */
+   { "READ_CORE_MEMORY_BATCH", command_read_memory_batch, "<address> <number of bytes> ..." },
+   { "SUBSCRIBE_CORE_MEMORY", command_subscribe_memory, "<id> <address> <number of bytes> ..." },
+   { "WATCH_CORE_MEMORY", command_watch_memory, "<id> <address> <number of bytes> ..." },
+   { "UNSUBSCRIBE_CORE_MEMORY", command_unsubscribe_memory, "<id>" },
 
    { "LOAD_STATE_SLOT",command_load_state_slot, "<slot number>"},
    { "PLAY_REPLAY_SLOT",command_play_replay_slot, "<slot number>"},
@@ -1336,6 +1336,10 @@
 
 #define DEFAULT_NETPLAY_CHECK_FRAMES 600
 
+/* Milliseconds a netplay rollback replay may take per frame
+ * before the rest is spread over later frames, or 0 for no limit */
+#define DEFAULT_NETPLAY_REPLAY_BUDGET 0
+
 #define DEFAULT_NETPLAY_USE_MITM_SERVER false
 
 #define DEFAULT_NETPLAY_MITM_SERVER "nyc"
@@ -1407,6 +1411,9 @@
 #define DEFAULT_SAVESTATE_FILE_COMPRESSION true
 #endif
 
+/* zlib level (1-9) of compressed save state files */
+#define DEFAULT_SAVESTATE_FILE_COMPRESSION_LEVEL 6
+
 /* Slowmotion ratio. */
 #define DEFAULT_SLOWMOTION_RATIO 3.0f
 
@@ -218,6 +218,7 @@ typedef struct settings
       unsigned netplay_chat_color_msg;
       unsigned netplay_input_latency_frames_min;
       unsigned netplay_input_latency_frames_range;
+      unsigned netplay_replay_budget;
       unsigned netplay_share_digital;
       unsigned netplay_share_analog;
       unsigned bundle_assets_extract_version_current;
@@ -231,6 +232,7 @@ typedef struct settings
       unsigned replay_checkpoint_interval;
       unsigned replay_max_keep;
       unsigned savestate_max_keep;
+      unsigned savestate_file_compression_level;
       unsigned network_cmd_port;
       unsigned network_remote_base_port;
       unsigned keymapper_port;
@@ -45,6 +45,8 @@ RETRO_BEGIN_DECLS
 #define FILE_PATH_RTC_EXTENSION ".rtc"
 #define FILE_PATH_CHT_EXTENSION ".cht"
 #define FILE_PATH_SRM_EXTENSION ".srm"
+#define FILE_PATH_SRM_JOURNAL_EXTENSION ".journal"
+#define FILE_PATH_TMP_EXTENSION ".tmp"
 #define FILE_PATH_STATE_EXTENSION ".state"
 #define FILE_PATH_LPL_EXTENSION ".lpl"
 #define FILE_PATH_LPL_EXTENSION_NO_DOT "lpl"
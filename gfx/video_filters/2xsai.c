@@ -18,6 +18,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation twoxsai_get_implementation
 #define softfilter_thread_data twoxsai_softfilter_thread_data
@@ -37,6 +43,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   int simd;
 };
 
 struct filter_data
@@ -44,6 +51,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned twoxsai_generic_input_fmts(void)
@@ -80,6 +88,7 @@ static void *twoxsai_generic_create(const struct softfilter_config *config,
     * so force single threaded operation... */
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    return filt;
 }
 
@@ -207,8 +216,221 @@ static void twoxsai_generic_destroy(void *data)
          out += 2
 #endif
 
+/* Branchless SIMD kernels. Every lane evaluates all the cases
+ * of twoxsai_function and picks its products with compare masks;
+ * result_cb becomes the difference of two equality masks, which
+ * are -1 where the scalar comparison is false. A vector of pixels
+ * reads exactly the neighbours the scalar code reads for those
+ * pixels, so the kernels start at x = 0 and return the first
+ * column left to the scalar loop. The interpolation never carries
+ * across a lane, so its results are bit-identical. */
+#if defined(__SSE2__)
+#define TWOXSAI_HAVE_SIMD
+#define TWOXSAI_SIMD_FLAG SOFTFILTER_SIMD_SSE2
+
+typedef __m128i twoxsai_vec32_t;
+typedef __m128i twoxsai_vec16_t;
+
+#define twoxsai_vec_load(bits, p)         _mm_loadu_si128((const __m128i*)(p))
+#define twoxsai_vec_store2(bits, p, a, b) \
+   _mm_storeu_si128((__m128i*)(p), _mm_unpacklo_epi##bits(a, b)); \
+   _mm_storeu_si128((__m128i*)(p) + 1, _mm_unpackhi_epi##bits(a, b))
+#define twoxsai_vec_dup(bits, v)          _mm_set1_epi##bits((int##bits##_t)(v))
+#define twoxsai_vec_eq(bits, a, b)        _mm_cmpeq_epi##bits(a, b)
+#define twoxsai_vec_and(bits, a, b)       _mm_and_si128(a, b)
+#define twoxsai_vec_or(bits, a, b)        _mm_or_si128(a, b)
+#define twoxsai_vec_andnot(bits, a, b)    _mm_andnot_si128(b, a)
+#define twoxsai_vec_select(bits, m, a, b) \
+   _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define twoxsai_vec_add(bits, a, b)       _mm_add_epi##bits(a, b)
+#define twoxsai_vec_sub(bits, a, b)       _mm_sub_epi##bits(a, b)
+#define twoxsai_vec_shr(bits, a, n)       _mm_srli_epi##bits(a, n)
+#define twoxsai_vec_gtz(bits, a)          _mm_cmpgt_epi##bits(a, _mm_setzero_si128())
+#define twoxsai_vec_ltz(bits, a)          _mm_cmplt_epi##bits(a, _mm_setzero_si128())
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define TWOXSAI_HAVE_SIMD
+#define TWOXSAI_SIMD_FLAG SOFTFILTER_SIMD_NEON
+
+typedef uint32x4_t twoxsai_vec32_t;
+typedef uint16x8_t twoxsai_vec16_t;
+
+#define twoxsai_vec_load(bits, p)         vld1q_u##bits(p)
+#define twoxsai_vec_store2(bits, p, a, b) \
+   vst1q_u##bits(p, vzipq_u##bits(a, b).val[0]); \
+   vst1q_u##bits((p) + 128 / bits, vzipq_u##bits(a, b).val[1])
+#define twoxsai_vec_dup(bits, v)          vdupq_n_u##bits(v)
+#define twoxsai_vec_eq(bits, a, b)        vceqq_u##bits(a, b)
+#define twoxsai_vec_and(bits, a, b)       vandq_u##bits(a, b)
+#define twoxsai_vec_or(bits, a, b)        vorrq_u##bits(a, b)
+#define twoxsai_vec_andnot(bits, a, b)    vbicq_u##bits(a, b)
+#define twoxsai_vec_select(bits, m, a, b) vbslq_u##bits(m, a, b)
+#define twoxsai_vec_add(bits, a, b)       vaddq_u##bits(a, b)
+#define twoxsai_vec_sub(bits, a, b)       vsubq_u##bits(a, b)
+#define twoxsai_vec_shr(bits, a, n)       vshrq_n_u##bits(a, n)
+#define twoxsai_vec_gtz(bits, a) \
+   vcgtq_s##bits(vreinterpretq_s##bits##_u##bits(a), vdupq_n_s##bits(0))
+#define twoxsai_vec_ltz(bits, a) \
+   vcltq_s##bits(vreinterpretq_s##bits##_u##bits(a), vdupq_n_s##bits(0))
+#endif
+
+#ifdef TWOXSAI_HAVE_SIMD
+#define twoxsai_vec_interpolate(bits, A, B, hi, lo) \
+   twoxsai_vec_add(bits, twoxsai_vec_add(bits, \
+         twoxsai_vec_shr(bits, twoxsai_vec_and(bits, A, twoxsai_vec_dup(bits, hi)), 1), \
+         twoxsai_vec_shr(bits, twoxsai_vec_and(bits, B, twoxsai_vec_dup(bits, hi)), 1)), \
+         twoxsai_vec_and(bits, twoxsai_vec_and(bits, A, B), twoxsai_vec_dup(bits, lo)))
+
+#define twoxsai_vec_interpolate2(bits, A, B, C, D, hi, lo) \
+   twoxsai_vec_add(bits, twoxsai_vec_add(bits, twoxsai_vec_add(bits, twoxsai_vec_add(bits, \
+         twoxsai_vec_shr(bits, twoxsai_vec_and(bits, A, twoxsai_vec_dup(bits, hi)), 2), \
+         twoxsai_vec_shr(bits, twoxsai_vec_and(bits, B, twoxsai_vec_dup(bits, hi)), 2)), \
+         twoxsai_vec_shr(bits, twoxsai_vec_and(bits, C, twoxsai_vec_dup(bits, hi)), 2)), \
+         twoxsai_vec_shr(bits, twoxsai_vec_and(bits, D, twoxsai_vec_dup(bits, hi)), 2)), \
+         twoxsai_vec_and(bits, twoxsai_vec_shr(bits, \
+            twoxsai_vec_add(bits, twoxsai_vec_add(bits, twoxsai_vec_add(bits, \
+            twoxsai_vec_and(bits, A, twoxsai_vec_dup(bits, lo)), \
+            twoxsai_vec_and(bits, B, twoxsai_vec_dup(bits, lo))), \
+            twoxsai_vec_and(bits, C, twoxsai_vec_dup(bits, lo))), \
+            twoxsai_vec_and(bits, D, twoxsai_vec_dup(bits, lo))), 2), \
+            twoxsai_vec_dup(bits, lo)))
+
+#define twoxsai_vec_interpolate_xrgb8888(A, B) twoxsai_vec_interpolate(32, A, B, 0xFEFEFEFE, 0x01010101)
+#define twoxsai_vec_interpolate2_xrgb8888(A, B, C, D) twoxsai_vec_interpolate2(32, A, B, C, D, 0xFCFCFCFC, 0x03030303)
+#define twoxsai_vec_interpolate_rgb565(A, B) twoxsai_vec_interpolate(16, A, B, 0xF7DE, 0x0821)
+#define twoxsai_vec_interpolate2_rgb565(A, B, C, D) twoxsai_vec_interpolate2(16, A, B, C, D, 0xE79C, 0x1863)
+
+/* All ones in lanes where the scalar result_cb term for X is 0 */
+#define twoxsai_vec_same(bits, X, C, D) \
+   twoxsai_vec_and(bits, twoxsai_vec_eq(bits, X, C), twoxsai_vec_eq(bits, X, D))
+
+#define twoxsai_vec_result(bits, A, B, C, D) \
+   twoxsai_vec_sub(bits, twoxsai_vec_same(bits, A, C, D), twoxsai_vec_same(bits, B, C, D))
+
+#define twoxsai_vec_declare_variables(vec_t, bits, in, nextline) \
+         const vec_t colorI = twoxsai_vec_load(bits, in - nextline - 1); \
+         const vec_t colorE = twoxsai_vec_load(bits, in - nextline + 0); \
+         const vec_t colorF = twoxsai_vec_load(bits, in - nextline + 1); \
+         const vec_t colorJ = twoxsai_vec_load(bits, in - nextline + 2); \
+         const vec_t colorG = twoxsai_vec_load(bits, in - 1); \
+         const vec_t colorA = twoxsai_vec_load(bits, in + 0); \
+         const vec_t colorB = twoxsai_vec_load(bits, in + 1); \
+         const vec_t colorK = twoxsai_vec_load(bits, in + 2); \
+         const vec_t colorH = twoxsai_vec_load(bits, in + nextline - 1); \
+         const vec_t colorC = twoxsai_vec_load(bits, in + nextline + 0); \
+         const vec_t colorD = twoxsai_vec_load(bits, in + nextline + 1); \
+         const vec_t colorL = twoxsai_vec_load(bits, in + nextline + 2); \
+         const vec_t colorM = twoxsai_vec_load(bits, in + nextline + nextline - 1); \
+         const vec_t colorN = twoxsai_vec_load(bits, in + nextline + nextline + 0); \
+         const vec_t colorO = twoxsai_vec_load(bits, in + nextline + nextline + 1)
+
+/* case1: A == D && B != C, case2: B == C && A != D,
+ * case3: A == D && B == C, anything else is the last case.
+ * The A == B subcase of case3 needs no mask of its own, since
+ * all four pixels are equal and both interpolations return A.
+ * keepA/keepB (and keep1A/keep1C) disagree on B == E (G == C),
+ * so the else-if chains of the last case need no priority mask. */
+#define twoxsai_vec_function(vec_t, bits, interpolate_cb, interpolate2_cb) \
+         const vec_t eqAD     = twoxsai_vec_eq(bits, colorA, colorD); \
+         const vec_t eqBC     = twoxsai_vec_eq(bits, colorB, colorC); \
+         const vec_t case1    = twoxsai_vec_andnot(bits, eqAD, eqBC); \
+         const vec_t case2    = twoxsai_vec_andnot(bits, eqBC, eqAD); \
+         const vec_t case3    = twoxsai_vec_and(bits, eqAD, eqBC); \
+         const vec_t any      = twoxsai_vec_or(bits, eqAD, eqBC); \
+         const vec_t keepA    = twoxsai_vec_andnot(bits, twoxsai_vec_and(bits, \
+                  twoxsai_vec_and(bits, twoxsai_vec_eq(bits, colorA, colorC), \
+                     twoxsai_vec_eq(bits, colorA, colorF)), \
+                  twoxsai_vec_eq(bits, colorB, colorJ)), \
+               twoxsai_vec_eq(bits, colorB, colorE)); \
+         const vec_t keepB    = twoxsai_vec_andnot(bits, twoxsai_vec_and(bits, \
+                  twoxsai_vec_and(bits, twoxsai_vec_eq(bits, colorB, colorE), \
+                     twoxsai_vec_eq(bits, colorB, colorD)), \
+                  twoxsai_vec_eq(bits, colorA, colorI)), \
+               twoxsai_vec_eq(bits, colorA, colorF)); \
+         const vec_t keep1A   = twoxsai_vec_andnot(bits, twoxsai_vec_and(bits, \
+                  twoxsai_vec_and(bits, twoxsai_vec_eq(bits, colorA, colorB), \
+                     twoxsai_vec_eq(bits, colorA, colorH)), \
+                  twoxsai_vec_eq(bits, colorC, colorM)), \
+               twoxsai_vec_eq(bits, colorG, colorC)); \
+         const vec_t keep1C   = twoxsai_vec_andnot(bits, twoxsai_vec_and(bits, \
+                  twoxsai_vec_and(bits, twoxsai_vec_eq(bits, colorC, colorG), \
+                     twoxsai_vec_eq(bits, colorC, colorD)), \
+                  twoxsai_vec_eq(bits, colorA, colorI)), \
+               twoxsai_vec_eq(bits, colorA, colorH)); \
+         const vec_t selA     = twoxsai_vec_or(bits, \
+               twoxsai_vec_and(bits, case1, twoxsai_vec_or(bits, keepA, \
+                  twoxsai_vec_and(bits, twoxsai_vec_eq(bits, colorA, colorE), \
+                     twoxsai_vec_eq(bits, colorB, colorL)))), \
+               twoxsai_vec_andnot(bits, keepA, any)); \
+         const vec_t selB     = twoxsai_vec_or(bits, \
+               twoxsai_vec_and(bits, case2, twoxsai_vec_or(bits, keepB, \
+                  twoxsai_vec_and(bits, twoxsai_vec_eq(bits, colorB, colorF), \
+                     twoxsai_vec_eq(bits, colorA, colorH)))), \
+               twoxsai_vec_andnot(bits, keepB, any)); \
+         const vec_t sel1A    = twoxsai_vec_or(bits, \
+               twoxsai_vec_and(bits, case1, twoxsai_vec_or(bits, keep1A, \
+                  twoxsai_vec_and(bits, twoxsai_vec_eq(bits, colorA, colorG), \
+                     twoxsai_vec_eq(bits, colorC, colorO)))), \
+               twoxsai_vec_andnot(bits, keep1A, any)); \
+         const vec_t sel1C    = twoxsai_vec_or(bits, \
+               twoxsai_vec_and(bits, case2, twoxsai_vec_or(bits, keep1C, \
+                  twoxsai_vec_and(bits, twoxsai_vec_eq(bits, colorC, colorH), \
+                     twoxsai_vec_eq(bits, colorA, colorF)))), \
+               twoxsai_vec_andnot(bits, keep1C, any)); \
+         const vec_t r        = twoxsai_vec_add(bits, twoxsai_vec_add(bits, \
+                  twoxsai_vec_result(bits, colorA, colorB, colorG, colorE), \
+                  twoxsai_vec_result(bits, colorB, colorA, colorK, colorF)), \
+               twoxsai_vec_add(bits, \
+                  twoxsai_vec_result(bits, colorB, colorA, colorH, colorN), \
+                  twoxsai_vec_result(bits, colorA, colorB, colorL, colorO))); \
+         const vec_t product  = twoxsai_vec_select(bits, selA, colorA, \
+               twoxsai_vec_select(bits, selB, colorB, interpolate_cb(colorA, colorB))); \
+         const vec_t product1 = twoxsai_vec_select(bits, sel1A, colorA, \
+               twoxsai_vec_select(bits, sel1C, colorC, interpolate_cb(colorA, colorC))); \
+         const vec_t product2 = twoxsai_vec_select(bits, \
+               twoxsai_vec_or(bits, case1, twoxsai_vec_and(bits, case3, twoxsai_vec_gtz(bits, r))), colorA, \
+               twoxsai_vec_select(bits, \
+                  twoxsai_vec_or(bits, case2, twoxsai_vec_and(bits, case3, twoxsai_vec_ltz(bits, r))), colorB, \
+                  interpolate2_cb(colorA, colorB, colorC, colorD))); \
+         twoxsai_vec_store2(bits, out, colorA, product); \
+         twoxsai_vec_store2(bits, out + dst_stride, product1, product2)
+
+static unsigned twoxsai_simd_line_xrgb8888(const uint32_t *in,
+      unsigned nextline, uint32_t *out, unsigned dst_stride,
+      unsigned width)
+{
+   unsigned x;
+
+   for (x = 0; x + 4 <= width; x += 4, in += 4, out += 8)
+   {
+      twoxsai_vec_declare_variables(twoxsai_vec32_t, 32, in, nextline);
+      twoxsai_vec_function(twoxsai_vec32_t, 32,
+            twoxsai_vec_interpolate_xrgb8888,
+            twoxsai_vec_interpolate2_xrgb8888);
+   }
+
+   return x;
+}
+
+static unsigned twoxsai_simd_line_rgb565(const uint16_t *in,
+      unsigned nextline, uint16_t *out, unsigned dst_stride,
+      unsigned width)
+{
+   unsigned x;
+
+   for (x = 0; x + 8 <= width; x += 8, in += 8, out += 16)
+   {
+      twoxsai_vec_declare_variables(twoxsai_vec16_t, 16, in, nextline);
+      twoxsai_vec_function(twoxsai_vec16_t, 16,
+            twoxsai_vec_interpolate_rgb565,
+            twoxsai_vec_interpolate2_rgb565);
+   }
+
+   return x;
+}
+#endif
+
 static void twoxsai_generic_xrgb8888(unsigned width, unsigned height,
-      int first, int last, uint32_t *src,
+      int first, int last, int simd, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -218,8 +440,18 @@ static void twoxsai_generic_xrgb8888(unsigned width, unsigned height,
    {
       uint32_t *in  = (uint32_t*)src;
       uint32_t *out = (uint32_t*)dst;
+      unsigned x    = 0;
+
+#ifdef TWOXSAI_HAVE_SIMD
+      if (simd)
+      {
+         x    = twoxsai_simd_line_xrgb8888(in, nextline, out, dst_stride, width);
+         in  += x;
+         out += x << 1;
+      }
+#endif
 
-      for (finish = width; finish; finish -= 1)
+      for (finish = width - x; finish; finish -= 1)
       {
          twoxsai_declare_variables(uint32_t, in, nextline);
 
@@ -240,7 +472,7 @@ static void twoxsai_generic_xrgb8888(unsigned width, unsigned height,
 }
 
 static void twoxsai_generic_rgb565(unsigned width, unsigned height,
-      int first, int last, uint16_t *src,
+      int first, int last, int simd, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -250,8 +482,18 @@ static void twoxsai_generic_rgb565(unsigned width, unsigned height,
    {
       uint16_t *in  = (uint16_t*)src;
       uint16_t *out = (uint16_t*)dst;
+      unsigned x    = 0;
 
-      for (finish = width; finish; finish -= 1)
+#ifdef TWOXSAI_HAVE_SIMD
+      if (simd)
+      {
+         x    = twoxsai_simd_line_rgb565(in, nextline, out, dst_stride, width);
+         in  += x;
+         out += x << 1;
+      }
+#endif
+
+      for (finish = width - x; finish; finish -= 1)
       {
          twoxsai_declare_variables(uint16_t, in, nextline);
 
@@ -280,7 +522,7 @@ static void twoxsai_work_cb_rgb565(void *data, void *thread_data)
    unsigned width                     = thr->width;
    unsigned height                    = thr->height;
    twoxsai_generic_rgb565(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -295,7 +537,7 @@ static void twoxsai_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned width                     = thr->width;
    unsigned height                    = thr->height;
    twoxsai_generic_xrgb8888(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
@@ -331,6 +573,9 @@ static void twoxsai_generic_packets(void *data,
        */
       thr->first             = y_start;
       thr->last              = y_end == height;
+#ifdef TWOXSAI_HAVE_SIMD
+      thr->simd              = (filt->simd & TWOXSAI_SIMD_FLAG) != 0;
+#endif
 
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
          packets[i].work     = twoxsai_work_cb_rgb565;
@@ -18,7 +18,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#include <retro_endianness.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation epx_get_implementation
@@ -39,6 +43,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   int simd;
 };
 
 struct filter_data
@@ -46,6 +51,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned epx_generic_input_fmts(void)
@@ -81,6 +87,7 @@ static void *epx_generic_create(const struct softfilter_config *config,
    }
    filt->threads            = 1;
    filt->in_fmt             = in_fmt;
+   filt->simd               = simd;
    return filt;
 }
 
@@ -103,86 +110,148 @@ static void epx_generic_destroy(void *data)
    free(filt);
 }
 
-static void epx_generic_rgb565 (unsigned width, unsigned height,
-      int first, int lsat, uint16_t *src,
-      unsigned src_stride, uint16_t *dst, unsigned dst_stride)
+/* Scalar reference kernel. Expands source pixels [x, end) of
+ * a line that is width pixels wide; the edge columns use the
+ * centre pixel in place of the missing left/right neighbour.
+ * Each output pair is written in memory order, which is what
+ * the packed 32-bit stores used to do on either endianness. */
+static void epx_line_rgb565(const uint16_t *sP,
+      const uint16_t *uP, const uint16_t *lP,
+      uint16_t *dP1, uint16_t *dP2,
+      unsigned x, unsigned end, unsigned width)
 {
-   uint16_t colorA;
-   int w;
-
-   for (; height; height--)
+   for (; x < end; x++)
    {
-      uint16_t *sP    = (uint16_t *) src;
-      uint16_t *uP    = (uint16_t *) (src - src_stride);
-      uint16_t *lP    = (uint16_t *) (src + src_stride);
-      uint32_t *dP1   = (uint32_t *) dst;
-      uint32_t *dP2   = (uint32_t *) (dst + dst_stride);
-
-      /* left edge */
-      uint16_t colorX = *sP;
-      uint16_t colorC = *++sP;
-      uint16_t colorB = *lP++;
-      uint16_t colorD = *uP++;
-
-      if ((colorX != colorC) && (colorB != colorD))
+      uint16_t colorA = (x > 0)         ? sP[x - 1] : sP[x];
+      uint16_t colorX = sP[x];
+      uint16_t colorC = (x < width - 1) ? sP[x + 1] : sP[x];
+      uint16_t colorB = lP[x];
+      uint16_t colorD = uP[x];
+
+      if ((colorA != colorC) && (colorB != colorD))
       {
-#ifdef MSB_FIRST
-         *dP1 = (colorX << 16) + ((colorC == colorD) ? colorC : colorX);
-         *dP2 = (colorX << 16) + ((colorB == colorC) ? colorB : colorX);
-#else
-         *dP1 = colorX + (((colorC == colorD) ? colorC : colorX) << 16);
-         *dP2 = colorX + (((colorB == colorC) ? colorB : colorX) << 16);
-#endif
+         dP1[(x << 1)    ] = (colorD == colorA) ? colorD : colorX;
+         dP1[(x << 1) + 1] = (colorC == colorD) ? colorC : colorX;
+         dP2[(x << 1)    ] = (colorA == colorB) ? colorA : colorX;
+         dP2[(x << 1) + 1] = (colorB == colorC) ? colorB : colorX;
       }
       else
-         *dP1 = *dP2 = (colorX << 16) + colorX;
+      {
+         dP1[(x << 1)    ] = colorX;
+         dP1[(x << 1) + 1] = colorX;
+         dP2[(x << 1)    ] = colorX;
+         dP2[(x << 1) + 1] = colorX;
+      }
+   }
+}
 
-      dP1++;
-      dP2++;
+/* Branchless SIMD kernels. They process source pixels starting
+ * at x = 1 for as long as the right neighbour of the last pixel
+ * in the vector is still inside the line, and return the first
+ * column that was not processed. */
+#if defined(__SSE2__)
+#define EPX_HAVE_SIMD
+#define EPX_SIMD_FLAG SOFTFILTER_SIMD_SSE2
 
-      for (w = width - 2; w; w--)
-      {
-         colorA = colorX;
-         colorX = colorC;
-         colorC = *++sP;
-         colorB = *lP++;
-         colorD = *uP++;
-
-         if ((colorA != colorC) && (colorB != colorD))
-         {
-#ifdef MSB_FIRST
-           *dP1 = (((colorD == colorA) ? colorD : colorX) << 16) + ((colorC == colorD) ? colorC : colorX);
-           *dP2 = (((colorA == colorB) ? colorA : colorX) << 16) + ((colorB == colorC) ? colorB : colorX);
-#else
-           *dP1 = ((colorD == colorA) ? colorD : colorX) + (((colorC == colorD) ? colorC : colorX) << 16);
-           *dP2 = ((colorA == colorB) ? colorA : colorX) + (((colorB == colorC) ? colorB : colorX) << 16);
-#endif
-         }
-         else
-            *dP1 = *dP2 = (colorX << 16) + colorX;
+#define EPX_SELECT(mask, a, b) \
+   _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b))
 
-         dP1++;
-         dP2++;
-      }
+static unsigned epx_simd_line_rgb565(const uint16_t *sP,
+      const uint16_t *uP, const uint16_t *lP,
+      uint16_t *dP1, uint16_t *dP2, unsigned width)
+{
+   unsigned x;
 
-      /* right edge */
-      colorA = colorX;
-      colorX = colorC;
-      colorB = *lP;
-      colorD = *uP;
+   for (x = 1; x + 8 < width; x += 8)
+   {
+      __m128i colorA = _mm_loadu_si128((const __m128i*)(sP + x - 1));
+      __m128i colorX = _mm_loadu_si128((const __m128i*)(sP + x));
+      __m128i colorC = _mm_loadu_si128((const __m128i*)(sP + x + 1));
+      __m128i colorB = _mm_loadu_si128((const __m128i*)(lP + x));
+      __m128i colorD = _mm_loadu_si128((const __m128i*)(uP + x));
+      /* Lanes where (A == C || B == D) keep the centre pixel */
+      __m128i skip   = _mm_or_si128(_mm_cmpeq_epi16(colorA, colorC),
+            _mm_cmpeq_epi16(colorB, colorD));
+      __m128i p00    = EPX_SELECT(_mm_andnot_si128(skip,
+               _mm_cmpeq_epi16(colorD, colorA)), colorD, colorX);
+      __m128i p01    = EPX_SELECT(_mm_andnot_si128(skip,
+               _mm_cmpeq_epi16(colorC, colorD)), colorC, colorX);
+      __m128i p10    = EPX_SELECT(_mm_andnot_si128(skip,
+               _mm_cmpeq_epi16(colorA, colorB)), colorA, colorX);
+      __m128i p11    = EPX_SELECT(_mm_andnot_si128(skip,
+               _mm_cmpeq_epi16(colorB, colorC)), colorB, colorX);
+
+      _mm_storeu_si128((__m128i*)(dP1 + (x << 1)),
+            _mm_unpacklo_epi16(p00, p01));
+      _mm_storeu_si128((__m128i*)(dP1 + (x << 1) + 8),
+            _mm_unpackhi_epi16(p00, p01));
+      _mm_storeu_si128((__m128i*)(dP2 + (x << 1)),
+            _mm_unpacklo_epi16(p10, p11));
+      _mm_storeu_si128((__m128i*)(dP2 + (x << 1) + 8),
+            _mm_unpackhi_epi16(p10, p11));
+   }
 
-      if ((colorA != colorX) && (colorB != colorD))
-      {
-#ifdef MSB_FIRST
-         *dP1 = (((colorD == colorA) ? colorD : colorX) << 16) + colorX;
-         *dP2 = (((colorA == colorB) ? colorA : colorX) << 16) + colorX;
-#else
-         *dP1 = ((colorD == colorA) ? colorD : colorX) + (colorX << 16);
-         *dP2 = ((colorA == colorB) ? colorA : colorX) + (colorX << 16);
+   return x;
+}
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define EPX_HAVE_SIMD
+#define EPX_SIMD_FLAG SOFTFILTER_SIMD_NEON
+
+static unsigned epx_simd_line_rgb565(const uint16_t *sP,
+      const uint16_t *uP, const uint16_t *lP,
+      uint16_t *dP1, uint16_t *dP2, unsigned width)
+{
+   unsigned x;
+
+   for (x = 1; x + 8 < width; x += 8)
+   {
+      uint16x8x2_t out1, out2;
+      uint16x8_t colorA = vld1q_u16(sP + x - 1);
+      uint16x8_t colorX = vld1q_u16(sP + x);
+      uint16x8_t colorC = vld1q_u16(sP + x + 1);
+      uint16x8_t colorB = vld1q_u16(lP + x);
+      uint16x8_t colorD = vld1q_u16(uP + x);
+      /* Lanes where (A == C || B == D) keep the centre pixel */
+      uint16x8_t skip   = vorrq_u16(vceqq_u16(colorA, colorC),
+            vceqq_u16(colorB, colorD));
+
+      out1.val[0]       = vbslq_u16(vbicq_u16(
+               vceqq_u16(colorD, colorA), skip), colorD, colorX);
+      out1.val[1]       = vbslq_u16(vbicq_u16(
+               vceqq_u16(colorC, colorD), skip), colorC, colorX);
+      out2.val[0]       = vbslq_u16(vbicq_u16(
+               vceqq_u16(colorA, colorB), skip), colorA, colorX);
+      out2.val[1]       = vbslq_u16(vbicq_u16(
+               vceqq_u16(colorB, colorC), skip), colorB, colorX);
+
+      /* vst2 interleaves the left/right output pixels */
+      vst2q_u16(dP1 + (x << 1), out1);
+      vst2q_u16(dP2 + (x << 1), out2);
+   }
+
+   return x;
+}
 #endif
+
+static void epx_generic_rgb565 (unsigned width, unsigned height,
+      int first, int lsat, int simd, uint16_t *src,
+      unsigned src_stride, uint16_t *dst, unsigned dst_stride)
+{
+   for (; height; height--)
+   {
+      unsigned x   = 0;
+      uint16_t *uP = src - src_stride;
+      uint16_t *lP = src + src_stride;
+
+#ifdef EPX_HAVE_SIMD
+      if (simd)
+      {
+         epx_line_rgb565(src, uP, lP, dst, dst + dst_stride, 0, 1, width);
+         x = epx_simd_line_rgb565(src, uP, lP,
+               dst, dst + dst_stride, width);
       }
-      else
-         *dP1 = *dP2 = (colorX << 16) + colorX;
+#endif
+      epx_line_rgb565(src, uP, lP, dst, dst + dst_stride, x, width, width);
 
       src += src_stride;
       dst += dst_stride << 1;
@@ -199,7 +268,7 @@ static void epx_work_cb_rgb565(void *data, void *thread_data)
    unsigned height  = thr->height;
 
    epx_generic_rgb565(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -231,6 +300,9 @@ static void epx_generic_packets(void *data,
        * access pixels outside their given buffer. */
       thr->first         = y_start;
       thr->last          = y_end == height;
+#ifdef EPX_HAVE_SIMD
+      thr->simd          = (filt->simd & EPX_SIMD_FLAG) != 0;
+#endif
 
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
          packets[i].work = epx_work_cb_rgb565;
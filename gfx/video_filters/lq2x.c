@@ -16,6 +16,13 @@
 
 #include "softfilter.h"
 #include <stdlib.h>
+#include <retro_inline.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation lq2x_get_implementation
@@ -36,6 +43,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   int simd;
 };
 
 struct filter_data
@@ -43,6 +51,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned lq2x_generic_input_fmts(void)
@@ -79,6 +88,7 @@ static void *lq2x_generic_create(const struct softfilter_config *config,
     * so force single threaded operation... */
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    return filt;
 }
 
@@ -101,91 +111,312 @@ static void lq2x_generic_destroy(void *data)
    free(filt);
 }
 
+/* Scalar reference kernels. Each call expands source pixels
+ * [x, end) of a single line that is width pixels wide;
+ * the SIMD kernels below only handle the interior of a line
+ * and defer to these for the edge columns and any remainder. */
+static void lq2x_line_rgb565(const uint16_t *src,
+      const uint16_t *prev, const uint16_t *next,
+      uint16_t *out0, uint16_t *out1,
+      unsigned x, unsigned end, unsigned width)
+{
+   for (; x < end; x++)
+   {
+      uint16_t A = prev[x];
+      uint16_t B = (x > 0) ? src[x - 1] : src[x];
+      uint16_t C = src[x];
+      uint16_t D = (x < width - 1) ? src[x + 1] : src[x];
+      uint16_t E = next[x];
+      uint16_t c = C;
+
+      if (A != E && B != D)
+      {
+         out0[(x << 1)    ] = (A == B ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
+         out0[(x << 1) + 1] = (A == D ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
+         out1[(x << 1)    ] = (E == B ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
+         out1[(x << 1) + 1] = (E == D ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
+      }
+      else
+      {
+         out0[(x << 1)    ] = c;
+         out0[(x << 1) + 1] = c;
+         out1[(x << 1)    ] = c;
+         out1[(x << 1) + 1] = c;
+      }
+   }
+}
+
+static void lq2x_line_xrgb8888(const uint32_t *src,
+      const uint32_t *prev, const uint32_t *next,
+      uint32_t *out0, uint32_t *out1,
+      unsigned x, unsigned end, unsigned width)
+{
+   for (; x < end; x++)
+   {
+      uint32_t A = prev[x];
+      uint32_t B = (x > 0) ? src[x - 1] : src[x];
+      uint32_t C = src[x];
+      uint32_t D = (x < width - 1) ? src[x + 1] : src[x];
+      uint32_t E = next[x];
+      uint32_t c = C;
+
+      if (A != E && B != D)
+      {
+         out0[(x << 1)    ] = (A == B ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
+         out0[(x << 1) + 1] = (A == D ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
+         out1[(x << 1)    ] = (E == B ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
+         out1[(x << 1) + 1] = (E == D ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
+      }
+      else
+      {
+         out0[(x << 1)    ] = c;
+         out0[(x << 1) + 1] = c;
+         out1[(x << 1)    ] = c;
+         out1[(x << 1) + 1] = c;
+      }
+   }
+}
+
+/* Branchless SIMD kernels. Both process source pixels
+ * starting at x = 1 for as long as the right neighbour of
+ * the last pixel in the vector is still inside the line,
+ * and return the first column that was not processed.
+ *
+ * The RGB565 blend is computed as (C & A) + (((C ^ A) & ~mask) >> 1),
+ * which equals the scalar (C + A - ((C ^ A) & mask)) >> 1 without
+ * needing a 17-bit intermediate. The XRGB8888 blend wraps at 32 bits
+ * exactly like the scalar code does. */
+#if defined(__SSE2__)
+#define LQ2X_HAVE_SIMD
+#define LQ2X_SIMD_FLAG SOFTFILTER_SIMD_SSE2
+
+#define LQ2X_SELECT(mask, a, b) \
+   _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b))
+
+static INLINE __m128i lq2x_blend_rgb565(__m128i c, __m128i a, __m128i mask)
+{
+   return _mm_add_epi16(_mm_and_si128(c, a),
+         _mm_srli_epi16(_mm_andnot_si128(mask, _mm_xor_si128(c, a)), 1));
+}
+
+static INLINE __m128i lq2x_blend_xrgb8888(__m128i c, __m128i a, __m128i mask)
+{
+   return _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(c, a),
+         _mm_and_si128(_mm_xor_si128(c, a), mask)), 1);
+}
+
+static unsigned lq2x_simd_line_rgb565(const uint16_t *src,
+      const uint16_t *prev, const uint16_t *next,
+      uint16_t *out0, uint16_t *out1, unsigned width)
+{
+   unsigned x;
+   const __m128i mask = _mm_set1_epi16(0x0821);
+
+   for (x = 1; x + 8 < width; x += 8)
+   {
+      __m128i A    = _mm_loadu_si128((const __m128i*)(prev + x));
+      __m128i B    = _mm_loadu_si128((const __m128i*)(src  + x - 1));
+      __m128i C    = _mm_loadu_si128((const __m128i*)(src  + x));
+      __m128i D    = _mm_loadu_si128((const __m128i*)(src  + x + 1));
+      __m128i E    = _mm_loadu_si128((const __m128i*)(next + x));
+      __m128i CA   = lq2x_blend_rgb565(C, A, mask);
+      __m128i CE   = lq2x_blend_rgb565(C, E, mask);
+      /* Lanes where (A == E || B == D) keep the centre pixel */
+      __m128i skip = _mm_or_si128(_mm_cmpeq_epi16(A, E),
+            _mm_cmpeq_epi16(B, D));
+      __m128i p00  = LQ2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi16(A, B)), CA, C);
+      __m128i p01  = LQ2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi16(A, D)), CA, C);
+      __m128i p10  = LQ2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi16(E, B)), CE, C);
+      __m128i p11  = LQ2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi16(E, D)), CE, C);
+
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1)),
+            _mm_unpacklo_epi16(p00, p01));
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1) + 8),
+            _mm_unpackhi_epi16(p00, p01));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1)),
+            _mm_unpacklo_epi16(p10, p11));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 8),
+            _mm_unpackhi_epi16(p10, p11));
+   }
+
+   return x;
+}
+
+static unsigned lq2x_simd_line_xrgb8888(const uint32_t *src,
+      const uint32_t *prev, const uint32_t *next,
+      uint32_t *out0, uint32_t *out1, unsigned width)
+{
+   unsigned x;
+   const __m128i mask = _mm_set1_epi32(0x0421);
+
+   for (x = 1; x + 4 < width; x += 4)
+   {
+      __m128i A    = _mm_loadu_si128((const __m128i*)(prev + x));
+      __m128i B    = _mm_loadu_si128((const __m128i*)(src  + x - 1));
+      __m128i C    = _mm_loadu_si128((const __m128i*)(src  + x));
+      __m128i D    = _mm_loadu_si128((const __m128i*)(src  + x + 1));
+      __m128i E    = _mm_loadu_si128((const __m128i*)(next + x));
+      __m128i CA   = lq2x_blend_xrgb8888(C, A, mask);
+      __m128i CE   = lq2x_blend_xrgb8888(C, E, mask);
+      __m128i skip = _mm_or_si128(_mm_cmpeq_epi32(A, E),
+            _mm_cmpeq_epi32(B, D));
+      __m128i p00  = LQ2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi32(A, B)), CA, C);
+      __m128i p01  = LQ2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi32(A, D)), CA, C);
+      __m128i p10  = LQ2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi32(E, B)), CE, C);
+      __m128i p11  = LQ2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi32(E, D)), CE, C);
+
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1)),
+            _mm_unpacklo_epi32(p00, p01));
+      _mm_storeu_si128((__m128i*)(out0 + (x << 1) + 4),
+            _mm_unpackhi_epi32(p00, p01));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1)),
+            _mm_unpacklo_epi32(p10, p11));
+      _mm_storeu_si128((__m128i*)(out1 + (x << 1) + 4),
+            _mm_unpackhi_epi32(p10, p11));
+   }
+
+   return x;
+}
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define LQ2X_HAVE_SIMD
+#define LQ2X_SIMD_FLAG SOFTFILTER_SIMD_NEON
+
+static unsigned lq2x_simd_line_rgb565(const uint16_t *src,
+      const uint16_t *prev, const uint16_t *next,
+      uint16_t *out0, uint16_t *out1, unsigned width)
+{
+   unsigned x;
+   const uint16x8_t mask = vdupq_n_u16(0x0821);
+
+   for (x = 1; x + 8 < width; x += 8)
+   {
+      uint16x8x2_t o0, o1;
+      uint16x8_t A    = vld1q_u16(prev + x);
+      uint16x8_t B    = vld1q_u16(src  + x - 1);
+      uint16x8_t C    = vld1q_u16(src  + x);
+      uint16x8_t D    = vld1q_u16(src  + x + 1);
+      uint16x8_t E    = vld1q_u16(next + x);
+      uint16x8_t CA   = vaddq_u16(vandq_u16(C, A),
+            vshrq_n_u16(vbicq_u16(veorq_u16(C, A), mask), 1));
+      uint16x8_t CE   = vaddq_u16(vandq_u16(C, E),
+            vshrq_n_u16(vbicq_u16(veorq_u16(C, E), mask), 1));
+      /* Lanes where (A == E || B == D) keep the centre pixel */
+      uint16x8_t skip = vorrq_u16(vceqq_u16(A, E), vceqq_u16(B, D));
+
+      o0.val[0]       = vbslq_u16(vbicq_u16(vceqq_u16(A, B), skip), CA, C);
+      o0.val[1]       = vbslq_u16(vbicq_u16(vceqq_u16(A, D), skip), CA, C);
+      o1.val[0]       = vbslq_u16(vbicq_u16(vceqq_u16(E, B), skip), CE, C);
+      o1.val[1]       = vbslq_u16(vbicq_u16(vceqq_u16(E, D), skip), CE, C);
+
+      /* vst2 interleaves the left/right output pixels */
+      vst2q_u16(out0 + (x << 1), o0);
+      vst2q_u16(out1 + (x << 1), o1);
+   }
+
+   return x;
+}
+
+static unsigned lq2x_simd_line_xrgb8888(const uint32_t *src,
+      const uint32_t *prev, const uint32_t *next,
+      uint32_t *out0, uint32_t *out1, unsigned width)
+{
+   unsigned x;
+   const uint32x4_t mask = vdupq_n_u32(0x0421);
+
+   for (x = 1; x + 4 < width; x += 4)
+   {
+      uint32x4x2_t o0, o1;
+      uint32x4_t A    = vld1q_u32(prev + x);
+      uint32x4_t B    = vld1q_u32(src  + x - 1);
+      uint32x4_t C    = vld1q_u32(src  + x);
+      uint32x4_t D    = vld1q_u32(src  + x + 1);
+      uint32x4_t E    = vld1q_u32(next + x);
+      uint32x4_t CA   = vshrq_n_u32(vsubq_u32(vaddq_u32(C, A),
+               vandq_u32(veorq_u32(C, A), mask)), 1);
+      uint32x4_t CE   = vshrq_n_u32(vsubq_u32(vaddq_u32(C, E),
+               vandq_u32(veorq_u32(C, E), mask)), 1);
+      uint32x4_t skip = vorrq_u32(vceqq_u32(A, E), vceqq_u32(B, D));
+
+      o0.val[0]       = vbslq_u32(vbicq_u32(vceqq_u32(A, B), skip), CA, C);
+      o0.val[1]       = vbslq_u32(vbicq_u32(vceqq_u32(A, D), skip), CA, C);
+      o1.val[0]       = vbslq_u32(vbicq_u32(vceqq_u32(E, B), skip), CE, C);
+      o1.val[1]       = vbslq_u32(vbicq_u32(vceqq_u32(E, D), skip), CE, C);
+
+      vst2q_u32(out0 + (x << 1), o0);
+      vst2q_u32(out1 + (x << 1), o1);
+   }
+
+   return x;
+}
+#endif
+
 static void lq2x_generic_rgb565(unsigned width, unsigned height,
-      int first, int last, uint16_t *src,
+      int first, int last, int simd, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
-   unsigned x, y;
+   unsigned y;
    uint16_t *out0 = (uint16_t*)dst;
    uint16_t *out1 = (uint16_t*)(dst + dst_stride);
 
    for (y = 0; y < height; y++)
    {
-      int prevline = (y == 0 ? 0 : src_stride);
-      int nextline = (y == height - 1 || last) ? 0 : src_stride;
-
-      for (x = 0; x < width; x++)
+      unsigned x     = 0;
+      int prevline   = (y == 0 ? 0 : src_stride);
+      int nextline   = (y == height - 1 || last) ? 0 : src_stride;
+      uint16_t *prev = src - prevline;
+      uint16_t *next = src + nextline;
+
+#ifdef LQ2X_HAVE_SIMD
+      if (simd)
       {
-         uint16_t A = *(src - prevline);
-         uint16_t B = (x > 0) ? *(src - 1) : *src;
-         uint16_t C = *src;
-         uint16_t D = (x < width - 1) ? *(src + 1) : *src;
-         uint16_t E = *(src++ + nextline);
-         uint16_t c = C;
-
-         if (A != E && B != D)
-         {
-            *out0++ = (A == B ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
-            *out0++ = (A == D ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
-            *out1++ = (E == B ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
-            *out1++ = (E == D ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
-         }
-         else
-         {
-            *out0++ = c;
-            *out0++ = c;
-            *out1++ = c;
-            *out1++ = c;
-         }
+         lq2x_line_rgb565(src, prev, next, out0, out1, 0, 1, width);
+         x = lq2x_simd_line_rgb565(src, prev, next, out0, out1, width);
       }
+#endif
+      lq2x_line_rgb565(src, prev, next, out0, out1, x, width, width);
 
-      src  += src_stride - width;
-      out0 += dst_stride + dst_stride - (width << 1);
-      out1 += dst_stride + dst_stride - (width << 1);
+      src  += src_stride;
+      out0 += dst_stride + dst_stride;
+      out1 += dst_stride + dst_stride;
    }
 }
 
 static void lq2x_generic_xrgb8888(unsigned width, unsigned height,
-      int first, int last, uint32_t *src,
+      int first, int last, int simd, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
-   unsigned x, y;
+   unsigned y;
    uint32_t *out0 = (uint32_t*)dst;
    uint32_t *out1 = (uint32_t*)(dst + dst_stride);
 
    for (y = 0; y < height; y++)
    {
-      int prevline = (y == 0 ? 0 : src_stride);
-      int nextline = (y == height - 1 || last) ? 0 : src_stride;
-
-      for (x = 0; x < width; x++)
+      unsigned x     = 0;
+      int prevline   = (y == 0 ? 0 : src_stride);
+      int nextline   = (y == height - 1 || last) ? 0 : src_stride;
+      uint32_t *prev = src - prevline;
+      uint32_t *next = src + nextline;
+
+#ifdef LQ2X_HAVE_SIMD
+      if (simd)
       {
-         uint32_t A = *(src - prevline);
-         uint32_t B = (x > 0) ? *(src - 1) : *src;
-         uint32_t C = *src;
-         uint32_t D = (x < width - 1) ? *(src + 1) : *src;
-         uint32_t E = *(src++ + nextline);
-         uint32_t c = C;
-
-         if (A != E && B != D)
-         {
-            *out0++ = (A == B ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
-            *out0++ = (A == D ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
-            *out1++ = (E == B ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
-            *out1++ = (E == D ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
-         }
-         else
-         {
-            *out0++ = c;
-            *out0++ = c;
-            *out1++ = c;
-            *out1++ = c;
-         }
+         lq2x_line_xrgb8888(src, prev, next, out0, out1, 0, 1, width);
+         x = lq2x_simd_line_xrgb8888(src, prev, next, out0, out1, width);
       }
+#endif
+      lq2x_line_xrgb8888(src, prev, next, out0, out1, x, width, width);
 
-      src += src_stride - width;
-      out0 += dst_stride + dst_stride - (width << 1);
-      out1 += dst_stride + dst_stride - (width << 1);
+      src  += src_stride;
+      out0 += dst_stride + dst_stride;
+      out1 += dst_stride + dst_stride;
    }
 }
 
@@ -198,7 +429,7 @@ static void lq2x_work_cb_rgb565(void *data, void *thread_data)
    unsigned width                     = thr->width;
    unsigned height                    = thr->height;
    lq2x_generic_rgb565(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -213,7 +444,7 @@ static void lq2x_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned width                     = thr->width;
    unsigned height                    = thr->height;
    lq2x_generic_xrgb8888(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
@@ -245,6 +476,9 @@ static void lq2x_generic_packets(void *data,
        * outside their given buffer. */
       thr->first             = y_start;
       thr->last              = y_end == height;
+#ifdef LQ2X_HAVE_SIMD
+      thr->simd              = (filt->simd & LQ2X_SIMD_FLAG) != 0;
+#endif
 
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
          packets[i].work     = lq2x_work_cb_rgb565;
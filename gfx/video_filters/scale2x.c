@@ -20,6 +20,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation scale2x_get_implementation
 #define softfilter_thread_data scale2x_softfilter_thread_data
@@ -37,6 +43,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   int simd;
 };
 
 struct filter_data
@@ -44,6 +51,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned scale2x_generic_input_fmts(void)
@@ -79,6 +87,7 @@ static void *scale2x_generic_create(const struct softfilter_config *config,
     * so force single threaded operation... */
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    return filt;
 }
 
@@ -99,6 +108,222 @@ static void scale2x_generic_destroy(void *data)
    free(filt);
 }
 
+/* Scalar reference kernels. Each call expands source pixels
+ * [x, end) of a single line that is width pixels wide; the SIMD kernels below only
+ * handle the interior of a line and defer to these for the
+ * edge columns and any remainder. */
+static void scale2x_line_xrgb8888(const uint32_t *input,
+      const uint32_t *prev, const uint32_t *next,
+      uint32_t *output0, uint32_t *output1,
+      unsigned x, unsigned end, unsigned width)
+{
+   for (; x < end; x++)
+   {
+      /* Get sample points */
+      uint32_t A = prev[x];
+      uint32_t B = (x > 0) ? input[x - 1] : input[x];
+      uint32_t C = input[x];
+      uint32_t D = (x < width - 1) ? input[x + 1] : input[x];
+      uint32_t E = next[x];
+
+      /* Apply pixel expansion algorithm */
+      if (A != E && B != D)
+      {
+         output0[(x << 1)    ] = (A == B ? A : C);
+         output0[(x << 1) + 1] = (A == D ? A : C);
+         output1[(x << 1)    ] = (E == B ? E : C);
+         output1[(x << 1) + 1] = (E == D ? E : C);
+      }
+      else
+      {
+         output0[(x << 1)    ] = C;
+         output0[(x << 1) + 1] = C;
+         output1[(x << 1)    ] = C;
+         output1[(x << 1) + 1] = C;
+      }
+   }
+}
+
+static void scale2x_line_rgb565(const uint16_t *input,
+      const uint16_t *prev, const uint16_t *next,
+      uint16_t *output0, uint16_t *output1,
+      unsigned x, unsigned end, unsigned width)
+{
+   for (; x < end; x++)
+   {
+      /* Get sample points */
+      uint16_t A = prev[x];
+      uint16_t B = (x > 0) ? input[x - 1] : input[x];
+      uint16_t C = input[x];
+      uint16_t D = (x < width - 1) ? input[x + 1] : input[x];
+      uint16_t E = next[x];
+
+      /* Apply pixel expansion algorithm */
+      if (A != E && B != D)
+      {
+         output0[(x << 1)    ] = (A == B ? A : C);
+         output0[(x << 1) + 1] = (A == D ? A : C);
+         output1[(x << 1)    ] = (E == B ? E : C);
+         output1[(x << 1) + 1] = (E == D ? E : C);
+      }
+      else
+      {
+         output0[(x << 1)    ] = C;
+         output0[(x << 1) + 1] = C;
+         output1[(x << 1)    ] = C;
+         output1[(x << 1) + 1] = C;
+      }
+   }
+}
+
+/* Branchless SIMD kernels. Both process source pixels
+ * starting at x = 1 for as long as the right neighbour of
+ * the last pixel in the vector is still inside the line,
+ * and return the first column that was not processed. */
+#if defined(__SSE2__)
+#define SCALE2X_HAVE_SIMD
+#define SCALE2X_SIMD_FLAG SOFTFILTER_SIMD_SSE2
+
+#define SCALE2X_SELECT(mask, a, b) \
+   _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b))
+
+static unsigned scale2x_simd_line_xrgb8888(const uint32_t *input,
+      const uint32_t *prev, const uint32_t *next,
+      uint32_t *output0, uint32_t *output1, unsigned width)
+{
+   unsigned x;
+
+   for (x = 1; x + 4 < width; x += 4)
+   {
+      __m128i A    = _mm_loadu_si128((const __m128i*)(prev  + x));
+      __m128i B    = _mm_loadu_si128((const __m128i*)(input + x - 1));
+      __m128i C    = _mm_loadu_si128((const __m128i*)(input + x));
+      __m128i D    = _mm_loadu_si128((const __m128i*)(input + x + 1));
+      __m128i E    = _mm_loadu_si128((const __m128i*)(next  + x));
+      /* Lanes where (A == E || B == D) keep the centre pixel */
+      __m128i skip = _mm_or_si128(_mm_cmpeq_epi32(A, E),
+            _mm_cmpeq_epi32(B, D));
+      __m128i p00  = SCALE2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi32(A, B)), A, C);
+      __m128i p01  = SCALE2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi32(A, D)), A, C);
+      __m128i p10  = SCALE2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi32(E, B)), E, C);
+      __m128i p11  = SCALE2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi32(E, D)), E, C);
+
+      _mm_storeu_si128((__m128i*)(output0 + (x << 1)),
+            _mm_unpacklo_epi32(p00, p01));
+      _mm_storeu_si128((__m128i*)(output0 + (x << 1) + 4),
+            _mm_unpackhi_epi32(p00, p01));
+      _mm_storeu_si128((__m128i*)(output1 + (x << 1)),
+            _mm_unpacklo_epi32(p10, p11));
+      _mm_storeu_si128((__m128i*)(output1 + (x << 1) + 4),
+            _mm_unpackhi_epi32(p10, p11));
+   }
+
+   return x;
+}
+
+static unsigned scale2x_simd_line_rgb565(const uint16_t *input,
+      const uint16_t *prev, const uint16_t *next,
+      uint16_t *output0, uint16_t *output1, unsigned width)
+{
+   unsigned x;
+
+   for (x = 1; x + 8 < width; x += 8)
+   {
+      __m128i A    = _mm_loadu_si128((const __m128i*)(prev  + x));
+      __m128i B    = _mm_loadu_si128((const __m128i*)(input + x - 1));
+      __m128i C    = _mm_loadu_si128((const __m128i*)(input + x));
+      __m128i D    = _mm_loadu_si128((const __m128i*)(input + x + 1));
+      __m128i E    = _mm_loadu_si128((const __m128i*)(next  + x));
+      __m128i skip = _mm_or_si128(_mm_cmpeq_epi16(A, E),
+            _mm_cmpeq_epi16(B, D));
+      __m128i p00  = SCALE2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi16(A, B)), A, C);
+      __m128i p01  = SCALE2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi16(A, D)), A, C);
+      __m128i p10  = SCALE2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi16(E, B)), E, C);
+      __m128i p11  = SCALE2X_SELECT(
+            _mm_andnot_si128(skip, _mm_cmpeq_epi16(E, D)), E, C);
+
+      _mm_storeu_si128((__m128i*)(output0 + (x << 1)),
+            _mm_unpacklo_epi16(p00, p01));
+      _mm_storeu_si128((__m128i*)(output0 + (x << 1) + 8),
+            _mm_unpackhi_epi16(p00, p01));
+      _mm_storeu_si128((__m128i*)(output1 + (x << 1)),
+            _mm_unpacklo_epi16(p10, p11));
+      _mm_storeu_si128((__m128i*)(output1 + (x << 1) + 8),
+            _mm_unpackhi_epi16(p10, p11));
+   }
+
+   return x;
+}
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define SCALE2X_HAVE_SIMD
+#define SCALE2X_SIMD_FLAG SOFTFILTER_SIMD_NEON
+
+static unsigned scale2x_simd_line_xrgb8888(const uint32_t *input,
+      const uint32_t *prev, const uint32_t *next,
+      uint32_t *output0, uint32_t *output1, unsigned width)
+{
+   unsigned x;
+
+   for (x = 1; x + 4 < width; x += 4)
+   {
+      uint32x4x2_t out0, out1;
+      uint32x4_t A    = vld1q_u32(prev  + x);
+      uint32x4_t B    = vld1q_u32(input + x - 1);
+      uint32x4_t C    = vld1q_u32(input + x);
+      uint32x4_t D    = vld1q_u32(input + x + 1);
+      uint32x4_t E    = vld1q_u32(next  + x);
+      /* Lanes where (A == E || B == D) keep the centre pixel */
+      uint32x4_t skip = vorrq_u32(vceqq_u32(A, E), vceqq_u32(B, D));
+
+      out0.val[0]     = vbslq_u32(vbicq_u32(vceqq_u32(A, B), skip), A, C);
+      out0.val[1]     = vbslq_u32(vbicq_u32(vceqq_u32(A, D), skip), A, C);
+      out1.val[0]     = vbslq_u32(vbicq_u32(vceqq_u32(E, B), skip), E, C);
+      out1.val[1]     = vbslq_u32(vbicq_u32(vceqq_u32(E, D), skip), E, C);
+
+      /* vst2 interleaves the left/right output pixels */
+      vst2q_u32(output0 + (x << 1), out0);
+      vst2q_u32(output1 + (x << 1), out1);
+   }
+
+   return x;
+}
+
+static unsigned scale2x_simd_line_rgb565(const uint16_t *input,
+      const uint16_t *prev, const uint16_t *next,
+      uint16_t *output0, uint16_t *output1, unsigned width)
+{
+   unsigned x;
+
+   for (x = 1; x + 8 < width; x += 8)
+   {
+      uint16x8x2_t out0, out1;
+      uint16x8_t A    = vld1q_u16(prev  + x);
+      uint16x8_t B    = vld1q_u16(input + x - 1);
+      uint16x8_t C    = vld1q_u16(input + x);
+      uint16x8_t D    = vld1q_u16(input + x + 1);
+      uint16x8_t E    = vld1q_u16(next  + x);
+      uint16x8_t skip = vorrq_u16(vceqq_u16(A, E), vceqq_u16(B, D));
+
+      out0.val[0]     = vbslq_u16(vbicq_u16(vceqq_u16(A, B), skip), A, C);
+      out0.val[1]     = vbslq_u16(vbicq_u16(vceqq_u16(A, D), skip), A, C);
+      out1.val[0]     = vbslq_u16(vbicq_u16(vceqq_u16(E, B), skip), E, C);
+      out1.val[1]     = vbslq_u16(vbicq_u16(vceqq_u16(E, D), skip), E, C);
+
+      vst2q_u16(output0 + (x << 1), out0);
+      vst2q_u16(output1 + (x << 1), out1);
+   }
+
+   return x;
+}
+#endif
+
 static void scale2x_work_cb_xrgb8888(void *data, void *thread_data)
 {
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
@@ -107,43 +332,30 @@ static void scale2x_work_cb_xrgb8888(void *data, void *thread_data)
    const uint32_t *input              = (const uint32_t*)thr->in_data;
    uint32_t *output0                  = (uint32_t*)thr->out_data;
    uint32_t *output1                  = (uint32_t*)thr->out_data + out_stride;
-   uint16_t x, y;
+   unsigned y;
 
    for (y = 0; y < thr->height; y++)
    {
+      unsigned x = 0;
       /* Determine offsets of previous/next source lines */
-      uint32_t line_prev = (y == 0)               ? 0 : in_stride;
-      uint32_t line_next = (y == thr->height - 1) ? 0 : in_stride;
+      const uint32_t *prev = input - ((y == 0)               ? 0 : in_stride);
+      const uint32_t *next = input + ((y == thr->height - 1) ? 0 : in_stride);
 
-      for (x = 0; x < thr->width; x++)
+#ifdef SCALE2X_HAVE_SIMD
+      if (thr->simd)
       {
-         /* Get sample points */
-         uint32_t A = *(input - line_prev);
-         uint32_t B = (x > 0) ? *(input - 1) : *input;
-         uint32_t C = *input;
-         uint32_t D = (x < thr->width - 1) ? *(input + 1) : *input;
-         uint32_t E = *(input++ + line_next);
-
-         /* Apply pixel expansion algorithm */
-         if (A != E && B != D)
-         {
-            *output0++ = (A == B ? A : C);
-            *output0++ = (A == D ? A : C);
-            *output1++ = (E == B ? E : C);
-            *output1++ = (E == D ? E : C);
-         }
-         else
-         {
-            *output0++ = C;
-            *output0++ = C;
-            *output1++ = C;
-            *output1++ = C;
-         }
+         scale2x_line_xrgb8888(input, prev, next,
+               output0, output1, 0, 1, thr->width);
+         x = scale2x_simd_line_xrgb8888(input, prev, next,
+               output0, output1, thr->width);
       }
+#endif
+      scale2x_line_xrgb8888(input, prev, next,
+            output0, output1, x, thr->width, thr->width);
 
-      input   += in_stride - thr->width;
-      output0 += (out_stride << 1) - (thr->width << 1);
-      output1 += (out_stride << 1) - (thr->width << 1);
+      input   += in_stride;
+      output0 += out_stride << 1;
+      output1 += out_stride << 1;
    }
 }
 
@@ -155,43 +367,30 @@ static void scale2x_work_cb_rgb565(void *data, void *thread_data)
    const uint16_t *input              = (const uint16_t*)thr->in_data;
    uint16_t *output0                  = (uint16_t*)thr->out_data;
    uint16_t *output1                  = (uint16_t*)thr->out_data + out_stride;
-   uint16_t x, y;
+   unsigned y;
 
    for (y = 0; y < thr->height; y++)
    {
+      unsigned x = 0;
       /* Determine offsets of previous/next source lines */
-      uint32_t line_prev = (y == 0)               ? 0 : in_stride;
-      uint32_t line_next = (y == thr->height - 1) ? 0 : in_stride;
+      const uint16_t *prev = input - ((y == 0)               ? 0 : in_stride);
+      const uint16_t *next = input + ((y == thr->height - 1) ? 0 : in_stride);
 
-      for (x = 0; x < thr->width; x++)
+#ifdef SCALE2X_HAVE_SIMD
+      if (thr->simd)
       {
-         /* Get sample points */
-         uint16_t A = *(input - line_prev);
-         uint16_t B = (x > 0) ? *(input - 1) : *input;
-         uint16_t C = *input;
-         uint16_t D = (x < thr->width - 1) ? *(input + 1) : *input;
-         uint16_t E = *(input++ + line_next);
-
-         /* Apply pixel expansion algorithm */
-         if (A != E && B != D)
-         {
-            *output0++ = (A == B ? A : C);
-            *output0++ = (A == D ? A : C);
-            *output1++ = (E == B ? E : C);
-            *output1++ = (E == D ? E : C);
-         }
-         else
-         {
-            *output0++ = C;
-            *output0++ = C;
-            *output1++ = C;
-            *output1++ = C;
-         }
+         scale2x_line_rgb565(input, prev, next,
+               output0, output1, 0, 1, thr->width);
+         x = scale2x_simd_line_rgb565(input, prev, next,
+               output0, output1, thr->width);
       }
+#endif
+      scale2x_line_rgb565(input, prev, next,
+            output0, output1, x, thr->width, thr->width);
 
-      input   += in_stride - thr->width;
-      output0 += (out_stride << 1) - (thr->width << 1);
-      output1 += (out_stride << 1) - (thr->width << 1);
+      input   += in_stride;
+      output0 += out_stride << 1;
+      output1 += out_stride << 1;
    }
 }
 
@@ -214,6 +413,9 @@ static void scale2x_generic_packets(void *data,
    thr->in_pitch                      = input_stride;
    thr->width                         = width;
    thr->height                        = height;
+#ifdef SCALE2X_HAVE_SIMD
+   thr->simd                          = (filt->simd & SCALE2X_SIMD_FLAG) != 0;
+#endif
 
    if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
       packets[0].work                 = scale2x_work_cb_xrgb8888;
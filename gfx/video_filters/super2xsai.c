@@ -19,6 +19,12 @@
 #include "softfilter.h"
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation supertwoxsai_get_implementation
 #define softfilter_thread_data supertwoxsai_softfilter_thread_data
@@ -38,6 +44,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   int simd;
 };
 
 struct filter_data
@@ -45,6 +52,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned supertwoxsai_generic_input_fmts(void)
@@ -81,6 +89,7 @@ static void *supertwoxsai_generic_create(const struct softfilter_config *config,
     * so force single threaded operation... */
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
 
    return filt;
 }
@@ -197,8 +206,224 @@ static void supertwoxsai_generic_destroy(void *data)
          out += 2
 #endif
 
+/* Branchless SIMD kernels, bit-identical to supertwoxsai_function:
+ * each product is a chain of mask selects over the values of all
+ * the cases, and result_cb is the difference of two equality masks.
+ * The kernels start at x = 0, as a vector of pixels reads exactly
+ * the neighbours the scalar code reads for them, and return the
+ * first column left to the scalar loop. */
+#if defined(__SSE2__)
+#define SUPERTWOXSAI_HAVE_SIMD
+#define SUPERTWOXSAI_SIMD_FLAG SOFTFILTER_SIMD_SSE2
+
+typedef __m128i supertwoxsai_vec32_t;
+typedef __m128i supertwoxsai_vec16_t;
+
+#define supertwoxsai_vec_load(bits, p)         _mm_loadu_si128((const __m128i*)(p))
+#define supertwoxsai_vec_store2(bits, p, a, b) \
+   _mm_storeu_si128((__m128i*)(p), _mm_unpacklo_epi##bits(a, b)); \
+   _mm_storeu_si128((__m128i*)(p) + 1, _mm_unpackhi_epi##bits(a, b))
+#define supertwoxsai_vec_dup(bits, v)          _mm_set1_epi##bits((int##bits##_t)(v))
+#define supertwoxsai_vec_eq(bits, a, b)        _mm_cmpeq_epi##bits(a, b)
+#define supertwoxsai_vec_and(bits, a, b)       _mm_and_si128(a, b)
+#define supertwoxsai_vec_or(bits, a, b)        _mm_or_si128(a, b)
+#define supertwoxsai_vec_andnot(bits, a, b)    _mm_andnot_si128(b, a)
+#define supertwoxsai_vec_select(bits, m, a, b) \
+   _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define supertwoxsai_vec_add(bits, a, b)       _mm_add_epi##bits(a, b)
+#define supertwoxsai_vec_sub(bits, a, b)       _mm_sub_epi##bits(a, b)
+#define supertwoxsai_vec_shr(bits, a, n)       _mm_srli_epi##bits(a, n)
+#define supertwoxsai_vec_gtz(bits, a)          _mm_cmpgt_epi##bits(a, _mm_setzero_si128())
+#define supertwoxsai_vec_ltz(bits, a)          _mm_cmplt_epi##bits(a, _mm_setzero_si128())
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define SUPERTWOXSAI_HAVE_SIMD
+#define SUPERTWOXSAI_SIMD_FLAG SOFTFILTER_SIMD_NEON
+
+typedef uint32x4_t supertwoxsai_vec32_t;
+typedef uint16x8_t supertwoxsai_vec16_t;
+
+#define supertwoxsai_vec_load(bits, p)         vld1q_u##bits(p)
+#define supertwoxsai_vec_store2(bits, p, a, b) \
+   vst1q_u##bits(p, vzipq_u##bits(a, b).val[0]); \
+   vst1q_u##bits((p) + 128 / bits, vzipq_u##bits(a, b).val[1])
+#define supertwoxsai_vec_dup(bits, v)          vdupq_n_u##bits(v)
+#define supertwoxsai_vec_eq(bits, a, b)        vceqq_u##bits(a, b)
+#define supertwoxsai_vec_and(bits, a, b)       vandq_u##bits(a, b)
+#define supertwoxsai_vec_or(bits, a, b)        vorrq_u##bits(a, b)
+#define supertwoxsai_vec_andnot(bits, a, b)    vbicq_u##bits(a, b)
+#define supertwoxsai_vec_select(bits, m, a, b) vbslq_u##bits(m, a, b)
+#define supertwoxsai_vec_add(bits, a, b)       vaddq_u##bits(a, b)
+#define supertwoxsai_vec_sub(bits, a, b)       vsubq_u##bits(a, b)
+#define supertwoxsai_vec_shr(bits, a, n)       vshrq_n_u##bits(a, n)
+#define supertwoxsai_vec_gtz(bits, a) \
+   vcgtq_s##bits(vreinterpretq_s##bits##_u##bits(a), vdupq_n_s##bits(0))
+#define supertwoxsai_vec_ltz(bits, a) \
+   vcltq_s##bits(vreinterpretq_s##bits##_u##bits(a), vdupq_n_s##bits(0))
+#endif
+
+#ifdef SUPERTWOXSAI_HAVE_SIMD
+#define supertwoxsai_vec_interpolate(bits, A, B, hi, lo) \
+   supertwoxsai_vec_add(bits, supertwoxsai_vec_add(bits, \
+         supertwoxsai_vec_shr(bits, supertwoxsai_vec_and(bits, A, supertwoxsai_vec_dup(bits, hi)), 1), \
+         supertwoxsai_vec_shr(bits, supertwoxsai_vec_and(bits, B, supertwoxsai_vec_dup(bits, hi)), 1)), \
+         supertwoxsai_vec_and(bits, supertwoxsai_vec_and(bits, A, B), supertwoxsai_vec_dup(bits, lo)))
+
+#define supertwoxsai_vec_interpolate2(bits, A, B, C, D, hi, lo) \
+   supertwoxsai_vec_add(bits, supertwoxsai_vec_add(bits, supertwoxsai_vec_add(bits, supertwoxsai_vec_add(bits, \
+         supertwoxsai_vec_shr(bits, supertwoxsai_vec_and(bits, A, supertwoxsai_vec_dup(bits, hi)), 2), \
+         supertwoxsai_vec_shr(bits, supertwoxsai_vec_and(bits, B, supertwoxsai_vec_dup(bits, hi)), 2)), \
+         supertwoxsai_vec_shr(bits, supertwoxsai_vec_and(bits, C, supertwoxsai_vec_dup(bits, hi)), 2)), \
+         supertwoxsai_vec_shr(bits, supertwoxsai_vec_and(bits, D, supertwoxsai_vec_dup(bits, hi)), 2)), \
+         supertwoxsai_vec_and(bits, supertwoxsai_vec_shr(bits, \
+            supertwoxsai_vec_add(bits, supertwoxsai_vec_add(bits, supertwoxsai_vec_add(bits, \
+            supertwoxsai_vec_and(bits, A, supertwoxsai_vec_dup(bits, lo)), \
+            supertwoxsai_vec_and(bits, B, supertwoxsai_vec_dup(bits, lo))), \
+            supertwoxsai_vec_and(bits, C, supertwoxsai_vec_dup(bits, lo))), \
+            supertwoxsai_vec_and(bits, D, supertwoxsai_vec_dup(bits, lo))), 2), \
+            supertwoxsai_vec_dup(bits, lo)))
+
+#define supertwoxsai_vec_interpolate_xrgb8888(A, B) supertwoxsai_vec_interpolate(32, A, B, 0xFEFEFEFE, 0x01010101)
+#define supertwoxsai_vec_interpolate2_xrgb8888(A, B, C, D) supertwoxsai_vec_interpolate2(32, A, B, C, D, 0xFCFCFCFC, 0x03030303)
+#define supertwoxsai_vec_interpolate_rgb565(A, B) supertwoxsai_vec_interpolate(16, A, B, 0xF7DE, 0x0821)
+#define supertwoxsai_vec_interpolate2_rgb565(A, B, C, D) supertwoxsai_vec_interpolate2(16, A, B, C, D, 0xE79C, 0x1863)
+
+/* All ones in lanes where the scalar result_cb term for X is 0 */
+#define supertwoxsai_vec_same(bits, X, C, D) \
+   supertwoxsai_vec_and(bits, supertwoxsai_vec_eq(bits, X, C), supertwoxsai_vec_eq(bits, X, D))
+
+#define supertwoxsai_vec_result(bits, A, B, C, D) \
+   supertwoxsai_vec_sub(bits, supertwoxsai_vec_same(bits, A, C, D), supertwoxsai_vec_same(bits, B, C, D))
+
+#define supertwoxsai_vec_declare_variables(vec_t, bits, in, nextline) \
+         const vec_t colorB0 = supertwoxsai_vec_load(bits, in - nextline - 1); \
+         const vec_t colorB1 = supertwoxsai_vec_load(bits, in - nextline + 0); \
+         const vec_t colorB2 = supertwoxsai_vec_load(bits, in - nextline + 1); \
+         const vec_t colorB3 = supertwoxsai_vec_load(bits, in - nextline + 2); \
+         const vec_t color4  = supertwoxsai_vec_load(bits, in - 1); \
+         const vec_t color5  = supertwoxsai_vec_load(bits, in + 0); \
+         const vec_t color6  = supertwoxsai_vec_load(bits, in + 1); \
+         const vec_t colorS2 = supertwoxsai_vec_load(bits, in + 2); \
+         const vec_t color1  = supertwoxsai_vec_load(bits, in + nextline - 1); \
+         const vec_t color2  = supertwoxsai_vec_load(bits, in + nextline + 0); \
+         const vec_t color3  = supertwoxsai_vec_load(bits, in + nextline + 1); \
+         const vec_t colorS1 = supertwoxsai_vec_load(bits, in + nextline + 2); \
+         const vec_t colorA0 = supertwoxsai_vec_load(bits, in + nextline + nextline - 1); \
+         const vec_t colorA1 = supertwoxsai_vec_load(bits, in + nextline + nextline + 0); \
+         const vec_t colorA2 = supertwoxsai_vec_load(bits, in + nextline + nextline + 1); \
+         const vec_t colorA3 = supertwoxsai_vec_load(bits, in + nextline + nextline + 2)
+
+/* case1: 2 == 6 && 5 != 3, case2: 5 == 3 && 2 != 6,
+ * case3: 5 == 3 && 2 == 6, anything else is the last case.
+ * The two rules of each else-if chain in the last case disagree
+ * on 5 == B2 (2 == A2), so they can be selected in any order. */
+#define supertwoxsai_vec_function(vec_t, bits, interpolate_cb, interpolate2_cb) \
+         const vec_t eq26      = supertwoxsai_vec_eq(bits, color2, color6); \
+         const vec_t eq53      = supertwoxsai_vec_eq(bits, color5, color3); \
+         const vec_t case1     = supertwoxsai_vec_andnot(bits, eq26, eq53); \
+         const vec_t case2     = supertwoxsai_vec_andnot(bits, eq53, eq26); \
+         const vec_t case3     = supertwoxsai_vec_and(bits, eq53, eq26); \
+         const vec_t r         = supertwoxsai_vec_add(bits, supertwoxsai_vec_add(bits, \
+                  supertwoxsai_vec_result(bits, color6, color5, color1, colorA1), \
+                  supertwoxsai_vec_result(bits, color6, color5, color4, colorB1)), \
+               supertwoxsai_vec_add(bits, \
+                  supertwoxsai_vec_result(bits, color6, color5, colorA2, colorS1), \
+                  supertwoxsai_vec_result(bits, color6, color5, colorB2, colorS2))); \
+         const vec_t i56       = interpolate_cb(color5, color6); \
+         const vec_t i25       = interpolate_cb(color2, color5); \
+         const vec_t value3    = supertwoxsai_vec_select(bits, supertwoxsai_vec_gtz(bits, r), color6, \
+               supertwoxsai_vec_select(bits, supertwoxsai_vec_ltz(bits, r), color5, i56)); \
+         const vec_t rule1b    = supertwoxsai_vec_andnot(bits, supertwoxsai_vec_andnot(bits, \
+                  supertwoxsai_vec_and(bits, supertwoxsai_vec_eq(bits, color6, color3), \
+                     supertwoxsai_vec_eq(bits, color6, colorB1)), \
+                  supertwoxsai_vec_eq(bits, color5, colorB2)), \
+               supertwoxsai_vec_eq(bits, color6, colorB0)); \
+         const vec_t rule1b2   = supertwoxsai_vec_andnot(bits, supertwoxsai_vec_andnot(bits, \
+                  supertwoxsai_vec_and(bits, supertwoxsai_vec_eq(bits, color5, color2), \
+                     supertwoxsai_vec_eq(bits, color5, colorB2)), \
+                  supertwoxsai_vec_eq(bits, colorB1, color6)), \
+               supertwoxsai_vec_eq(bits, color5, colorB3)); \
+         const vec_t rule2b    = supertwoxsai_vec_andnot(bits, supertwoxsai_vec_andnot(bits, \
+                  supertwoxsai_vec_and(bits, supertwoxsai_vec_eq(bits, color6, color3), \
+                     supertwoxsai_vec_eq(bits, color3, colorA1)), \
+                  supertwoxsai_vec_eq(bits, color2, colorA2)), \
+               supertwoxsai_vec_eq(bits, color3, colorA0)); \
+         const vec_t rule2b2   = supertwoxsai_vec_andnot(bits, supertwoxsai_vec_andnot(bits, \
+                  supertwoxsai_vec_and(bits, supertwoxsai_vec_eq(bits, color5, color2), \
+                     supertwoxsai_vec_eq(bits, color2, colorA2)), \
+                  supertwoxsai_vec_eq(bits, colorA1, color3)), \
+               supertwoxsai_vec_eq(bits, color2, colorA3)); \
+         const vec_t product1b = supertwoxsai_vec_select(bits, case1, color2, \
+               supertwoxsai_vec_select(bits, case2, color5, \
+               supertwoxsai_vec_select(bits, case3, value3, \
+               supertwoxsai_vec_select(bits, rule1b, interpolate2_cb(color6, color6, color6, color5), \
+               supertwoxsai_vec_select(bits, rule1b2, interpolate2_cb(color6, color5, color5, color5), \
+                  i56))))); \
+         const vec_t product2b = supertwoxsai_vec_select(bits, case1, color2, \
+               supertwoxsai_vec_select(bits, case2, color5, \
+               supertwoxsai_vec_select(bits, case3, value3, \
+               supertwoxsai_vec_select(bits, rule2b, interpolate2_cb(color3, color3, color3, color2), \
+               supertwoxsai_vec_select(bits, rule2b2, interpolate2_cb(color2, color2, color2, color3), \
+                  interpolate_cb(color2, color3)))))); \
+         const vec_t rule2a    = supertwoxsai_vec_or(bits, \
+               supertwoxsai_vec_andnot(bits, \
+                  supertwoxsai_vec_and(bits, case2, supertwoxsai_vec_eq(bits, color4, color5)), \
+                  supertwoxsai_vec_eq(bits, color5, colorA2)), \
+               supertwoxsai_vec_andnot(bits, supertwoxsai_vec_andnot(bits, \
+                     supertwoxsai_vec_and(bits, supertwoxsai_vec_eq(bits, color5, color1), \
+                        supertwoxsai_vec_eq(bits, color6, color5)), \
+                     supertwoxsai_vec_eq(bits, color4, color2)), \
+                  supertwoxsai_vec_eq(bits, color5, colorA0))); \
+         const vec_t rule1a    = supertwoxsai_vec_or(bits, \
+               supertwoxsai_vec_andnot(bits, \
+                  supertwoxsai_vec_and(bits, case1, supertwoxsai_vec_eq(bits, color1, color2)), \
+                  supertwoxsai_vec_eq(bits, color2, colorB2)), \
+               supertwoxsai_vec_andnot(bits, supertwoxsai_vec_andnot(bits, \
+                     supertwoxsai_vec_and(bits, supertwoxsai_vec_eq(bits, color4, color2), \
+                        supertwoxsai_vec_eq(bits, color3, color2)), \
+                     supertwoxsai_vec_eq(bits, color1, color5)), \
+                  supertwoxsai_vec_eq(bits, color2, colorB0))); \
+         const vec_t product2a = supertwoxsai_vec_select(bits, rule2a, i25, color2); \
+         const vec_t product1a = supertwoxsai_vec_select(bits, rule1a, i25, color5); \
+         supertwoxsai_vec_store2(bits, out, product1a, product1b); \
+         supertwoxsai_vec_store2(bits, out + dst_stride, product2a, product2b)
+
+static unsigned supertwoxsai_simd_line_xrgb8888(const uint32_t *in,
+      unsigned nextline, uint32_t *out, unsigned dst_stride,
+      unsigned width)
+{
+   unsigned x;
+
+   for (x = 0; x + 4 <= width; x += 4, in += 4, out += 8)
+   {
+      supertwoxsai_vec_declare_variables(supertwoxsai_vec32_t, 32, in, nextline);
+      supertwoxsai_vec_function(supertwoxsai_vec32_t, 32,
+            supertwoxsai_vec_interpolate_xrgb8888,
+            supertwoxsai_vec_interpolate2_xrgb8888);
+   }
+
+   return x;
+}
+
+static unsigned supertwoxsai_simd_line_rgb565(const uint16_t *in,
+      unsigned nextline, uint16_t *out, unsigned dst_stride,
+      unsigned width)
+{
+   unsigned x;
+
+   for (x = 0; x + 8 <= width; x += 8, in += 8, out += 16)
+   {
+      supertwoxsai_vec_declare_variables(supertwoxsai_vec16_t, 16, in, nextline);
+      supertwoxsai_vec_function(supertwoxsai_vec16_t, 16,
+            supertwoxsai_vec_interpolate_rgb565,
+            supertwoxsai_vec_interpolate2_rgb565);
+   }
+
+   return x;
+}
+#endif
+
 static void supertwoxsai_generic_xrgb8888(unsigned width, unsigned height,
-      int first, int last, uint32_t *src,
+      int first, int last, int simd, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -208,8 +433,18 @@ static void supertwoxsai_generic_xrgb8888(unsigned width, unsigned height,
    {
       uint32_t *in  = (uint32_t*)src;
       uint32_t *out = (uint32_t*)dst;
+      unsigned x    = 0;
+
+#ifdef SUPERTWOXSAI_HAVE_SIMD
+      if (simd)
+      {
+         x    = supertwoxsai_simd_line_xrgb8888(in, nextline, out, dst_stride, width);
+         in  += x;
+         out += x << 1;
+      }
+#endif
 
-      for (finish = width; finish; finish -= 1)
+      for (finish = width - x; finish; finish -= 1)
       {
          supertwoxsai_declare_variables(uint32_t, in, nextline);
 
@@ -229,7 +464,7 @@ static void supertwoxsai_generic_xrgb8888(unsigned width, unsigned height,
 }
 
 static void supertwoxsai_generic_rgb565(unsigned width, unsigned height,
-      int first, int last, uint16_t *src,
+      int first, int last, int simd, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -239,8 +474,18 @@ static void supertwoxsai_generic_rgb565(unsigned width, unsigned height,
    {
       uint16_t *in  = (uint16_t*)src;
       uint16_t *out = (uint16_t*)dst;
+      unsigned x    = 0;
 
-      for (finish = width; finish; finish -= 1)
+#ifdef SUPERTWOXSAI_HAVE_SIMD
+      if (simd)
+      {
+         x    = supertwoxsai_simd_line_rgb565(in, nextline, out, dst_stride, width);
+         in  += x;
+         out += x << 1;
+      }
+#endif
+
+      for (finish = width - x; finish; finish -= 1)
       {
          supertwoxsai_declare_variables(uint16_t, in, nextline);
 
@@ -267,7 +512,7 @@ static void supertwoxsai_work_cb_rgb565(void *data, void *thread_data)
    unsigned width                     = thr->width;
    unsigned height                    = thr->height;
    supertwoxsai_generic_rgb565(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd, input,
         (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
         output,
         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -281,7 +526,7 @@ static void supertwoxsai_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned width                     = thr->width;
    unsigned height                    = thr->height;
    supertwoxsai_generic_xrgb8888(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd, input,
 	 (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
 	 output,
 	 (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
@@ -312,6 +557,9 @@ static void supertwoxsai_generic_packets(void *data,
        * outside their given buffer. */
       thr->first             = y_start;
       thr->last              = y_end == height;
+#ifdef SUPERTWOXSAI_HAVE_SIMD
+      thr->simd               = (filt->simd & SUPERTWOXSAI_SIMD_FLAG) != 0;
+#endif
 
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
          packets[i].work     = supertwoxsai_work_cb_rgb565;
@@ -19,6 +19,12 @@
 #include "softfilter.h"
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation supereagle_get_implementation
 #define softfilter_thread_data supereagle_softfilter_thread_data
@@ -38,6 +44,7 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   int simd;
 };
 
 struct filter_data
@@ -45,6 +52,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_simd_mask_t simd;
 };
 
 static unsigned supereagle_generic_input_fmts(void)
@@ -78,6 +86,7 @@ static void *supereagle_generic_create(const struct softfilter_config *config,
    }
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   filt->simd    = simd;
    return filt;
 }
 
@@ -210,8 +219,201 @@ static void supereagle_generic_destroy(void *data)
          out += 2
 #endif
 
+/* Branchless SIMD kernels. The case masks of supereagle_function
+ * pick between the products of every case, so the output is
+ * bit-identical to the scalar code; result_cb turns into the
+ * difference of two equality masks. A vector of pixels reads the
+ * same neighbours as the scalar loop, so the kernels run from
+ * x = 0 and return the first column left to the scalar code. */
+#if defined(__SSE2__)
+#define SUPEREAGLE_HAVE_SIMD
+#define SUPEREAGLE_SIMD_FLAG SOFTFILTER_SIMD_SSE2
+
+typedef __m128i supereagle_vec32_t;
+typedef __m128i supereagle_vec16_t;
+
+#define supereagle_vec_load(bits, p)         _mm_loadu_si128((const __m128i*)(p))
+#define supereagle_vec_store2(bits, p, a, b) \
+   _mm_storeu_si128((__m128i*)(p), _mm_unpacklo_epi##bits(a, b)); \
+   _mm_storeu_si128((__m128i*)(p) + 1, _mm_unpackhi_epi##bits(a, b))
+#define supereagle_vec_dup(bits, v)          _mm_set1_epi##bits((int##bits##_t)(v))
+#define supereagle_vec_eq(bits, a, b)        _mm_cmpeq_epi##bits(a, b)
+#define supereagle_vec_and(bits, a, b)       _mm_and_si128(a, b)
+#define supereagle_vec_or(bits, a, b)        _mm_or_si128(a, b)
+#define supereagle_vec_andnot(bits, a, b)    _mm_andnot_si128(b, a)
+#define supereagle_vec_select(bits, m, a, b) \
+   _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b))
+#define supereagle_vec_add(bits, a, b)       _mm_add_epi##bits(a, b)
+#define supereagle_vec_sub(bits, a, b)       _mm_sub_epi##bits(a, b)
+#define supereagle_vec_shr(bits, a, n)       _mm_srli_epi##bits(a, n)
+#define supereagle_vec_gtz(bits, a)          _mm_cmpgt_epi##bits(a, _mm_setzero_si128())
+#define supereagle_vec_ltz(bits, a)          _mm_cmplt_epi##bits(a, _mm_setzero_si128())
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define SUPEREAGLE_HAVE_SIMD
+#define SUPEREAGLE_SIMD_FLAG SOFTFILTER_SIMD_NEON
+
+typedef uint32x4_t supereagle_vec32_t;
+typedef uint16x8_t supereagle_vec16_t;
+
+#define supereagle_vec_load(bits, p)         vld1q_u##bits(p)
+#define supereagle_vec_store2(bits, p, a, b) \
+   vst1q_u##bits(p, vzipq_u##bits(a, b).val[0]); \
+   vst1q_u##bits((p) + 128 / bits, vzipq_u##bits(a, b).val[1])
+#define supereagle_vec_dup(bits, v)          vdupq_n_u##bits(v)
+#define supereagle_vec_eq(bits, a, b)        vceqq_u##bits(a, b)
+#define supereagle_vec_and(bits, a, b)       vandq_u##bits(a, b)
+#define supereagle_vec_or(bits, a, b)        vorrq_u##bits(a, b)
+#define supereagle_vec_andnot(bits, a, b)    vbicq_u##bits(a, b)
+#define supereagle_vec_select(bits, m, a, b) vbslq_u##bits(m, a, b)
+#define supereagle_vec_add(bits, a, b)       vaddq_u##bits(a, b)
+#define supereagle_vec_sub(bits, a, b)       vsubq_u##bits(a, b)
+#define supereagle_vec_shr(bits, a, n)       vshrq_n_u##bits(a, n)
+#define supereagle_vec_gtz(bits, a) \
+   vcgtq_s##bits(vreinterpretq_s##bits##_u##bits(a), vdupq_n_s##bits(0))
+#define supereagle_vec_ltz(bits, a) \
+   vcltq_s##bits(vreinterpretq_s##bits##_u##bits(a), vdupq_n_s##bits(0))
+#endif
+
+#ifdef SUPEREAGLE_HAVE_SIMD
+#define supereagle_vec_interpolate(bits, A, B, hi, lo) \
+   supereagle_vec_add(bits, supereagle_vec_add(bits, \
+         supereagle_vec_shr(bits, supereagle_vec_and(bits, A, supereagle_vec_dup(bits, hi)), 1), \
+         supereagle_vec_shr(bits, supereagle_vec_and(bits, B, supereagle_vec_dup(bits, hi)), 1)), \
+         supereagle_vec_and(bits, supereagle_vec_and(bits, A, B), supereagle_vec_dup(bits, lo)))
+
+#define supereagle_vec_interpolate2(bits, A, B, C, D, hi, lo) \
+   supereagle_vec_add(bits, supereagle_vec_add(bits, supereagle_vec_add(bits, supereagle_vec_add(bits, \
+         supereagle_vec_shr(bits, supereagle_vec_and(bits, A, supereagle_vec_dup(bits, hi)), 2), \
+         supereagle_vec_shr(bits, supereagle_vec_and(bits, B, supereagle_vec_dup(bits, hi)), 2)), \
+         supereagle_vec_shr(bits, supereagle_vec_and(bits, C, supereagle_vec_dup(bits, hi)), 2)), \
+         supereagle_vec_shr(bits, supereagle_vec_and(bits, D, supereagle_vec_dup(bits, hi)), 2)), \
+         supereagle_vec_and(bits, supereagle_vec_shr(bits, \
+            supereagle_vec_add(bits, supereagle_vec_add(bits, supereagle_vec_add(bits, \
+            supereagle_vec_and(bits, A, supereagle_vec_dup(bits, lo)), \
+            supereagle_vec_and(bits, B, supereagle_vec_dup(bits, lo))), \
+            supereagle_vec_and(bits, C, supereagle_vec_dup(bits, lo))), \
+            supereagle_vec_and(bits, D, supereagle_vec_dup(bits, lo))), 2), \
+            supereagle_vec_dup(bits, lo)))
+
+#define supereagle_vec_interpolate_xrgb8888(A, B) supereagle_vec_interpolate(32, A, B, 0xFEFEFEFE, 0x01010101)
+#define supereagle_vec_interpolate2_xrgb8888(A, B, C, D) supereagle_vec_interpolate2(32, A, B, C, D, 0xFCFCFCFC, 0x03030303)
+#define supereagle_vec_interpolate_rgb565(A, B) supereagle_vec_interpolate(16, A, B, 0xF7DE, 0x0821)
+#define supereagle_vec_interpolate2_rgb565(A, B, C, D) supereagle_vec_interpolate2(16, A, B, C, D, 0xE79C, 0x1863)
+
+/* All ones in lanes where the scalar result_cb term for X is 0 */
+#define supereagle_vec_same(bits, X, C, D) \
+   supereagle_vec_and(bits, supereagle_vec_eq(bits, X, C), supereagle_vec_eq(bits, X, D))
+
+#define supereagle_vec_result(bits, A, B, C, D) \
+   supereagle_vec_sub(bits, supereagle_vec_same(bits, A, C, D), supereagle_vec_same(bits, B, C, D))
+
+#define supereagle_vec_declare_variables(vec_t, bits, in, nextline) \
+         const vec_t colorB1 = supereagle_vec_load(bits, in - nextline + 0); \
+         const vec_t colorB2 = supereagle_vec_load(bits, in - nextline + 1); \
+         const vec_t color4  = supereagle_vec_load(bits, in - 1); \
+         const vec_t color5  = supereagle_vec_load(bits, in + 0); \
+         const vec_t color6  = supereagle_vec_load(bits, in + 1); \
+         const vec_t colorS2 = supereagle_vec_load(bits, in + 2); \
+         const vec_t color1  = supereagle_vec_load(bits, in + nextline - 1); \
+         const vec_t color2  = supereagle_vec_load(bits, in + nextline + 0); \
+         const vec_t color3  = supereagle_vec_load(bits, in + nextline + 1); \
+         const vec_t colorS1 = supereagle_vec_load(bits, in + nextline + 2); \
+         const vec_t colorA1 = supereagle_vec_load(bits, in + nextline + nextline + 0); \
+         const vec_t colorA2 = supereagle_vec_load(bits, in + nextline + nextline + 1)
+
+/* case1: 2 == 6 && 5 != 3, case2: 5 == 3 && 2 != 6,
+ * case3: 5 == 3 && 2 == 6, anything else is the last case. */
+#define supereagle_vec_function(vec_t, bits, interpolate_cb, interpolate2_cb) \
+         const vec_t eq26      = supereagle_vec_eq(bits, color2, color6); \
+         const vec_t eq53      = supereagle_vec_eq(bits, color5, color3); \
+         const vec_t case1     = supereagle_vec_andnot(bits, eq26, eq53); \
+         const vec_t case2     = supereagle_vec_andnot(bits, eq53, eq26); \
+         const vec_t case3     = supereagle_vec_and(bits, eq53, eq26); \
+         const vec_t r         = supereagle_vec_add(bits, supereagle_vec_add(bits, \
+                  supereagle_vec_result(bits, color6, color5, color1, colorA1), \
+                  supereagle_vec_result(bits, color6, color5, color4, colorB1)), \
+               supereagle_vec_add(bits, \
+                  supereagle_vec_result(bits, color6, color5, colorA2, colorS1), \
+                  supereagle_vec_result(bits, color6, color5, colorB2, colorS2))); \
+         const vec_t rpos      = supereagle_vec_and(bits, case3, supereagle_vec_gtz(bits, r)); \
+         const vec_t rneg      = supereagle_vec_and(bits, case3, supereagle_vec_ltz(bits, r)); \
+         const vec_t i56       = interpolate_cb(color5, color6); \
+         const vec_t i25       = interpolate_cb(color2, color5); \
+         const vec_t i23       = interpolate_cb(color2, color3); \
+         const vec_t i26       = interpolate_cb(color2, color6); \
+         const vec_t i53       = interpolate_cb(color5, color3); \
+         const vec_t product1a = supereagle_vec_select(bits, case1, \
+               supereagle_vec_select(bits, supereagle_vec_or(bits, \
+                     supereagle_vec_eq(bits, color1, color2), \
+                     supereagle_vec_eq(bits, color6, colorB2)), \
+                  interpolate_cb(color2, i25), i56), \
+               supereagle_vec_select(bits, supereagle_vec_or(bits, case2, case3), \
+                  supereagle_vec_select(bits, rpos, i56, color5), \
+                  interpolate2_cb(color5, color5, color5, i26))); \
+         const vec_t product2b = supereagle_vec_select(bits, case1, \
+               supereagle_vec_select(bits, supereagle_vec_or(bits, \
+                     supereagle_vec_eq(bits, color6, colorS2), \
+                     supereagle_vec_eq(bits, color2, colorA1)), \
+                  interpolate_cb(color2, i23), i23), \
+               supereagle_vec_select(bits, supereagle_vec_or(bits, case2, case3), \
+                  supereagle_vec_select(bits, rpos, i56, color5), \
+                  interpolate2_cb(color3, color3, color3, i26))); \
+         const vec_t product1b = supereagle_vec_select(bits, case2, \
+               supereagle_vec_select(bits, supereagle_vec_or(bits, \
+                     supereagle_vec_eq(bits, colorB1, color5), \
+                     supereagle_vec_eq(bits, color3, colorS1)), \
+                  interpolate_cb(color5, i56), i56), \
+               supereagle_vec_select(bits, supereagle_vec_or(bits, case1, case3), \
+                  supereagle_vec_select(bits, rneg, i56, color2), \
+                  interpolate2_cb(color6, color6, color6, i53))); \
+         const vec_t product2a = supereagle_vec_select(bits, case2, \
+               supereagle_vec_select(bits, supereagle_vec_or(bits, \
+                     supereagle_vec_eq(bits, color3, colorA2), \
+                     supereagle_vec_eq(bits, color4, color5)), \
+                  interpolate_cb(color5, i25), i23), \
+               supereagle_vec_select(bits, supereagle_vec_or(bits, case1, case3), \
+                  supereagle_vec_select(bits, rneg, i56, color2), \
+                  interpolate2_cb(color2, color2, color2, i53))); \
+         supereagle_vec_store2(bits, out, product1a, product1b); \
+         supereagle_vec_store2(bits, out + dst_stride, product2a, product2b)
+
+static unsigned supereagle_simd_line_xrgb8888(const uint32_t *in,
+      unsigned nextline, uint32_t *out, unsigned dst_stride,
+      unsigned width)
+{
+   unsigned x;
+
+   for (x = 0; x + 4 <= width; x += 4, in += 4, out += 8)
+   {
+      supereagle_vec_declare_variables(supereagle_vec32_t, 32, in, nextline);
+      supereagle_vec_function(supereagle_vec32_t, 32,
+            supereagle_vec_interpolate_xrgb8888,
+            supereagle_vec_interpolate2_xrgb8888);
+   }
+
+   return x;
+}
+
+static unsigned supereagle_simd_line_rgb565(const uint16_t *in,
+      unsigned nextline, uint16_t *out, unsigned dst_stride,
+      unsigned width)
+{
+   unsigned x;
+
+   for (x = 0; x + 8 <= width; x += 8, in += 8, out += 16)
+   {
+      supereagle_vec_declare_variables(supereagle_vec16_t, 16, in, nextline);
+      supereagle_vec_function(supereagle_vec16_t, 16,
+            supereagle_vec_interpolate_rgb565,
+            supereagle_vec_interpolate2_rgb565);
+   }
+
+   return x;
+}
+#endif
+
 static void supereagle_generic_xrgb8888(unsigned width, unsigned height,
-      int first, int last, uint32_t *src,
+      int first, int last, int simd, uint32_t *src,
       unsigned src_stride, uint32_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -221,8 +423,18 @@ static void supereagle_generic_xrgb8888(unsigned width, unsigned height,
    {
       uint32_t *in  = (uint32_t*)src;
       uint32_t *out = (uint32_t*)dst;
+      unsigned x    = 0;
+
+#ifdef SUPEREAGLE_HAVE_SIMD
+      if (simd)
+      {
+         x    = supereagle_simd_line_xrgb8888(in, nextline, out, dst_stride, width);
+         in  += x;
+         out += x << 1;
+      }
+#endif
 
-      for (finish = width; finish; finish -= 1)
+      for (finish = width - x; finish; finish -= 1)
       {
          supereagle_declare_variables(uint32_t, in, nextline);
          supereagle_function(supereagle_result, supereagle_interpolate_xrgb8888, supereagle_interpolate2_xrgb8888);
@@ -234,7 +446,7 @@ static void supereagle_generic_xrgb8888(unsigned width, unsigned height,
 }
 
 static void supereagle_generic_rgb565(unsigned width, unsigned height,
-      int first, int last, uint16_t *src,
+      int first, int last, int simd, uint16_t *src,
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
    unsigned finish;
@@ -244,8 +456,18 @@ static void supereagle_generic_rgb565(unsigned width, unsigned height,
    {
       uint16_t *in  = (uint16_t*)src;
       uint16_t *out = (uint16_t*)dst;
+      unsigned x    = 0;
 
-      for (finish = width; finish; finish -= 1)
+#ifdef SUPEREAGLE_HAVE_SIMD
+      if (simd)
+      {
+         x    = supereagle_simd_line_rgb565(in, nextline, out, dst_stride, width);
+         in  += x;
+         out += x << 1;
+      }
+#endif
+
+      for (finish = width - x; finish; finish -= 1)
       {
          supereagle_declare_variables(uint16_t, in, nextline);
          supereagle_function(supereagle_result, supereagle_interpolate_rgb565, supereagle_interpolate2_rgb565);
@@ -265,7 +487,7 @@ static void supereagle_work_cb_rgb565(void *data, void *thread_data)
    unsigned height  = thr->height;
 
    supereagle_generic_rgb565(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
@@ -280,7 +502,7 @@ static void supereagle_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned height  = thr->height;
 
    supereagle_generic_xrgb8888(width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->simd, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
          output,
          (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
@@ -310,6 +532,9 @@ static void supereagle_generic_packets(void *data,
       /* Workers need to know if they can access pixels outside their given buffer. */
       thr->first             = y_start;
       thr->last              = y_end == height;
+#ifdef SUPEREAGLE_HAVE_SIMD
+      thr->simd               = (filt->simd & SUPEREAGLE_SIMD_FLAG) != 0;
+#endif
 
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
          packets[i].work     = supereagle_work_cb_rgb565;
@@ -240,6 +240,7 @@ CHEATS
 ============================================================ */
 #ifdef HAVE_CHEATS
 #include "../cheat_manager.c"
+#include "../cheat_search.c"
 #endif
 #include "../libretro-common/hash/lrc_hash.c"
 
@@ -795,6 +796,9 @@ AUDIO RESAMPLER
 #ifdef HAVE_NEAREST_RESAMPLER
 #include "../libretro-common/audio/resampler/drivers/nearest_resampler.c"
 #endif
+#ifdef HAVE_POLYPHASE_RESAMPLER
+#include "../libretro-common/audio/resampler/drivers/polyphase_resampler.c"
+#endif
 #ifdef HAVE_CC_RESAMPLER
 #include "../audio/drivers_resampler/cc_resampler.c"
 #endif
@@ -1073,6 +1077,9 @@ FILE
 #include "../libretro-common/file/nbio/nbio_stdio.c"
 #if defined(__linux__)
 #include "../libretro-common/file/nbio/nbio_linux.c"
+#if defined(HAVE_IO_URING)
+#include "../libretro-common/file/nbio/nbio_uring.c"
+#endif
 #endif
 #if defined(HAVE_MMAP) && defined(BSD)
 #include "../libretro-common/file/nbio/nbio_unixmmap.c"
@@ -1098,6 +1105,7 @@ STATE MANAGER
 #ifdef HAVE_REWIND
 #include "../state_manager.c"
 #endif
+#include "../state_manager_raw.c"
 
 /*============================================================
 FRONTEND
@@ -1218,6 +1226,8 @@ RECORDING
 ============================================================ */
 #include "../record/record_driver.c"
 #include "../record/drivers/record_wav.c"
+#include "../record/drivers/record_rcap.c"
+#include "../record/drivers/rcap_codec.c"
 #ifdef HAVE_FFMPEG
 #include "../record/drivers/record_ffmpeg.c"
 #endif
@@ -1244,6 +1254,7 @@ NETPLAY
 ============================================================ */
 #ifdef HAVE_NETWORKING
 #include "../network/natt.c"
+#include "../network/netplay/netplay_buf.c"
 #include "../network/netplay/netplay_frontend.c"
 #include "../network/netplay/netplay_room_parse.c"
 #include "../libretro-common/net/net_compat.c"
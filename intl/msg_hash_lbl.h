@@ -2492,6 +2492,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_RANGE,
    "netplay_input_latency_frames_range"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_NETPLAY_REPLAY_BUDGET,
+   "netplay_replay_budget"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_NETPLAY_DISCONNECT,
    "menu_netplay_disconnect"
@@ -3544,6 +3548,10 @@ MSG_HASH(
    MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION,
    "savestate_file_compression"
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION_LEVEL,
+   "savestate_file_compression_level"
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_SAVESTATE_AUTO_SAVE,
    "savestate_auto_save"
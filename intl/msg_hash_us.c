@@ -452,6 +452,9 @@ int msg_hash_get_help_us_enum(enum msg_hash_enums msg, char *s, size_t len)
           case MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_RANGE:
              strlcpy(s, msg_hash_to_str(MENU_ENUM_LABEL_HELP_NETPLAY_INPUT_LATENCY_FRAMES_RANGE), len);
              break;
+          case MENU_ENUM_LABEL_NETPLAY_REPLAY_BUDGET:
+             strlcpy(s, msg_hash_to_str(MENU_ENUM_LABEL_HELP_NETPLAY_REPLAY_BUDGET), len);
+             break;
           case MENU_ENUM_LABEL_VIDEO_MAX_SWAPCHAIN_IMAGES:
              strlcpy(s, msg_hash_to_str(MENU_ENUM_LABEL_HELP_VIDEO_MAX_SWAPCHAIN_IMAGES), len);
              break;
@@ -4871,6 +4871,14 @@ MSG_HASH(
    MENU_ENUM_SUBLABEL_SAVESTATE_FILE_COMPRESSION,
    "Write save state files in an archived format. Dramatically reduces file size at the expense of increased saving/loading times."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_SAVESTATE_FILE_COMPRESSION_LEVEL,
+   "Save State Compression Level"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_SAVESTATE_FILE_COMPRESSION_LEVEL,
+   "Compression level of save state files, from 1 (fastest saving) to 9 (smallest files). Loading is equally fast at any level."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_SORT_SCREENSHOTS_BY_CONTENT_ENABLE,
    "Sort Screenshots into Folders by Content Directory"
@@ -7653,6 +7661,18 @@ MSG_HASH(
    MENU_ENUM_LABEL_HELP_NETPLAY_INPUT_LATENCY_FRAMES_RANGE,
    "The range of frames of input latency that may be used by netplay to hide network latency.\nIf set, netplay will adjust the number of frames of input latency dynamically to balance CPU time, input latency and network latency. This reduces jitter and makes netplay less CPU-intensive, but at the price of unpredictable input lag."
    )
+MSG_HASH(
+   MENU_ENUM_LABEL_VALUE_NETPLAY_REPLAY_BUDGET,
+   "Rollback Time Budget (ms)"
+   )
+MSG_HASH(
+   MENU_ENUM_SUBLABEL_NETPLAY_REPLAY_BUDGET,
+   "The time netplay may spend per frame replaying frames after late input, before the rest is spread over the next frames. Reduces hitches with demanding cores, at the expense of corrections showing up later. Set to zero for no limit."
+   )
+MSG_HASH(
+   MENU_ENUM_LABEL_HELP_NETPLAY_REPLAY_BUDGET,
+   "The time netplay may spend per frame replaying frames after late input.\nWhen input from a peer arrives late, netplay replays every frame since then to correct its prediction. With demanding cores, this can take long enough to cause a visible hitch. If set, replays expected to take longer than this are spread over the next frames, while the predicted game keeps running, at the price of corrections showing up a few frames later. Set to zero to always replay all at once."
+   )
 MSG_HASH(
    MENU_ENUM_LABEL_VALUE_NETPLAY_NAT_TRAVERSAL,
    "Netplay NAT Traversal"
@@ -39,7 +39,8 @@ retro_resampler_t null_resampler = {
    resampler_null_free,
    RESAMPLER_API_VERSION,
    "null",
-   "null"
+   "null",
+   NULL
 };
 
 static const retro_resampler_t *resampler_drivers[] = {
@@ -49,6 +50,9 @@ static const retro_resampler_t *resampler_drivers[] = {
 #endif
 #ifdef HAVE_NEAREST_RESAMPLER
    &nearest_resampler,
+#endif
+#ifdef HAVE_POLYPHASE_RESAMPLER
+   &polyphase_resampler,
 #endif
    &null_resampler,
    NULL,
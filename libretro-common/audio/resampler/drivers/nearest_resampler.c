@@ -54,6 +54,46 @@ static void resampler_nearest_process(
    data->output_frames = (outp - (audio_frame_float_t*)data->data_out);
 }
 
+static void resampler_nearest_process_s16(
+      void *re_, struct resampler_data_s16 *data)
+{
+   rarch_nearest_resampler_t *re = (rarch_nearest_resampler_t*)re_;
+   const int16_t        *inp     = data->data_in;
+   const int16_t        *inp_max = inp + data->input_frames * 2;
+   int16_t              *outp    = data->data_out;
+   float                   ratio = 1.0 / data->ratio;
+   float                    gain = data->gain;
+
+   /* Nearest only picks frames, so the samples never
+    * need to leave s16 unless the volume is changed. */
+   while (inp != inp_max)
+   {
+      while (re->fraction > 1)
+      {
+         if (gain == 1.0f)
+         {
+            outp[0]    = inp[0];
+            outp[1]    = inp[1];
+         }
+         else
+         {
+            int32_t l  = (int32_t)(inp[0] * gain);
+            int32_t r  = (int32_t)(inp[1] * gain);
+            outp[0]    = (l > 0x7FFF) ? 0x7FFF :
+               (l < -0x8000 ? -0x8000 : (int16_t)l);
+            outp[1]    = (r > 0x7FFF) ? 0x7FFF :
+               (r < -0x8000 ? -0x8000 : (int16_t)r);
+         }
+         outp         += 2;
+         re->fraction -= ratio;
+      }
+      re->fraction++;
+      inp           += 2;
+   }
+
+   data->output_frames = (outp - data->data_out) >> 1;
+}
+
 static void resampler_nearest_free(void *re_)
 {
    rarch_nearest_resampler_t *re = (rarch_nearest_resampler_t*)re_;
@@ -80,5 +120,6 @@ retro_resampler_t nearest_resampler = {
    resampler_nearest_free,
    RESAMPLER_API_VERSION,
    "nearest",
-   "nearest"
+   "nearest",
+   resampler_nearest_process_s16
 };
@@ -0,0 +1,461 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (polyphase_resampler.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Fixed-ratio polyphase resampler.
+ *
+ * Most cores run at a rate that is a clean rational of the output
+ * rate (32040 -> 48000 is 400/267, 44100 -> 48000 is 160/147).
+ * At init time the nominal ratio is approximated by L/M, and a
+ * Kaiser-windowed phase table is built with a multiple of L phases.
+ * At the nominal ratio every output sample then lands exactly on
+ * a precomputed phase, so no coefficient interpolation is needed
+ * and only L rows of the table are ever touched.
+ *
+ * Dynamic rate control and slow motion move the ratio away from
+ * L/M. That is handled as a drift of the 32.32 fixed-point phase
+ * accumulator; each output picks the phase at or just before its
+ * exact position, so the timing error never exceeds one phase and
+ * does not accumulate. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include <retro_inline.h>
+#include <filters.h>
+#include <memalign.h>
+
+#include <audio/audio_resampler.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+#include <arm_neon.h>
+#endif
+
+/* Largest denominator tried when approximating the nominal ratio,
+ * and the relative error that is still considered a match. */
+#define POLYPHASE_MAX_L          1024
+#define POLYPHASE_RATIO_EPSILON  1e-4
+/* The phase count is rounded up to a multiple of L that is at
+ * least this large, which bounds the timing error under drift. */
+#define POLYPHASE_MIN_PHASES     1024
+
+typedef struct rarch_polyphase_resampler
+{
+   /* Phase table and both history buffers share one allocation. */
+   float *main_buffer;
+   float *phase_table;
+   float *buffer_l;
+   float *buffer_r;
+   double ratio_nominal;
+   uint64_t time;
+   uint64_t step_nominal;
+   unsigned phases;
+   unsigned taps;
+   unsigned ptr;
+} rarch_polyphase_resampler_t;
+
+static uint64_t resampler_polyphase_step(
+      rarch_polyphase_resampler_t *re, double ratio)
+{
+   /* Stay on the exact phase grid whenever the requested ratio
+    * is the nominal one, so rounding cannot introduce drift. */
+   if (fabs(ratio - re->ratio_nominal) <= re->ratio_nominal * 1e-12)
+      return re->step_nominal;
+   return (uint64_t)((double)re->phases * 4294967296.0 / ratio);
+}
+
+/* Pushes input frames into the history buffers until the
+ * accumulator points inside the current input sample again.
+ * Returns the number of frames that were consumed. */
+static INLINE size_t resampler_polyphase_push(
+      rarch_polyphase_resampler_t *re, const float **input, size_t frames)
+{
+   size_t consumed     = 0;
+   uint64_t phases_fp  = (uint64_t)re->phases << 32;
+   unsigned taps       = re->taps;
+
+   while (consumed < frames && re->time >= phases_fp)
+   {
+      /* Push in reverse to make filter more obvious. */
+      if (!re->ptr)
+         re->ptr = taps;
+      re->ptr--;
+
+      re->buffer_l[re->ptr + taps] = re->buffer_l[re->ptr] = *(*input)++;
+      re->buffer_r[re->ptr + taps] = re->buffer_r[re->ptr] = *(*input)++;
+
+      re->time -= phases_fp;
+      consumed++;
+   }
+
+   return consumed;
+}
+
+#if defined(__SSE__)
+static void resampler_polyphase_process_sse(void *re_,
+      struct resampler_data *data)
+{
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)re_;
+   uint64_t step                   = resampler_polyphase_step(re, data->ratio);
+   uint64_t phases_fp              = (uint64_t)re->phases << 32;
+   const float *input              = data->data_in;
+   float *output                   = data->data_out;
+   size_t frames                   = data->input_frames;
+   size_t out_frames               = 0;
+   unsigned taps                   = re->taps;
+
+   while (frames)
+   {
+      frames -= resampler_polyphase_push(re, &input, frames);
+
+      {
+         const float *buffer_l = re->buffer_l + re->ptr;
+         const float *buffer_r = re->buffer_r + re->ptr;
+
+         while (re->time < phases_fp)
+         {
+            unsigned i;
+            __m128 sum;
+            const float *coeffs = re->phase_table
+               + (size_t)(re->time >> 32) * taps;
+            __m128 sum_l        = _mm_setzero_ps();
+            __m128 sum_r        = _mm_setzero_ps();
+
+            for (i = 0; i < taps; i += 4)
+            {
+               __m128 c = _mm_load_ps(coeffs + i);
+               sum_l    = _mm_add_ps(sum_l,
+                     _mm_mul_ps(_mm_loadu_ps(buffer_l + i), c));
+               sum_r    = _mm_add_ps(sum_r,
+                     _mm_mul_ps(_mm_loadu_ps(buffer_r + i), c));
+            }
+
+            /* { R1, R0, L1, L0 } + { R3, R2, L3, L2 },
+             * then fold the odd lanes into the even ones. */
+            sum = _mm_add_ps(
+                  _mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(1, 0, 1, 0)),
+                  _mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(3, 2, 3, 2)));
+            sum = _mm_add_ps(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 1, 1)), sum);
+
+            _mm_store_ss(output + 0, sum);
+            _mm_store_ss(output + 1, _mm_movehl_ps(sum, sum));
+
+            output   += 2;
+            out_frames++;
+            re->time += step;
+         }
+      }
+   }
+
+   data->output_frames = out_frames;
+}
+#endif
+
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+static void resampler_polyphase_process_neon(void *re_,
+      struct resampler_data *data)
+{
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)re_;
+   uint64_t step                   = resampler_polyphase_step(re, data->ratio);
+   uint64_t phases_fp              = (uint64_t)re->phases << 32;
+   const float *input              = data->data_in;
+   float *output                   = data->data_out;
+   size_t frames                   = data->input_frames;
+   size_t out_frames               = 0;
+   unsigned taps                   = re->taps;
+
+   while (frames)
+   {
+      frames -= resampler_polyphase_push(re, &input, frames);
+
+      {
+         const float *buffer_l = re->buffer_l + re->ptr;
+         const float *buffer_r = re->buffer_r + re->ptr;
+
+         while (re->time < phases_fp)
+         {
+            unsigned i;
+            float32x2_t p3, p4;
+            const float *coeffs = re->phase_table
+               + (size_t)(re->time >> 32) * taps;
+            float32x4_t p1      = vdupq_n_f32(0.0f);
+            float32x4_t p2      = vdupq_n_f32(0.0f);
+
+            for (i = 0; i < taps; i += 4)
+            {
+               float32x4_t c = vld1q_f32(coeffs + i);
+               p1            = vmlaq_f32(p1, vld1q_f32(buffer_l + i), c);
+               p2            = vmlaq_f32(p2, vld1q_f32(buffer_r + i), c);
+            }
+
+            p3 = vadd_f32(vget_low_f32(p1), vget_high_f32(p1));
+            p4 = vadd_f32(vget_low_f32(p2), vget_high_f32(p2));
+            vst1_f32(output, vpadd_f32(p3, p4));
+
+            output   += 2;
+            out_frames++;
+            re->time += step;
+         }
+      }
+   }
+
+   data->output_frames = out_frames;
+}
+#endif
+
+static void resampler_polyphase_process_c(void *re_,
+      struct resampler_data *data)
+{
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)re_;
+   uint64_t step                   = resampler_polyphase_step(re, data->ratio);
+   uint64_t phases_fp              = (uint64_t)re->phases << 32;
+   const float *input              = data->data_in;
+   float *output                   = data->data_out;
+   size_t frames                   = data->input_frames;
+   size_t out_frames               = 0;
+   unsigned taps                   = re->taps;
+
+   while (frames)
+   {
+      frames -= resampler_polyphase_push(re, &input, frames);
+
+      {
+         const float *buffer_l = re->buffer_l + re->ptr;
+         const float *buffer_r = re->buffer_r + re->ptr;
+
+         while (re->time < phases_fp)
+         {
+            unsigned i;
+            float sum_l         = 0.0f;
+            float sum_r         = 0.0f;
+            const float *coeffs = re->phase_table
+               + (size_t)(re->time >> 32) * taps;
+
+            for (i = 0; i < taps; i++)
+            {
+               sum_l += buffer_l[i] * coeffs[i];
+               sum_r += buffer_r[i] * coeffs[i];
+            }
+
+            output[0] = sum_l;
+            output[1] = sum_r;
+
+            output   += 2;
+            out_frames++;
+            re->time += step;
+         }
+      }
+   }
+
+   data->output_frames = out_frames;
+}
+
+static void resampler_polyphase_free(void *data)
+{
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)data;
+   if (re)
+      memalign_free(re->main_buffer);
+   free(re);
+}
+
+/**
+ * resampler_polyphase_rational:
+ * @ratio              : Output rate divided by input rate.
+ * @out_l              : Number of output samples per period.
+ * @out_m              : Number of input samples per period.
+ *
+ * Finds the smallest L/M within POLYPHASE_RATIO_EPSILON of @ratio.
+ *
+ * Returns: true (1) if a small enough fraction exists.
+ **/
+static bool resampler_polyphase_rational(double ratio,
+      unsigned *out_l, unsigned *out_m)
+{
+   unsigned l;
+
+   for (l = 1; l <= POLYPHASE_MAX_L; l++)
+   {
+      double m = floor(l / ratio + 0.5);
+      if (m < 1.0)
+         continue;
+      if (fabs((double)l / m - ratio) <= ratio * POLYPHASE_RATIO_EPSILON)
+      {
+         *out_l = l;
+         *out_m = (unsigned)m;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+static void resampler_polyphase_init_table(float *phase_table,
+      unsigned phases, unsigned taps, double cutoff, double kaiser_beta)
+{
+   unsigned i, j;
+   double window_mod = besseli0(kaiser_beta);
+   double sidelobes  = taps / 2.0;
+
+   for (i = 0; i < phases; i++)
+   {
+      for (j = 0; j < taps; j++)
+      {
+         double n            = (double)j * phases + i;
+         double window_phase = n / ((double)phases * taps); /* [0, 1). */
+         double sinc_phase;
+         window_phase        = 2.0 * window_phase - 1.0;    /* [-1, 1) */
+         sinc_phase          = sidelobes * window_phase;
+         phase_table[(size_t)i * taps + j] = (float)(cutoff
+               * sinc(M_PI * sinc_phase * cutoff)
+               * besseli0(kaiser_beta
+                  * sqrt(1.0 - window_phase * window_phase))
+               / window_mod);
+      }
+   }
+}
+
+static void *resampler_polyphase_new(const struct resampler_config *config,
+      double bandwidth_mod, enum resampler_quality quality,
+      resampler_simd_mask_t mask)
+{
+   unsigned l, m, k;
+   size_t phase_elems;
+   double cutoff                   = 0.0;
+   double kaiser_beta              = 0.0;
+   unsigned sidelobes              = 0;
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)
+      calloc(1, sizeof(*re));
+
+   if (!re)
+      return NULL;
+
+   /* Same passbands as the sinc resampler, but without
+    * its Lanczos windows for the lowest settings. */
+   switch (quality)
+   {
+      case RESAMPLER_QUALITY_LOWEST:
+         cutoff      = 0.98;
+         sidelobes   = 2;
+         kaiser_beta = 3.5;
+         break;
+      case RESAMPLER_QUALITY_LOWER:
+         cutoff      = 0.98;
+         sidelobes   = 4;
+         kaiser_beta = 4.5;
+         break;
+      case RESAMPLER_QUALITY_HIGHER:
+         cutoff      = 0.90;
+         sidelobes   = 32;
+         kaiser_beta = 10.5;
+         break;
+      case RESAMPLER_QUALITY_HIGHEST:
+         cutoff      = 0.962;
+         sidelobes   = 128;
+         kaiser_beta = 14.5;
+         break;
+      case RESAMPLER_QUALITY_NORMAL:
+      case RESAMPLER_QUALITY_DONTCARE:
+         cutoff      = 0.825;
+         sidelobes   = 8;
+         kaiser_beta = 5.5;
+         break;
+   }
+
+   re->taps = sidelobes * 2;
+
+   /* Downsampling, must lower cutoff, and extend number of
+    * taps accordingly to keep same stopband attenuation. */
+   if (bandwidth_mod < 1.0)
+   {
+      cutoff  *= bandwidth_mod;
+      re->taps = (unsigned)ceil(re->taps / bandwidth_mod);
+   }
+
+   /* Be SIMD-friendly. */
+   re->taps = (re->taps + 3) & ~3;
+
+   /* Without a usable fraction the resampler still works,
+    * it simply drifts across a POLYPHASE_MIN_PHASES table. */
+   if (!resampler_polyphase_rational(bandwidth_mod, &l, &m))
+   {
+      l = POLYPHASE_MIN_PHASES;
+      m = (unsigned)floor(l / bandwidth_mod + 0.5);
+   }
+
+   k                 = (POLYPHASE_MIN_PHASES + l - 1) / l;
+   re->phases        = l * k;
+   re->ratio_nominal = (double)l / m;
+   re->step_nominal  = (uint64_t)m * k << 32;
+   /* Start with a full window worth of history to fill. */
+   re->time          = (uint64_t)re->phases << 32;
+
+   phase_elems       = (size_t)re->phases * re->taps;
+   re->main_buffer   = (float*)memalign_alloc(128,
+         sizeof(float) * (phase_elems + 4 * re->taps));
+   if (!re->main_buffer)
+      goto error;
+
+   memset(re->main_buffer, 0, sizeof(float) * (phase_elems + 4 * re->taps));
+
+   re->phase_table = re->main_buffer;
+   re->buffer_l    = re->main_buffer + phase_elems;
+   re->buffer_r    = re->buffer_l + 2 * re->taps;
+
+   resampler_polyphase_init_table(re->phase_table, re->phases, re->taps,
+         cutoff, kaiser_beta);
+
+   polyphase_resampler.process = resampler_polyphase_process_c;
+
+   if (mask & RESAMPLER_SIMD_SSE)
+   {
+#if defined(__SSE__)
+      polyphase_resampler.process = resampler_polyphase_process_sse;
+#endif
+   }
+   else if (mask & RESAMPLER_SIMD_NEON)
+   {
+#if (defined(__ARM_NEON__) || defined(HAVE_NEON))
+      polyphase_resampler.process = resampler_polyphase_process_neon;
+#endif
+   }
+
+   return re;
+
+error:
+   resampler_polyphase_free(re);
+   return NULL;
+}
+
+retro_resampler_t polyphase_resampler = {
+   resampler_polyphase_new,
+   resampler_polyphase_process_c,
+   resampler_polyphase_free,
+   RESAMPLER_API_VERSION,
+   "polyphase",
+   "polyphase",
+   NULL
+};
@@ -33,6 +33,8 @@
 #include <memalign.h>
 
 #include <audio/audio_resampler.h>
+#include <audio/conversion/float_to_s16.h>
+#include <audio/conversion/s16_to_float.h>
 #include <filters.h>
 
 #ifdef __SSE__
@@ -75,6 +77,10 @@ typedef struct rarch_sinc_resampler
    float *phase_table;
    float *buffer_l;
    float *buffer_r;
+   /* Float frames for resampler_sinc_process_s16(),
+    * one block of input followed by its output. */
+   float *s16_buffer;
+   size_t s16_buffer_frames;
    unsigned phase_bits;
    unsigned subphase_bits;
    unsigned subphase_mask;
@@ -407,6 +413,334 @@ static void resampler_sinc_process_avx(void *re_, struct resampler_data *data)
 }
 #endif
 
+/* FMA3 and AVX-512 kernels are compiled with per-function target
+ * attributes where the compiler supports it, so that generic x86
+ * builds can still pick them at runtime through the SIMD mask. */
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) \
+      || (defined(__GNUC__) && __GNUC__ >= 7))
+#define SINC_HAVE_FMA3
+#define SINC_HAVE_AVX512F
+#define SINC_TARGET_FMA3    __attribute__((target("avx,fma")))
+#define SINC_TARGET_AVX512F __attribute__((target("avx512f,avx,fma")))
+#elif defined(__FMA__) || defined(__AVX512F__)
+#if defined(__FMA__)
+#define SINC_HAVE_FMA3
+#endif
+#if defined(__AVX512F__)
+#define SINC_HAVE_AVX512F
+#endif
+#define SINC_TARGET_FMA3
+#define SINC_TARGET_AVX512F
+#endif
+
+#if defined(SINC_HAVE_FMA3) || defined(SINC_HAVE_AVX512F)
+#if !defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+/* Reduces { l3, l2, l1, l0 } and { r3, r2, r1, r0 } and
+ * stores the two sums as one stereo frame. */
+SINC_TARGET_FMA3
+static INLINE void resampler_sinc_store_sse(float *output,
+      __m128 sum_l, __m128 sum_r)
+{
+   __m128 sum = _mm_add_ps(_mm_shuffle_ps(sum_l, sum_r,
+            _MM_SHUFFLE(1, 0, 1, 0)),
+         _mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(3, 2, 3, 2)));
+   sum        = _mm_add_ps(_mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 1, 1)), sum);
+   _mm_store_ss(output + 0, sum);
+   _mm_store_ss(output + 1, _mm_movehl_ps(sum, sum));
+}
+#endif
+
+#if defined(SINC_HAVE_FMA3)
+SINC_TARGET_FMA3
+static void resampler_sinc_process_fma3_kaiser(void *re_, struct resampler_data *data)
+{
+   rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)re_;
+   unsigned phases                = 1 << (resamp->phase_bits + resamp->subphase_bits);
+
+   uint32_t ratio                 = phases / data->ratio;
+   const float *input             = data->data_in;
+   float *output                  = data->data_out;
+   size_t frames                  = data->input_frames;
+   size_t out_frames              = 0;
+   unsigned taps                  = resamp->taps;
+
+   while (frames)
+   {
+      while (frames && resamp->time >= phases)
+      {
+         /* Push in reverse to make filter more obvious. */
+         if (!resamp->ptr)
+            resamp->ptr = taps;
+         resamp->ptr--;
+
+         resamp->buffer_l[resamp->ptr + taps] =
+            resamp->buffer_l[resamp->ptr]     = *input++;
+
+         resamp->buffer_r[resamp->ptr + taps] =
+            resamp->buffer_r[resamp->ptr]     = *input++;
+
+         resamp->time                        -= phases;
+         frames--;
+      }
+
+      {
+         const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+         const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+         while (resamp->time < phases)
+         {
+            int i;
+            unsigned phase           = resamp->time >> resamp->subphase_bits;
+            const float *phase_table = resamp->phase_table + phase * taps * 2;
+            const float *delta_table = phase_table + taps;
+            __m256 delta             = _mm256_set1_ps((float)
+                  (resamp->time & resamp->subphase_mask) * resamp->subphase_mod);
+
+            __m256 sum_l             = _mm256_setzero_ps();
+            __m256 sum_r             = _mm256_setzero_ps();
+
+            for (i = 0; i < (int)taps; i += 8)
+            {
+               __m256 buf_l  = _mm256_loadu_ps(buffer_l + i);
+               __m256 buf_r  = _mm256_loadu_ps(buffer_r + i);
+               __m256 sinc   = _mm256_fmadd_ps(_mm256_load_ps(delta_table + i),
+                     delta, _mm256_load_ps(phase_table + i));
+
+               sum_l         = _mm256_fmadd_ps(buf_l, sinc, sum_l);
+               sum_r         = _mm256_fmadd_ps(buf_r, sinc, sum_r);
+            }
+
+            resampler_sinc_store_sse(output,
+                  _mm_add_ps(_mm256_castps256_ps128(sum_l),
+                     _mm256_extractf128_ps(sum_l, 1)),
+                  _mm_add_ps(_mm256_castps256_ps128(sum_r),
+                     _mm256_extractf128_ps(sum_r, 1)));
+
+            output += 2;
+            out_frames++;
+            resamp->time += ratio;
+         }
+      }
+   }
+
+   data->output_frames = out_frames;
+}
+
+SINC_TARGET_FMA3
+static void resampler_sinc_process_fma3(void *re_, struct resampler_data *data)
+{
+   rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)re_;
+   unsigned phases                = 1 << (resamp->phase_bits + resamp->subphase_bits);
+
+   uint32_t ratio                 = phases / data->ratio;
+   const float *input             = data->data_in;
+   float *output                  = data->data_out;
+   size_t frames                  = data->input_frames;
+   size_t out_frames              = 0;
+   unsigned taps                  = resamp->taps;
+
+   while (frames)
+   {
+      while (frames && resamp->time >= phases)
+      {
+         /* Push in reverse to make filter more obvious. */
+         if (!resamp->ptr)
+            resamp->ptr = taps;
+         resamp->ptr--;
+
+         resamp->buffer_l[resamp->ptr + taps] =
+            resamp->buffer_l[resamp->ptr]     = *input++;
+
+         resamp->buffer_r[resamp->ptr + taps] =
+            resamp->buffer_r[resamp->ptr]     = *input++;
+
+         resamp->time                        -= phases;
+         frames--;
+      }
+
+      {
+         const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+         const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+         while (resamp->time < phases)
+         {
+            int i;
+            unsigned phase           = resamp->time >> resamp->subphase_bits;
+            const float *phase_table = resamp->phase_table + phase * taps;
+
+            __m256 sum_l             = _mm256_setzero_ps();
+            __m256 sum_r             = _mm256_setzero_ps();
+
+            for (i = 0; i < (int)taps; i += 8)
+            {
+               __m256 buf_l  = _mm256_loadu_ps(buffer_l + i);
+               __m256 buf_r  = _mm256_loadu_ps(buffer_r + i);
+               __m256 sinc   = _mm256_load_ps(phase_table + i);
+
+               sum_l         = _mm256_fmadd_ps(buf_l, sinc, sum_l);
+               sum_r         = _mm256_fmadd_ps(buf_r, sinc, sum_r);
+            }
+
+            resampler_sinc_store_sse(output,
+                  _mm_add_ps(_mm256_castps256_ps128(sum_l),
+                     _mm256_extractf128_ps(sum_l, 1)),
+                  _mm_add_ps(_mm256_castps256_ps128(sum_r),
+                     _mm256_extractf128_ps(sum_r, 1)));
+
+            output += 2;
+            out_frames++;
+            resamp->time += ratio;
+         }
+      }
+   }
+
+   data->output_frames = out_frames;
+}
+#endif
+
+#if defined(SINC_HAVE_AVX512F)
+/* Assumes that taps is a multiple of 16. */
+SINC_TARGET_AVX512F
+static void resampler_sinc_process_avx512f_kaiser(void *re_, struct resampler_data *data)
+{
+   rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)re_;
+   unsigned phases                = 1 << (resamp->phase_bits + resamp->subphase_bits);
+
+   uint32_t ratio                 = phases / data->ratio;
+   const float *input             = data->data_in;
+   float *output                  = data->data_out;
+   size_t frames                  = data->input_frames;
+   size_t out_frames              = 0;
+   unsigned taps                  = resamp->taps;
+
+   while (frames)
+   {
+      while (frames && resamp->time >= phases)
+      {
+         /* Push in reverse to make filter more obvious. */
+         if (!resamp->ptr)
+            resamp->ptr = taps;
+         resamp->ptr--;
+
+         resamp->buffer_l[resamp->ptr + taps] =
+            resamp->buffer_l[resamp->ptr]     = *input++;
+
+         resamp->buffer_r[resamp->ptr + taps] =
+            resamp->buffer_r[resamp->ptr]     = *input++;
+
+         resamp->time                        -= phases;
+         frames--;
+      }
+
+      {
+         const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+         const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+         while (resamp->time < phases)
+         {
+            int i;
+            unsigned phase           = resamp->time >> resamp->subphase_bits;
+            const float *phase_table = resamp->phase_table + phase * taps * 2;
+            const float *delta_table = phase_table + taps;
+            __m512 delta             = _mm512_set1_ps((float)
+                  (resamp->time & resamp->subphase_mask) * resamp->subphase_mod);
+
+            __m512 sum_l             = _mm512_setzero_ps();
+            __m512 sum_r             = _mm512_setzero_ps();
+
+            for (i = 0; i < (int)taps; i += 16)
+            {
+               __m512 buf_l  = _mm512_loadu_ps(buffer_l + i);
+               __m512 buf_r  = _mm512_loadu_ps(buffer_r + i);
+               __m512 sinc   = _mm512_fmadd_ps(_mm512_load_ps(delta_table + i),
+                     delta, _mm512_load_ps(phase_table + i));
+
+               sum_l         = _mm512_fmadd_ps(buf_l, sinc, sum_l);
+               sum_r         = _mm512_fmadd_ps(buf_r, sinc, sum_r);
+            }
+
+            output[0] = _mm512_reduce_add_ps(sum_l);
+            output[1] = _mm512_reduce_add_ps(sum_r);
+
+            output += 2;
+            out_frames++;
+            resamp->time += ratio;
+         }
+      }
+   }
+
+   data->output_frames = out_frames;
+}
+
+/* Assumes that taps is a multiple of 16. */
+SINC_TARGET_AVX512F
+static void resampler_sinc_process_avx512f(void *re_, struct resampler_data *data)
+{
+   rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)re_;
+   unsigned phases                = 1 << (resamp->phase_bits + resamp->subphase_bits);
+
+   uint32_t ratio                 = phases / data->ratio;
+   const float *input             = data->data_in;
+   float *output                  = data->data_out;
+   size_t frames                  = data->input_frames;
+   size_t out_frames              = 0;
+   unsigned taps                  = resamp->taps;
+
+   while (frames)
+   {
+      while (frames && resamp->time >= phases)
+      {
+         /* Push in reverse to make filter more obvious. */
+         if (!resamp->ptr)
+            resamp->ptr = taps;
+         resamp->ptr--;
+
+         resamp->buffer_l[resamp->ptr + taps] =
+            resamp->buffer_l[resamp->ptr]     = *input++;
+
+         resamp->buffer_r[resamp->ptr + taps] =
+            resamp->buffer_r[resamp->ptr]     = *input++;
+
+         resamp->time                        -= phases;
+         frames--;
+      }
+
+      {
+         const float *buffer_l    = resamp->buffer_l + resamp->ptr;
+         const float *buffer_r    = resamp->buffer_r + resamp->ptr;
+         while (resamp->time < phases)
+         {
+            int i;
+            unsigned phase           = resamp->time >> resamp->subphase_bits;
+            const float *phase_table = resamp->phase_table + phase * taps;
+
+            __m512 sum_l             = _mm512_setzero_ps();
+            __m512 sum_r             = _mm512_setzero_ps();
+
+            for (i = 0; i < (int)taps; i += 16)
+            {
+               __m512 buf_l  = _mm512_loadu_ps(buffer_l + i);
+               __m512 buf_r  = _mm512_loadu_ps(buffer_r + i);
+               __m512 sinc   = _mm512_load_ps(phase_table + i);
+
+               sum_l         = _mm512_fmadd_ps(buf_l, sinc, sum_l);
+               sum_r         = _mm512_fmadd_ps(buf_r, sinc, sum_r);
+            }
+
+            output[0] = _mm512_reduce_add_ps(sum_l);
+            output[1] = _mm512_reduce_add_ps(sum_r);
+
+            output += 2;
+            out_frames++;
+            resamp->time += ratio;
+         }
+      }
+   }
+
+   data->output_frames = out_frames;
+}
+#endif
+
 #if defined(__SSE__)
 static void resampler_sinc_process_sse_kaiser(void *re_, struct resampler_data *data)
 {
@@ -733,10 +1067,87 @@ static void resampler_sinc_free(void *data)
 {
    rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)data;
    if (resamp)
+   {
       memalign_free(resamp->main_buffer);
+      if (resamp->s16_buffer)
+         memalign_free(resamp->s16_buffer);
+   }
    free(resamp);
 }
 
+/* Input frames converted per block by resampler_sinc_process_s16(). */
+#define SINC_S16_BLOCK_FRAMES 256
+
+/**
+ * resampler_sinc_process_s16:
+ *
+ * Runs the float kernel selected at init over small blocks,
+ * converting each block from s16 on the way in and back to s16
+ * on the way out. A block and its output stay in cache, so the
+ * conversions cost no extra pass over a full-size float buffer.
+ **/
+static void resampler_sinc_process_s16(void *re_,
+      struct resampler_data_s16 *data)
+{
+   struct resampler_data block;
+   rarch_sinc_resampler_t *resamp = (rarch_sinc_resampler_t*)re_;
+   uint32_t phases                = 1 << (resamp->phase_bits + resamp->subphase_bits);
+   uint32_t ratio                 = phases / data->ratio;
+   const int16_t *input           = data->data_in;
+   int16_t *output                = data->data_out;
+   size_t frames                  = data->input_frames;
+   size_t out_frames              = 0;
+   /* Each kernel call ends once time is back at or above phases,
+    * so n input frames give at most (n + 1) * phases / ratio + 1
+    * output frames. */
+   size_t out_max                 = (size_t)(((double)(SINC_S16_BLOCK_FRAMES + 1)
+            * phases) / ratio) + 2;
+   size_t buffer_frames           = SINC_S16_BLOCK_FRAMES + out_max;
+
+   if (buffer_frames > resamp->s16_buffer_frames)
+   {
+      if (resamp->s16_buffer)
+         memalign_free(resamp->s16_buffer);
+      resamp->s16_buffer_frames   = 0;
+      resamp->s16_buffer          = (float*)memalign_alloc(128,
+            buffer_frames * 2 * sizeof(float));
+      if (!resamp->s16_buffer)
+      {
+         data->output_frames      = 0;
+         return;
+      }
+      resamp->s16_buffer_frames   = buffer_frames;
+   }
+
+   block.data_in                  = resamp->s16_buffer;
+   block.data_out                 = resamp->s16_buffer
+      + SINC_S16_BLOCK_FRAMES * 2;
+   block.ratio                    = data->ratio;
+
+   while (frames)
+   {
+      size_t block_frames         = frames > SINC_S16_BLOCK_FRAMES
+         ? SINC_S16_BLOCK_FRAMES : frames;
+
+      convert_s16_to_float(resamp->s16_buffer, input,
+            block_frames * 2, data->gain);
+
+      block.input_frames          = block_frames;
+      block.output_frames         = 0;
+      sinc_resampler.process(resamp, &block);
+
+      convert_float_to_s16(output, block.data_out,
+            block.output_frames * 2);
+
+      input                      += block_frames * 2;
+      output                     += block.output_frames * 2;
+      out_frames                 += block.output_frames;
+      frames                     -= block_frames;
+   }
+
+   data->output_frames            = out_frames;
+}
+
 static void sinc_init_table_kaiser(rarch_sinc_resampler_t *resamp,
       double cutoff,
       float *phase_table, int phases, int taps, bool calculate_delta)
@@ -866,6 +1277,8 @@ static void *resampler_sinc_new(const struct resampler_config *config,
    size_t phase_elems             = 0;
    size_t elems                   = 0;
    unsigned enable_avx            = 0;
+   unsigned enable_fma3           = 0;
+   unsigned enable_avx512f        = 0;
    unsigned sidelobes             = 0;
    enum sinc_window window_type   = SINC_WINDOW_NONE;
    rarch_sinc_resampler_t *re     = (rarch_sinc_resampler_t*)
@@ -931,7 +1344,26 @@ static void *resampler_sinc_new(const struct resampler_config *config,
       re->taps = (unsigned)ceil(re->taps / bandwidth_mod);
    }
 
+   /* Only the long filters of the higher quality levels
+    * benefit from the wide kernels, see enable_avx above. */
+   if (enable_avx)
+   {
+#if defined(SINC_HAVE_AVX512F)
+      if (mask & RESAMPLER_SIMD_AVX512F)
+         enable_avx512f = 1;
+#endif
+#if defined(SINC_HAVE_FMA3)
+      if (!enable_avx512f && (mask & RESAMPLER_SIMD_FMA3))
+         enable_fma3    = 1;
+#endif
+   }
+
    /* Be SIMD-friendly. */
+   if (enable_avx512f)
+      re->taps  = (re->taps + 15) & ~15;
+   else if (enable_fma3)
+      re->taps  = (re->taps + 7) & ~7;
+   else
 #if defined(__AVX__)
    if (enable_avx)
       re->taps  = (re->taps + 7) & ~7;
@@ -978,14 +1410,30 @@ static void *resampler_sinc_new(const struct resampler_config *config,
    if (window_type == SINC_WINDOW_KAISER)
       sinc_resampler.process    = resampler_sinc_process_c_kaiser;
 
-   if (mask & RESAMPLER_SIMD_AVX && enable_avx)
+   if (enable_avx512f)
    {
+#if defined(SINC_HAVE_AVX512F)
+      sinc_resampler.process    = resampler_sinc_process_avx512f;
+      if (window_type == SINC_WINDOW_KAISER)
+         sinc_resampler.process = resampler_sinc_process_avx512f_kaiser;
+#endif
+   }
+   else if (enable_fma3)
+   {
+#if defined(SINC_HAVE_FMA3)
+      sinc_resampler.process    = resampler_sinc_process_fma3;
+      if (window_type == SINC_WINDOW_KAISER)
+         sinc_resampler.process = resampler_sinc_process_fma3_kaiser;
+#endif
+   }
 #if defined(__AVX__)
+   else if (mask & RESAMPLER_SIMD_AVX && enable_avx)
+   {
       sinc_resampler.process    = resampler_sinc_process_avx;
       if (window_type == SINC_WINDOW_KAISER)
          sinc_resampler.process = resampler_sinc_process_avx_kaiser;
-#endif
    }
+#endif
    else if (mask & RESAMPLER_SIMD_SSE)
    {
 #if defined(__SSE__)
@@ -1021,5 +1469,6 @@ retro_resampler_t sinc_resampler = {
    resampler_sinc_free,
    RESAMPLER_API_VERSION,
    "sinc",
-   "sinc"
+   "sinc",
+   resampler_sinc_process_s16
 };
@@ -727,13 +727,25 @@ uint64_t cpu_features_get(void)
     * AVX CPU support (guaranteed to have at least i686). */
    if (((flags[2] & avx_flags) == avx_flags)
          && ((xgetbv_x86(0) & 0x6) == 0x6))
+   {
       cpu |= RETRO_SIMD_AVX;
 
+      if (flags[2] & (1 << 12))
+         cpu |= RETRO_SIMD_FMA3;
+   }
+
    if (max_flag >= 7)
    {
       x86_cpuid(7, flags);
       if (flags[1] & (1 << 5))
          cpu |= RETRO_SIMD_AVX2;
+
+      /* AVX-512 additionally needs the OS to save
+       * the opmask and upper ZMM register state. */
+      if (     (cpu & RETRO_SIMD_AVX)
+            && (flags[1] & (1 << 16))
+            && ((xgetbv_x86(0) & 0xe6) == 0xe6))
+         cpu |= RETRO_SIMD_AVX512F;
    }
 
    x86_cpuid(0x80000000, flags);
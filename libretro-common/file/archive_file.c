@@ -30,13 +30,71 @@
 #include <retro_miscellaneous.h>
 #include <lists/string_list.h>
 #include <string/stdstring.h>
+#include <lrc_hash.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #ifdef HAVE_MMAP
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
 #include <sys/mman.h>
-#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+#include <encodings/utf.h>
+#endif
+
+/* Assume W-functions do not work below Win2K and Xbox platforms */
+#if defined(_WIN32_WINNT) && _WIN32_WINNT < 0x0500 || defined(_XBOX)
+#ifndef LEGACY_WIN32
+#define LEGACY_WIN32
+#endif
+#endif
+
+/* Number of archive directories kept by the cache */
+#define ARCHIVE_CACHE_SIZE 16
+
+typedef struct
+{
+   const uint8_t *cdata;
+   uint32_t csize;
+   uint32_t size;
+   uint32_t crc32;
+   uint32_t hash;
+   size_t name;               /* offset in file_archive_dir_t.names */
+   unsigned cmode;
+} file_archive_dir_entry_t;
+
+/* Directory of one archive, as enumerated by its backend */
+typedef struct
+{
+   const struct file_archive_file_backend *backend;
+   char *path;
+   char *names;
+   file_archive_dir_entry_t *entries;
+   uint32_t *buckets;         /* entry index + 1, 0 when empty */
+   int64_t archive_size;
+   int64_t mtime;
+   size_t names_size;
+   size_t names_capacity;
+   uint32_t count;
+   uint32_t capacity;
+   uint32_t mask;
+   unsigned last_use;
+   bool failed;
+} file_archive_dir_t;
+
+static file_archive_dir_t *file_archive_cache[ARCHIVE_CACHE_SIZE];
+static unsigned file_archive_cache_clock = 0;
+static bool file_archive_cache_enabled   = false;
+#ifdef HAVE_THREADS
+static slock_t *file_archive_cache_lock  = NULL;
 #endif
 
 static int file_archive_get_file_list_cb(
@@ -52,6 +110,10 @@ static int file_archive_get_file_list_cb(
    union string_list_elem_attr attr;
    attr.i = 0;
 
+   /* 7z directories are enumerated without a name */
+   if (string_is_empty(path))
+      return 1;
+
    if (valid_exts)
    {
       size_t path_len              = strlen(path);
@@ -320,6 +382,400 @@ int file_archive_parse_file_progress(file_archive_transfer_t *state)
    return (int)((state->step_current * 100) / (state->step_total));
 }
 
+/* Size and modification time of the archive at @path,
+ * to tell whether what is cached of it is still current. */
+bool file_archive_get_stamp(const char *path,
+      int64_t *size, int64_t *mtime)
+{
+#if defined(VITA) || defined(__PSL1GHT__) || defined(__PS3__)
+   return false;
+#else
+#if defined(_WIN32)
+   struct _stat stat_buf;
+   int ret                 = -1;
+#if defined(LEGACY_WIN32)
+   char *path_local        = utf8_to_local_string_alloc(path);
+
+   if (path_local)
+   {
+      ret = _stat(path_local, &stat_buf);
+      free(path_local);
+   }
+#else
+   wchar_t *path_wide      = utf8_to_utf16_string_alloc(path);
+
+   if (path_wide)
+   {
+      ret = _wstat(path_wide, &stat_buf);
+      free(path_wide);
+   }
+#endif
+   if (ret < 0)
+      return false;
+#else
+   struct stat stat_buf;
+
+   if (stat(path, &stat_buf) < 0)
+      return false;
+#endif
+
+   *size  = (int64_t)stat_buf.st_size;
+   *mtime = (int64_t)stat_buf.st_mtime;
+   return true;
+#endif
+}
+
+static void file_archive_dir_free(file_archive_dir_t *dir)
+{
+   if (!dir)
+      return;
+
+   free(dir->path);
+   free(dir->names);
+   free(dir->entries);
+   free(dir->buckets);
+   free(dir);
+}
+
+static int file_archive_dir_add_cb(const char *name, const char *valid_exts,
+      const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
+      uint32_t checksum, struct archive_extract_userdata *userdata)
+{
+   file_archive_dir_t *dir          = (file_archive_dir_t*)userdata->cb_data;
+   size_t name_len                  = strlen(name) + 1;
+   file_archive_dir_entry_t *entry  = NULL;
+
+   /* 7z directories are enumerated without a name */
+   if (name_len == 1)
+      return 1;
+
+   if (dir->count == dir->capacity)
+   {
+      uint32_t capacity                  = dir->capacity ? dir->capacity * 2 : 64;
+      file_archive_dir_entry_t *entries  = (file_archive_dir_entry_t*)
+         realloc(dir->entries, capacity * sizeof(*entries));
+
+      if (!entries)
+         goto error;
+
+      dir->entries  = entries;
+      dir->capacity = capacity;
+   }
+
+   if (dir->names_size + name_len > dir->names_capacity)
+   {
+      size_t capacity = dir->names_capacity ? dir->names_capacity * 2 : 4096;
+      char *names;
+
+      while (capacity < dir->names_size + name_len)
+         capacity *= 2;
+
+      if (!(names = (char*)realloc(dir->names, capacity)))
+         goto error;
+
+      dir->names          = names;
+      dir->names_capacity = capacity;
+   }
+
+   memcpy(dir->names + dir->names_size, name, name_len);
+
+   entry          = &dir->entries[dir->count++];
+   entry->cdata   = cdata;
+   entry->cmode   = cmode;
+   entry->csize   = csize;
+   entry->size    = size;
+   entry->crc32   = checksum;
+   entry->hash    = djb2_calculate(name);
+   entry->name    = dir->names_size;
+
+   dir->names_size += name_len;
+   return 1;
+
+error:
+   dir->failed = true;
+   return 0;
+}
+
+static const file_archive_dir_entry_t *file_archive_dir_find(
+      const file_archive_dir_t *dir, const char *name)
+{
+   uint32_t hash = djb2_calculate(name);
+   uint32_t i    = hash & dir->mask;
+
+   while (dir->buckets[i])
+   {
+      const file_archive_dir_entry_t *entry = &dir->entries[dir->buckets[i] - 1];
+
+      if (     entry->hash == hash
+            && string_is_equal(dir->names + entry->name, name))
+         return entry;
+
+      i = (i + 1) & dir->mask;
+   }
+
+   return NULL;
+}
+
+/* Hashes the names of all entries. An archive may list the
+ * same name twice, lookups find the first one like a walk. */
+static bool file_archive_dir_index(file_archive_dir_t *dir)
+{
+   uint32_t i;
+   uint32_t buckets = 16;
+
+   while (buckets < dir->count * 2)
+      buckets *= 2;
+
+   if (!(dir->buckets = (uint32_t*)calloc(buckets, sizeof(uint32_t))))
+      return false;
+
+   dir->mask = buckets - 1;
+
+   for (i = 0; i < dir->count; i++)
+   {
+      const file_archive_dir_entry_t *entry = &dir->entries[i];
+      uint32_t b                            = entry->hash & dir->mask;
+
+      if (file_archive_dir_find(dir, dir->names + entry->name))
+         continue;
+
+      while (dir->buckets[b])
+         b = (b + 1) & dir->mask;
+      dir->buckets[b] = i + 1;
+   }
+
+   return true;
+}
+
+static file_archive_dir_t *file_archive_dir_new(const char *path,
+      int64_t archive_size, int64_t mtime)
+{
+   struct archive_extract_userdata userdata;
+   file_archive_dir_t *dir = (file_archive_dir_t*)
+      calloc(1, sizeof(*dir));
+
+   if (!dir)
+      return NULL;
+
+   dir->backend                       = file_archive_get_file_backend(path);
+   dir->path                          = strdup(path);
+   dir->archive_size                  = archive_size;
+   dir->mtime                         = mtime;
+
+   userdata.archive_path[0]           = '\0';
+   userdata.current_file_path[0]      = '\0';
+   userdata.first_extracted_file_path = NULL;
+   userdata.extraction_directory      = NULL;
+   userdata.ext                       = NULL;
+   userdata.list                      = NULL;
+   userdata.found_file                = false;
+   userdata.list_only                 = true;
+   userdata.crc                       = 0;
+   userdata.transfer                  = NULL;
+   userdata.dec                       = NULL;
+   userdata.cb_data                   = dir;
+
+   if (     !dir->backend
+         || !dir->path
+         || !file_archive_walk(path, NULL, file_archive_dir_add_cb, &userdata)
+         || dir->failed
+         || !file_archive_dir_index(dir))
+   {
+      file_archive_dir_free(dir);
+      return NULL;
+   }
+
+   return dir;
+}
+
+/**
+ * file_archive_cache_get:
+ * @path                        : filename path of archive, an
+ *                                archive delimiter and what
+ *                                follows it are ignored.
+ *
+ * Looks up the directory of an archive in the cache, parsing
+ * the archive if it is not cached or was modified since.
+ * The cache stays locked until file_archive_cache_release()
+ * when a directory is returned.
+ *
+ * Returns: directory of the archive, NULL if the cache is
+ * disabled or the archive cannot be parsed.
+ **/
+static file_archive_dir_t *file_archive_cache_get(const char *path)
+{
+   char archive_path[PATH_MAX_LENGTH];
+   unsigned i;
+   int64_t archive_size    = 0;
+   int64_t mtime           = 0;
+   unsigned slot           = 0;
+   char *delim             = NULL;
+   file_archive_dir_t *dir = NULL;
+
+   if (!file_archive_cache_enabled)
+      return NULL;
+
+   strlcpy(archive_path, path, sizeof(archive_path));
+   if ((delim = (char*)path_get_archive_delim(archive_path)))
+      *delim = '\0';
+
+   if (!file_archive_get_stamp(archive_path, &archive_size, &mtime))
+      return NULL;
+
+#ifdef HAVE_THREADS
+   slock_lock(file_archive_cache_lock);
+#endif
+   for (i = 0; i < ARCHIVE_CACHE_SIZE; i++)
+   {
+      dir = file_archive_cache[i];
+      if (dir && string_is_equal(dir->path, archive_path))
+      {
+         if (dir->archive_size == archive_size && dir->mtime == mtime)
+         {
+            dir->last_use = ++file_archive_cache_clock;
+            return dir;
+         }
+         break;
+      }
+   }
+#ifdef HAVE_THREADS
+   slock_unlock(file_archive_cache_lock);
+#endif
+
+   /* Parse without holding the lock, other archives
+    * can be looked up meanwhile. */
+   if (!(dir = file_archive_dir_new(archive_path, archive_size, mtime)))
+      return NULL;
+
+#ifdef HAVE_THREADS
+   slock_lock(file_archive_cache_lock);
+#endif
+   /* Replace the outdated directory of this archive if there
+    * is one, else take a free slot or the least recently used. */
+   for (i = 0; i < ARCHIVE_CACHE_SIZE; i++)
+   {
+      if (     file_archive_cache[i]
+            && string_is_equal(file_archive_cache[i]->path, archive_path))
+         break;
+   }
+
+   if (i < ARCHIVE_CACHE_SIZE)
+      slot = i;
+   else
+   {
+      for (i = 0; i < ARCHIVE_CACHE_SIZE; i++)
+      {
+         if (!file_archive_cache[i])
+         {
+            slot = i;
+            break;
+         }
+         if (file_archive_cache[i]->last_use
+               < file_archive_cache[slot]->last_use)
+            slot = i;
+      }
+   }
+
+   file_archive_dir_free(file_archive_cache[slot]);
+   file_archive_cache[slot] = dir;
+   dir->last_use            = ++file_archive_cache_clock;
+
+   return dir;
+}
+
+static void file_archive_cache_release(void)
+{
+#ifdef HAVE_THREADS
+   slock_unlock(file_archive_cache_lock);
+#endif
+}
+
+/**
+ * file_archive_walk_cached:
+ * @file                        : filename path of archive
+ * @valid_exts                  : Valid extensions of archive to be parsed.
+ *                                If NULL, allow all.
+ * @file_cb                     : file_cb function pointer
+ * @userdata                    : userdata to pass to file_cb function pointer.
+ *
+ * Like file_archive_walk(), but enumerates the cached directory
+ * of the archive. Nothing is decompressed, file_cb must not use
+ * userdata->transfer.
+ *
+ * Returns: true (1) if the directory was enumerated, false (0)
+ * if the cache is disabled or the archive cannot be parsed.
+ **/
+static bool file_archive_walk_cached(const char *file, const char *valid_exts,
+      file_archive_file_cb file_cb, struct archive_extract_userdata *userdata)
+{
+   uint32_t i;
+   file_archive_dir_t *dir = file_archive_cache_get(file);
+
+   if (!dir)
+      return false;
+
+   for (i = 0; i < dir->count; i++)
+   {
+      const file_archive_dir_entry_t *entry = &dir->entries[i];
+
+      strlcpy(userdata->current_file_path, dir->names + entry->name,
+            sizeof(userdata->current_file_path));
+      userdata->crc = entry->crc32;
+
+      if (!file_cb(userdata->current_file_path, valid_exts,
+               entry->cdata, entry->cmode, entry->csize, entry->size,
+               entry->crc32, userdata))
+         break;
+   }
+
+   file_archive_cache_release();
+   return true;
+}
+
+void file_archive_cache_init(void)
+{
+   file_archive_cache_deinit();
+#ifdef HAVE_THREADS
+   if (!(file_archive_cache_lock = slock_new()))
+      return;
+#endif
+   file_archive_cache_enabled = true;
+#ifdef HAVE_7ZIP
+   sevenzip_block_cache_init();
+#endif
+}
+
+void file_archive_cache_flush(void)
+{
+#ifdef HAVE_7ZIP
+   sevenzip_block_cache_flush();
+#endif
+}
+
+void file_archive_cache_deinit(void)
+{
+   unsigned i;
+
+   file_archive_cache_enabled = false;
+#ifdef HAVE_7ZIP
+   sevenzip_block_cache_deinit();
+#endif
+
+   for (i = 0; i < ARCHIVE_CACHE_SIZE; i++)
+   {
+      file_archive_dir_free(file_archive_cache[i]);
+      file_archive_cache[i] = NULL;
+   }
+
+#ifdef HAVE_THREADS
+   if (file_archive_cache_lock)
+   {
+      slock_free(file_archive_cache_lock);
+      file_archive_cache_lock = NULL;
+   }
+#endif
+}
+
 /**
  * file_archive_extract_file:
  * @archive_path                : filename path to archive.
@@ -411,8 +867,10 @@ bool file_archive_get_file_list_noalloc(struct string_list *list,
    userdata.transfer                        = NULL;
    userdata.dec                             = NULL;
 
-   if (!file_archive_walk(path, valid_exts,
-            file_archive_get_file_list_cb, &userdata))
+   if (     !file_archive_walk_cached(path, valid_exts,
+               file_archive_get_file_list_cb, &userdata)
+         && !file_archive_walk(path, valid_exts,
+               file_archive_get_file_list_cb, &userdata))
       return false;
    return true;
 }
@@ -442,8 +900,10 @@ struct string_list *file_archive_get_file_list(const char *path,
 
    if (!userdata.list)
       return NULL;
-   if (!file_archive_walk(path, valid_exts,
-         file_archive_get_file_list_cb, &userdata))
+   if (     !file_archive_walk_cached(path, valid_exts,
+               file_archive_get_file_list_cb, &userdata)
+         && !file_archive_walk(path, valid_exts,
+               file_archive_get_file_list_cb, &userdata))
    {
       string_list_free(userdata.list);
       return NULL;
@@ -533,6 +993,12 @@ int file_archive_compressed_read(
    const struct
       file_archive_file_backend *backend = NULL;
    struct string_list *str_list          = NULL;
+   file_archive_dir_t *dir               = NULL;
+   const uint8_t *cdata                  = NULL;
+   unsigned cmode                        = 0;
+   uint32_t csize                        = 0;
+   uint32_t size                         = 0;
+   bool found                            = false;
 
    /* Safety check.
     * If optional_filename and optional_filename
@@ -562,8 +1028,38 @@ int file_archive_compressed_read(
    }
 
    backend = file_archive_get_file_backend(str_list->elems[0].data);
-   *length = backend->compressed_file_read(str_list->elems[0].data,
-         str_list->elems[1].data, buf, optional_filename);
+
+   /* Locate the member in the cached directory if the
+    * backend can read it from there. Names that are not
+    * found are left to the backend to match. */
+   if (     backend->compressed_file_read_entry
+         && (dir = file_archive_cache_get(str_list->elems[0].data)))
+   {
+      const char *needle                    = str_list->elems[1].data;
+      const file_archive_dir_entry_t *entry = file_archive_dir_find(dir, needle);
+      size_t needle_len                     = strlen(needle);
+
+      /* Ignore directories. */
+      if (     entry
+            && needle[needle_len - 1] != '/'
+            && needle[needle_len - 1] != '\\')
+      {
+         cdata = entry->cdata;
+         cmode = entry->cmode;
+         csize = entry->csize;
+         size  = entry->size;
+         found = true;
+      }
+
+      file_archive_cache_release();
+   }
+
+   if (found)
+      *length = backend->compressed_file_read_entry(str_list->elems[0].data,
+            cdata, cmode, csize, size, buf, optional_filename);
+   else
+      *length = backend->compressed_file_read(str_list->elems[0].data,
+            str_list->elems[1].data, buf, optional_filename);
 
    string_list_free(str_list);
 
@@ -573,6 +1069,45 @@ int file_archive_compressed_read(
    return 0;
 }
 
+size_t file_archive_compressed_read_multi(const char *path,
+      const char **members, size_t count, void **bufs, int64_t *lengths)
+{
+   size_t i;
+   size_t read                                     = 0;
+   const struct file_archive_file_backend *backend =
+      file_archive_get_file_backend(path);
+
+   for (i = 0; i < count; i++)
+   {
+      bufs[i]    = NULL;
+      lengths[i] = -1;
+   }
+
+   if (!backend)
+      return 0;
+
+   if (backend->compressed_file_read_multi)
+      return backend->compressed_file_read_multi(path,
+            members, count, bufs, lengths);
+
+   for (i = 0; i < count; i++)
+   {
+      char member_path[PATH_MAX_LENGTH];
+
+      fill_pathname_join_delim(member_path, path, members[i], '#',
+            sizeof(member_path));
+
+      if (     file_archive_compressed_read(member_path,
+                  &bufs[i], NULL, &lengths[i])
+            && lengths[i] != -1)
+         read++;
+      else
+         lengths[i] = -1;
+   }
+
+   return read;
+}
+
 const struct file_archive_file_backend *file_archive_get_zlib_file_backend(void)
 {
 #ifdef HAVE_ZLIB
@@ -635,6 +1170,7 @@ uint32_t file_archive_get_file_crc32(const char *path)
    struct archive_extract_userdata userdata        = {0};
    bool returnerr                                  = false;
    const char *archive_path                        = NULL;
+   file_archive_dir_t *dir                         = NULL;
    bool contains_compressed = path_contains_compressed_file(path);
 
    if (contains_compressed)
@@ -646,6 +1182,24 @@ uint32_t file_archive_get_file_crc32(const char *path)
          archive_path += 1;
    }
 
+   /* The directory holds the CRC32 of every file */
+   if ((dir = file_archive_cache_get(path)))
+   {
+      const file_archive_dir_entry_t *entry = NULL;
+      uint32_t crc                          = 0;
+
+      if (contains_compressed && archive_path)
+         entry = file_archive_dir_find(dir, archive_path);
+      else if (dir->count)
+         entry = &dir->entries[0];
+
+      if (entry)
+         crc = entry->crc32;
+
+      file_archive_cache_release();
+      return crc;
+   }
+
    state.type              = ARCHIVE_TRANSFER_INIT;
    state.archive_file      = NULL;
 #ifdef HAVE_MMAP
@@ -666,11 +1220,18 @@ uint32_t file_archive_get_file_crc32(const char *path)
 
    for (;;)
    {
+      /* The archive could not be opened or does
+       * not contain the file. */
+      if (state.type != ARCHIVE_TRANSFER_ITERATE)
+      {
+         userdata.crc = 0;
+         break;
+      }
+
       /* Now find the first file in the archive. */
-      if (state.type == ARCHIVE_TRANSFER_ITERATE)
-         file_archive_parse_file_iterate(&state,
-                  &returnerr, path, NULL, NULL,
-                  &userdata);
+      file_archive_parse_file_iterate(&state,
+               &returnerr, path, NULL, NULL,
+               &userdata);
 
       /* If no path specified within archive, stop after
        * finding the first file.
@@ -36,10 +36,24 @@
 #include <7zip/7zCrc.h>
 #include <7zip/7zFile.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #define SEVENZIP_MAGIC "7z\xBC\xAF\x27\x1C"
 #define SEVENZIP_MAGIC_LEN 6
 #define SEVENZIP_LOOKTOREAD_BUF_SIZE (1 << 14)
 
+/* Largest decoded solid block kept for the next read,
+ * none on platforms short of memory */
+#ifndef SEVENZIP_BLOCK_CACHE_SIZE
+#if defined(_3DS) || defined(GEKKO) || defined(HW_RVL) || defined(PSP) || defined(VITA) || defined(SN_TARGET_PSP2) || defined(PS2) || defined(_XBOX) || defined(DINGUX)
+#define SEVENZIP_BLOCK_CACHE_SIZE 0
+#else
+#define SEVENZIP_BLOCK_CACHE_SIZE (64 * 1024 * 1024)
+#endif
+#endif
+
 /* Assume W-functions do not work below Win2K and Xbox platforms */
 #if defined(_WIN32_WINNT) && _WIN32_WINNT < 0x0500 || defined(_XBOX)
 #ifndef LEGACY_WIN32
@@ -56,12 +70,38 @@ struct sevenzip_context_t
    ISzAlloc allocTempImp;
    CSzArEx db;
    size_t temp_size;
+   size_t output_size;
    uint32_t parse_index;
    uint32_t decompress_index;
    uint32_t packIndex;
    uint32_t   block_index;
 };
 
+/* A member to extract, ordered by solid block */
+typedef struct
+{
+   uint32_t block;
+   uint32_t index;
+   size_t needle;
+} sevenzip_member_t;
+
+/* The last archive read, kept with its decoded solid block
+ * while the cache of archive directories is enabled. Its
+ * file is closed in between reads. */
+typedef struct
+{
+   struct sevenzip_context_t *context;
+   char *path;
+   int64_t archive_size;
+   int64_t mtime;
+} sevenzip_block_cache_t;
+
+static sevenzip_block_cache_t sevenzip_block_cache = {0};
+static bool sevenzip_block_cache_enabled           = false;
+#ifdef HAVE_THREADS
+static slock_t *sevenzip_block_cache_lock          = NULL;
+#endif
+
 static void *sevenzip_stream_alloc_impl(ISzAllocPtr p, size_t size)
 {
    if (size == 0)
@@ -130,37 +170,10 @@ static void sevenzip_parse_file_free(void *context)
    free(sevenzip_context);
 }
 
-/* Extract the relative path (needle) from a 7z archive
- * (path) and allocate a buf for it to write it in.
- * If optional_outfile is set, extract to that instead
- * and don't allocate buffer.
- */
-static int64_t sevenzip_file_read(
-      const char *path,
-      const char *needle, void **buf,
-      const char *optional_outfile)
+/* Opens the file of an archive for reading */
+static bool sevenzip_context_open_file(
+      struct sevenzip_context_t *sevenzip_context, const char *path)
 {
-   CFileInStream archiveStream;
-   CLookToRead2 lookStream;
-   ISzAlloc allocImp;
-   ISzAlloc allocTempImp;
-   CSzArEx db;
-   uint8_t *output      = 0;
-   int64_t outsize      = -1;
-
-   /*These are the allocation routines.
-    * Currently using the non-standard 7zip choices. */
-   allocImp.Alloc       = sevenzip_stream_alloc_impl;
-   allocImp.Free        = sevenzip_stream_free_impl;
-   allocTempImp.Alloc   = sevenzip_stream_alloc_tmp_impl;
-   allocTempImp.Free    = sevenzip_stream_free_impl;
-
-   lookStream.bufSize   = SEVENZIP_LOOKTOREAD_BUF_SIZE * sizeof(Byte);
-   lookStream.buf       = (Byte*)malloc(lookStream.bufSize);
-
-   if (!lookStream.buf)
-      lookStream.bufSize = 0;
-
 #if defined(_WIN32) && defined(USE_WINDOWS_FILE) && !defined(LEGACY_WIN32)
    if (!string_is_empty(path))
    {
@@ -169,10 +182,10 @@ static int64_t sevenzip_file_read(
       if (pathW)
       {
          /* Could not open 7zip archive? */
-         if (InFile_OpenW(&archiveStream.file, pathW))
+         if (InFile_OpenW(&sevenzip_context->archiveStream.file, pathW))
          {
             free(pathW);
-            return -1;
+            return false;
          }
 
          free(pathW);
@@ -180,132 +193,399 @@ static int64_t sevenzip_file_read(
    }
 #else
    /* Could not open 7zip archive? */
-   if (InFile_Open(&archiveStream.file, path))
-      return -1;
+   if (InFile_Open(&sevenzip_context->archiveStream.file, path))
+      return false;
 #endif
 
-   FileInStream_CreateVTable(&archiveStream);
-   LookToRead2_CreateVTable(&lookStream, false);
-   lookStream.realStream = &archiveStream.vt;
-   LookToRead2_Init(&lookStream);
+   FileInStream_CreateVTable(&sevenzip_context->archiveStream);
+   LookToRead2_CreateVTable(&sevenzip_context->lookStream, false);
+   sevenzip_context->lookStream.realStream = &sevenzip_context->archiveStream.vt;
+   LookToRead2_Init(&sevenzip_context->lookStream);
+
+   return true;
+}
+
+static bool sevenzip_context_open(
+      struct sevenzip_context_t *sevenzip_context, const char *path)
+{
+   if (!sevenzip_context_open_file(sevenzip_context, path))
+      return false;
+
    CrcGenerateTable();
+   SzArEx_Init(&sevenzip_context->db);
 
-   memset(&db, 0, sizeof(db));
+   return SzArEx_Open(&sevenzip_context->db,
+         &sevenzip_context->lookStream.vt,
+         &sevenzip_context->allocImp,
+         &sevenzip_context->allocTempImp) == SZ_OK;
+}
 
-   SzArEx_Init(&db);
+/* Looks up the indices of @count files in one pass over the
+ * names in the archive. Files not found get (uint32_t)-1. */
+static void sevenzip_context_find(
+      struct sevenzip_context_t *sevenzip_context,
+      const char **needles, size_t count, uint32_t *indices)
+{
+   uint32_t i;
+   size_t j;
+   uint16_t *temp   = NULL;
+   size_t temp_size = 0;
+   size_t left      = count;
+
+   for (j = 0; j < count; j++)
+      indices[j] = (uint32_t)-1;
 
-   if (SzArEx_Open(&db, &lookStream.vt, &allocImp, &allocTempImp) == SZ_OK)
+   for (i = 0; i < sevenzip_context->db.NumFiles && left; i++)
    {
-      uint32_t i;
-      bool file_found      = false;
-      uint16_t *temp       = NULL;
-      size_t temp_size     = 0;
-      uint32_t block_index   = 0xFFFFFFFF;
-      SRes res             = SZ_OK;
-
-      for (i = 0; i < db.NumFiles; i++)
-      {
-         size_t len;
-         char infile[PATH_MAX_LENGTH];
-         size_t offset                = 0;
-         size_t outSizeProcessed      = 0;
+      size_t len;
+      char infile[PATH_MAX_LENGTH];
 
-         /* We skip over everything which is not a directory.
-          * FIXME: Why continue then if IsDir is true?*/
-         if (SzArEx_IsDir(&db, i))
-            continue;
+      if (SzArEx_IsDir(&sevenzip_context->db, i))
+         continue;
 
-         len = SzArEx_GetFileNameUtf16(&db, i, NULL);
+      len = SzArEx_GetFileNameUtf16(&sevenzip_context->db, i, NULL);
 
-         if (len > temp_size)
-         {
-            if (temp)
-               free(temp);
-            temp_size = len;
-            temp = (uint16_t *)malloc(temp_size * sizeof(temp[0]));
-
-            if (temp == 0)
-            {
-               res = SZ_ERROR_MEM;
-               break;
-            }
-         }
+      if (len > temp_size)
+      {
+         if (temp)
+            free(temp);
+         temp_size = len;
 
-         SzArEx_GetFileNameUtf16(&db, i, temp);
-         res       = SZ_ERROR_FAIL;
-         infile[0] = '\0';
+         if (!(temp = (uint16_t *)malloc(temp_size * sizeof(temp[0]))))
+            break;
+      }
 
-         if (temp)
-            res = utf16_to_char_string(temp, infile, sizeof(infile))
-               ? SZ_OK : SZ_ERROR_FAIL;
+      SzArEx_GetFileNameUtf16(&sevenzip_context->db, i, temp);
+
+      if (!utf16_to_char_string(temp, infile, sizeof(infile)))
+         continue;
 
-         if (string_is_equal(infile, needle))
+      for (j = 0; j < count; j++)
+      {
+         if (     indices[j] == (uint32_t)-1
+               && string_is_equal(infile, needles[j]))
          {
-            size_t output_size   = 0;
-
-            /* C LZMA SDK does not support chunked extraction - see here:
-             * sourceforge.net/p/sevenzip/discussion/45798/thread/6fb59aaf/
-             * */
-            file_found = true;
-            res = SzArEx_Extract(&db, &lookStream.vt, i, &block_index,
-                  &output, &output_size, &offset, &outSizeProcessed,
-                  &allocImp, &allocTempImp);
-
-            if (res != SZ_OK)
-               break; /* This goes to the error section. */
-
-            outsize = (int64_t)outSizeProcessed;
-
-            if (optional_outfile)
-            {
-               const void *ptr = (const void*)(output + offset);
-
-               if (!filestream_write_file(optional_outfile, ptr, outsize))
-               {
-                  res        = SZ_OK;
-                  file_found = true;
-                  outsize    = -1;
-               }
-            }
-            else
-            {
-               /*We could either use the 7Zip allocated buffer,
-                * or create our own and use it.
-                * We would however need to realloc anyways, because RetroArch
-                * expects a \0 at the end, therefore we allocate new,
-                * copy and free the old one. */
-               *buf = malloc((size_t)(outsize + 1));
-               ((char*)(*buf))[outsize] = '\0';
-               memcpy(*buf,output + offset,outsize);
-            }
-            break;
+            indices[j] = i;
+            left--;
          }
       }
+   }
+
+   if (temp)
+      free(temp);
+}
+
+/* Extracts file @index to a new buffer, or to optional_outfile
+ * if set. The solid block of the file is decoded unless it was
+ * the last one decoded.
+ *
+ * Returns: size of the file, -1 on failure.
+ */
+static int64_t sevenzip_context_extract(
+      struct sevenzip_context_t *sevenzip_context, uint32_t index,
+      void **buf, const char *optional_outfile)
+{
+   size_t offset           = 0;
+   size_t outSizeProcessed = 0;
+   int64_t outsize;
+
+   /* C LZMA SDK does not support chunked extraction - see here:
+    * sourceforge.net/p/sevenzip/discussion/45798/thread/6fb59aaf/
+    * */
+   if (SzArEx_Extract(&sevenzip_context->db,
+            &sevenzip_context->lookStream.vt, index,
+            &sevenzip_context->block_index, &sevenzip_context->output,
+            &sevenzip_context->output_size, &offset, &outSizeProcessed,
+            &sevenzip_context->allocImp,
+            &sevenzip_context->allocTempImp) != SZ_OK)
+   {
+      /* Do not reuse a block that failed to decode */
+      IAlloc_Free(&sevenzip_context->allocImp, sevenzip_context->output);
+      sevenzip_context->output      = NULL;
+      sevenzip_context->output_size = 0;
+      sevenzip_context->block_index = 0xFFFFFFFF;
+      return -1;
+   }
+
+   outsize = (int64_t)outSizeProcessed;
+
+   if (optional_outfile)
+   {
+      const void *ptr = (const void*)(sevenzip_context->output + offset);
+
+      if (!filestream_write_file(optional_outfile, ptr, outsize))
+         return -1;
+   }
+   else
+   {
+      /*We could either use the 7Zip allocated buffer,
+       * or create our own and use it.
+       * We would however need to realloc anyways, because RetroArch
+       * expects a \0 at the end, therefore we allocate new,
+       * copy and free the old one. */
+      if (!(*buf = malloc((size_t)(outsize + 1))))
+         return -1;
+      ((char*)(*buf))[outsize] = '\0';
+      if (outsize)
+         memcpy(*buf, sevenzip_context->output + offset, (size_t)outsize);
+   }
 
-      if (temp)
-         free(temp);
-      IAlloc_Free(&allocImp, output);
+   return outsize;
+}
 
-      if (!(file_found && res == SZ_OK))
+/* Takes the archive at @path from the block cache if it is
+ * there and unchanged, otherwise opens it. @archive_size is
+ * set to -1 when the archive must not be cached. */
+static struct sevenzip_context_t *sevenzip_context_acquire(
+      const char *path, int64_t *archive_size, int64_t *mtime)
+{
+   struct sevenzip_context_t *sevenzip_context = NULL;
+
+   *archive_size = -1;
+   *mtime        = 0;
+
+   if (     sevenzip_block_cache_enabled
+         && file_archive_get_stamp(path, archive_size, mtime))
+   {
+#ifdef HAVE_THREADS
+      slock_lock(sevenzip_block_cache_lock);
+#endif
+      if (     sevenzip_block_cache.context
+            && sevenzip_block_cache.archive_size == *archive_size
+            && sevenzip_block_cache.mtime        == *mtime
+            && string_is_equal(sevenzip_block_cache.path, path))
       {
-         /* Error handling
-          *
-          * Failed to open compressed file inside 7zip archive.
-          */
+         sevenzip_context             = sevenzip_block_cache.context;
+         sevenzip_block_cache.context = NULL;
+      }
+#ifdef HAVE_THREADS
+      slock_unlock(sevenzip_block_cache_lock);
+#endif
 
-         outsize    = -1;
+      if (sevenzip_context)
+      {
+         if (sevenzip_context_open_file(sevenzip_context, path))
+            return sevenzip_context;
+         sevenzip_parse_file_free(sevenzip_context);
+         return NULL;
       }
    }
 
-   SzArEx_Free(&db, &allocImp);
-   File_Close(&archiveStream.file);
+   sevenzip_context = (struct sevenzip_context_t*)sevenzip_stream_new();
 
-   if (lookStream.buf)
-      free(lookStream.buf);
+   if (!sevenzip_context_open(sevenzip_context, path))
+   {
+      sevenzip_parse_file_free(sevenzip_context);
+      return NULL;
+   }
+
+   return sevenzip_context;
+}
+
+/* Puts an archive back into the block cache, replacing the
+ * one cached before, or frees it. */
+static void sevenzip_context_release(
+      struct sevenzip_context_t *sevenzip_context,
+      const char *path, int64_t archive_size, int64_t mtime)
+{
+   struct sevenzip_context_t *old_context = NULL;
+   char *old_path                         = NULL;
+   char *cached_path                      = NULL;
+
+   if (     !sevenzip_block_cache_enabled
+         || archive_size < 0
+         || sevenzip_context->output_size > SEVENZIP_BLOCK_CACHE_SIZE
+         || !(cached_path = strdup(path)))
+   {
+      sevenzip_parse_file_free(sevenzip_context);
+      return;
+   }
+
+   File_Close(&sevenzip_context->archiveStream.file);
+
+#ifdef HAVE_THREADS
+   slock_lock(sevenzip_block_cache_lock);
+#endif
+   old_context                       = sevenzip_block_cache.context;
+   old_path                          = sevenzip_block_cache.path;
+   sevenzip_block_cache.context      = sevenzip_context;
+   sevenzip_block_cache.path         = cached_path;
+   sevenzip_block_cache.archive_size = archive_size;
+   sevenzip_block_cache.mtime        = mtime;
+#ifdef HAVE_THREADS
+   slock_unlock(sevenzip_block_cache_lock);
+#endif
+
+   if (old_context)
+      sevenzip_parse_file_free(old_context);
+   if (old_path)
+      free(old_path);
+}
+
+void sevenzip_block_cache_init(void)
+{
+   sevenzip_block_cache_deinit();
+   if (SEVENZIP_BLOCK_CACHE_SIZE <= 0)
+      return;
+#ifdef HAVE_THREADS
+   if (!(sevenzip_block_cache_lock = slock_new()))
+      return;
+#endif
+   sevenzip_block_cache_enabled = true;
+}
+
+void sevenzip_block_cache_flush(void)
+{
+   struct sevenzip_context_t *context = NULL;
+   char *path                         = NULL;
+
+   if (!sevenzip_block_cache_enabled)
+      return;
+
+#ifdef HAVE_THREADS
+   slock_lock(sevenzip_block_cache_lock);
+#endif
+   context                      = sevenzip_block_cache.context;
+   path                         = sevenzip_block_cache.path;
+   sevenzip_block_cache.context = NULL;
+   sevenzip_block_cache.path    = NULL;
+#ifdef HAVE_THREADS
+   slock_unlock(sevenzip_block_cache_lock);
+#endif
+
+   if (context)
+      sevenzip_parse_file_free(context);
+   if (path)
+      free(path);
+}
+
+void sevenzip_block_cache_deinit(void)
+{
+   sevenzip_block_cache_enabled = false;
+
+   if (sevenzip_block_cache.context)
+      sevenzip_parse_file_free(sevenzip_block_cache.context);
+   if (sevenzip_block_cache.path)
+      free(sevenzip_block_cache.path);
+   sevenzip_block_cache.context = NULL;
+   sevenzip_block_cache.path    = NULL;
+
+#ifdef HAVE_THREADS
+   if (sevenzip_block_cache_lock)
+   {
+      slock_free(sevenzip_block_cache_lock);
+      sevenzip_block_cache_lock = NULL;
+   }
+#endif
+}
+
+/* Extract the relative path (needle) from a 7z archive
+ * (path) and allocate a buf for it to write it in.
+ * If optional_outfile is set, extract to that instead
+ * and don't allocate buffer.
+ */
+static int64_t sevenzip_file_read(
+      const char *path,
+      const char *needle, void **buf,
+      const char *optional_outfile)
+{
+   uint32_t index;
+   int64_t archive_size;
+   int64_t mtime;
+   int64_t outsize                             = -1;
+   struct sevenzip_context_t *sevenzip_context =
+      sevenzip_context_acquire(path, &archive_size, &mtime);
+
+   if (!sevenzip_context)
+      return -1;
+
+   sevenzip_context_find(sevenzip_context, &needle, 1, &index);
+
+   if (index != (uint32_t)-1)
+      outsize = sevenzip_context_extract(sevenzip_context, index,
+            buf, optional_outfile);
+
+   sevenzip_context_release(sevenzip_context, path, archive_size, mtime);
 
    return outsize;
 }
 
+static int sevenzip_member_cmp(const void *a, const void *b)
+{
+   const sevenzip_member_t *ma = (const sevenzip_member_t*)a;
+   const sevenzip_member_t *mb = (const sevenzip_member_t*)b;
+
+   if (ma->block != mb->block)
+      return ma->block < mb->block ? -1 : 1;
+   if (ma->index != mb->index)
+      return ma->index < mb->index ? -1 : 1;
+   return 0;
+}
+
+/* Extract several files from a 7z archive (path) in the
+ * order they are stored in, so that every solid block is
+ * decoded only once.
+ */
+static size_t sevenzip_file_read_multi(
+      const char *path,
+      const char **needles, size_t count,
+      void **bufs, int64_t *lengths)
+{
+   size_t i;
+   int64_t archive_size;
+   int64_t mtime;
+   size_t found                                = 0;
+   size_t read                                 = 0;
+   uint32_t *indices                           = NULL;
+   sevenzip_member_t *members                  = NULL;
+   struct sevenzip_context_t *sevenzip_context =
+      sevenzip_context_acquire(path, &archive_size, &mtime);
+
+   if (!sevenzip_context)
+      return 0;
+
+   indices = (uint32_t*)malloc(count * sizeof(*indices));
+   members = (sevenzip_member_t*)malloc(count * sizeof(*members));
+
+   if (indices && members)
+   {
+      sevenzip_context_find(sevenzip_context, needles, count, indices);
+
+      for (i = 0; i < count; i++)
+      {
+         if (indices[i] == (uint32_t)-1)
+            continue;
+
+         members[found].block  = sevenzip_context->db.FileToFolder[indices[i]];
+         members[found].index  = indices[i];
+         members[found].needle = i;
+         found++;
+      }
+
+      qsort(members, found, sizeof(*members), sevenzip_member_cmp);
+
+      for (i = 0; i < found; i++)
+      {
+         size_t needle   = members[i].needle;
+
+         lengths[needle] = sevenzip_context_extract(sevenzip_context,
+               members[i].index, &bufs[needle], NULL);
+
+         if (lengths[needle] != -1)
+            read++;
+      }
+   }
+
+   if (indices)
+      free(indices);
+   if (members)
+      free(members);
+
+   sevenzip_context_release(sevenzip_context, path, archive_size, mtime);
+
+   return read;
+}
+
 static bool sevenzip_stream_decompress_data_to_file_init(
       void *context, file_archive_file_handle_t *handle,
       const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size)
@@ -328,18 +608,17 @@ static int sevenzip_stream_decompress_data_to_file_iterate(
          (struct sevenzip_context_t*)context;
 
    SRes res                = SZ_ERROR_FAIL;
-   size_t output_size      = 0;
    size_t offset           = 0;
    size_t outSizeProcessed = 0;
 
    res = SzArEx_Extract(&sevenzip_context->db,
          &sevenzip_context->lookStream.vt, sevenzip_context->decompress_index,
          &sevenzip_context->block_index, &sevenzip_context->output,
-         &output_size, &offset, &outSizeProcessed,
+         &sevenzip_context->output_size, &offset, &outSizeProcessed,
          &sevenzip_context->allocImp, &sevenzip_context->allocTempImp);
 
    if (res != SZ_OK)
-      return 0;
+      return -1;
 
    if (handle)
       handle->data = sevenzip_context->output + offset;
@@ -366,38 +645,7 @@ static int sevenzip_parse_file_init(file_archive_transfer_t *state,
    sevenzip_context = (struct sevenzip_context_t*)sevenzip_stream_new();
    state->context = sevenzip_context;
 
-#if defined(_WIN32) && defined(USE_WINDOWS_FILE) && !defined(LEGACY_WIN32)
-   if (!string_is_empty(file))
-   {
-      wchar_t *fileW = utf8_to_utf16_string_alloc(file);
-
-      if (fileW)
-      {
-         /* could not open 7zip archive? */
-         if (InFile_OpenW(&sevenzip_context->archiveStream.file, fileW))
-         {
-            free(fileW);
-            goto error;
-         }
-
-         free(fileW);
-      }
-   }
-#else
-   /* could not open 7zip archive? */
-   if (InFile_Open(&sevenzip_context->archiveStream.file, file))
-      goto error;
-#endif
-
-   FileInStream_CreateVTable(&sevenzip_context->archiveStream);
-   LookToRead2_CreateVTable(&sevenzip_context->lookStream, false);
-   sevenzip_context->lookStream.realStream = &sevenzip_context->archiveStream.vt;
-   LookToRead2_Init(&sevenzip_context->lookStream);
-   CrcGenerateTable();
-   SzArEx_Init(&sevenzip_context->db);
-
-   if (SzArEx_Open(&sevenzip_context->db, &sevenzip_context->lookStream.vt,
-         &sevenzip_context->allocImp, &sevenzip_context->allocTempImp) != SZ_OK)
+   if (!sevenzip_context_open(sevenzip_context, file))
       goto error;
 
    state->step_total = sevenzip_context->db.NumFiles;
@@ -523,5 +771,7 @@ const struct file_archive_file_backend sevenzip_backend = {
    sevenzip_stream_decompress_data_to_file_iterate,
    sevenzip_stream_crc32_calculate,
    sevenzip_file_read,
+   NULL,
+   sevenzip_file_read_multi,
    "7z"
 };
@@ -398,6 +398,57 @@ static int64_t zip_file_read(
    return (int64_t)decomp.size;
 }
 
+/* Extract the member whose local header starts at cdata
+ * from a ZIP archive (path) without reading its central
+ * directory, for callers that have it already.
+ *
+ * optional_outfile if not NULL will be used to extract the file to.
+ * buf will be 0 then.
+ */
+static int64_t zip_file_read_entry(
+      const char *path,
+      const uint8_t *cdata, unsigned cmode, uint32_t csize,
+      uint32_t size, void **buf,
+      const char *optional_outfile)
+{
+   file_archive_transfer_t state     = {0};
+   zip_context_t zip_context         = {0};
+   file_archive_file_handle_t handle = {0};
+   int64_t ret                       = -1;
+
+   if (!(state.archive_file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return -1;
+
+   state.archive_size  = filestream_get_size(state.archive_file);
+   state.context       = &zip_context;
+   zip_context.state   = &state;
+
+   if (zip_file_decompressed_handle(&state,
+            &handle, cdata, cmode, csize, size, 0))
+   {
+      if (optional_outfile)
+      {
+         /* Called in case core has need_fullpath enabled. */
+         if (filestream_write_file(optional_outfile, handle.data, size))
+            ret = 0;
+      }
+      else
+      {
+         /* We keep the data, prevent its deallocation during free */
+         *buf                           = handle.data;
+         zip_context.decompressed_data  = NULL;
+         ret                            = (int64_t)size;
+      }
+   }
+
+   zip_context_free_stream(&zip_context, false);
+   filestream_close(state.archive_file);
+
+   return ret;
+}
+
 static int zip_parse_file_init(file_archive_transfer_t *state,
       const char *file)
 {
@@ -559,5 +610,7 @@ const struct file_archive_file_backend zlib_backend = {
    zlib_stream_decompress_data_to_file_iterate,
    zlib_stream_crc32_calculate,
    zip_file_read,
+   zip_file_read_entry,
+   NULL,
    "zlib"
 };
@@ -0,0 +1,674 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (nbio_uring.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <file/nbio.h>
+
+#if defined(__linux__) && defined(HAVE_IO_URING)
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/* Not every libc knows about io_uring yet; the numbers
+ * are the same on all architectures but Alpha */
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup    425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter    426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+
+/* Requests kept in flight per handle; the file is
+ * split into chunks of NBIO_URING_CHUNK bytes */
+#define NBIO_URING_ENTRIES   32
+#define NBIO_URING_CHUNK     (256 * 1024)
+/* Buffers at least this large are registered with
+ * the kernel, so it doesn't map the pages of every
+ * request again */
+#define NBIO_URING_FIXED_MIN (1024 * 1024)
+/* Rings of freed handles kept for the next ones;
+ * setting one up costs more than reading a small file */
+#define NBIO_URING_POOL_SIZE 4
+
+struct nbio_uring_ring
+{
+   struct io_uring_sqe *sqes;
+   struct io_uring_cqe *cqes;
+   unsigned *sq_head;
+   unsigned *sq_tail;
+   unsigned *sq_mask;
+   unsigned *sq_array;
+   unsigned *cq_head;
+   unsigned *cq_tail;
+   unsigned *cq_mask;
+   void *sq_map;
+   void *cq_map;
+   size_t sq_map_len;
+   size_t cq_map_len;
+   size_t sqes_len;
+   int fd;
+};
+
+struct nbio_uring_t
+{
+   void *ptr;
+   size_t len;
+   size_t progress;  /* next byte handed to a request */
+   struct nbio_uring_ring *ring; /* NULL: use pread/pwrite */
+   /* Per request: what's left of its chunk */
+   size_t slot_off[NBIO_URING_ENTRIES];
+   size_t slot_len[NBIO_URING_ENTRIES];
+   struct iovec iov[NBIO_URING_ENTRIES];
+   uint32_t slots;   /* bit set for every request in flight */
+   unsigned pending; /* queued, but not taken by the kernel yet */
+   int fd;
+   unsigned mode;
+   /*
+    * possible values:
+    * NBIO_READ, NBIO_WRITE - obvious
+    * -1 - currently doing nothing
+    */
+   signed char op;
+   bool fixed;       /* ptr is registered */
+   bool no_fixed;    /* registering failed, don't try again */
+   bool failed;
+};
+
+static struct nbio_uring_ring *nbio_uring_pool[NBIO_URING_POOL_SIZE];
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+   return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit,
+      unsigned min_complete, unsigned flags)
+{
+   return (int)syscall(__NR_io_uring_enter, fd, to_submit,
+         min_complete, flags, NULL, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode,
+      void *arg, unsigned nr_args)
+{
+   return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/**
+ * nbio_uring_supported:
+ *
+ * Checks once whether the kernel can set up an io_uring.
+ * It can't before Linux 5.1, and it can be turned off
+ * (kernel.io_uring_disabled) or filtered by seccomp.
+ *
+ * Returns: true if io_uring can be used, otherwise false.
+ **/
+bool nbio_uring_supported(void)
+{
+   static int supported = -1;
+
+   if (supported < 0)
+   {
+      struct io_uring_params p;
+      int fd;
+
+      memset(&p, 0, sizeof(p));
+      if ((fd = io_uring_setup(1, &p)) >= 0)
+      {
+         close(fd);
+         supported = 1;
+      }
+      else
+         supported = 0;
+   }
+
+   return supported == 1;
+}
+
+static void nbio_uring_ring_free(struct nbio_uring_ring *ring)
+{
+   if (ring->sqes)
+      munmap(ring->sqes, ring->sqes_len);
+   if (ring->cq_map && ring->cq_map != ring->sq_map)
+      munmap(ring->cq_map, ring->cq_map_len);
+   if (ring->sq_map)
+      munmap(ring->sq_map, ring->sq_map_len);
+   if (ring->fd >= 0)
+      close(ring->fd);
+   free(ring);
+}
+
+static struct nbio_uring_ring *nbio_uring_ring_new(void)
+{
+   struct io_uring_params p;
+   uint8_t *sq, *cq;
+   struct nbio_uring_ring *ring = (struct nbio_uring_ring*)
+      calloc(1, sizeof(*ring));
+
+   if (!ring)
+      return NULL;
+
+   memset(&p, 0, sizeof(p));
+   if ((ring->fd = io_uring_setup(NBIO_URING_ENTRIES, &p)) < 0)
+      goto error;
+
+   ring->sq_map_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+   ring->cq_map_len = p.cq_off.cqes
+      + p.cq_entries * sizeof(struct io_uring_cqe);
+
+   /* Since Linux 5.4 both rings share one mapping */
+   if (p.features & IORING_FEAT_SINGLE_MMAP)
+   {
+      if (ring->cq_map_len > ring->sq_map_len)
+         ring->sq_map_len = ring->cq_map_len;
+      ring->cq_map_len    = ring->sq_map_len;
+   }
+
+   ring->sq_map = mmap(NULL, ring->sq_map_len, PROT_READ | PROT_WRITE,
+         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+   if (ring->sq_map == MAP_FAILED)
+   {
+      ring->sq_map = NULL;
+      goto error;
+   }
+
+   if (p.features & IORING_FEAT_SINGLE_MMAP)
+      ring->cq_map = ring->sq_map;
+   else
+   {
+      ring->cq_map = mmap(NULL, ring->cq_map_len, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+      if (ring->cq_map == MAP_FAILED)
+      {
+         ring->cq_map = NULL;
+         goto error;
+      }
+   }
+
+   ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+   ring->sqes     = (struct io_uring_sqe*)mmap(NULL, ring->sqes_len,
+         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+         ring->fd, IORING_OFF_SQES);
+   if (ring->sqes == MAP_FAILED)
+   {
+      ring->sqes = NULL;
+      goto error;
+   }
+
+   sq             = (uint8_t*)ring->sq_map;
+   cq             = (uint8_t*)ring->cq_map;
+   ring->sq_head  = (unsigned*)(sq + p.sq_off.head);
+   ring->sq_tail  = (unsigned*)(sq + p.sq_off.tail);
+   ring->sq_mask  = (unsigned*)(sq + p.sq_off.ring_mask);
+   ring->sq_array = (unsigned*)(sq + p.sq_off.array);
+   ring->cq_head  = (unsigned*)(cq + p.cq_off.head);
+   ring->cq_tail  = (unsigned*)(cq + p.cq_off.tail);
+   ring->cq_mask  = (unsigned*)(cq + p.cq_off.ring_mask);
+   ring->cqes     = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+   return ring;
+
+error:
+   nbio_uring_ring_free(ring);
+   return NULL;
+}
+
+/* Each pool entry is swapped atomically, so handles
+ * can be opened and freed on any thread */
+static struct nbio_uring_ring *nbio_uring_ring_get(void)
+{
+   unsigned i;
+
+   for (i = 0; i < NBIO_URING_POOL_SIZE; i++)
+   {
+      struct nbio_uring_ring *ring = __atomic_exchange_n(
+            &nbio_uring_pool[i], NULL, __ATOMIC_ACQ_REL);
+      if (ring)
+         return ring;
+   }
+
+   return nbio_uring_ring_new();
+}
+
+/* Only idle rings go back: nothing in flight,
+ * no buffer registered */
+static void nbio_uring_ring_put(struct nbio_uring_ring *ring)
+{
+   unsigned i;
+
+   for (i = 0; i < NBIO_URING_POOL_SIZE; i++)
+   {
+      struct nbio_uring_ring *expected = NULL;
+      if (__atomic_compare_exchange_n(&nbio_uring_pool[i], &expected,
+               ring, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+         return;
+   }
+
+   nbio_uring_ring_free(ring);
+}
+
+static void nbio_uring_unregister(struct nbio_uring_t *handle)
+{
+   if (handle->fixed)
+      io_uring_register(handle->ring->fd,
+            IORING_UNREGISTER_BUFFERS, NULL, 0);
+   handle->fixed = false;
+}
+
+/* Registered buffers count against RLIMIT_MEMLOCK before
+ * Linux 5.12, so this may fail; plain requests work too */
+static void nbio_uring_register(struct nbio_uring_t *handle)
+{
+   struct iovec iov;
+
+   if (     handle->fixed
+         || handle->no_fixed
+         || !handle->ring
+         || handle->len < NBIO_URING_FIXED_MIN)
+      return;
+
+   iov.iov_base = handle->ptr;
+   iov.iov_len  = handle->len;
+
+   if (io_uring_register(handle->ring->fd,
+            IORING_REGISTER_BUFFERS, &iov, 1) == 0)
+      handle->fixed    = true;
+   else
+      handle->no_fixed = true;
+}
+
+/* Queues the rest of the chunk of a slot, without
+ * submitting it */
+static void nbio_uring_queue(struct nbio_uring_t *handle, unsigned slot)
+{
+   struct nbio_uring_ring *ring = handle->ring;
+   unsigned tail                = *ring->sq_tail;
+   unsigned idx                 = tail & *ring->sq_mask;
+   struct io_uring_sqe *sqe     = &ring->sqes[idx];
+   uint8_t *buf                 = (uint8_t*)handle->ptr
+      + handle->slot_off[slot];
+
+   memset(sqe, 0, sizeof(*sqe));
+   sqe->fd        = handle->fd;
+   sqe->off       = handle->slot_off[slot];
+   sqe->user_data = slot;
+
+   if (handle->fixed)
+   {
+      sqe->opcode    = (handle->op == NBIO_READ)
+         ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+      sqe->addr      = (uint64_t)(uintptr_t)buf;
+      sqe->len       = (uint32_t)handle->slot_len[slot];
+      sqe->buf_index = 0;
+   }
+   else
+   {
+      handle->iov[slot].iov_base = buf;
+      handle->iov[slot].iov_len  = handle->slot_len[slot];
+      sqe->opcode    = (handle->op == NBIO_READ)
+         ? IORING_OP_READV : IORING_OP_WRITEV;
+      sqe->addr      = (uint64_t)(uintptr_t)&handle->iov[slot];
+      sqe->len       = 1;
+   }
+
+   ring->sq_array[idx] = idx;
+   /* The kernel may only see the tail once the entry is written */
+   __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+   handle->slots        |= (uint32_t)1 << slot;
+   handle->pending++;
+}
+
+/* Hands out the next chunks to every free slot and
+ * submits them, all in one system call */
+static void nbio_uring_submit(struct nbio_uring_t *handle,
+      unsigned min_complete)
+{
+   unsigned slot;
+   unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+
+   for (slot = 0; slot < NBIO_URING_ENTRIES
+         && handle->progress < handle->len
+         && !handle->failed; slot++)
+   {
+      size_t amount = handle->len - handle->progress;
+
+      if (handle->slots & ((uint32_t)1 << slot))
+         continue;
+      if (amount > NBIO_URING_CHUNK)
+         amount = NBIO_URING_CHUNK;
+
+      handle->slot_off[slot] = handle->progress;
+      handle->slot_len[slot] = amount;
+      handle->progress      += amount;
+      nbio_uring_queue(handle, slot);
+   }
+
+   if (!handle->pending && !min_complete)
+      return;
+
+   for (;;)
+   {
+      int ret = io_uring_enter(handle->ring->fd, handle->pending,
+            min_complete, flags);
+
+      if (ret >= 0)
+      {
+         handle->pending -= (unsigned)ret;
+         break;
+      }
+      /* Out of resources for now; the queued requests
+       * stay in the ring and go with the next call */
+      if (errno == EAGAIN || errno == EBUSY)
+         break;
+      if (errno != EINTR)
+         abort();
+   }
+}
+
+/* Takes every completion off the ring, no system call
+ * needed. Short or interrupted requests are queued again
+ * for what they didn't transfer. */
+static void nbio_uring_reap(struct nbio_uring_t *handle)
+{
+   struct nbio_uring_ring *ring = handle->ring;
+   unsigned head                = *ring->cq_head;
+   unsigned tail                = __atomic_load_n(ring->cq_tail,
+         __ATOMIC_ACQUIRE);
+
+   for (; head != tail; head++)
+   {
+      struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+      unsigned slot            = (unsigned)cqe->user_data;
+      int res                  = cqe->res;
+
+      handle->slots &= ~((uint32_t)1 << slot);
+
+      if (res == -EAGAIN || res == -EINTR)
+         res = 0;
+      else if (res <= 0)
+      {
+         /* Error, or end of file on a file that shrank;
+          * finish what's in flight and leave the rest */
+         handle->failed = true;
+         continue;
+      }
+
+      handle->slot_off[slot] += (size_t)res;
+      handle->slot_len[slot] -= (size_t)res;
+      if (handle->slot_len[slot] && !handle->failed)
+         nbio_uring_queue(handle, slot);
+   }
+
+   __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/* Keeps the slots busy until the whole file is done, or
+ * only waits for those in flight once the handle failed */
+static void nbio_uring_wait(struct nbio_uring_t *handle)
+{
+   while (handle->slots
+         || (handle->progress < handle->len && !handle->failed))
+   {
+      nbio_uring_submit(handle, 1);
+      nbio_uring_reap(handle);
+   }
+}
+
+/* Without a ring: one chunk per call, like nbio_stdio */
+static void nbio_uring_sync(struct nbio_uring_t *handle, size_t amount)
+{
+   while (amount && handle->progress < handle->len)
+   {
+      ssize_t ret;
+      uint8_t *buf = (uint8_t*)handle->ptr + handle->progress;
+      size_t size  = handle->len - handle->progress;
+
+      if (size > amount)
+         size = amount;
+
+      if (handle->op == NBIO_READ)
+         ret = pread(handle->fd, buf, size, (off_t)handle->progress);
+      else
+         ret = pwrite(handle->fd, buf, size, (off_t)handle->progress);
+
+      if (ret < 0 && errno == EINTR)
+         continue;
+      if (ret <= 0)
+      {
+         handle->failed = true;
+         break;
+      }
+
+      handle->progress += (size_t)ret;
+      amount           -= (size_t)ret;
+   }
+}
+
+static void *nbio_uring_open(const char * filename, unsigned mode)
+{
+   static const int o_flags[]  = { O_RDONLY, O_RDWR|O_CREAT|O_TRUNC, O_RDWR, O_RDONLY, O_RDWR|O_CREAT|O_TRUNC };
+
+   off_t len                   = 0;
+   struct nbio_uring_t* handle = NULL;
+   int fd                      = open(filename, o_flags[mode]|O_CLOEXEC, 0644);
+   if (fd < 0)
+      return NULL;
+
+   if (     (len = lseek(fd, 0, SEEK_END)) < 0
+         || !(handle = (struct nbio_uring_t*)calloc(1, sizeof(*handle))))
+   {
+      close(fd);
+      return NULL;
+   }
+
+   handle->fd      = fd;
+   handle->mode    = mode;
+   handle->op      = -1;
+   handle->len     = (size_t)len;
+
+   if (handle->len && !(handle->ptr = malloc(handle->len)))
+   {
+      close(fd);
+      free(handle);
+      return NULL;
+   }
+
+   if (nbio_uring_supported())
+      handle->ring = nbio_uring_ring_get();
+
+   return handle;
+}
+
+static void nbio_uring_begin_op(struct nbio_uring_t *handle, signed char op)
+{
+   if (handle->op >= 0)
+      abort();
+
+   handle->op       = op;
+   handle->progress = 0;
+   handle->failed   = false;
+
+   if (handle->ring)
+   {
+      nbio_uring_register(handle);
+      nbio_uring_submit(handle, 0);
+   }
+}
+
+static void nbio_uring_begin_read(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (handle)
+      nbio_uring_begin_op(handle, NBIO_READ);
+}
+
+static void nbio_uring_begin_write(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (handle)
+      nbio_uring_begin_op(handle, NBIO_WRITE);
+}
+
+static bool nbio_uring_iterate(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   bool blocking;
+   if (!handle)
+      return false;
+   if (handle->op < 0)
+      return true;
+
+   blocking = handle->mode == BIO_READ || handle->mode == BIO_WRITE;
+
+   if (!handle->ring)
+      nbio_uring_sync(handle, blocking ? handle->len : NBIO_URING_CHUNK);
+   else if (blocking)
+      nbio_uring_wait(handle);
+   else
+   {
+      nbio_uring_reap(handle);
+      nbio_uring_submit(handle, 0);
+      if (handle->slots)
+         return false;
+   }
+
+   if (handle->progress < handle->len && !handle->failed)
+      return false;
+
+   handle->op = -1;
+   return true;
+}
+
+static void nbio_uring_resize(void *data, size_t len)
+{
+   void *new_ptr               = NULL;
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+
+   if (handle->op >= 0)
+      abort();
+   /* Blocked like in the other backends, so nobody
+    * relies on it */
+   if (len < handle->len)
+      abort();
+
+   if (ftruncate(handle->fd, (off_t)len) != 0)
+      abort();
+
+   /* The buffer may move */
+   nbio_uring_unregister(handle);
+   if (!(new_ptr = realloc(handle->ptr, len)))
+      abort();
+
+   handle->ptr      = new_ptr;
+   handle->len      = len;
+   handle->no_fixed = false;
+}
+
+static void *nbio_uring_get_ptr(void *data, size_t* len)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return NULL;
+   if (len)
+      *len = handle->len;
+   if (handle->op < 0)
+      return handle->ptr;
+   return NULL;
+}
+
+/* Reads and writes of regular files can't be stopped once
+ * the kernel has them, so this waits for those in flight;
+ * the buffer must not be freed under them */
+static void nbio_uring_cancel(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+
+   if (handle->op >= 0)
+   {
+      handle->failed = true;
+      if (handle->ring)
+         nbio_uring_wait(handle);
+      handle->op     = -1;
+   }
+}
+
+static void nbio_uring_free(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+
+   nbio_uring_cancel(handle);
+   if (handle->ring)
+   {
+      nbio_uring_unregister(handle);
+      nbio_uring_ring_put(handle->ring);
+   }
+   close(handle->fd);
+   free(handle->ptr);
+   free(handle);
+}
+
+nbio_intf_t nbio_uring = {
+   nbio_uring_open,
+   nbio_uring_begin_read,
+   nbio_uring_begin_write,
+   nbio_uring_iterate,
+   nbio_uring_resize,
+   nbio_uring_get_ptr,
+   nbio_uring_cancel,
+   nbio_uring_free,
+   "nbio_uring",
+};
+#else
+nbio_intf_t nbio_uring = {
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   "nbio_uring",
+};
+
+#endif
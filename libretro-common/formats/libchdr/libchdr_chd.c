@@ -62,6 +62,10 @@
 #include <retro_inline.h>
 #include <streams/file_stream.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #define TRUE 1
 #define FALSE 0
 
@@ -190,6 +194,43 @@ struct _metadata_entry
 	UINT8					flags;			/* flag bits */
 };
 
+/* state needed to decompress hunks, one per decompressing thread */
+typedef struct _hunk_decompressor hunk_decompressor;
+struct _hunk_decompressor
+{
+	UINT8 *					compressed;		/* pointer to buffer for compressed data */
+
+#ifdef HAVE_ZLIB
+	zlib_codec_data			zlib_codec_data;		/* zlib codec data */
+	cdzl_codec_data			cdzl_codec_data;		/* cdzl codec data */
+#endif
+#ifdef HAVE_7ZIP
+	cdlz_codec_data			cdlz_codec_data;		/* cdlz codec data */
+#endif
+#ifdef HAVE_FLAC
+	cdfl_codec_data			cdfl_codec_data;		/* cdfl codec data */
+#endif
+
+#ifdef HAVE_THREADS
+	slock_t *				filelock;		/* serializes file access between threads, or NULL */
+#endif
+};
+
+/* a range of hunks being decompressed by one or more threads */
+typedef struct _hunk_batch hunk_batch;
+struct _hunk_batch
+{
+	chd_file *				chd;			/* file the hunks are read from */
+	UINT8 *					dest;			/* buffer for count hunks */
+	UINT32					hunknum;		/* first hunk of the range */
+	UINT32					count;			/* number of hunks in the range */
+	UINT32					next;			/* next hunk to claim, relative to hunknum */
+	chd_error				err;			/* first error encountered */
+#ifdef HAVE_THREADS
+	slock_t *				lock;			/* protects next and err */
+#endif
+};
+
 /* internal representation of an open CHD file */
 struct _chd_file
 {
@@ -211,24 +252,14 @@ struct _chd_file
 	UINT32					comparehunk;	/* index of current compare data */
 #endif
 
-	UINT8 *					compressed;		/* pointer to buffer for compressed data */
 	const codec_interface *	codecintf[4];	/* interface to the codec */
-
-#ifdef HAVE_ZLIB
-	zlib_codec_data			zlib_codec_data;		/* zlib codec data */
-	cdzl_codec_data			cdzl_codec_data;		/* cdzl codec data */
-#endif
-#ifdef HAVE_7ZIP
-	cdlz_codec_data			cdlz_codec_data;		/* cdlz codec data */
-#endif
-#ifdef HAVE_FLAC
-	cdfl_codec_data			cdfl_codec_data;		/* cdfl codec data */
-#endif
+	hunk_decompressor		decompressor;	/* codecs used by chd_read() */
 
 #ifdef NEED_CACHE_HUNK
 	UINT32					maxhunk;		/* maximum hunk accessed */
 #endif
    UINT8 *              file_cache; /* cache of underlying file */
+   UINT8 *              hunk_cache; /* every hunk, decompressed */
 };
 
 /***************************************************************************
@@ -251,6 +282,13 @@ static chd_error header_read(chd_file *chd, chd_header *header);
 static chd_error hunk_read_into_cache(chd_file *chd, UINT32 hunknum);
 #endif
 static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *dest);
+static chd_error hunk_decompress(chd_file *chd, hunk_decompressor *decomp, UINT32 hunknum, UINT8 *dest);
+
+/* internal decompressor management */
+static void *decompressor_codec(hunk_decompressor *decomp, UINT32 compression);
+static chd_error decompressor_init(chd_file *chd, hunk_decompressor *decomp);
+static void decompressor_free(chd_file *chd, hunk_decompressor *decomp);
+static chd_error hunk_batch_decompress(chd_file *chd, UINT32 hunknum, UINT32 count, UINT8 *dest, unsigned threads);
 
 /* internal map access */
 static chd_error map_read(chd_file *chd);
@@ -852,11 +890,6 @@ chd_error chd_open_file(RFILE *file, int mode, chd_file *parent, chd_file **chd)
 	newchd->comparehunk = ~0;
 #endif
 
-	/* allocate the temporary compressed buffer */
-	newchd->compressed = (UINT8 *)malloc(newchd->header.hunkbytes);
-	if (newchd->compressed == NULL)
-		EARLY_EXIT(err = CHDERR_OUT_OF_MEMORY);
-
 	/* find the codec interface */
 	if (newchd->header.version < 5)
 	{
@@ -868,20 +901,11 @@ chd_error chd_open_file(RFILE *file, int mode, chd_file *parent, chd_file **chd)
 			}
 		if (intfnum == ARRAY_SIZE(codec_interfaces))
 			EARLY_EXIT(err = CHDERR_UNSUPPORTED_FORMAT);
-
-#ifdef HAVE_ZLIB
-		/* initialize the codec */
-		if (newchd->codecintf[0]->init != NULL)
-      {
-         err = (*newchd->codecintf[0]->init)(&newchd->zlib_codec_data, newchd->header.hunkbytes);
-         (void)err;
-      }
-#endif
 	}
 	else
 	{
 		int i, decompnum;
-		/* verify the compression types and initialize the codecs */
+		/* verify the compression types */
 		for (decompnum = 0; decompnum < (int)ARRAY_SIZE(newchd->header.compression); decompnum++)
 		{
 			for (i = 0 ; i < (int)ARRAY_SIZE(codec_interfaces); i++)
@@ -889,54 +913,18 @@ chd_error chd_open_file(RFILE *file, int mode, chd_file *parent, chd_file **chd)
 				if (codec_interfaces[i].compression == newchd->header.compression[decompnum])
 				{
 					newchd->codecintf[decompnum] = &codec_interfaces[i];
-					if (newchd->codecintf[decompnum] == NULL && newchd->header.compression[decompnum] != 0)
-                    {
-						err = CHDERR_UNSUPPORTED_FORMAT;
-                        (void)err;
-                    }
-
-					/* initialize the codec */
-					if (newchd->codecintf[decompnum]->init != NULL)
-					{
-						void* codec = NULL;
-						switch (newchd->header.compression[decompnum])
-						{
-                     case CHD_CODEC_ZLIB:
-#ifdef HAVE_ZLIB
-								codec = &newchd->zlib_codec_data;
-#endif
-								break;
-
-							case CHD_CODEC_CD_ZLIB:
-#ifdef HAVE_ZLIB
-								codec = &newchd->cdzl_codec_data;
-#endif
-								break;
-
-							case CHD_CODEC_CD_LZMA:
-#ifdef HAVE_7ZIP
-								codec = &newchd->cdlz_codec_data;
-#endif
-								break;
-
-							case CHD_CODEC_CD_FLAC:
-#ifdef HAVE_FLAC
-								codec = &newchd->cdfl_codec_data;
-#endif
-								break;
-						}
-						if (codec != NULL)
-                        {
-							err = (*newchd->codecintf[decompnum]->init)(codec, newchd->header.hunkbytes);
-                            (void)err;
-                        }
-					}
-
+					break;
 				}
 			}
 		}
 	}
 
+	/* allocate the temporary compressed buffer and initialize the codecs;
+	 * a codec that failed to initialize fails the hunks that use it */
+	err = decompressor_init(newchd, &newchd->decompressor);
+	if (err == CHDERR_OUT_OF_MEMORY && newchd->decompressor.compressed == NULL)
+		EARLY_EXIT(err);
+
 #if 0
 	/* HACK */
 	if (err != CHDERR_NONE)
@@ -962,7 +950,7 @@ chd_error chd_precache(chd_file *chd)
 {
 	int64_t size, count;
 
-	if (!chd->file_cache)
+	if (!chd->file_cache && !chd->hunk_cache)
 	{
 		filestream_seek(chd->file, 0, SEEK_END);
 		size = filestream_tell(chd->file);
@@ -984,6 +972,50 @@ chd_error chd_precache(chd_file *chd)
 	return CHDERR_NONE;
 }
 
+/*-------------------------------------------------
+    chd_precache_decompressed - decompress every
+    hunk into memory, on up to the given number
+    of threads
+-------------------------------------------------*/
+
+chd_error chd_precache_decompressed(chd_file *chd, unsigned threads)
+{
+	chd_error err;
+	UINT64 size;
+	UINT8 *cache;
+
+	if (chd == NULL || chd->cookie != COOKIE_VALUE)
+		return CHDERR_INVALID_PARAMETER;
+
+	if (chd->hunk_cache || chd->header.totalhunks == 0)
+		return CHDERR_NONE;
+
+	size = (UINT64)chd->header.totalhunks * chd->header.hunkbytes;
+	if (size > (UINT64)(size_t)-1)
+		return CHDERR_OUT_OF_MEMORY;
+
+	cache = (UINT8 *)malloc((size_t)size);
+	if (cache == NULL)
+		return CHDERR_OUT_OF_MEMORY;
+
+	err = hunk_batch_decompress(chd, 0, chd->header.totalhunks, cache, threads);
+	if (err != CHDERR_NONE)
+	{
+		free(cache);
+		return err;
+	}
+
+	/* hunks are served from memory from now on, the
+	 * compressed copy of the file is not needed any more */
+	chd->hunk_cache = cache;
+	if (chd->file_cache)
+	{
+		free(chd->file_cache);
+		chd->file_cache = NULL;
+	}
+
+	return CHDERR_NONE;
+}
 
 /*-------------------------------------------------
     chd_open - open a CHD file by
@@ -1041,62 +1073,12 @@ void chd_close(chd_file *chd)
 	if (chd == NULL || chd->cookie != COOKIE_VALUE)
 		return;
 
-	/* deinit the codec */
-	if (chd->header.version < 5)
-	{
-#ifdef HAVE_ZLIB
-		if (chd->codecintf[0] != NULL && chd->codecintf[0]->free != NULL)
-			(*chd->codecintf[0]->free)(&chd->zlib_codec_data);
-#endif
-	}
-	else
-	{
-		int i;
-		/* Free the codecs */
-		for (i = 0 ; i < 4 ; i++)
-      {
-         void* codec = NULL;
-         if (!chd->codecintf[i])
-            continue;
-
-         switch (chd->codecintf[i]->compression)
-         {
-            case CHD_CODEC_CD_LZMA:
-#ifdef HAVE_7ZIP
-               codec = &chd->cdlz_codec_data;
-#endif
-               break;
-
-            case CHD_CODEC_ZLIB:
-#ifdef HAVE_ZLIB
-               codec = &chd->zlib_codec_data;
-#endif
-               break;
+	/* deinit the codecs and free the compressed data buffer */
+	decompressor_free(chd, &chd->decompressor);
 
-            case CHD_CODEC_CD_ZLIB:
-#ifdef HAVE_ZLIB
-               codec = &chd->cdzl_codec_data;
-#endif
-               break;
-
-            case CHD_CODEC_CD_FLAC:
-#ifdef HAVE_FLAC
-               codec = &chd->cdfl_codec_data;
-#endif
-               break;
-         }
-         if (codec)
-            (*chd->codecintf[i]->free)(codec);
-      }
-
-		/* Free the raw map */
-		if (chd->header.rawmap != NULL)
-			free(chd->header.rawmap);
-	}
-
-	/* free the compressed data buffer */
-	if (chd->compressed != NULL)
-		free(chd->compressed);
+	/* Free the raw map */
+	if (chd->header.version >= 5 && chd->header.rawmap != NULL)
+		free(chd->header.rawmap);
 
 #ifdef NEED_CACHE_HUNK
 	/* free the hunk cache and compare data */
@@ -1120,6 +1102,8 @@ void chd_close(chd_file *chd)
 
    if (chd->file_cache)
       free(chd->file_cache);
+   if (chd->hunk_cache)
+      free(chd->hunk_cache);
 
 	/* free our memory */
 	free(chd);
@@ -1213,6 +1197,32 @@ chd_error chd_read(chd_file *chd, UINT32 hunknum, void *buffer)
 	return hunk_read_into_memory(chd, hunknum, (UINT8 *)buffer);
 }
 
+/*-------------------------------------------------
+    chd_read_hunks - read a range of hunks from
+    the CHD file, decompressing them on up to the
+    given number of threads
+-------------------------------------------------*/
+
+chd_error chd_read_hunks(chd_file *chd, UINT32 hunknum, UINT32 count, void *buffer, unsigned threads)
+{
+	/* punt if NULL or invalid */
+	if (chd == NULL || chd->cookie != COOKIE_VALUE || buffer == NULL)
+		return CHDERR_INVALID_PARAMETER;
+
+	/* return an error if out of range */
+	if (hunknum >= chd->header.totalhunks || count > chd->header.totalhunks - hunknum)
+		return CHDERR_HUNK_OUT_OF_RANGE;
+
+	if (chd->hunk_cache)
+	{
+		memcpy(buffer, chd->hunk_cache + (size_t)hunknum * chd->header.hunkbytes,
+				(size_t)count * chd->header.hunkbytes);
+		return CHDERR_NONE;
+	}
+
+	return hunk_batch_decompress(chd, hunknum, count, (UINT8 *)buffer, threads);
+}
+
 /***************************************************************************
     METADATA MANAGEMENT
 ***************************************************************************/
@@ -1299,6 +1309,12 @@ chd_error chd_codec_config(chd_file *chd, int param, void *config)
 
 const char *chd_get_codec_name(UINT32 codec)
 {
+	int intfnum;
+
+	for (intfnum = 0; intfnum < (int)ARRAY_SIZE(codec_interfaces); intfnum++)
+		if (codec_interfaces[intfnum].compression == codec)
+			return codec_interfaces[intfnum].compname;
+
 	return "Unknown";
 }
 
@@ -1568,16 +1584,24 @@ static chd_error hunk_read_into_cache(chd_file *chd, UINT32 hunknum)
     hunk
 -------------------------------------------------*/
 
-static UINT8* hunk_read_compressed(chd_file *chd, UINT64 offset, size_t size)
+static UINT8* hunk_read_compressed(chd_file *chd, hunk_decompressor *decomp, UINT64 offset, size_t size)
 {
    int64_t bytes;
    if (chd->file_cache)
       return chd->file_cache + offset;
+#ifdef HAVE_THREADS
+   if (decomp->filelock)
+      slock_lock(decomp->filelock);
+#endif
    filestream_seek(chd->file, offset, SEEK_SET);
-   bytes = filestream_read(chd->file, chd->compressed, size);
+   bytes = filestream_read(chd->file, decomp->compressed, size);
+#ifdef HAVE_THREADS
+   if (decomp->filelock)
+      slock_unlock(decomp->filelock);
+#endif
    if (bytes != (int64_t)size)
       return NULL;
-   return chd->compressed;
+   return decomp->compressed;
 }
 
 /*-------------------------------------------------
@@ -1585,7 +1609,7 @@ static UINT8* hunk_read_compressed(chd_file *chd, UINT64 offset, size_t size)
     hunk
 -------------------------------------------------*/
 
-static chd_error hunk_read_uncompressed(chd_file *chd, UINT64 offset, size_t size, UINT8 *dest)
+static chd_error hunk_read_uncompressed(chd_file *chd, hunk_decompressor *decomp, UINT64 offset, size_t size, UINT8 *dest)
 {
    int64_t bytes;
    if (chd->file_cache)
@@ -1593,8 +1617,16 @@ static chd_error hunk_read_uncompressed(chd_file *chd, UINT64 offset, size_t siz
       memcpy(dest, chd->file_cache + offset, size);
       return CHDERR_NONE;
    }
+#ifdef HAVE_THREADS
+   if (decomp->filelock)
+      slock_lock(decomp->filelock);
+#endif
    filestream_seek(chd->file, offset, SEEK_SET);
    bytes = filestream_read(chd->file, dest, size);
+#ifdef HAVE_THREADS
+   if (decomp->filelock)
+      slock_unlock(decomp->filelock);
+#endif
    if (bytes != (int64_t)size)
       return CHDERR_READ_ERROR;
    return CHDERR_NONE;
@@ -1606,6 +1638,47 @@ static chd_error hunk_read_uncompressed(chd_file *chd, UINT64 offset, size_t siz
 -------------------------------------------------*/
 
 static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *dest)
+{
+	if (chd->hunk_cache && hunknum < chd->header.totalhunks && dest != NULL)
+	{
+		memcpy(dest, chd->hunk_cache + (size_t)hunknum * chd->header.hunkbytes,
+				chd->header.hunkbytes);
+		return CHDERR_NONE;
+	}
+
+	return hunk_decompress(chd, &chd->decompressor, hunknum, dest);
+}
+
+/*-------------------------------------------------
+    hunk_read_parent - read a hunk from the
+    parent, which has a single decompressor
+-------------------------------------------------*/
+
+static chd_error hunk_read_parent(chd_file *chd, hunk_decompressor *decomp, UINT32 hunknum, UINT8 *dest)
+{
+	chd_error err;
+
+	if (chd->parent == NULL)
+		return CHDERR_REQUIRES_PARENT;
+
+#ifdef HAVE_THREADS
+	if (decomp->filelock)
+		slock_lock(decomp->filelock);
+#endif
+	err = hunk_read_into_memory(chd->parent, hunknum, dest);
+#ifdef HAVE_THREADS
+	if (decomp->filelock)
+		slock_unlock(decomp->filelock);
+#endif
+	return err;
+}
+
+/*-------------------------------------------------
+    hunk_decompress - read a hunk into memory at
+    the given location using the given codecs
+-------------------------------------------------*/
+
+static chd_error hunk_decompress(chd_file *chd, hunk_decompressor *decomp, UINT32 hunknum, UINT8 *dest)
 {
 	chd_error err;
 
@@ -1635,15 +1708,15 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
                /* read it into the decompression buffer */
 
                void *codec;
-               compressed_bytes = hunk_read_compressed(chd, entry->offset,
-                     entry->length);
+               compressed_bytes = hunk_read_compressed(chd, decomp,
+                     entry->offset, entry->length);
                if (compressed_bytes == NULL)
                   return CHDERR_READ_ERROR;
 
 #ifdef HAVE_ZLIB
                /* now decompress using the codec */
                err   = CHDERR_NONE;
-               codec = &chd->zlib_codec_data;
+               codec = &decomp->zlib_codec_data;
                if (chd->codecintf[0]->decompress != NULL)
                   err = (*chd->codecintf[0]->decompress)(codec, compressed_bytes, entry->length, dest, chd->header.hunkbytes);
                if (err != CHDERR_NONE)
@@ -1654,7 +1727,7 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 
 			/* uncompressed data */
 			case V34_MAP_ENTRY_TYPE_UNCOMPRESSED:
-            err = hunk_read_uncompressed(chd, entry->offset, chd->header.hunkbytes, dest);
+            err = hunk_read_uncompressed(chd, decomp, entry->offset, chd->header.hunkbytes, dest);
             if (err != CHDERR_NONE)
                return err;
 				break;
@@ -1672,11 +1745,11 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 				if (chd->cachehunk == entry->offset && dest == chd->cache)
 					break;
 #endif
-				return hunk_read_into_memory(chd, (UINT32)entry->offset, dest);
+				return hunk_decompress(chd, decomp, (UINT32)entry->offset, dest);
 
 			/* parent-referenced data */
 			case V34_MAP_ENTRY_TYPE_PARENT_HUNK:
-				err = hunk_read_into_memory(chd->parent, (UINT32)entry->offset, dest);
+				err = hunk_read_parent(chd, decomp, (UINT32)entry->offset, dest);
 				if (err != CHDERR_NONE)
 					return err;
 				break;
@@ -1724,37 +1797,12 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 			case COMPRESSION_TYPE_1:
 			case COMPRESSION_TYPE_2:
 			case COMPRESSION_TYPE_3:
-            compressed_bytes = hunk_read_compressed(chd, blockoffs, blocklen);
+            compressed_bytes = hunk_read_compressed(chd, decomp, blockoffs, blocklen);
             if (compressed_bytes == NULL)
                return CHDERR_READ_ERROR;
             if (!chd->codecintf[rawmap[0]])
                return CHDERR_UNSUPPORTED_FORMAT;
-				switch (chd->codecintf[rawmap[0]]->compression)
-				{
-					case CHD_CODEC_CD_LZMA:
-#ifdef HAVE_7ZIP
-						codec = &chd->cdlz_codec_data;
-#endif
-						break;
-
-               case CHD_CODEC_ZLIB:
-#ifdef HAVE_ZLIB
-                  codec = &chd->zlib_codec_data;
-#endif
-                  break;
-
-					case CHD_CODEC_CD_ZLIB:
-#ifdef HAVE_ZLIB
-						codec = &chd->cdzl_codec_data;
-#endif
-						break;
-
-					case CHD_CODEC_CD_FLAC:
-#ifdef HAVE_FLAC
-						codec = &chd->cdfl_codec_data;
-#endif
-						break;
-				}
+				codec = decompressor_codec(decomp, chd->codecintf[rawmap[0]]->compression);
 				if (codec==NULL)
 					return CHDERR_CODEC_ERROR;
 				err = (*chd->codecintf[rawmap[0]]->decompress)(codec, compressed_bytes, blocklen, dest, chd->header.hunkbytes);
@@ -1767,7 +1815,7 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 				return CHDERR_NONE;
 
 			case COMPRESSION_NONE:
-            err = hunk_read_uncompressed(chd, blockoffs, blocklen, dest);
+            err = hunk_read_uncompressed(chd, decomp, blockoffs, blocklen, dest);
             if (err != CHDERR_NONE)
                return err;
 #ifdef VERIFY_BLOCK_CRC
@@ -1777,7 +1825,7 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 				return CHDERR_NONE;
 
 			case COMPRESSION_SELF:
-				return hunk_read_into_memory(chd, (UINT32)blockoffs, dest);
+				return hunk_decompress(chd, decomp, (UINT32)blockoffs, dest);
 
 			case COMPRESSION_PARENT:
 #if 0
@@ -1795,6 +1843,257 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 	return CHDERR_DECOMPRESSION_ERROR;
 }
 
+/***************************************************************************
+    INTERNAL DECOMPRESSORS
+***************************************************************************/
+
+/*-------------------------------------------------
+    decompressor_codec - return the codec data
+    of a decompressor for a compression type
+-------------------------------------------------*/
+
+static void *decompressor_codec(hunk_decompressor *decomp, UINT32 compression)
+{
+	switch (compression)
+	{
+#ifdef HAVE_ZLIB
+		case CHDCOMPRESSION_ZLIB:
+		case CHDCOMPRESSION_ZLIB_PLUS:
+		case CHD_CODEC_ZLIB:
+			return &decomp->zlib_codec_data;
+
+		case CHD_CODEC_CD_ZLIB:
+			return &decomp->cdzl_codec_data;
+#endif
+
+#ifdef HAVE_7ZIP
+		case CHD_CODEC_CD_LZMA:
+			return &decomp->cdlz_codec_data;
+#endif
+
+#ifdef HAVE_FLAC
+		case CHD_CODEC_CD_FLAC:
+			return &decomp->cdfl_codec_data;
+#endif
+	}
+
+	return NULL;
+}
+
+/*-------------------------------------------------
+    decompressor_init - allocate a decompressor's
+    buffer and initialize the file's codecs in it
+-------------------------------------------------*/
+
+static chd_error decompressor_init(chd_file *chd, hunk_decompressor *decomp)
+{
+	chd_error err = CHDERR_NONE;
+	int i;
+
+	decomp->compressed = (UINT8 *)malloc(chd->header.hunkbytes);
+	if (decomp->compressed == NULL)
+		return CHDERR_OUT_OF_MEMORY;
+
+	for (i = 0; i < (int)ARRAY_SIZE(chd->codecintf); i++)
+	{
+		chd_error codecerr;
+		void *codec;
+
+		if (chd->codecintf[i] == NULL || chd->codecintf[i]->init == NULL)
+			continue;
+
+		codec = decompressor_codec(decomp, chd->codecintf[i]->compression);
+		if (codec == NULL)
+			continue;
+
+		codecerr = (*chd->codecintf[i]->init)(codec, chd->header.hunkbytes);
+		if (codecerr != CHDERR_NONE && err == CHDERR_NONE)
+			err = codecerr;
+	}
+
+	return err;
+}
+
+/*-------------------------------------------------
+    decompressor_free - free the codecs and the
+    buffer of a decompressor
+-------------------------------------------------*/
+
+static void decompressor_free(chd_file *chd, hunk_decompressor *decomp)
+{
+	int i;
+
+	/* codecs are only initialized once the buffer is allocated */
+	if (decomp->compressed == NULL)
+		return;
+
+	for (i = 0; i < (int)ARRAY_SIZE(chd->codecintf); i++)
+	{
+		void *codec;
+
+		if (chd->codecintf[i] == NULL || chd->codecintf[i]->free == NULL)
+			continue;
+
+		codec = decompressor_codec(decomp, chd->codecintf[i]->compression);
+		if (codec != NULL)
+			(*chd->codecintf[i]->free)(codec);
+	}
+
+	free(decomp->compressed);
+	decomp->compressed = NULL;
+}
+
+/*-------------------------------------------------
+    hunk_batch_run - decompress hunks of a batch
+    until none are left
+-------------------------------------------------*/
+
+static void hunk_batch_run(hunk_batch *batch, hunk_decompressor *decomp)
+{
+	UINT32 hunkbytes = batch->chd->header.hunkbytes;
+
+	for (;;)
+	{
+		chd_error err;
+		UINT32 index;
+		int claimed = FALSE;
+
+#ifdef HAVE_THREADS
+		if (batch->lock)
+			slock_lock(batch->lock);
+#endif
+		index = batch->next;
+		if (batch->err == CHDERR_NONE && index < batch->count)
+		{
+			batch->next++;
+			claimed = TRUE;
+		}
+#ifdef HAVE_THREADS
+		if (batch->lock)
+			slock_unlock(batch->lock);
+#endif
+
+		if (!claimed)
+			break;
+
+		err = hunk_decompress(batch->chd, decomp, batch->hunknum + index,
+				batch->dest + (size_t)index * hunkbytes);
+		if (err == CHDERR_NONE)
+			continue;
+
+#ifdef HAVE_THREADS
+		if (batch->lock)
+			slock_lock(batch->lock);
+#endif
+		if (batch->err == CHDERR_NONE)
+			batch->err = err;
+#ifdef HAVE_THREADS
+		if (batch->lock)
+			slock_unlock(batch->lock);
+#endif
+	}
+}
+
+#ifdef HAVE_THREADS
+/* a thread helping to decompress a batch */
+typedef struct _hunk_worker hunk_worker;
+struct _hunk_worker
+{
+	hunk_batch *			batch;
+	hunk_decompressor		decomp;
+	sthread_t *				thread;
+};
+
+static void hunk_worker_thread(void *data)
+{
+	hunk_worker *worker = (hunk_worker *)data;
+	hunk_batch_run(worker->batch, &worker->decomp);
+}
+#endif
+
+/*-------------------------------------------------
+    hunk_batch_decompress - decompress a range of
+    hunks on the calling thread and up to
+    threads - 1 worker threads, each with its own
+    codecs
+-------------------------------------------------*/
+
+static chd_error hunk_batch_decompress(chd_file *chd, UINT32 hunknum, UINT32 count, UINT8 *dest, unsigned threads)
+{
+	hunk_batch batch;
+#ifdef HAVE_THREADS
+	hunk_worker *workers = NULL;
+	slock_t *filelock    = NULL;
+	unsigned spawned     = 0;
+	unsigned i;
+#endif
+
+	memset(&batch, 0, sizeof(batch));
+	batch.chd     = chd;
+	batch.dest    = dest;
+	batch.hunknum = hunknum;
+	batch.count   = count;
+	batch.err     = CHDERR_NONE;
+
+#ifdef HAVE_THREADS
+	if (threads > count)
+		threads = count;
+
+	if (threads > 1)
+	{
+		batch.lock = slock_new();
+		filelock   = slock_new();
+		workers    = (hunk_worker *)calloc(threads - 1, sizeof(*workers));
+	}
+
+	/* fewer or no workers just make the batch slower */
+	if (batch.lock && filelock && workers)
+	{
+		for (i = 0; i < threads - 1; i++)
+		{
+			hunk_worker *worker = &workers[spawned];
+
+			worker->batch = &batch;
+			if (decompressor_init(chd, &worker->decomp) != CHDERR_NONE)
+			{
+				decompressor_free(chd, &worker->decomp);
+				break;
+			}
+			worker->decomp.filelock = filelock;
+
+			if (!(worker->thread = sthread_create(hunk_worker_thread, worker)))
+			{
+				decompressor_free(chd, &worker->decomp);
+				break;
+			}
+			spawned++;
+		}
+	}
+
+	chd->decompressor.filelock = spawned ? filelock : NULL;
+#endif
+
+	hunk_batch_run(&batch, &chd->decompressor);
+
+#ifdef HAVE_THREADS
+	chd->decompressor.filelock = NULL;
+
+	for (i = 0; i < spawned; i++)
+	{
+		sthread_join(workers[i].thread);
+		decompressor_free(chd, &workers[i].decomp);
+	}
+
+	free(workers);
+	if (filelock)
+		slock_free(filelock);
+	if (batch.lock)
+		slock_free(batch.lock);
+#endif
+
+	return batch.err;
+}
+
 /***************************************************************************
     INTERNAL MAP ACCESS
 ***************************************************************************/
@@ -46,6 +46,8 @@ RETRO_BEGIN_DECLS
 #define RESAMPLER_SIMD_AVX2     (1 << 12)
 #define RESAMPLER_SIMD_VFPU     (1 << 13)
 #define RESAMPLER_SIMD_PS       (1 << 14)
+#define RESAMPLER_SIMD_FMA3     (1 << 22)
+#define RESAMPLER_SIMD_AVX512F  (1 << 23)
 
 enum resampler_quality
 {
@@ -105,6 +107,46 @@ struct resampler_data
    double ratio;
 };
 
+/**
+ * The s16 counterpart of ::resampler_data, for drivers that can
+ * resample 16-bit stereo frames without an intermediate float buffer.
+ */
+struct resampler_data_s16
+{
+   /**
+    * The interleaved stereo frames to be resampled.
+    */
+   const int16_t *data_in;
+
+   /**
+    * The buffer that will be used to store resampled output.
+    * Must be allocated in advance, and must not be the same as data_in.
+    */
+   int16_t *data_out;
+
+   /**
+    * The size of ::data_in, in frames.
+    */
+   size_t input_frames;
+
+   /**
+    * The number of frames that the resampler produced.
+    * This value is set by the resampler.
+    */
+   size_t output_frames;
+
+   /**
+    * The desired ratio of output_frames to input_frames,
+    * as in ::resampler_data.
+    */
+   double ratio;
+
+   /**
+    * Volume applied to the input, as in convert_s16_to_float().
+    */
+   float gain;
+};
+
 /* Returns true if config key was found. Otherwise,
  * returns false, and sets value to default value.
  */
@@ -156,6 +198,10 @@ typedef void (*resampler_free_t)(void *data);
 /* Processes input data. */
 typedef void (*resampler_process_t)(void *_data, struct resampler_data *data);
 
+/* Processes s16 input data. */
+typedef void (*resampler_process_s16_t)(void *_data,
+      struct resampler_data_s16 *data);
+
 typedef struct retro_resampler
 {
    resampler_init_t     init;
@@ -171,6 +217,11 @@ typedef struct retro_resampler
    /* Computer-friendly short version of ident.
     * Lower case, no spaces and special characters, etc. */
    const char *short_ident;
+
+   /* Optional, can be NULL. Resamples s16 frames directly,
+    * for when nothing has to run on the float samples
+    * between the resampler and the audio driver. */
+   resampler_process_s16_t process_s16;
 } retro_resampler_t;
 
 typedef struct audio_frame_float
@@ -184,6 +235,7 @@ extern retro_resampler_t sinc_resampler;
 extern retro_resampler_t CC_resampler;
 #endif
 extern retro_resampler_t nearest_resampler;
+extern retro_resampler_t polyphase_resampler;
 
 /**
  * audio_resampler_driver_find_handle:
@@ -131,6 +131,15 @@ struct file_archive_file_backend
    uint32_t (*stream_crc_calculate)(uint32_t, const uint8_t *, size_t);
    int64_t (*compressed_file_read)(const char *path, const char *needle, void **buf,
          const char *optional_outfile);
+   /* Optional. Reads the member at cdata, as passed to file_cb,
+    * without parsing the archive directory again */
+   int64_t (*compressed_file_read_entry)(const char *path,
+         const uint8_t *cdata, unsigned cmode, uint32_t csize,
+         uint32_t size, void **buf, const char *optional_outfile);
+   /* Optional. Reads several members in one pass */
+   size_t (*compressed_file_read_multi)(const char *path,
+         const char **needles, size_t count,
+         void **bufs, int64_t *lengths);
    const char *ident;
 };
 
@@ -187,6 +196,25 @@ int file_archive_compressed_read(
       const char* path, void **buf,
       const char* optional_filename, int64_t *length);
 
+/**
+ * file_archive_compressed_read_multi:
+ * @path                        : filename path of archive
+ * @members                     : paths of the files within the archive
+ * @count                       : number of files
+ * @bufs                        : buffers of the files, set to NULL for
+ *                                files that could not be read. Must be
+ *                                freed by the caller.
+ * @lengths                     : sizes of the files, set to -1 for files
+ *                                that could not be read.
+ *
+ * Reads several files from one archive. Solid blocks of
+ * 7z archives are decoded once for all files in them.
+ *
+ * Returns: number of files read.
+ **/
+size_t file_archive_compressed_read_multi(const char *path,
+      const char **members, size_t count, void **bufs, int64_t *lengths);
+
 const struct file_archive_file_backend* file_archive_get_zlib_file_backend(void);
 const struct file_archive_file_backend* file_archive_get_7z_file_backend(void);
 
@@ -202,9 +230,48 @@ const struct file_archive_file_backend* file_archive_get_file_backend(const char
  **/
 uint32_t file_archive_get_file_crc32(const char *path);
 
+/**
+ * file_archive_cache_init:
+ *
+ * Enables the cache of archive directories. While it is enabled,
+ * file lists, CRC32 queries and ZIP member reads use the directory
+ * parsed the first time an archive was opened, for as long as the
+ * size and modification time of the archive do not change.
+ *
+ * Must be called before any other thread uses this API.
+ **/
+void file_archive_cache_init(void);
+
+/* Frees all cached archive directories and disables the cache.
+ * Must be called upon program termination */
+void file_archive_cache_deinit(void);
+
+/* Frees the decoded archive data kept for the next read, keeping
+ * the cache enabled. Call it once a batch of reads is done, such
+ * as loading content, so that data doesn't stay in memory. */
+void file_archive_cache_flush(void);
+
+/**
+ * file_archive_get_stamp:
+ * @path                        : filename path of archive
+ * @size                        : size of the archive
+ * @mtime                       : modification time of the archive
+ *
+ * Returns: true (1) on success, false (0) if the archive does
+ * not exist or the platform has no modification times.
+ **/
+bool file_archive_get_stamp(const char *path,
+      int64_t *size, int64_t *mtime);
+
 extern const struct file_archive_file_backend zlib_backend;
 extern const struct file_archive_file_backend sevenzip_backend;
 
+/* Keeps the solid block last decoded by sevenzip_backend,
+ * along with the cache of archive directories */
+void sevenzip_block_cache_init(void);
+void sevenzip_block_cache_flush(void);
+void sevenzip_block_cache_deinit(void);
+
 RETRO_END_DECLS
 
 #endif
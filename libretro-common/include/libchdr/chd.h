@@ -356,6 +356,10 @@ chd_error chd_open(const char *filename, int mode, chd_file *parent, chd_file **
 /* precache underlying file */
 chd_error chd_precache(chd_file *chd);
 
+/* decompress every hunk into memory, on up to 'threads' threads including the
+ * calling one; uses totalhunks * hunkbytes bytes and frees the chd_precache() copy */
+chd_error chd_precache_decompressed(chd_file *chd, unsigned threads);
+
 /* close a CHD file */
 void chd_close(chd_file *chd);
 
@@ -375,6 +379,10 @@ const chd_header *chd_get_header(chd_file *chd);
 /* read one hunk from the CHD file */
 chd_error chd_read(chd_file *chd, UINT32 hunknum, void *buffer);
 
+/* read 'count' consecutive hunks into 'buffer', decompressing them on up to
+ * 'threads' threads including the calling one */
+chd_error chd_read_hunks(chd_file *chd, UINT32 hunknum, UINT32 count, void *buffer, unsigned threads);
+
 /* ----- metadata management ----- */
 
 /* get indexed metadata of a particular sort */
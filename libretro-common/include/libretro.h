@@ -4197,6 +4197,21 @@ struct retro_log_callback
 /** Indicates CPU support for the ASIMD instruction set. */
 #define RETRO_SIMD_ASIMD    (1 << 21)
 
+/**
+ * Indicates CPU support for the FMA3 instruction set.
+ * Only set when AVX is usable as well.
+ *
+ * @see https://www.intel.com/content/www/us/en/docs/intrinsics-guide/index.html#techs=FMA
+ */
+#define RETRO_SIMD_FMA3     (1 << 22)
+
+/**
+ * Indicates CPU and OS support for the AVX-512 Foundation instruction set.
+ *
+ * @see https://www.intel.com/content/www/us/en/docs/intrinsics-guide/index.html#avx512techs=AVX512F
+ */
+#define RETRO_SIMD_AVX512F  (1 << 23)
+
 /** @} */
 
 /**
@@ -164,6 +164,104 @@ void fifo_free(fifo_buffer_t *buffer);
  */
 bool fifo_deinitialize(fifo_buffer_t *buffer);
 
+/**
+ * Minimum distance in bytes between the read and write indices
+ * of a \c fifo_spsc_t, so that they never share a cache line.
+ */
+#define FIFO_SPSC_CACHE_LINE 64
+
+/** @copydoc fifo_spsc_t */
+struct fifo_spsc
+{
+   uint8_t *buffer;
+   /* Usable capacity in bytes, as requested by the caller. */
+   size_t size;
+   /* Storage size minus one; the storage size is a power of two. */
+   size_t mask;
+   uint8_t pad0[FIFO_SPSC_CACHE_LINE];
+   /* Only ever written by the producer. */
+   size_t write_idx;
+   uint8_t pad1[FIFO_SPSC_CACHE_LINE];
+   /* Only ever written by the consumer. */
+   size_t read_idx;
+   uint8_t pad2[FIFO_SPSC_CACHE_LINE];
+};
+
+/**
+ * A bounded FIFO byte queue for exactly one producer thread
+ * and one consumer thread.
+ *
+ * Unlike \c fifo_buffer_t it needs no external lock:
+ * the indices are free-running counters that are published
+ * with release stores and observed with acquire loads,
+ * and each one is only written by one side.
+ * Blocking on a full or empty queue is left to the caller.
+ */
+typedef struct fifo_spsc fifo_spsc_t;
+
+/**
+ * Creates a new single-producer/single-consumer queue
+ * that can hold \c size bytes.
+ * Must be freed with \c fifo_spsc_free.
+ *
+ * @param size The capacity of the queue, in bytes.
+ * @return The new queue if successful, \c NULL otherwise.
+ */
+fifo_spsc_t *fifo_spsc_new(size_t size);
+
+/**
+ * Releases \c buffer and its contents.
+ * Neither side may be using the queue anymore.
+ *
+ * @param buffer The queue to free.
+ * If \c NULL, this function will do nothing.
+ */
+void fifo_spsc_free(fifo_spsc_t *buffer);
+
+/**
+ * Returns the number of bytes the consumer can read.
+ * The result may grow concurrently, but never shrinks
+ * unless the consumer itself reads.
+ *
+ * @param buffer The queue to check.
+ * @return The number of bytes available for reading.
+ */
+size_t fifo_spsc_read_avail(fifo_spsc_t *buffer);
+
+/**
+ * Returns the number of bytes the producer can write.
+ * The result may grow concurrently, but never shrinks
+ * unless the producer itself writes.
+ *
+ * @param buffer The queue to check.
+ * @return The number of bytes that \c buffer can accept.
+ */
+size_t fifo_spsc_write_avail(fifo_spsc_t *buffer);
+
+/**
+ * Writes up to \c size bytes to the given queue.
+ * Must only be called from the producer thread.
+ *
+ * @param buffer The queue to write to.
+ * @param in_buf The buffer to read bytes from.
+ * @param size The length of \c in_buf, in bytes.
+ * @return The number of bytes actually written,
+ * which is less than \c size if the queue is full.
+ */
+size_t fifo_spsc_write(fifo_spsc_t *buffer, const void *in_buf, size_t size);
+
+/**
+ * Reads up to \c size bytes from the given queue.
+ * Must only be called from the consumer thread.
+ *
+ * @param buffer The queue to read from.
+ * @param out_buf The buffer to store the read bytes in.
+ * @param size The length of \c out_buf, in bytes.
+ * @return The number of bytes actually read,
+ * which is less than \c size if the queue runs empty.
+ */
+size_t fifo_spsc_read(fifo_spsc_t *buffer, void *out_buf, size_t size);
+
 
 RETRO_END_DECLS
 
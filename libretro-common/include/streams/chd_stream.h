@@ -27,6 +27,7 @@
 #include <stddef.h>
 
 #include <retro_common_api.h>
+#include <boolean.h>
 
 RETRO_BEGIN_DECLS
 
@@ -39,10 +40,52 @@ typedef struct chdstream chdstream_t;
 /* Primary (largest) data track, used for CRC identification purposes */
 #define CHDSTREAM_TRACK_PRIMARY (-3)
 
+/* Decompressed hunks kept by a newly opened stream */
+#define CHDSTREAM_CACHE_HUNKS 16
+/* Hunks decompressed ahead of sequential reads, needs HAVE_THREADS */
+#define CHDSTREAM_PREFETCH_HUNKS 4
+
+typedef struct chdstream_stats
+{
+   /* Hunk lookups served from the cache. Reads within the
+    * hunk last looked up are not counted. */
+   uint64_t hits;
+   /* Hits on hunks decompressed ahead by the prefetcher */
+   uint64_t prefetch_hits;
+   /* Hunk lookups decompressed on the reading thread */
+   uint64_t misses;
+   /* Hunks decompressed, including prefetched ones */
+   uint64_t decompressed;
+   /* Time spent decompressing them */
+   uint64_t decompress_usec;
+} chdstream_stats_t;
+
 chdstream_t *chdstream_open(const char *path, int32_t track);
 
 void chdstream_close(chdstream_t *stream);
 
+/**
+ * chdstream_set_cache:
+ * @stream       : CHD stream.
+ * @hunks        : decompressed hunks to keep, at least 1.
+ * @prefetch     : hunks to decompress ahead of sequential reads on
+ *                 a background thread, 0 to disable. At most
+ *                 @hunks - 1.
+ *
+ * Resizes the hunk cache, dropping the hunks cached so far.
+ *
+ * Returns: false if the cache could not be allocated.
+ **/
+bool chdstream_set_cache(chdstream_t *stream,
+      unsigned hunks, unsigned prefetch);
+
+/**
+ * chdstream_get_stats:
+ * @stream       : CHD stream.
+ * @stats        : filled with the counters since the stream was opened.
+ **/
+void chdstream_get_stats(chdstream_t *stream, chdstream_stats_t *stats);
+
 ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes);
 
 int chdstream_getc(chdstream_t *stream);
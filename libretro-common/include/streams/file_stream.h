@@ -343,6 +343,19 @@ int filestream_error(RFILE *stream);
  */
 int filestream_flush(RFILE *stream);
 
+/**
+ * Flushes pending writes and, where the platform allows it,
+ * waits until the file's contents are on the disk.
+ * Files opened through a VFS interface from the frontend
+ * are only flushed.
+ *
+ * @param stream The file to sync.
+ * @return 0 if the sync was successful,
+ * or -1 if there was an error.
+ * @see filestream_flush
+ */
+int filestream_sync(RFILE *stream);
+
 /**
  * Deletes the file at the given path.
  * If the file is open by any process,
@@ -67,8 +67,22 @@ RETRO_BEGIN_DECLS
  * <size of next compressed chunk> : repeated until end of file
  * <next compressed chunk>         :
  * 
+ * Every chunk is an independent zlib stream. When
+ * built with HAVE_THREADS, batches of chunks are
+ * (de)compressed concurrently, one per CPU core,
+ * while still being written/read in file order.
+ * 
  */
 
+/* Compression levels
+ * > Default: zlib level 6, best balance between
+ *   file size and compression speed
+ * > Fast: zlib level 1, for data that is written
+ *   often (e.g. frequent automatic saves);
+ *   files are larger, but decompress just as fast */
+#define RZIP_COMPRESSION_LEVEL_DEFAULT 6
+#define RZIP_COMPRESSION_LEVEL_FAST    1
+
 /* Prevent direct access to rzipstream_t members */
 typedef struct rzipstream rzipstream_t;
 
@@ -176,6 +190,16 @@ int64_t rzipstream_tell(rzipstream_t *stream);
  * compressed content */
 bool rzipstream_is_compressed(rzipstream_t *stream);
 
+/* File Settings */
+
+/* Sets the zlib compression level (1-9) of an RZIP
+ * file open for writing. Takes effect from the next
+ * chunk written; any level produces the same file
+ * format, so files remain readable by every version.
+ * Returns false if stream is not open for writing,
+ * or if level is invalid */
+bool rzipstream_set_compression_level(rzipstream_t *stream, unsigned level);
+
 /* File Close */
 
 /* Closes RZIP file. If file is open for writing,
@@ -29,6 +29,50 @@
 
 #include <queues/fifo_queue.h>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/* Acquire/release accessors for the fifo_spsc_t indices.
+ * Plain volatile accesses plus a compiler barrier are enough
+ * on x86, which never reorders loads with older loads or
+ * stores with older stores. */
+#if defined(__ATOMIC_ACQUIRE)
+#define FIFO_SPSC_LOAD_ACQUIRE(ptr)       __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define FIFO_SPSC_STORE_RELEASE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#elif defined(__GNUC__)
+static INLINE size_t fifo_spsc_load_acquire(volatile size_t *ptr)
+{
+   size_t val = *ptr;
+   __sync_synchronize();
+   return val;
+}
+#define FIFO_SPSC_LOAD_ACQUIRE(ptr)       fifo_spsc_load_acquire(ptr)
+#define FIFO_SPSC_STORE_RELEASE(ptr, val) do { __sync_synchronize(); *(volatile size_t*)(ptr) = (val); } while (0)
+#elif defined(_MSC_VER) && (defined(_M_ARM) || defined(_M_ARM64))
+static INLINE size_t fifo_spsc_load_acquire(volatile size_t *ptr)
+{
+   size_t val = *ptr;
+   __dmb(_ARM_BARRIER_ISH);
+   return val;
+}
+#define FIFO_SPSC_LOAD_ACQUIRE(ptr)       fifo_spsc_load_acquire(ptr)
+#define FIFO_SPSC_STORE_RELEASE(ptr, val) do { __dmb(_ARM_BARRIER_ISH); *(volatile size_t*)(ptr) = (val); } while (0)
+#elif defined(_MSC_VER)
+static INLINE size_t fifo_spsc_load_acquire(volatile size_t *ptr)
+{
+   size_t val = *ptr;
+   _ReadWriteBarrier();
+   return val;
+}
+#define FIFO_SPSC_LOAD_ACQUIRE(ptr)       fifo_spsc_load_acquire(ptr)
+#define FIFO_SPSC_STORE_RELEASE(ptr, val) do { _ReadWriteBarrier(); *(volatile size_t*)(ptr) = (val); } while (0)
+#else
+/* No known barrier, good enough for single-core targets only. */
+#define FIFO_SPSC_LOAD_ACQUIRE(ptr)       (*(volatile size_t*)(ptr))
+#define FIFO_SPSC_STORE_RELEASE(ptr, val) (*(volatile size_t*)(ptr) = (val))
+#endif
+
 static bool fifo_initialize_internal(fifo_buffer_t *buf, size_t size)
 {
    uint8_t *buffer    = (uint8_t*)calloc(1, size + 1);
@@ -122,3 +166,101 @@ void fifo_read(fifo_buffer_t *buffer, void *in_buf, size_t size)
 
    buffer->first = (buffer->first + size) % buffer->size;
 }
+
+fifo_spsc_t *fifo_spsc_new(size_t size)
+{
+   size_t storage     = 1;
+   fifo_spsc_t *buf;
+
+   while (storage < size)
+      storage <<= 1;
+
+   if (!(buf = (fifo_spsc_t*)calloc(1, sizeof(*buf))))
+      return NULL;
+
+   if (!(buf->buffer = (uint8_t*)calloc(1, storage)))
+   {
+      free(buf);
+      return NULL;
+   }
+
+   buf->size          = size;
+   buf->mask          = storage - 1;
+
+   return buf;
+}
+
+void fifo_spsc_free(fifo_spsc_t *buffer)
+{
+   if (!buffer)
+      return;
+
+   free(buffer->buffer);
+   free(buffer);
+}
+
+size_t fifo_spsc_read_avail(fifo_spsc_t *buffer)
+{
+   size_t read_idx  = FIFO_SPSC_LOAD_ACQUIRE(&buffer->read_idx);
+   size_t write_idx = FIFO_SPSC_LOAD_ACQUIRE(&buffer->write_idx);
+   return write_idx - read_idx;
+}
+
+size_t fifo_spsc_write_avail(fifo_spsc_t *buffer)
+{
+   size_t write_idx = FIFO_SPSC_LOAD_ACQUIRE(&buffer->write_idx);
+   size_t read_idx  = FIFO_SPSC_LOAD_ACQUIRE(&buffer->read_idx);
+   return buffer->size - (write_idx - read_idx);
+}
+
+size_t fifo_spsc_write(fifo_spsc_t *buffer, const void *in_buf, size_t size)
+{
+   size_t first_write;
+   /* Only the producer stores write_idx, so a plain load is fine. */
+   size_t write_idx   = buffer->write_idx;
+   size_t read_idx    = FIFO_SPSC_LOAD_ACQUIRE(&buffer->read_idx);
+   size_t avail       = buffer->size - (write_idx - read_idx);
+   size_t pos         = write_idx & buffer->mask;
+
+   if (size > avail)
+      size            = avail;
+
+   first_write        = buffer->mask + 1 - pos;
+   if (first_write > size)
+      first_write     = size;
+
+   memcpy(buffer->buffer + pos, in_buf, first_write);
+   memcpy(buffer->buffer, (const uint8_t*)in_buf + first_write,
+         size - first_write);
+
+   /* Publish the data before the new index. */
+   FIFO_SPSC_STORE_RELEASE(&buffer->write_idx, write_idx + size);
+
+   return size;
+}
+
+size_t fifo_spsc_read(fifo_spsc_t *buffer, void *out_buf, size_t size)
+{
+   size_t first_read;
+   /* Only the consumer stores read_idx, so a plain load is fine. */
+   size_t read_idx    = buffer->read_idx;
+   size_t write_idx   = FIFO_SPSC_LOAD_ACQUIRE(&buffer->write_idx);
+   size_t avail       = write_idx - read_idx;
+   size_t pos         = read_idx & buffer->mask;
+
+   if (size > avail)
+      size            = avail;
+
+   first_read         = buffer->mask + 1 - pos;
+   if (first_read > size)
+      first_read      = size;
+
+   memcpy(out_buf, buffer->buffer + pos, first_read);
+   memcpy((uint8_t*)out_buf + first_read, buffer->buffer,
+         size - first_read);
+
+   /* Hand the space back only after the data was copied out. */
+   FIFO_SPSC_STORE_RELEASE(&buffer->read_idx, read_idx + size);
+
+   return size;
+}
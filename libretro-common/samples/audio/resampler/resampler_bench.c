@@ -0,0 +1,170 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (resampler_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Measures throughput of the sinc and polyphase resamplers for
+ * every quality level, a few common rate pairs and each SIMD
+ * kernel the CPU supports. Output frames/s are reported in
+ * multiples of realtime for the destination rate as well. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include <audio/audio_resampler.h>
+
+#define CHUNK_FRAMES 1024
+
+struct bench_kernel
+{
+   const char *name;
+   resampler_simd_mask_t mask;
+   int supported;
+};
+
+struct bench_driver
+{
+   retro_resampler_t *backend;
+   /* SIMD bits that select a distinct kernel in this driver. */
+   resampler_simd_mask_t kernels;
+};
+
+static double now_sec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+   static const char *quality_names[] = {
+      "dontcare", "lowest", "lower", "normal", "higher", "highest"
+   };
+   static const double rates[][2] = {
+      { 32040.0, 48000.0 },
+      { 44100.0, 48000.0 },
+      { 48000.0, 44100.0 },
+      { 32000.0, 48000.0 },
+   };
+   struct bench_kernel kernels[] = {
+      { "c",       0,                                                     1 },
+      { "sse",     RESAMPLER_SIMD_SSE,                                    0 },
+      { "avx",     RESAMPLER_SIMD_SSE | RESAMPLER_SIMD_AVX,               0 },
+      { "fma3",    RESAMPLER_SIMD_SSE | RESAMPLER_SIMD_AVX
+                   | RESAMPLER_SIMD_FMA3,                                 0 },
+      { "avx512f", RESAMPLER_SIMD_SSE | RESAMPLER_SIMD_AVX
+                   | RESAMPLER_SIMD_FMA3 | RESAMPLER_SIMD_AVX512F,        0 },
+      { "neon",    RESAMPLER_SIMD_NEON,                                   0 },
+   };
+   struct bench_driver drivers[] = {
+      { &sinc_resampler,      ~(resampler_simd_mask_t)0 },
+      { &polyphase_resampler, RESAMPLER_SIMD_SSE | RESAMPLER_SIMD_NEON },
+   };
+   float *in, *out;
+   unsigned d, i, k, q, r;
+   double seconds = argc > 1 ? atof(argv[1]) : 0.5;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+   __builtin_cpu_init();
+   kernels[1].supported = __builtin_cpu_supports("sse");
+   kernels[2].supported = __builtin_cpu_supports("avx");
+   kernels[3].supported = __builtin_cpu_supports("fma");
+   kernels[4].supported = __builtin_cpu_supports("avx512f");
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+   kernels[5].supported = 1;
+#endif
+
+   in  = (float*)malloc(CHUNK_FRAMES * 2 * sizeof(float));
+   out = (float*)malloc(CHUNK_FRAMES * 2 * 4 * sizeof(float));
+
+   /* Two detuned sines, so that the filter does real work. */
+   for (i = 0; i < CHUNK_FRAMES; i++)
+   {
+      in[2 * i + 0] = 0.5f * sinf(i * 0.031f);
+      in[2 * i + 1] = 0.5f * sinf(i * 0.047f);
+   }
+
+   printf("%-10s %-8s %-8s %-14s %14s %10s\n",
+         "driver", "quality", "kernel", "ratio", "frames/s", "realtime");
+
+   for (q = RESAMPLER_QUALITY_LOWEST; q <= RESAMPLER_QUALITY_HIGHEST; q++)
+   {
+      for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+      {
+         double ratio = rates[r][1] / rates[r][0];
+
+         for (d = 0; d < sizeof(drivers) / sizeof(drivers[0]); d++)
+         {
+         retro_resampler_t *backend = drivers[d].backend;
+
+         for (k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+         {
+            char ratio_str[32];
+            void *re;
+            double start, elapsed;
+            size_t produced = 0;
+            struct resampler_data data;
+
+            if (!kernels[k].supported)
+               continue;
+            /* Skip masks that would only pick an already measured kernel. */
+            if (kernels[k].mask & ~drivers[d].kernels)
+               continue;
+
+            if (!(re = backend->init(NULL, ratio,
+                        (enum resampler_quality)q, kernels[k].mask)))
+               continue;
+
+            start = now_sec();
+            do
+            {
+               for (i = 0; i < 16; i++)
+               {
+                  data.data_in       = in;
+                  data.data_out      = out;
+                  data.input_frames  = CHUNK_FRAMES;
+                  data.output_frames = 0;
+                  data.ratio         = ratio;
+                  backend->process(re, &data);
+                  produced          += data.output_frames;
+               }
+               elapsed = now_sec() - start;
+            } while (elapsed < seconds);
+
+            snprintf(ratio_str, sizeof(ratio_str), "%.0f->%.0f",
+                  rates[r][0], rates[r][1]);
+            printf("%-10s %-8s %-8s %-14s %14.0f %9.1fx\n",
+                  backend->ident, quality_names[q], kernels[k].name, ratio_str,
+                  produced / elapsed, produced / elapsed / rates[r][1]);
+
+            backend->free(re);
+         }
+         }
+      }
+   }
+
+   free(in);
+   free(out);
+   return 0;
+}
@@ -0,0 +1,205 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (fifo_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Pushes a byte stream from one thread to another, once through
+ * a fifo_buffer_t guarded by a lock and once through a fifo_spsc_t,
+ * using the same producer/consumer pattern as the threaded audio
+ * drivers: the producer blocks while the queue is full and the
+ * consumer drains it in fixed periods. Every byte is checked. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <queues/fifo_queue.h>
+#include <rthreads/rthreads.h>
+
+#define QUEUE_SIZE   (16 * 1024)
+#define WRITE_CHUNK  4096
+#define READ_PERIOD  1024
+
+struct bench_state
+{
+   fifo_buffer_t *locked;
+   fifo_spsc_t *spsc;
+   slock_t *fifo_lock;
+   slock_t *cond_lock;
+   scond_t *cond;
+   size_t total;
+   size_t errors;
+};
+
+static double now_sec(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_wake(struct bench_state *st)
+{
+   slock_lock(st->cond_lock);
+   scond_signal(st->cond);
+   slock_unlock(st->cond_lock);
+}
+
+static size_t bench_read(struct bench_state *st, uint8_t *buf)
+{
+   size_t got;
+
+   if (st->spsc)
+      got = fifo_spsc_read(st->spsc, buf, READ_PERIOD);
+   else
+   {
+      size_t avail;
+      slock_lock(st->fifo_lock);
+      avail = FIFO_READ_AVAIL(st->locked);
+      got   = avail < READ_PERIOD ? avail : READ_PERIOD;
+      fifo_read(st->locked, buf, got);
+      slock_unlock(st->fifo_lock);
+   }
+
+   if (got)
+      bench_wake(st);
+   return got;
+}
+
+static size_t bench_write(struct bench_state *st,
+      const uint8_t *buf, size_t size)
+{
+   size_t put;
+
+   if (st->spsc)
+      return fifo_spsc_write(st->spsc, buf, size);
+
+   slock_lock(st->fifo_lock);
+   put = FIFO_WRITE_AVAIL(st->locked);
+   if (put > size)
+      put = size;
+   fifo_write(st->locked, buf, put);
+   slock_unlock(st->fifo_lock);
+   return put;
+}
+
+static size_t bench_write_avail(struct bench_state *st)
+{
+   size_t avail;
+
+   if (st->spsc)
+      return fifo_spsc_write_avail(st->spsc);
+
+   slock_lock(st->fifo_lock);
+   avail = FIFO_WRITE_AVAIL(st->locked);
+   slock_unlock(st->fifo_lock);
+   return avail;
+}
+
+static void consumer_thread(void *data)
+{
+   struct bench_state *st = (struct bench_state*)data;
+   uint8_t buf[READ_PERIOD];
+   size_t received        = 0;
+
+   while (received < st->total)
+   {
+      size_t i;
+      size_t got = bench_read(st, buf);
+
+      for (i = 0; i < got; i++)
+         if (buf[i] != (uint8_t)((received + i) * 7))
+            st->errors++;
+      received  += got;
+   }
+
+}
+
+static double run(struct bench_state *st)
+{
+   uint8_t chunk[WRITE_CHUNK];
+   size_t sent = 0;
+   double start;
+   sthread_t *thread;
+
+   st->errors = 0;
+   start      = now_sec();
+   thread     = sthread_create(consumer_thread, st);
+
+   while (sent < st->total)
+   {
+      size_t i, put;
+      size_t len = st->total - sent;
+      if (len > WRITE_CHUNK)
+         len = WRITE_CHUNK;
+
+      for (i = 0; i < len; i++)
+         chunk[i] = (uint8_t)((sent + i) * 7);
+
+      for (i = 0; i < len; i += put)
+      {
+         put = bench_write(st, chunk + i, len - i);
+         if (!put)
+         {
+            slock_lock(st->cond_lock);
+            if (!bench_write_avail(st))
+               scond_wait(st->cond, st->cond_lock);
+            slock_unlock(st->cond_lock);
+         }
+      }
+
+      sent += len;
+   }
+
+   sthread_join(thread);
+   return now_sec() - start;
+}
+
+int main(int argc, char *argv[])
+{
+   struct bench_state st;
+   double elapsed;
+   size_t mb = argc > 1 ? (size_t)atoi(argv[1]) : 256;
+
+   memset(&st, 0, sizeof(st));
+   st.total     = mb << 20;
+   st.fifo_lock = slock_new();
+   st.cond_lock = slock_new();
+   st.cond      = scond_new();
+
+   st.locked    = fifo_new(QUEUE_SIZE);
+   elapsed      = run(&st);
+   printf("%-8s %8.1f MB/s %s\n", "locked",
+         mb / elapsed, st.errors ? "CORRUPT" : "ok");
+   fifo_free(st.locked);
+   st.locked    = NULL;
+
+   st.spsc      = fifo_spsc_new(QUEUE_SIZE);
+   elapsed      = run(&st);
+   printf("%-8s %8.1f MB/s %s\n", "spsc",
+         mb / elapsed, st.errors ? "CORRUPT" : "ok");
+   fifo_spsc_free(st.spsc);
+
+   slock_free(st.fifo_lock);
+   slock_free(st.cond_lock);
+   scond_free(st.cond);
+   return 0;
+}
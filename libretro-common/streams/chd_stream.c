@@ -30,24 +30,87 @@
 #include <retro_endianness.h>
 #include <libchdr/chd.h>
 #include <string/stdstring.h>
+#include <features/features_cpu.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #define SECTOR_SIZE 2352
 #define SUBCODE_SIZE 96
 #define TRACK_PAD 4
 
+/* Sequential readers followed at once by the prefetcher,
+ * such as a core streaming audio while it loads data */
+#define PREFETCH_RANGES 4
+
+enum chdstream_hunk_state
+{
+   CHDSTREAM_HUNK_EMPTY = 0,
+   CHDSTREAM_HUNK_LOADING,
+   CHDSTREAM_HUNK_READY
+};
+
+typedef struct chdstream_hunk
+{
+   /* Decompressed hunk, allocated on first use */
+   uint8_t *data;
+   /* Value of the LRU clock when last used */
+   uint32_t last_use;
+   /* Hunk number, -1 if empty */
+   int32_t hunknum;
+   enum chdstream_hunk_state state;
+   /* Loaded ahead and not read yet */
+   bool prefetched;
+} chdstream_hunk_t;
+
 struct chdstream
 {
    chd_file *chd;
-   /* Loaded hunk */
-   uint8_t *hunkmem;
+   /* Cached hunks, least recently used are replaced first */
+   chdstream_hunk_t *hunks;
+   /* Hunk the read cursor is in, never replaced by prefetching */
+   chdstream_hunk_t *cur;
+#ifdef HAVE_THREADS
+   /* Protects hunks, stats and the prefetch request */
+   slock_t *lock;
+   /* Serialises chd_read(), which is not reentrant */
+   slock_t *chd_lock;
+   /* Signals a prefetch request */
+   scond_t *cond;
+   /* Signals a hunk leaving the loading state */
+   scond_t *done_cond;
+   sthread_t *thread;
+   struct
+   {
+      /* Hunk whose read asked for the range */
+      uint32_t base;
+      /* Next hunk to prefetch */
+      uint32_t next;
+      /* Hunks left to prefetch from next */
+      unsigned left;
+   } ranges[PREFETCH_RANGES];
+   /* Range to serve, or replace, next */
+   unsigned range_turn;
+   bool quit;
+#endif
+   chdstream_stats_t stats;
    /* Byte offset where track data starts (after pregap) */
    size_t track_start;
    /* Byte offset where track data ends */
    size_t track_end;
    /* Byte offset of read cursor */
    size_t offset;
-   /* Loaded hunk number */
-   int32_t hunknum;
+   /* LRU clock */
+   uint32_t clock;
+   /* Number of cached hunks */
+   unsigned num_hunks;
+   /* Number of hunks to decompress ahead of sequential reads */
+   unsigned prefetch;
+   /* Bytes per hunk */
+   uint32_t hunkbytes;
+   /* Hunks in the chd */
+   uint32_t totalhunks;
    /* Size of frame taken from each hunk */
    uint32_t frame_size;
    /* Offset of data within frame */
@@ -207,7 +270,6 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
 {
    metadata_t meta;
    uint32_t pregap         = 0;
-   uint8_t *hunkmem        = NULL;
    const chd_header *hd    = NULL;
    chdstream_t *stream     = NULL;
    chd_file *chd           = NULL;
@@ -219,28 +281,26 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    if (!chdstream_find_track(chd, track, &meta))
       goto error;
 
-   stream                  = (chdstream_t*)malloc(sizeof(*stream));
+   stream                  = (chdstream_t*)calloc(1, sizeof(*stream));
    if (!stream)
       goto error;
 
-   stream->chd             = NULL;
-   stream->swab            = false;
-   stream->frame_size      = 0;
-   stream->frame_offset    = 0;
-   stream->frames_per_hunk = 0;
-   stream->track_frame     = 0;
-   stream->track_start     = 0;
-   stream->track_end       = 0;
-   stream->offset          = 0;
-   stream->hunkmem         = NULL;
-   stream->hunknum         = -1;
 
    hd                      = chd_get_header(chd);
-   hunkmem                 = (uint8_t*)malloc(hd->hunkbytes);
-   if (!hunkmem)
+   stream->hunkbytes       = hd->hunkbytes;
+   stream->totalhunks      = hd->totalhunks;
+
+#ifdef HAVE_THREADS
+   if (   !(stream->lock      = slock_new())
+       || !(stream->chd_lock  = slock_new())
+       || !(stream->cond      = scond_new())
+       || !(stream->done_cond = scond_new()))
       goto error;
+#endif
 
-   stream->hunkmem         = hunkmem;
+   if (!chdstream_set_cache(stream, CHDSTREAM_CACHE_HUNKS,
+            CHDSTREAM_PREFETCH_HUNKS))
+      goto error;
 
    if (string_is_equal(meta.type, "MODE1_RAW"))
       stream->frame_size   = SECTOR_SIZE;
@@ -277,48 +337,406 @@ error:
    return NULL;
 }
 
+static void chdstream_free_hunks(chdstream_t *stream)
+{
+   unsigned i;
+
+   if (!stream->hunks)
+      return;
+
+   for (i = 0; i < stream->num_hunks; i++)
+      free(stream->hunks[i].data);
+   free(stream->hunks);
+
+   stream->hunks     = NULL;
+   stream->cur       = NULL;
+   stream->num_hunks = 0;
+}
+
+#ifdef HAVE_THREADS
+static void chdstream_stop_prefetch(chdstream_t *stream)
+{
+   if (!stream->thread)
+      return;
+
+   slock_lock(stream->lock);
+   stream->quit = true;
+   scond_signal(stream->cond);
+   slock_unlock(stream->lock);
+
+   sthread_join(stream->thread);
+
+   stream->thread        = NULL;
+   stream->quit          = false;
+   memset(stream->ranges, 0, sizeof(stream->ranges));
+}
+#endif
+
 void chdstream_close(chdstream_t *stream)
 {
    if (!stream)
       return;
 
-   if (stream->hunkmem)
-      free(stream->hunkmem);
+#ifdef HAVE_THREADS
+   chdstream_stop_prefetch(stream);
+   if (stream->lock)
+      slock_free(stream->lock);
+   if (stream->chd_lock)
+      slock_free(stream->chd_lock);
+   if (stream->cond)
+      scond_free(stream->cond);
+   if (stream->done_cond)
+      scond_free(stream->done_cond);
+#endif
+   chdstream_free_hunks(stream);
    if (stream->chd)
       chd_close(stream->chd);
    free(stream);
 }
 
-static bool
-chdstream_load_hunk(chdstream_t *stream, uint32_t hunknum)
+bool chdstream_set_cache(chdstream_t *stream,
+      unsigned hunks, unsigned prefetch)
+{
+   unsigned i;
+
+   if (hunks < 1)
+      hunks = 1;
+#ifdef HAVE_THREADS
+   /* Leave the reader a hunk to decompress misses into */
+   if (prefetch > hunks - 1)
+      prefetch = hunks - 1;
+   chdstream_stop_prefetch(stream);
+#else
+   prefetch = 0;
+#endif
+
+   chdstream_free_hunks(stream);
+
+   if (!(stream->hunks = (chdstream_hunk_t*)
+            calloc(hunks, sizeof(*stream->hunks))))
+      return false;
+
+   for (i = 0; i < hunks; i++)
+      stream->hunks[i].hunknum = -1;
+
+   stream->num_hunks    = hunks;
+   stream->prefetch     = prefetch;
+   return true;
+}
+
+void chdstream_get_stats(chdstream_t *stream, chdstream_stats_t *stats)
 {
-   uint16_t *array;
+#ifdef HAVE_THREADS
+   slock_lock(stream->lock);
+#endif
+   *stats = stream->stats;
+#ifdef HAVE_THREADS
+   slock_unlock(stream->lock);
+#endif
+}
 
-   if ((int)hunknum == stream->hunknum)
-      return true;
+static chdstream_hunk_t *chdstream_find_hunk(chdstream_t *stream,
+      uint32_t hunknum)
+{
+   unsigned i;
 
-   if (chd_read(stream->chd, hunknum, stream->hunkmem) != CHDERR_NONE)
+   for (i = 0; i < stream->num_hunks; i++)
+      if (   stream->hunks[i].hunknum == (int32_t)hunknum
+          && stream->hunks[i].state   != CHDSTREAM_HUNK_EMPTY)
+         return &stream->hunks[i];
+
+   return NULL;
+}
+
+/* Picks the hunk to replace and marks it as loading @hunknum.
+ * Hunks being loaded and the one being read are kept. */
+static chdstream_hunk_t *chdstream_claim_hunk(chdstream_t *stream,
+      uint32_t hunknum)
+{
+   unsigned i;
+   chdstream_hunk_t *victim = NULL;
+
+   for (i = 0; i < stream->num_hunks; i++)
+   {
+      chdstream_hunk_t *hunk = &stream->hunks[i];
+
+      if (hunk == stream->cur || hunk->state == CHDSTREAM_HUNK_LOADING)
+         continue;
+
+      if (hunk->state == CHDSTREAM_HUNK_EMPTY)
+      {
+         victim = hunk;
+         break;
+      }
+
+      if (!victim || (int32_t)(hunk->last_use - victim->last_use) < 0)
+         victim = hunk;
+   }
+
+   if (!victim)
+      return NULL;
+
+   if (!victim->data && !(victim->data =
+            (uint8_t*)malloc(stream->hunkbytes)))
+      return NULL;
+
+   victim->hunknum    = hunknum;
+   victim->state      = CHDSTREAM_HUNK_LOADING;
+   victim->prefetched = false;
+   return victim;
+}
+
+/* Called without the lock held */
+static bool chdstream_decompress_hunk(chdstream_t *stream,
+      chdstream_hunk_t *hunk, retro_time_t *usec)
+{
+   chd_error err;
+   retro_time_t start = cpu_features_get_time_usec();
+
+#ifdef HAVE_THREADS
+   slock_lock(stream->chd_lock);
+#endif
+   err = chd_read(stream->chd, hunk->hunknum, hunk->data);
+#ifdef HAVE_THREADS
+   slock_unlock(stream->chd_lock);
+#endif
+
+   if (err != CHDERR_NONE)
       return false;
 
    if (stream->swab)
    {
       uint32_t i;
-      uint32_t count = chd_get_header(stream->chd)->hunkbytes / 2;
-      array          = (uint16_t*)stream->hunkmem;
+      uint32_t count  = stream->hunkbytes / 2;
+      uint16_t *array = (uint16_t*)hunk->data;
       for (i = 0; i < count; ++i)
          array[i] = SWAP16(array[i]);
    }
 
-   stream->hunknum = hunknum;
+   *usec = cpu_features_get_time_usec() - start;
    return true;
 }
 
+static void chdstream_finish_hunk(chdstream_t *stream,
+      chdstream_hunk_t *hunk, bool ok, retro_time_t usec)
+{
+   if (ok)
+   {
+      hunk->state     = CHDSTREAM_HUNK_READY;
+      hunk->last_use  = ++stream->clock;
+      stream->stats.decompressed++;
+      stream->stats.decompress_usec += usec;
+   }
+   else
+   {
+      hunk->state     = CHDSTREAM_HUNK_EMPTY;
+      hunk->hunknum   = -1;
+   }
+
+#ifdef HAVE_THREADS
+   scond_broadcast(stream->done_cond);
+#endif
+}
+
+#ifdef HAVE_THREADS
+/* Takes the next hunk to prefetch, serving the ranges in turn.
+ * Returns false if there is none. */
+static bool chdstream_next_prefetch(chdstream_t *stream,
+      uint32_t *hunknum)
+{
+   unsigned i;
+
+   for (i = 0; i < PREFETCH_RANGES; i++)
+   {
+      unsigned r = (stream->range_turn + i) % PREFETCH_RANGES;
+
+      if (!stream->ranges[r].left)
+         continue;
+
+      *hunknum = stream->ranges[r].next++;
+      stream->ranges[r].left--;
+      if (*hunknum >= stream->totalhunks)
+      {
+         stream->ranges[r].left = 0;
+         continue;
+      }
+
+      stream->range_turn = (r + 1) % PREFETCH_RANGES;
+      return true;
+   }
+
+   return false;
+}
+
+static void chdstream_prefetch_thread(void *data)
+{
+   chdstream_t *stream = (chdstream_t*)data;
+
+   slock_lock(stream->lock);
+
+   for (;;)
+   {
+      bool ok;
+      chdstream_hunk_t *hunk;
+      uint32_t hunknum  = 0;
+      retro_time_t usec = 0;
+
+      while (!stream->quit && !chdstream_next_prefetch(stream, &hunknum))
+         scond_wait(stream->cond, stream->lock);
+
+      if (stream->quit)
+         break;
+
+      if (   chdstream_find_hunk(stream, hunknum)
+          || !(hunk = chdstream_claim_hunk(stream, hunknum)))
+         continue;
+
+      hunk->prefetched = true;
+
+      slock_unlock(stream->lock);
+      ok = chdstream_decompress_hunk(stream, hunk, &usec);
+      slock_lock(stream->lock);
+
+      chdstream_finish_hunk(stream, hunk, ok, usec);
+   }
+
+   slock_unlock(stream->lock);
+}
+
+/* Called with the lock held */
+static void chdstream_request_prefetch(chdstream_t *stream,
+      uint32_t hunknum)
+{
+   unsigned i;
+
+   if (!stream->thread && !(stream->thread =
+            sthread_create(chdstream_prefetch_thread, stream)))
+   {
+      /* Keep reading without */
+      stream->prefetch = 0;
+      return;
+   }
+
+   /* Moves the range of the reader that got here, or replaces
+    * an idle one, or else the one that would be served next */
+   for (i = 0; i < PREFETCH_RANGES; i++)
+      if (stream->ranges[i].left && stream->ranges[i].base == hunknum - 1)
+         break;
+   if (i == PREFETCH_RANGES)
+      for (i = 0; i < PREFETCH_RANGES; i++)
+         if (!stream->ranges[i].left)
+            break;
+   if (i == PREFETCH_RANGES)
+      i = stream->range_turn;
+
+   stream->ranges[i].base = hunknum;
+   stream->ranges[i].next = hunknum + 1;
+   stream->ranges[i].left = stream->prefetch;
+
+   /* Hunks already loaded ahead are about to be read; keep
+    * them over the ones the readers have left behind */
+   for (i = 1; i <= stream->prefetch; i++)
+   {
+      chdstream_hunk_t *hunk = chdstream_find_hunk(stream, hunknum + i);
+      if (hunk)
+         hunk->last_use = stream->clock;
+   }
+
+   scond_signal(stream->cond);
+}
+#endif
+
+static chdstream_hunk_t *chdstream_load_hunk(chdstream_t *stream,
+      uint32_t hunknum)
+{
+   chdstream_hunk_t *hunk;
+
+   /* Still reading the same hunk */
+   if (stream->cur && stream->cur->hunknum == (int32_t)hunknum)
+      return stream->cur;
+
+#ifdef HAVE_THREADS
+   slock_lock(stream->lock);
+#endif
+
+   /* Wait for the hunk if it is being prefetched */
+   while (   (hunk = chdstream_find_hunk(stream, hunknum))
+          && hunk->state == CHDSTREAM_HUNK_LOADING)
+   {
+#ifdef HAVE_THREADS
+      scond_wait(stream->done_cond, stream->lock);
+#endif
+   }
+
+   if (hunk)
+   {
+      stream->stats.hits++;
+      if (hunk->prefetched)
+         stream->stats.prefetch_hits++;
+   }
+   else
+   {
+      bool ok;
+      retro_time_t usec = 0;
+
+      stream->stats.misses++;
+
+      /* The hunk being left may be replaced */
+      stream->cur = NULL;
+
+      if (!(hunk = chdstream_claim_hunk(stream, hunknum)))
+         goto error;
+
+#ifdef HAVE_THREADS
+      slock_unlock(stream->lock);
+#endif
+      ok = chdstream_decompress_hunk(stream, hunk, &usec);
+#ifdef HAVE_THREADS
+      slock_lock(stream->lock);
+#endif
+
+      chdstream_finish_hunk(stream, hunk, ok, usec);
+      if (!ok)
+         goto error;
+   }
+
+   hunk->prefetched = false;
+   hunk->last_use   = ++stream->clock;
+   stream->cur      = hunk;
+
+#ifdef HAVE_THREADS
+   /* Decompress ahead of sequential reads, recognised by
+    * the previous hunk having been read. This follows each
+    * of several readers taking turns. */
+   if (stream->prefetch && hunknum > 0)
+   {
+      chdstream_hunk_t *prev = chdstream_find_hunk(stream, hunknum - 1);
+      if (   prev
+          && prev->state == CHDSTREAM_HUNK_READY
+          && !prev->prefetched)
+         chdstream_request_prefetch(stream, hunknum);
+   }
+#endif
+
+#ifdef HAVE_THREADS
+   slock_unlock(stream->lock);
+#endif
+   return hunk;
+
+error:
+#ifdef HAVE_THREADS
+   slock_unlock(stream->lock);
+#endif
+   return NULL;
+}
+
 ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
 {
    size_t end;
    size_t data_offset   = 0;
    const chd_header *hd = chd_get_header(stream->chd);
    uint8_t         *out = (uint8_t*)data;
+   chdstream_hunk_t *cur;
 
    if (stream->track_end - stream->offset < bytes)
       bytes             = stream->track_end - stream->offset;
@@ -344,11 +762,11 @@ ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
          uint32_t hunk_offset = (chd_frame % stream->frames_per_hunk) 
             * hd->unitbytes;
 
-         if (!chdstream_load_hunk(stream, hunk))
+         if (!(cur = chdstream_load_hunk(stream, hunk)))
             return -1;
 
          memcpy(out + data_offset,
-                stream->hunkmem + frame_offset
+                cur->data + frame_offset
                 + hunk_offset + stream->frame_offset, amount);
       }
 
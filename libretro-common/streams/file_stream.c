@@ -420,6 +420,23 @@ int filestream_flush(RFILE *stream)
    return output;
 }
 
+int filestream_sync(RFILE *stream)
+{
+   int output;
+
+   /* A VFS interface from the frontend can only flush */
+   if (filestream_flush_cb)
+      output = filestream_flush_cb(stream->hfile);
+   else
+      output = retro_vfs_file_sync_impl(
+            (libretro_vfs_implementation_file*)stream->hfile);
+
+   if (output == VFS_ERROR_RETURN_VALUE)
+      stream->error_flag = true;
+
+   return output;
+}
+
 int filestream_delete(const char *path)
 {
    if (filestream_remove_cb)
@@ -22,21 +22,21 @@
 
 #include <string/stdstring.h>
 #include <file/file_path.h>
+#include <retro_miscellaneous.h>
 
 #include <streams/file_stream.h>
 #include <streams/trans_stream.h>
 
 #include <streams/rzip_stream.h>
 
+#if defined(HAVE_THREADS)
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#endif
+
 /* Current RZIP file format version */
 #define RZIP_VERSION 1
 
-/* Compression level
- * > zlib default of 6 provides the best
- *   balance between file size and
- *   compression speed */
-#define RZIP_COMPRESSION_LEVEL 6
-
 /* Default chunk size: 128kb */
 #define RZIP_DEFAULT_CHUNK_SIZE 131072
 
@@ -44,6 +44,49 @@
 #define RZIP_HEADER_SIZE 20
 #define RZIP_CHUNK_HEADER_SIZE 4
 
+/* Maximum number of chunks handled per batch
+ * > Every chunk is a self-contained zlib stream,
+ *   so the chunks of a batch are (de)compressed
+ *   concurrently, one per CPU core */
+#define RZIP_MAX_JOBS 8
+
+/* Holds everything required to (de)compress
+ * a single chunk */
+typedef struct rzip_job
+{
+   void *trans_stream;
+   /* buf: compressed chunk data */
+   uint8_t *buf;
+   /* data: uncompressed chunk data
+    * > Points into the input buffer of the
+    *   stream when writing, and into its output
+    *   buffer when reading */
+   uint8_t *data;
+   uint32_t buf_size;
+   uint32_t buf_len;
+   uint32_t data_size;
+   uint32_t data_len;
+   bool ok;
+} rzip_job_t;
+
+#if defined(HAVE_THREADS)
+/* Worker threads sharing the jobs of a batch
+ * with the thread that owns the stream */
+typedef struct rzip_pool
+{
+   sthread_t *threads[RZIP_MAX_JOBS];
+   slock_t *lock;
+   scond_t *cond;
+   scond_t *done_cond;
+   rzipstream_t *stream;
+   unsigned num_threads;
+   unsigned next;
+   unsigned count;
+   unsigned done;
+   bool quit;
+} rzip_pool_t;
+#endif
+
 /* Holds all metadata for an RZIP file stream */
 struct rzipstream
 {
@@ -53,9 +96,11 @@ struct rzipstream
    uint64_t virtual_ptr;
    RFILE* file;
    const struct trans_stream_backend *deflate_backend;
-   void *deflate_stream;
    const struct trans_stream_backend *inflate_backend;
-   void *inflate_stream;
+#if defined(HAVE_THREADS)
+   rzip_pool_t *pool;
+#endif
+   rzip_job_t jobs[RZIP_MAX_JOBS];
    uint8_t *in_buf;
    uint8_t *out_buf;
    uint32_t in_buf_size;
@@ -64,6 +109,8 @@ struct rzipstream
    uint32_t out_buf_ptr;
    uint32_t out_buf_occupancy;
    uint32_t chunk_size;
+   unsigned num_jobs;
+   unsigned level;
    bool is_compressed;
    bool is_writing;
 };
@@ -186,6 +233,311 @@ static bool rzipstream_write_file_header(rzipstream_t *stream)
          header_bytes, sizeof(header_bytes)) == RZIP_HEADER_SIZE);
 }
 
+/* Chunk Jobs */
+
+/* Returns the size of the space reserved for
+ * each uncompressed chunk in the output buffer
+ * of a read stream
+ * > If file header is valid, chunks have a size
+ *   of at most stream->chunk_size. Allocate some
+ *   additional space, just for redundant safety... */
+static uint64_t rzipstream_get_chunk_stride(rzipstream_t *stream)
+{
+   return (uint64_t)stream->chunk_size + (stream->chunk_size >> 2);
+}
+
+/* Returns the number of chunks to process per batch
+ * > One per CPU core, but no more than the file
+ *   holds when its size is known */
+static unsigned rzipstream_get_num_jobs(rzipstream_t *stream)
+{
+   unsigned num_jobs = 1;
+#if defined(HAVE_THREADS)
+   uint64_t num_chunks;
+
+   num_jobs = cpu_features_get_core_amount();
+   if (num_jobs > RZIP_MAX_JOBS)
+      num_jobs = RZIP_MAX_JOBS;
+
+   if (!stream->is_writing)
+   {
+      num_chunks = (stream->size + stream->chunk_size - 1) /
+            stream->chunk_size;
+      if (num_chunks < num_jobs)
+         num_jobs = (unsigned)num_chunks;
+
+      /* Batch buffer must remain addressable with
+       * 32 bit offsets */
+      while ((num_jobs > 1) &&
+            (rzipstream_get_chunk_stride(stream) * num_jobs > 0x7FFFFFFF))
+         num_jobs--;
+   }
+   else if ((uint64_t)stream->chunk_size * num_jobs > 0x7FFFFFFF)
+      num_jobs = 1;
+
+   if (num_jobs < 1)
+      num_jobs = 1;
+#endif
+   return num_jobs;
+}
+
+/* Allocates the transform stream of a job and,
+ * when writing, its compressed data buffer */
+static bool rzipstream_init_job(rzipstream_t *stream, rzip_job_t *job)
+{
+   if (stream->is_writing)
+   {
+      if (!job->trans_stream)
+      {
+         if (!(job->trans_stream = stream->deflate_backend->stream_new()))
+            return false;
+
+         /* Set compression level */
+         if (!stream->deflate_backend->define(
+               job->trans_stream, "level", stream->level))
+            return false;
+      }
+
+      if (!job->buf)
+      {
+         /* Compressed output of a chunk
+          * > Account for minimum zlib overhead
+          *   of 11 bytes... */
+         job->buf_size = stream->chunk_size * 2;
+         job->buf_size =
+               (job->buf_size < (stream->chunk_size + 11)) ?
+                     job->buf_size + 11 :
+                     job->buf_size;
+
+         if (!(job->buf = (uint8_t *)malloc(job->buf_size)))
+            return false;
+      }
+   }
+   else if (!job->trans_stream)
+   {
+      if (!(job->trans_stream = stream->inflate_backend->stream_new()))
+         return false;
+   }
+
+   return true;
+}
+
+/* Compresses or decompresses a single chunk
+ * > May be called from a worker thread, so must
+ *   only touch the job itself */
+static void rzipstream_run_job(rzipstream_t *stream, rzip_job_t *job)
+{
+   uint32_t trans_read    = 0;
+   uint32_t trans_written = 0;
+
+   job->ok = false;
+
+   /* Note: We have to set 'flush == true' here, otherwise we
+    * can't guarantee that the entire chunk will be written
+    * to the output buffer - this is inefficient, but not
+    * much we can do... */
+   if (stream->is_writing)
+   {
+      stream->deflate_backend->set_in(
+            job->trans_stream, job->data, job->data_size);
+      stream->deflate_backend->set_out(
+            job->trans_stream, job->buf, job->buf_size);
+
+      if (!stream->deflate_backend->trans(
+            job->trans_stream, true,
+            &trans_read, &trans_written, NULL))
+         return;
+
+      /* Error checking */
+      if (trans_read != job->data_size)
+         return;
+
+      if ((trans_written == 0) ||
+          (trans_written > job->buf_size))
+         return;
+
+      job->buf_len = trans_written;
+   }
+   else
+   {
+      stream->inflate_backend->set_in(
+            job->trans_stream, job->buf, job->buf_len);
+      stream->inflate_backend->set_out(
+            job->trans_stream, job->data, job->data_size);
+
+      if (!stream->inflate_backend->trans(
+            job->trans_stream, true,
+            &trans_read, &trans_written, NULL))
+         return;
+
+      /* Error checking */
+      if (trans_read != job->buf_len)
+         return;
+
+      if ((trans_written == 0) ||
+          (trans_written > job->data_size))
+         return;
+
+      job->data_len = trans_written;
+   }
+
+   job->ok = true;
+}
+
+#if defined(HAVE_THREADS)
+static void rzipstream_pool_thread(void *data)
+{
+   rzip_pool_t *pool = (rzip_pool_t*)data;
+
+   slock_lock(pool->lock);
+
+   for (;;)
+   {
+      unsigned i;
+
+      while (!pool->quit && (pool->next >= pool->count))
+         scond_wait(pool->cond, pool->lock);
+
+      if (pool->quit)
+         break;
+
+      i = pool->next++;
+      slock_unlock(pool->lock);
+
+      rzipstream_run_job(pool->stream, &pool->stream->jobs[i]);
+
+      slock_lock(pool->lock);
+      if (++pool->done == pool->count)
+         scond_signal(pool->done_cond);
+   }
+
+   slock_unlock(pool->lock);
+}
+
+static void rzipstream_pool_free(rzip_pool_t *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   if (pool->lock)
+   {
+      slock_lock(pool->lock);
+      pool->quit = true;
+      if (pool->cond)
+         scond_broadcast(pool->cond);
+      slock_unlock(pool->lock);
+   }
+
+   for (i = 0; i < pool->num_threads; i++)
+      sthread_join(pool->threads[i]);
+
+   if (pool->done_cond)
+      scond_free(pool->done_cond);
+   if (pool->cond)
+      scond_free(pool->cond);
+   if (pool->lock)
+      slock_free(pool->lock);
+
+   free(pool);
+}
+
+/* Starts one worker thread per job, minus the
+ * one run by the thread owning the stream
+ * > Returns NULL if no thread could be started,
+ *   in which case jobs are run one by one */
+static rzip_pool_t *rzipstream_pool_new(rzipstream_t *stream)
+{
+   unsigned i;
+   rzip_pool_t *pool = (rzip_pool_t*)calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   pool->stream = stream;
+
+   if (   !(pool->lock      = slock_new())
+       || !(pool->cond      = scond_new())
+       || !(pool->done_cond = scond_new()))
+      goto error;
+
+   for (i = 0; i + 1 < stream->num_jobs; i++)
+   {
+      if (!(pool->threads[i] = sthread_create(
+            rzipstream_pool_thread, pool)))
+         break;
+      pool->num_threads++;
+   }
+
+   if (pool->num_threads == 0)
+      goto error;
+
+   return pool;
+
+error:
+   rzipstream_pool_free(pool);
+   return NULL;
+}
+#endif
+
+/* Runs the first 'count' jobs, concurrently
+ * if possible
+ * Returns false if any of them failed */
+static bool rzipstream_run_jobs(rzipstream_t *stream, unsigned count)
+{
+   unsigned i;
+
+#if defined(HAVE_THREADS)
+   /* Worker threads are only started once a
+    * batch holds more than one chunk, so small
+    * files never pay for them */
+   if ((count > 1) && !stream->pool)
+      stream->pool = rzipstream_pool_new(stream);
+
+   if ((count > 1) && stream->pool)
+   {
+      rzip_pool_t *pool = stream->pool;
+
+      slock_lock(pool->lock);
+
+      pool->next  = 0;
+      pool->done  = 0;
+      pool->count = count;
+      scond_broadcast(pool->cond);
+
+      /* Take a share of the work instead
+       * of just waiting */
+      while (pool->next < pool->count)
+      {
+         i = pool->next++;
+         slock_unlock(pool->lock);
+
+         rzipstream_run_job(stream, &stream->jobs[i]);
+
+         slock_lock(pool->lock);
+         pool->done++;
+      }
+
+      while (pool->done < pool->count)
+         scond_wait(pool->done_cond, pool->lock);
+
+      slock_unlock(pool->lock);
+   }
+   else
+#endif
+   {
+      for (i = 0; i < count; i++)
+         rzipstream_run_job(stream, &stream->jobs[i]);
+   }
+
+   for (i = 0; i < count; i++)
+      if (!stream->jobs[i].ok)
+         return false;
+
+   return true;
+}
+
 /* Stream Initialisation/De-initialisation */
 
 /* Initialises all members of an rzipstream_t struct,
@@ -203,9 +555,7 @@ static bool rzipstream_init_stream(
    stream->chunk_size        = RZIP_DEFAULT_CHUNK_SIZE;
    stream->file              = NULL;
    stream->deflate_backend   = NULL;
-   stream->deflate_stream    = NULL;
    stream->inflate_backend   = NULL;
-   stream->inflate_stream    = NULL;
    stream->in_buf            = NULL;
    stream->in_buf_size       = 0;
    stream->in_buf_ptr        = 0;
@@ -213,6 +563,7 @@ static bool rzipstream_init_stream(
    stream->out_buf_size      = 0;
    stream->out_buf_ptr       = 0;
    stream->out_buf_occupancy = 0;
+   stream->num_jobs          = 1;
 
    /* Check whether this is a read or write stream */
    stream->is_writing = is_writing;
@@ -248,67 +599,50 @@ static bool rzipstream_init_stream(
    else if (!rzipstream_read_file_header(stream))
       return false;
 
-   /* Initialise appropriate transform stream
-    * and determine associated buffer sizes */
+   /* Get appropriate transform backend and
+    * determine associated buffer sizes
+    * > Transform streams and compressed data
+    *   buffers are owned by the chunk jobs, and
+    *   are allocated once needed */
    if (stream->is_writing)
    {
       /* Compression */
       if (!(stream->deflate_backend = trans_stream_get_zlib_deflate_backend()))
          return false;
 
-      if (!(stream->deflate_stream = stream->deflate_backend->stream_new()))
-         return false;
-
-      /* Set compression level */
-      if (!stream->deflate_backend->define(
-            stream->deflate_stream, "level", RZIP_COMPRESSION_LEVEL))
-         return false;
+      stream->num_jobs = rzipstream_get_num_jobs(stream);
 
-      /* Buffers
-       * > Input: uncompressed
-       * > Output: compressed */
-      stream->in_buf_size  = stream->chunk_size;
-      stream->out_buf_size = stream->chunk_size * 2;
-      /* > Account for minimum zlib overhead
-       *   of 11 bytes... */ 
-      stream->out_buf_size =
-            (stream->out_buf_size < (stream->in_buf_size + 11)) ?
-                  stream->out_buf_size + 11 :
-                  stream->out_buf_size;
+      /* Input buffer: uncompressed
+       * > Starts out holding a single chunk, and
+       *   grows to a full batch once more data
+       *   is written */
+      stream->in_buf_size = stream->chunk_size;
 
       /* Redundant safety check */
-      if (   (stream->in_buf_size  == 0)
-          || (stream->out_buf_size == 0))
+      if (stream->in_buf_size == 0)
          return false;
    }
    /* When reading, don't need an inflate transform
     * stream (or buffers) if source file is uncompressed */
    else if (stream->is_compressed)
    {
+      uint64_t out_buf_size;
+
       /* Decompression */
       if (!(stream->inflate_backend = trans_stream_get_zlib_inflate_backend()))
          return false;
 
-      if (!(stream->inflate_stream = stream->inflate_backend->stream_new()))
-         return false;
+      stream->num_jobs = rzipstream_get_num_jobs(stream);
 
-      /* Buffers
-       * > Input: compressed
-       * > Output: uncompressed
-       * Note 1: Actual compressed chunk sizes are read
-       *         from the file - just allocate a sensible
-       *         default to minimise memory reallocations
-       * Note 2: If file header is valid, output buffer
-       *         should have a size of exactly stream->chunk_size.
-       *         Allocate some additional space, just for
-       *         redundant safety... */
-      stream->in_buf_size  = stream->chunk_size * 2;
-      stream->out_buf_size = stream->chunk_size + (stream->chunk_size >> 2);
+      /* Output buffer: uncompressed
+       * > Holds one batch of chunks */
+      out_buf_size = rzipstream_get_chunk_stride(stream) * stream->num_jobs;
 
       /* Redundant safety check */
-      if (   (stream->in_buf_size  == 0)
-          || (stream->out_buf_size == 0))
+      if ((out_buf_size == 0) || (out_buf_size > 0xFFFFFFFF))
          return false;
+
+      stream->out_buf_size = (uint32_t)out_buf_size;
    }
 
    /* Allocate buffers */
@@ -331,22 +665,37 @@ static bool rzipstream_init_stream(
  * > Also closes associated file, if currently open */
 static int rzipstream_free_stream(rzipstream_t *stream)
 {
+   unsigned i;
    int ret = 0;
+   const struct trans_stream_backend *backend = NULL;
 
    if (!stream)
       return -1;
 
-   /* Free transform streams */
-   if (stream->deflate_stream && stream->deflate_backend)
-      stream->deflate_backend->stream_free(stream->deflate_stream);
+#if defined(HAVE_THREADS)
+   /* Stop worker threads */
+   rzipstream_pool_free(stream->pool);
+   stream->pool = NULL;
+#endif
 
-   stream->deflate_stream  = NULL;
-   stream->deflate_backend = NULL;
+   /* Free chunk jobs */
+   backend = stream->is_writing ?
+         stream->deflate_backend : stream->inflate_backend;
+
+   for (i = 0; i < RZIP_MAX_JOBS; i++)
+   {
+      rzip_job_t *job = &stream->jobs[i];
+
+      if (job->trans_stream && backend)
+         backend->stream_free(job->trans_stream);
+      job->trans_stream = NULL;
 
-   if (stream->inflate_stream && stream->inflate_backend)
-      stream->inflate_backend->stream_free(stream->inflate_stream);
+      if (job->buf)
+         free(job->buf);
+      job->buf = NULL;
+   }
 
-   stream->inflate_stream  = NULL;
+   stream->deflate_backend = NULL;
    stream->inflate_backend = NULL;
 
    /* Free buffers */
@@ -406,9 +755,7 @@ rzipstream_t* rzipstream_open(const char *path, unsigned mode)
    stream->virtual_ptr     = 0;
    stream->file            = NULL;
    stream->deflate_backend = NULL;
-   stream->deflate_stream  = NULL;
    stream->inflate_backend = NULL;
-   stream->inflate_stream  = NULL;
    stream->in_buf          = NULL;
    stream->in_buf_size     = 0;
    stream->in_buf_ptr      = 0;
@@ -416,6 +763,12 @@ rzipstream_t* rzipstream_open(const char *path, unsigned mode)
    stream->out_buf_size    = 0;
    stream->out_buf_ptr     = 0;
    stream->out_buf_occupancy = 0;
+   stream->num_jobs        = 1;
+   stream->level           = RZIP_COMPRESSION_LEVEL_DEFAULT;
+#if defined(HAVE_THREADS)
+   stream->pool            = NULL;
+#endif
+   memset(stream->jobs, 0, sizeof(stream->jobs));
 
    /* Initialise stream */
    if (!rzipstream_init_stream(
@@ -431,88 +784,112 @@ rzipstream_t* rzipstream_open(const char *path, unsigned mode)
 
 /* File Read */
 
-/* Reads and decompresses the next chunk of data
+/* Reads and decompresses the next batch of chunks
  * in the RZIP file */
-static bool rzipstream_read_chunk(rzipstream_t *stream)
+static bool rzipstream_read_chunks(rzipstream_t *stream)
 {
    unsigned i;
-   uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
-   uint32_t compressed_chunk_size;
-   uint32_t inflate_read;
-   uint32_t inflate_written;
+   unsigned count     = 0;
+   unsigned max_count = 0;
+   uint32_t stride    = 0;
+   uint32_t offset    = 0;
+   uint64_t remaining = 0;
 
-   if (!stream || !stream->inflate_backend || !stream->inflate_stream)
+   if (!stream || !stream->inflate_backend)
       return false;
 
-   for (i = 0; i < RZIP_CHUNK_HEADER_SIZE; i++)
-      chunk_header_bytes[i] = 0;
+   /* Get number of chunks left in the file,
+    * up to one batch
+    * > Note: this is only an estimate if chunks
+    *   were not written at full size - reading
+    *   stops early at the end of the file */
+   if (stream->virtual_ptr < stream->size)
+      remaining = stream->size - stream->virtual_ptr;
+   max_count = (unsigned)MIN((remaining + stream->chunk_size - 1) /
+         stream->chunk_size, stream->num_jobs);
+   if (max_count < 1)
+      max_count = 1;
+
+   stride = (uint32_t)rzipstream_get_chunk_stride(stream);
+
+   for (count = 0; count < max_count; count++)
+   {
+      uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
+      uint32_t compressed_chunk_size;
+      rzip_job_t *job = &stream->jobs[count];
 
-   /* Attempt to read chunk header bytes */
-   if (filestream_read(
-         stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
-         RZIP_CHUNK_HEADER_SIZE)
-      return false;
+      for (i = 0; i < RZIP_CHUNK_HEADER_SIZE; i++)
+         chunk_header_bytes[i] = 0;
 
-   /* Get size of next compressed chunk */
-   compressed_chunk_size = ((uint32_t)chunk_header_bytes[3] << 24) |
-                           ((uint32_t)chunk_header_bytes[2] << 16) |
-                           ((uint32_t)chunk_header_bytes[1] <<  8) |
-                            (uint32_t)chunk_header_bytes[0];
-   if (compressed_chunk_size == 0)
-      return false;
-
-   /* Resize input buffer, if required */
-   if (compressed_chunk_size > stream->in_buf_size)
-   {
-      free(stream->in_buf);
-      stream->in_buf      = NULL;
+      /* Attempt to read chunk header bytes */
+      if (filestream_read(
+            stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
+            RZIP_CHUNK_HEADER_SIZE)
+      {
+         if (count > 0)
+            break;
+         return false;
+      }
 
-      stream->in_buf_size = compressed_chunk_size;
-      stream->in_buf      = (uint8_t *)calloc(stream->in_buf_size, 1);
-      if (!stream->in_buf)
+      /* Get size of next compressed chunk */
+      compressed_chunk_size = ((uint32_t)chunk_header_bytes[3] << 24) |
+                              ((uint32_t)chunk_header_bytes[2] << 16) |
+                              ((uint32_t)chunk_header_bytes[1] <<  8) |
+                               (uint32_t)chunk_header_bytes[0];
+      if (compressed_chunk_size == 0)
          return false;
 
-      /* Note: Uncompressed data size is fixed, and read
-       * from the file header - we therefore don't attempt
-       * to resize the output buffer (if it's too small, then
-       * that's an error condition) */
-   }
+      if (!rzipstream_init_job(stream, job))
+         return false;
 
-   /* Read compressed chunk from file */
-   if (filestream_read(
-         stream->file, stream->in_buf, compressed_chunk_size) !=
-         compressed_chunk_size)
-      return false;
+      /* Resize compressed data buffer, if required */
+      if (compressed_chunk_size > job->buf_size)
+      {
+         free(job->buf);
+         job->buf      = NULL;
+
+         job->buf_size = compressed_chunk_size;
+         if (!(job->buf = (uint8_t *)malloc(job->buf_size)))
+         {
+            job->buf_size = 0;
+            return false;
+         }
+
+         /* Note: Uncompressed data size is fixed, and read
+          * from the file header - we therefore don't attempt
+          * to resize the output buffer (if it's too small, then
+          * that's an error condition) */
+      }
 
-   /* Decompress chunk data */
-   stream->inflate_backend->set_in(
-         stream->inflate_stream,
-         stream->in_buf, compressed_chunk_size);
+      /* Read compressed chunk from file */
+      if (filestream_read(
+            stream->file, job->buf, compressed_chunk_size) !=
+            compressed_chunk_size)
+         return false;
 
-   stream->inflate_backend->set_out(
-         stream->inflate_stream,
-         stream->out_buf, stream->out_buf_size);
+      job->buf_len   = compressed_chunk_size;
+      job->data      = stream->out_buf + (count * stride);
+      job->data_size = stride;
+   }
 
-   /* Note: We have to set 'flush == true' here, otherwise we
-    * can't guarantee that the entire chunk will be written
-    * to the output buffer - this is inefficient, but not
-    * much we can do... */
-   if (!stream->inflate_backend->trans(
-         stream->inflate_stream, true,
-         &inflate_read, &inflate_written, NULL))
+   /* Decompress chunk data */
+   if (!rzipstream_run_jobs(stream, count))
       return false;
 
-   /* Error checking */
-   if (inflate_read != compressed_chunk_size)
-      return false;
+   /* Chunks were decompressed into fixed slots
+    * > Close the gaps between them */
+   for (i = 0; i < count; i++)
+   {
+      rzip_job_t *job = &stream->jobs[i];
 
-   if ((inflate_written == 0) ||
-       (inflate_written > stream->out_buf_size))
-      return false;
+      if (job->data != stream->out_buf + offset)
+         memmove(stream->out_buf + offset, job->data, job->data_len);
+      offset += job->data_len;
+   }
 
    /* Record current output buffer occupancy
     * and reset pointer */
-   stream->out_buf_occupancy = inflate_written;
+   stream->out_buf_occupancy = offset;
    stream->out_buf_ptr       = 0;
 
    return true;
@@ -549,7 +926,7 @@ int64_t rzipstream_read(rzipstream_t *stream, void *data, int64_t len)
        * been read, grab and extract the next chunk
        * from disk */
       if (stream->out_buf_ptr >= stream->out_buf_occupancy)
-         if (!rzipstream_read_chunk(stream))
+         if (!rzipstream_read_chunks(stream))
             return -1;
 
       /* Get amount of data to 'read out' this loop
@@ -717,61 +1094,56 @@ error:
 /* File Write */
 
 /* Compresses currently cached data and writes it
- * as the next RZIP file chunk */
-static bool rzipstream_write_chunk(rzipstream_t *stream)
+ * as the next RZIP file chunks */
+static bool rzipstream_write_chunks(rzipstream_t *stream)
 {
    unsigned i;
-   uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
-   uint32_t deflate_read;
-   uint32_t deflate_written;
+   unsigned count  = 0;
+   uint32_t offset = 0;
 
-   if (!stream || !stream->deflate_backend || !stream->deflate_stream)
+   if (!stream || !stream->deflate_backend)
       return false;
 
-   for (i = 0; i < RZIP_CHUNK_HEADER_SIZE; i++)
-      chunk_header_bytes[i] = 0;
-
-   /* Compress data currently held in input buffer */
-   stream->deflate_backend->set_in(
-         stream->deflate_stream,
-         stream->in_buf, stream->in_buf_ptr);
-
-   stream->deflate_backend->set_out(
-         stream->deflate_stream,
-         stream->out_buf, stream->out_buf_size);
+   /* Split data currently held in input buffer
+    * into chunks */
+   for (offset = 0; offset < stream->in_buf_ptr;
+         offset += stream->chunk_size)
+   {
+      rzip_job_t *job = &stream->jobs[count++];
 
-   /* Note: We have to set 'flush == true' here, otherwise we
-    * can't guarantee that the entire chunk will be written
-    * to the output buffer - this is inefficient, but not
-    * much we can do... */
-   if (!stream->deflate_backend->trans(
-         stream->deflate_stream, true,
-         &deflate_read, &deflate_written, NULL))
-      return false;
+      if (!rzipstream_init_job(stream, job))
+         return false;
 
-   /* Error checking */
-   if (deflate_read != stream->in_buf_ptr)
-      return false;
+      job->data      = stream->in_buf + offset;
+      job->data_size = MIN(stream->chunk_size, stream->in_buf_ptr - offset);
+   }
 
-   if ((deflate_written == 0) ||
-       (deflate_written > stream->out_buf_size))
+   /* Compress chunk data */
+   if (!rzipstream_run_jobs(stream, count))
       return false;
 
-   /* Write compressed chunk size to file */
-   chunk_header_bytes[3] = (deflate_written >> 24) & 0xFF;
-   chunk_header_bytes[2] = (deflate_written >> 16) & 0xFF;
-   chunk_header_bytes[1] = (deflate_written >>  8) & 0xFF;
-   chunk_header_bytes[0] =  deflate_written        & 0xFF;
-
-   if (filestream_write(
-         stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
-         RZIP_CHUNK_HEADER_SIZE)
-      return false;
+   /* Write chunks to file, in order */
+   for (i = 0; i < count; i++)
+   {
+      uint8_t chunk_header_bytes[RZIP_CHUNK_HEADER_SIZE];
+      rzip_job_t *job = &stream->jobs[i];
+
+      /* Write compressed chunk size to file */
+      chunk_header_bytes[3] = (job->buf_len >> 24) & 0xFF;
+      chunk_header_bytes[2] = (job->buf_len >> 16) & 0xFF;
+      chunk_header_bytes[1] = (job->buf_len >>  8) & 0xFF;
+      chunk_header_bytes[0] =  job->buf_len        & 0xFF;
+
+      if (filestream_write(
+            stream->file, chunk_header_bytes, sizeof(chunk_header_bytes)) !=
+            RZIP_CHUNK_HEADER_SIZE)
+         return false;
 
-   /* Write compressed data to file */
-   if (filestream_write(
-         stream->file, stream->out_buf, deflate_written) != deflate_written)
-      return false;
+      /* Write compressed data to file */
+      if (filestream_write(
+            stream->file, job->buf, job->buf_len) != job->buf_len)
+         return false;
+   }
 
    /* Reset input buffer pointer */
    stream->in_buf_ptr = 0;
@@ -795,10 +1167,26 @@ int64_t rzipstream_write(rzipstream_t *stream, const void *data, int64_t len)
    {
       int64_t cache_size = 0;
 
-      /* If input buffer is full, compress and write to disk */
+      /* If input buffer is full, either grow it
+       * to hold a full batch of chunks, or compress
+       * the batch and write it to disk */
       if (stream->in_buf_ptr >= stream->in_buf_size)
-         if (!rzipstream_write_chunk(stream))
+      {
+         uint32_t batch_size = stream->chunk_size * stream->num_jobs;
+
+         if (stream->in_buf_size < batch_size)
+         {
+            uint8_t *in_buf = (uint8_t *)realloc(stream->in_buf, batch_size);
+
+            if (!in_buf)
+               return -1;
+
+            stream->in_buf      = in_buf;
+            stream->in_buf_size = batch_size;
+         }
+         else if (!rzipstream_write_chunks(stream))
             return -1;
+      }
 
       /* Get amount of data to cache during this loop
        * > i.e. minimum of space remaining in input buffer
@@ -820,7 +1208,7 @@ int64_t rzipstream_write(rzipstream_t *stream, const void *data, int64_t len)
    }
 
    /* We always write the specified number of bytes
-    * (unless rzipstream_write_chunk() fails, in
+    * (unless rzipstream_write_chunks() fails, in
     * which we register a complete failure...) */
    return len;
 }
@@ -954,10 +1342,12 @@ void rzipstream_rewind(rzipstream_t *stream)
    }
    else
    {
-      /* Check whether first file chunk is currently
-       * buffered in memory */
-      if ((stream->virtual_ptr < stream->chunk_size) &&
-          (stream->out_buf_ptr < stream->out_buf_occupancy))
+      /* Check whether first batch of file chunks is
+       * currently buffered in memory
+       * > i.e. the output buffer starts at the
+       *   beginning of the uncompressed data */
+      if ((stream->out_buf_occupancy > 0) &&
+          (stream->virtual_ptr == stream->out_buf_ptr))
       {
          /* It is: No file access is therefore required
           * > Just reset pointers */
@@ -966,7 +1356,7 @@ void rzipstream_rewind(rzipstream_t *stream)
       }
       else
       {
-         /* It isn't: Have to re-read the first chunk
+         /* It isn't: Have to re-read the first batch
           * from disk... */
 
          /* Reset file position to first chunk location */
@@ -974,13 +1364,15 @@ void rzipstream_rewind(rzipstream_t *stream)
          if (filestream_error(stream->file))
             return;
 
-         /* Read chunk */
-         if (!rzipstream_read_chunk(stream))
-            return;
-
-         /* Reset pointers */
+         /* Reset pointers
+          * > Must happen first, since the number of
+          *   chunks to read depends on the position */
          stream->virtual_ptr = 0;
          stream->out_buf_ptr = 0;
+
+         /* Read chunks */
+         if (!rzipstream_read_chunks(stream))
+            return;
       }
    }
 }
@@ -1035,6 +1427,32 @@ bool rzipstream_is_compressed(rzipstream_t *stream)
    return stream && stream->is_compressed;
 }
 
+/* File Settings */
+
+/* Sets the zlib compression level (1-9) of an RZIP
+ * file open for writing. Takes effect from the next
+ * chunk written; any level produces the same file
+ * format, so files remain readable by every version.
+ * Returns false if stream is not open for writing,
+ * or if level is invalid */
+bool rzipstream_set_compression_level(rzipstream_t *stream, unsigned level)
+{
+   unsigned i;
+
+   if (!stream || !stream->is_writing ||
+       (level < 1) || (level > 9))
+      return false;
+
+   stream->level = level;
+
+   for (i = 0; i < RZIP_MAX_JOBS; i++)
+      if (stream->jobs[i].trans_stream)
+         stream->deflate_backend->define(
+               stream->jobs[i].trans_stream, "level", level);
+
+   return true;
+}
+
 /* File Close */
 
 /* Closes RZIP file. If file is open for writing,
@@ -1051,7 +1469,7 @@ int rzipstream_close(rzipstream_t *stream)
    if (stream->is_writing)
    {
       if (stream->in_buf_ptr > 0)
-         if (!rzipstream_write_chunk(stream))
+         if (!rzipstream_write_chunks(stream))
             goto error;
 
       if (!rzipstream_write_file_header(stream))
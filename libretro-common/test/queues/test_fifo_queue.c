@@ -0,0 +1,203 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (test_fifo_queue.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include <check.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <queues/fifo_queue.h>
+
+#define SUITE_NAME "FIFO SPSC Queue"
+
+static void _fill(uint8_t *data, size_t size, unsigned seed)
+{
+   size_t i;
+   for (i = 0; i < size; i++)
+      data[i] = (uint8_t)(seed + i * 7);
+}
+
+START_TEST (test_fifo_spsc_create)
+{
+   fifo_spsc_t *queue = fifo_spsc_new(64);
+   ck_assert_ptr_nonnull(queue);
+   fifo_spsc_free(queue);
+   fifo_spsc_free(NULL);
+}
+END_TEST
+
+START_TEST (test_fifo_spsc_empty)
+{
+   uint8_t out[16];
+   fifo_spsc_t *queue = fifo_spsc_new(64);
+
+   ck_assert_uint_eq(fifo_spsc_read_avail(queue), 0);
+   ck_assert_uint_eq(fifo_spsc_write_avail(queue), 64);
+   ck_assert_uint_eq(fifo_spsc_read(queue, out, sizeof(out)), 0);
+
+   /* Drained back to empty */
+   _fill(out, sizeof(out), 1);
+   ck_assert_uint_eq(fifo_spsc_write(queue, out, sizeof(out)), sizeof(out));
+   ck_assert_uint_eq(fifo_spsc_read(queue, out, sizeof(out)), sizeof(out));
+   ck_assert_uint_eq(fifo_spsc_read_avail(queue), 0);
+   ck_assert_uint_eq(fifo_spsc_write_avail(queue), 64);
+   ck_assert_uint_eq(fifo_spsc_read(queue, out, 1), 0);
+
+   fifo_spsc_free(queue);
+}
+END_TEST
+
+START_TEST (test_fifo_spsc_full)
+{
+   uint8_t in[64];
+   uint8_t out[64];
+   fifo_spsc_t *queue = fifo_spsc_new(sizeof(in));
+
+   _fill(in, sizeof(in), 3);
+   ck_assert_uint_eq(fifo_spsc_write(queue, in, sizeof(in) - 1), sizeof(in) - 1);
+   ck_assert_uint_eq(fifo_spsc_write_avail(queue), 1);
+   ck_assert_uint_eq(fifo_spsc_write(queue, in + sizeof(in) - 1, 1), 1);
+   ck_assert_uint_eq(fifo_spsc_write_avail(queue), 0);
+   ck_assert_uint_eq(fifo_spsc_read_avail(queue), sizeof(in));
+
+   /* Nothing more fits until the consumer reads */
+   ck_assert_uint_eq(fifo_spsc_write(queue, in, 1), 0);
+   ck_assert_uint_eq(fifo_spsc_read(queue, out, 1), 1);
+   ck_assert_uint_eq(fifo_spsc_write_avail(queue), 1);
+   ck_assert_uint_eq(fifo_spsc_write(queue, in, sizeof(in)), 1);
+
+   ck_assert_uint_eq(fifo_spsc_read(queue, out + 1, sizeof(out) - 1),
+         sizeof(out) - 1);
+   ck_assert_int_eq(memcmp(in, out, sizeof(in)), 0);
+   ck_assert_uint_eq(fifo_spsc_read_avail(queue), 1);
+   ck_assert_uint_eq(fifo_spsc_read(queue, out, sizeof(out)), 1);
+   ck_assert_uint_eq(out[0], in[0]);
+
+   fifo_spsc_free(queue);
+}
+END_TEST
+
+START_TEST (test_fifo_spsc_non_power_of_two)
+{
+   uint8_t in[200];
+   uint8_t out[200];
+   /* Backed by 128 bytes of storage, but only 100 are usable */
+   fifo_spsc_t *queue = fifo_spsc_new(100);
+
+   _fill(in, sizeof(in), 5);
+   ck_assert_uint_eq(fifo_spsc_write_avail(queue), 100);
+   ck_assert_uint_eq(fifo_spsc_write(queue, in, sizeof(in)), 100);
+   ck_assert_uint_eq(fifo_spsc_write_avail(queue), 0);
+   ck_assert_uint_eq(fifo_spsc_read_avail(queue), 100);
+
+   ck_assert_uint_eq(fifo_spsc_read(queue, out, 30), 30);
+   ck_assert_uint_eq(fifo_spsc_write_avail(queue), 30);
+   ck_assert_uint_eq(fifo_spsc_write(queue, in + 100, sizeof(in)), 30);
+   ck_assert_uint_eq(fifo_spsc_write_avail(queue), 0);
+
+   ck_assert_uint_eq(fifo_spsc_read(queue, out + 30, sizeof(out)), 100);
+   ck_assert_int_eq(memcmp(in, out, 130), 0);
+
+   fifo_spsc_free(queue);
+}
+END_TEST
+
+START_TEST (test_fifo_spsc_wraparound)
+{
+   unsigned i, j;
+   uint8_t in[37];
+   uint8_t out[37];
+   uint8_t next_in    = 0;
+   uint8_t next_out   = 0;
+   fifo_spsc_t *queue = fifo_spsc_new(100);
+
+   /* Keep some data queued so that writes and reads
+    * straddle the end of the storage at varying offsets */
+   for (j = 0; j < 20; j++)
+      in[j] = next_in++;
+   ck_assert_uint_eq(fifo_spsc_write(queue, in, 20), 20);
+
+   for (i = 0; i < 100; i++)
+   {
+      for (j = 0; j < sizeof(in); j++)
+         in[j] = next_in++;
+      ck_assert_uint_eq(fifo_spsc_write(queue, in, sizeof(in)), sizeof(in));
+      ck_assert_uint_eq(fifo_spsc_read_avail(queue), 20 + sizeof(in));
+      ck_assert_uint_eq(fifo_spsc_write_avail(queue), 100 - 20 - sizeof(in));
+
+      ck_assert_uint_eq(fifo_spsc_read(queue, out, sizeof(out)), sizeof(out));
+      for (j = 0; j < sizeof(out); j++)
+         ck_assert_uint_eq(out[j], next_out++);
+   }
+
+   fifo_spsc_free(queue);
+}
+END_TEST
+
+START_TEST (test_fifo_spsc_index_overflow)
+{
+   uint8_t in[48];
+   uint8_t out[48];
+   fifo_spsc_t *queue = fifo_spsc_new(64);
+
+   /* The indices are free-running counters */
+   queue->write_idx = queue->read_idx = SIZE_MAX - 10;
+
+   _fill(in, sizeof(in), 9);
+   ck_assert_uint_eq(fifo_spsc_write(queue, in, sizeof(in)), sizeof(in));
+   ck_assert_uint_eq(fifo_spsc_read_avail(queue), sizeof(in));
+   ck_assert_uint_eq(fifo_spsc_write_avail(queue), 64 - sizeof(in));
+   ck_assert_uint_eq(fifo_spsc_read(queue, out, sizeof(out)), sizeof(out));
+   ck_assert_int_eq(memcmp(in, out, sizeof(in)), 0);
+   ck_assert_uint_eq(fifo_spsc_read_avail(queue), 0);
+   ck_assert_uint_eq(fifo_spsc_write_avail(queue), 64);
+
+   fifo_spsc_free(queue);
+}
+END_TEST
+
+Suite *create_suite(void)
+{
+   Suite *s = suite_create(SUITE_NAME);
+
+   TCase *tc_core = tcase_create("Core");
+   tcase_add_test(tc_core, test_fifo_spsc_create);
+   tcase_add_test(tc_core, test_fifo_spsc_empty);
+   tcase_add_test(tc_core, test_fifo_spsc_full);
+   tcase_add_test(tc_core, test_fifo_spsc_non_power_of_two);
+   tcase_add_test(tc_core, test_fifo_spsc_wraparound);
+   tcase_add_test(tc_core, test_fifo_spsc_index_overflow);
+   suite_add_tcase(s, tc_core);
+
+   return s;
+}
+
+int main(void)
+{
+	int num_fail;
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	num_fail = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return (num_fail == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
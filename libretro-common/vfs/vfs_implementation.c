@@ -736,6 +736,32 @@ int retro_vfs_file_flush_impl(libretro_vfs_implementation_file *stream)
    return -1;
 }
 
+int retro_vfs_file_sync_impl(libretro_vfs_implementation_file *stream)
+{
+   int fd;
+
+   if (!stream)
+      return -1;
+
+   if (stream->fp && fflush(stream->fp) != 0)
+      return -1;
+
+#if defined(_WIN32) && !defined(_XBOX)
+   fd = stream->fp ? _fileno(stream->fp) : stream->fd;
+   if (fd < 0 || _commit(fd) != 0)
+      return -1;
+#elif (defined(__linux__) || defined(__unix__) || defined(__APPLE__)) && !defined(EMSCRIPTEN)
+   fd = stream->fp ? fileno(stream->fp) : stream->fd;
+   if (fd < 0 || fsync(fd) != 0)
+      return -1;
+#else
+   /* Flushing is all there is here */
+   (void)fd;
+#endif
+
+   return 0;
+}
+
 int retro_vfs_file_remove_impl(const char *path)
 {
    if (path && *path)
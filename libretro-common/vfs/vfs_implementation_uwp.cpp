@@ -212,6 +212,13 @@ int retro_vfs_file_flush_impl(libretro_vfs_implementation_file* stream)
     return -1;
 }
 
+int retro_vfs_file_sync_impl(libretro_vfs_implementation_file* stream)
+{
+    if (stream && fflush(stream->fp) == 0 && _commit(_fileno(stream->fp)) == 0)
+       return 0;
+    return -1;
+}
+
 int retro_vfs_file_remove_impl(const char *path)
 {
    BOOL result;
@@ -799,6 +799,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_auto_load,           MENU_
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_thumbnail_enable,    MENU_ENUM_SUBLABEL_SAVESTATE_THUMBNAIL_ENABLE)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_save_file_compression,         MENU_ENUM_SUBLABEL_SAVE_FILE_COMPRESSION)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_file_compression,    MENU_ENUM_SUBLABEL_SAVESTATE_FILE_COMPRESSION)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_file_compression_level, MENU_ENUM_SUBLABEL_SAVESTATE_FILE_COMPRESSION_LEVEL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_savestate_max_keep,            MENU_ENUM_SUBLABEL_SAVESTATE_MAX_KEEP)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_autosave_interval,             MENU_ENUM_SUBLABEL_AUTOSAVE_INTERVAL)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_replay_max_keep,               MENU_ENUM_SUBLABEL_REPLAY_MAX_KEEP)
@@ -1064,6 +1065,7 @@ DEFAULT_SUBLABEL_MACRO(action_bind_thumbnails_directory,
 DEFAULT_SUBLABEL_MACRO(action_bind_rgui_config_directory,                          MENU_ENUM_SUBLABEL_RGUI_CONFIG_DIRECTORY)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_latency_frames,                  MENU_ENUM_SUBLABEL_NETPLAY_INPUT_LATENCY_FRAMES_MIN)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_input_latency_frames_range,            MENU_ENUM_SUBLABEL_NETPLAY_INPUT_LATENCY_FRAMES_RANGE)
+DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_netplay_replay_budget,                 MENU_ENUM_SUBLABEL_NETPLAY_REPLAY_BUDGET)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_disk_tray_eject,                       MENU_ENUM_SUBLABEL_DISK_TRAY_EJECT)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_disk_tray_insert,                      MENU_ENUM_SUBLABEL_DISK_TRAY_INSERT)
 DEFAULT_SUBLABEL_MACRO(action_bind_sublabel_disk_index,                            MENU_ENUM_SUBLABEL_DISK_INDEX)
@@ -3263,6 +3265,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_RANGE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_input_latency_frames_range);
             break;
+         case MENU_ENUM_LABEL_NETPLAY_REPLAY_BUDGET:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_netplay_replay_budget);
+            break;
          case MENU_ENUM_LABEL_NETPLAY_INPUT_LATENCY_FRAMES_MIN:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_input_latency_frames);
             break;
@@ -4020,6 +4025,9 @@ int menu_cbs_init_bind_sublabel(menu_file_list_cbs_t *cbs,
          case MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_savestate_file_compression);
             break;
+         case MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION_LEVEL:
+            BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_savestate_file_compression_level);
+            break;
          case MENU_ENUM_LABEL_SAVESTATE_AUTO_SAVE:
             BIND_ACTION_SUBLABEL(cbs, action_bind_sublabel_savestate_auto_save);
             break;
@@ -11903,6 +11903,20 @@ static bool setting_append_list(
                   general_write_handler,
                   general_read_handler,
                   SD_FLAG_NONE);
+
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.savestate_file_compression_level,
+                  MENU_ENUM_LABEL_SAVESTATE_FILE_COMPRESSION_LEVEL,
+                  MENU_ENUM_LABEL_VALUE_SAVESTATE_FILE_COMPRESSION_LEVEL,
+                  DEFAULT_SAVESTATE_FILE_COMPRESSION_LEVEL,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].action_ok     = &setting_action_ok_uint;
+            menu_settings_list_current_add_range(list, list_info, 1, 9, 1, true, true);
 #endif
 
             /* TODO/FIXME: This is in the wrong group... */
@@ -23043,6 +23057,22 @@ static bool setting_append_list(
             (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
             menu_settings_list_current_add_range(list, list_info, 0, 15, 1, true, true);
 
+            CONFIG_UINT(
+                  list, list_info,
+                  &settings->uints.netplay_replay_budget,
+                  MENU_ENUM_LABEL_NETPLAY_REPLAY_BUDGET,
+                  MENU_ENUM_LABEL_VALUE_NETPLAY_REPLAY_BUDGET,
+                  DEFAULT_NETPLAY_REPLAY_BUDGET,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler);
+            (*list)[list_info->index - 1].ui_type   = ST_UI_TYPE_UINT_SPINBOX;
+            (*list)[list_info->index - 1].action_ok = &setting_action_ok_uint;
+            menu_settings_list_current_add_range(list, list_info, 0, 100, 1, true, true);
+            SETTINGS_DATA_LIST_CURRENT_ADD_FLAGS(list, list_info, SD_FLAG_ADVANCED);
+
             CONFIG_BOOL(
                   list, list_info,
                   &settings->bools.netplay_nat_traversal,
@@ -2466,6 +2466,7 @@ enum msg_hash_enums
    MENU_LABEL(SAVESTATE_THUMBNAIL_ENABLE),
    MENU_LABEL(SAVE_FILE_COMPRESSION),
    MENU_LABEL(SAVESTATE_FILE_COMPRESSION),
+   MENU_LABEL(SAVESTATE_FILE_COMPRESSION_LEVEL),
 
    MENU_LBL_H(SUSPEND_SCREENSAVER_ENABLE),
    MENU_ENUM_LABEL_VOLUME_UP,
@@ -2506,6 +2507,7 @@ enum msg_hash_enums
    MENU_LBL_H(NETPLAY_CHECK_FRAMES),
    MENU_LBL_H(NETPLAY_INPUT_LATENCY_FRAMES_MIN),
    MENU_LBL_H(NETPLAY_INPUT_LATENCY_FRAMES_RANGE),
+   MENU_LBL_H(NETPLAY_REPLAY_BUDGET),
    MENU_LABEL(NETPLAY_SPECTATOR_MODE_ENABLE), /* deprecated */
    MENU_LABEL(NETPLAY_TCP_UDP_PORT),
    MENU_LABEL(NETPLAY_MAX_CONNECTIONS),
@@ -159,6 +159,10 @@ typedef struct
 #endif
    int room_count;
    int latest_ping;
+   /* Deepest recent replay, or -1, and the most time
+    * recently spent replaying in a frame, in microseconds */
+   int latest_replay_depth;
+   int latest_replay_cost;
    unsigned server_port_deferred;
    uint8_t flags;
    char server_address_deferred[256];
@@ -37,8 +37,12 @@
 #include <encodings/crc32.h>
 #include <encodings/base64.h>
 #include <features/features_cpu.h>
+#include <retro_endianness.h>
 #include <lrc_hash.h>
 
+#define XXH_INLINE_ALL
+#include "../../deps/xxHash/xxhash.h"
+
 #ifdef HAVE_IFINFO
 #include <net/net_ifinfo.h>
 #endif
@@ -52,6 +56,7 @@
 #include "../../file_path_special.h"
 #include "../../paths.h"
 #include "../../retroarch.h"
+#include "../../state_manager.h"
 #include "../../version.h"
 #include "../../verbosity.h"
 
@@ -136,12 +141,6 @@
 #define DISCOVERY_QUERY_MAGIC    0x52414E51 /* RANQ */
 #define DISCOVERY_RESPONSE_MAGIC 0x52414E53 /* RANS */
 
-/* MITM magics */
-#define MITM_SESSION_MAGIC 0x52415453 /* RATS */
-#define MITM_LINK_MAGIC    0x5241544C /* RATL */
-#define MITM_ADDR_MAGIC    0x52415441 /* RATA */
-#define MITM_PING_MAGIC    0x52415450 /* RATP */
-
 #if 0
 /* Activate this to enable assertions on code sections
  * that should be exclusive to one modus */
@@ -720,34 +719,6 @@ static void RETRO_CALLCONV netplay_netpacket_send_cb(int flags,
       const void* buf, size_t len, uint16_t client_id);
 static void RETRO_CALLCONV netplay_netpacket_poll_receive_cb(void);
 
-/*
- * netplay_init_socket_buffer
- *
- * Initialize a new socket buffer.
- */
-static bool netplay_init_socket_buffer(struct socket_buffer *sbuf, size_t size)
-{
-   sbuf->data  = (unsigned char*)malloc(size);
-   if (!sbuf->data)
-      return false;
-   sbuf->bufsz = size;
-   sbuf->start = sbuf->read = sbuf->end = 0;
-
-   return true;
-}
-
-/**
- * netplay_deinit_socket_buffer
- *
- * Free a socket buffer.
- */
-static void netplay_deinit_socket_buffer(struct socket_buffer *sbuf)
-{
-   free(sbuf->data);
-   sbuf->data = NULL;
-}
-
-
 /**
  * netplay_handshake_init_send
  *
@@ -2110,6 +2081,144 @@ static uint32_t netplay_delta_frame_crc(netplay_t *netplay,
          netplay->state_size);
 }
 
+/**
+ * netplay_hash_state_blocks
+ *
+ * Hash a serialized state in NETPLAY_STATE_BLOCK_SIZE blocks, leaving the
+ * per-block hashes in block_hashes. Returns a hash of all block hashes.
+ */
+static uint64_t netplay_hash_state_blocks(netplay_t *netplay,
+      const void *state)
+{
+   size_t i;
+   uint64_t hash       = 0;
+   const uint8_t *data = (const uint8_t*)state;
+
+   for (i = 0; i < netplay->block_count; i++)
+   {
+      XXH64_canonical_t canonical;
+      size_t offset            = i * NETPLAY_STATE_BLOCK_SIZE;
+      size_t len               = netplay->state_size - offset;
+      if (len > NETPLAY_STATE_BLOCK_SIZE)
+         len                   = NETPLAY_STATE_BLOCK_SIZE;
+
+      netplay->block_hashes[i] = XXH3_64bits(data + offset, len);
+
+      /* Chain over the big-endian form, so that peers of
+       * either byte order arrive at the same value. */
+      XXH64_canonicalFromHash(&canonical, netplay->block_hashes[i]);
+      hash = XXH3_64bits_withSeed(&canonical, sizeof(canonical), hash);
+   }
+
+   return hash;
+}
+
+/**
+ * netplay_delta_frame_hash
+ *
+ * Get the hash for the serialization of this frame, in the form the given
+ * protocol version expects: a CRC-32 of the whole state up to version 6,
+ * a hash of the per-block hashes after that.
+ */
+static uint32_t netplay_delta_frame_hash(netplay_t *netplay,
+      struct delta_frame *delta, uint32_t protocol)
+{
+   if (!netplay->state_size)
+      return 0;
+   if (protocol < 7)
+      return netplay_delta_frame_crc(netplay, delta);
+   return (uint32_t)netplay_hash_state_blocks(netplay, delta->state);
+}
+
+/**
+ * netplay_delta_patch_to_net
+ *
+ * Convert the control words of a savestate patch made by
+ * state_manager_raw_compress() to network order. The state data in between
+ * is copied bytes, and is left alone.
+ */
+static void netplay_delta_patch_to_net(uint8_t *patch)
+{
+   uint16_t *patch16 = (uint16_t*)patch;
+
+   for (;;)
+   {
+      uint16_t numchanged = patch16[0];
+
+      patch16[0]          = retro_cpu_to_be16(numchanged);
+
+      if (numchanged)
+      {
+         patch16[1]       = retro_cpu_to_be16(patch16[1]);
+         patch16         += 2 + numchanged;
+      }
+      else
+      {
+         bool end         = !patch16[1] && !patch16[2];
+         patch16[1]       = retro_cpu_to_be16(patch16[1]);
+         patch16[2]       = retro_cpu_to_be16(patch16[2]);
+         patch16         += 3;
+         if (end)
+            break;
+      }
+   }
+}
+
+/**
+ * netplay_delta_patch_from_net
+ *
+ * Convert a received savestate patch back to host order, making sure that
+ * it doesn't reach past the end of a state of the given size.
+ *
+ * Returns false if the patch is malformed.
+ */
+static bool netplay_delta_patch_from_net(uint8_t *patch, size_t patch_size,
+      size_t state_size)
+{
+   uint16_t *patch16 = (uint16_t*)patch;
+   size_t words      = patch_size / sizeof(uint16_t);
+   size_t num16s     = (state_size + sizeof(uint16_t) - 1)
+      / sizeof(uint16_t);
+   size_t pos        = 0;
+   size_t i          = 0;
+
+   while (i < words)
+   {
+      uint16_t numchanged = retro_be_to_cpu16(patch16[i]);
+
+      patch16[i]          = numchanged;
+
+      if (numchanged)
+      {
+         if (words - i < 2 + (size_t)numchanged)
+            return false;
+         patch16[i + 1]   = retro_be_to_cpu16(patch16[i + 1]);
+         pos             += patch16[i + 1] + (size_t)numchanged;
+         i               += 2 + numchanged;
+      }
+      else
+      {
+         uint32_t numunchanged;
+
+         if (words - i < 3)
+            return false;
+         patch16[i + 1]   = retro_be_to_cpu16(patch16[i + 1]);
+         patch16[i + 2]   = retro_be_to_cpu16(patch16[i + 2]);
+         numunchanged     = patch16[i + 1]
+            | ((uint32_t)patch16[i + 2] << 16);
+         if (!numunchanged)
+            return true;
+         pos             += numunchanged;
+         i               += 3;
+      }
+
+      if (pos > num16s)
+         return false;
+   }
+
+   return false;
+}
+
 /*
  * Free an input state list
  */
@@ -2241,329 +2350,6 @@ static uint32_t netplay_expected_input_size(netplay_t *netplay,
    return ret;
 }
 
-static size_t buf_used(struct socket_buffer *sbuf)
-{
-   if (sbuf->end < sbuf->start)
-   {
-      size_t newend = sbuf->end;
-      while (newend < sbuf->start)
-         newend += sbuf->bufsz;
-      return newend - sbuf->start;
-   }
-
-   return sbuf->end - sbuf->start;
-}
-
-static size_t buf_unread(struct socket_buffer *sbuf)
-{
-   if (sbuf->end < sbuf->read)
-   {
-      size_t newend = sbuf->end;
-      while (newend < sbuf->read)
-         newend += sbuf->bufsz;
-      return newend - sbuf->read;
-   }
-
-   return sbuf->end - sbuf->read;
-}
-
-static size_t buf_remaining(struct socket_buffer *sbuf)
-{
-   return sbuf->bufsz - buf_used(sbuf) - 1;
-}
-
-/**
- * netplay_resize_socket_buffer
- *
- * Resize the given socket_buffer's buffer to the requested size.
- */
-static bool netplay_resize_socket_buffer(
-      struct socket_buffer *sbuf, size_t newsize)
-{
-   unsigned char *newdata = (unsigned char*)malloc(newsize);
-   if (!newdata)
-      return false;
-
-    /* Copy in the old data */
-    if (sbuf->end < sbuf->start)
-    {
-       memcpy(newdata,
-             sbuf->data + sbuf->start,
-             sbuf->bufsz - sbuf->start);
-       memcpy(newdata + sbuf->bufsz - sbuf->start,
-             sbuf->data,
-             sbuf->end);
-    }
-    else if (sbuf->end > sbuf->start)
-       memcpy(newdata,
-             sbuf->data + sbuf->start,
-             sbuf->end - sbuf->start);
-
-    /* Adjust our read offset */
-    if (sbuf->read < sbuf->start)
-       sbuf->read += sbuf->bufsz - sbuf->start;
-    else
-       sbuf->read -= sbuf->start;
-
-    /* Adjust start and end */
-    sbuf->end      = buf_used(sbuf);
-    sbuf->start    = 0;
-
-    /* Free the old one and replace it with the new one */
-    free(sbuf->data);
-    sbuf->data     = newdata;
-    sbuf->bufsz    = newsize;
-
-    return true;
-}
-
-/**
- * netplay_send
- *
- * Queue the given data for sending.
- */
-bool netplay_send(
-      struct socket_buffer *sbuf,
-      int sockfd, const void *buf,
-      size_t len)
-{
-   if (buf_remaining(sbuf) < len)
-   {
-      /* Need to force a blocking send */
-      if (!netplay_send_flush(sbuf, sockfd, true))
-         return false;
-   }
-
-   if (buf_remaining(sbuf) < len)
-   {
-      /* Can only be that this is simply too big
-       * for our buffer, in which case we just
-       * need to do a blocking send */
-      if (!socket_send_all_blocking(sockfd, buf, len, true))
-         return false;
-      return true;
-   }
-
-   /* Copy it into our buffer */
-   if (sbuf->bufsz - sbuf->end < len)
-   {
-      /* Half at a time */
-      size_t chunka = sbuf->bufsz - sbuf->end,
-             chunkb = len - chunka;
-      memcpy(sbuf->data + sbuf->end, buf, chunka);
-      memcpy(sbuf->data, (const unsigned char *)buf + chunka, chunkb);
-      sbuf->end = chunkb;
-
-   }
-   else
-   {
-      /* Straight in */
-      memcpy(sbuf->data + sbuf->end, buf, len);
-      sbuf->end += len;
-   }
-
-   return true;
-}
-
-/**
- * netplay_send_flush
- *
- * Flush unsent data in the given socket buffer, blocking to do so if
- * requested.
- *
- * Returns false only on socket failures, true otherwise.
- */
-bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
-{
-   if (buf_used(sbuf) == 0)
-      return true;
-
-   if (sbuf->end > sbuf->start)
-   {
-      /* Usual case: Everything's in order */
-      if (block)
-      {
-         if (!socket_send_all_blocking(
-                  sockfd, sbuf->data + sbuf->start,
-                  buf_used(sbuf), true))
-            return false;
-
-         sbuf->start = sbuf->end = 0;
-      }
-      else
-      {
-         ssize_t sent = socket_send_all_nonblocking(
-               sockfd, sbuf->data + sbuf->start,
-               buf_used(sbuf), true);
-
-         if (sent < 0)
-            return false;
-
-         sbuf->start += sent;
-
-         if (sbuf->start == sbuf->end)
-            sbuf->start = sbuf->end = 0;
-      }
-   }
-   else
-   {
-      /* Unusual case: Buffer overlaps break */
-      if (block)
-      {
-         if (!socket_send_all_blocking(
-                  sockfd, sbuf->data + sbuf->start,
-                  sbuf->bufsz - sbuf->start, true))
-            return false;
-
-         sbuf->start = 0;
-
-         return netplay_send_flush(sbuf, sockfd, true);
-      }
-      else
-      {
-         ssize_t sent = socket_send_all_nonblocking(
-               sockfd, sbuf->data + sbuf->start,
-               sbuf->bufsz - sbuf->start, true);
-
-         if (sent < 0)
-            return false;
-
-         sbuf->start += sent;
-
-         if (sbuf->start >= sbuf->bufsz)
-         {
-            sbuf->start = 0;
-            return netplay_send_flush(sbuf, sockfd, false);
-         }
-      }
-
-   }
-
-   return true;
-}
-
-/**
- * netplay_recv
- *
- * Receive buffered or fresh data.
- *
- * Returns number of bytes returned, which may be short, 0, or -1 on error.
- */
-ssize_t netplay_recv(struct socket_buffer *sbuf, int sockfd,
-      void *buf, size_t len)
-{
-   ssize_t recvd;
-   bool error    = false;
-
-   if (buf_unread(sbuf) >= len || !buf_remaining(sbuf))
-      goto copy;
-
-   /* Receive whatever we can into the buffer */
-   if (sbuf->end >= sbuf->start)
-   {
-      recvd = socket_receive_all_nonblocking(sockfd, &error,
-         sbuf->data + sbuf->end, sbuf->bufsz - sbuf->end -
-         ((sbuf->start == 0) ? 1 : 0));
-
-      if (recvd < 0 || error)
-         return -1;
-
-      sbuf->end += recvd;
-
-      if (sbuf->end >= sbuf->bufsz)
-      {
-         sbuf->end = 0;
-
-         if (sbuf->start > 1 && buf_unread(sbuf) < len)
-         {
-            error = false;
-            recvd = socket_receive_all_nonblocking(sockfd, &error,
-               sbuf->data, sbuf->start - 1);
-
-            if (recvd < 0 || error)
-               return -1;
-
-            sbuf->end += recvd;
-         }
-      }
-   }
-   else
-   {
-      recvd = socket_receive_all_nonblocking(
-            sockfd, &error, sbuf->data + sbuf->end,
-            sbuf->start - sbuf->end - 1);
-
-      if (recvd < 0 || error)
-         return -1;
-
-      sbuf->end += recvd;
-   }
-
-   /* Now copy it into the reader */
-copy:
-   if (sbuf->end >= sbuf->read || (sbuf->bufsz - sbuf->read) >= len)
-   {
-      size_t unread = buf_unread(sbuf);
-
-      if (len <= unread)
-      {
-         memcpy(buf, sbuf->data + sbuf->read, len);
-         sbuf->read += len;
-         if (sbuf->read >= sbuf->bufsz)
-            sbuf->read = 0;
-         recvd = len;
-      }
-      else if (unread > 0)
-      {
-         memcpy(buf, sbuf->data + sbuf->read, unread);
-         sbuf->read += unread;
-         if (sbuf->read >= sbuf->bufsz)
-            sbuf->read = 0;
-         recvd = unread;
-      }
-      else
-         recvd = 0;
-   }
-   else
-   {
-      /* Our read goes around the edge */
-      size_t chunka = sbuf->bufsz - sbuf->read;
-      size_t chunkb = ((len - chunka) > sbuf->end) ? sbuf->end :
-         (len - chunka);
-
-      memcpy(buf, sbuf->data + sbuf->read, chunka);
-      if (chunkb > 0)
-         memcpy((unsigned char*)buf + chunka, sbuf->data, chunkb);
-
-      sbuf->read = chunkb;
-      recvd      = chunka + chunkb;
-   }
-
-   return recvd;
-}
-
-/**
- * netplay_recv_reset
- *
- * Reset our recv buffer so that future netplay_recvs
- * will read the same data again.
- */
-void netplay_recv_reset(struct socket_buffer *sbuf)
-{
-   sbuf->read = sbuf->start;
-}
-
-/**
- * netplay_recv_flush
- *
- * Flush our recv buffer, so a future netplay_recv_reset will reset to this
- * point.
- */
-void netplay_recv_flush(struct socket_buffer *sbuf)
-{
-   sbuf->start = sbuf->read;
-}
-
 static bool netplay_full(netplay_t *netplay, int fd)
 {
    size_t i;
@@ -2643,18 +2429,47 @@ static bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
 {
    size_t i;
    uint32_t payload[2];
-   bool success = true;
+   /* Each kind of hash is only computed if some peer needs it. */
+   uint32_t crc       = 0;
+   uint32_t hash      = 0;
+   bool have_crc      = false;
+   bool have_hash     = false;
+   bool success       = true;
    NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
 
    payload[0]   = htonl(delta->frame);
-   payload[1]   = htonl(delta->crc);
 
    for (i = 0; i < netplay->connections_size; i++)
    {
-      if (     (netplay->connections[i].flags & NETPLAY_CONN_FLAG_ACTIVE)
-            && (netplay->connections[i].mode >= NETPLAY_CONNECTION_CONNECTED))
-         success = netplay_send_raw_cmd(netplay, &netplay->connections[i],
-            NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
+      struct netplay_connection *connection = &netplay->connections[i];
+
+      if (   !(connection->flags & NETPLAY_CONN_FLAG_ACTIVE)
+            || (connection->mode < NETPLAY_CONNECTION_CONNECTED))
+         continue;
+
+      if (connection->netplay_protocol < 7)
+      {
+         if (!have_crc)
+         {
+            crc       = netplay_delta_frame_hash(netplay, delta,
+                  connection->netplay_protocol);
+            have_crc  = true;
+         }
+         payload[1]   = htonl(crc);
+      }
+      else
+      {
+         if (!have_hash)
+         {
+            hash      = netplay_delta_frame_hash(netplay, delta,
+                  connection->netplay_protocol);
+            have_hash = true;
+         }
+         payload[1]   = htonl(hash);
+      }
+
+      success = netplay_send_raw_cmd(netplay, connection,
+         NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
    }
    return success;
 }
@@ -2677,6 +2492,53 @@ static bool netplay_cmd_request_savestate(netplay_t *netplay)
       NETPLAY_CMD_REQUEST_SAVESTATE, NULL, 0);
 }
 
+/**
+ * netplay_cmd_request_savestate_blocks
+ *
+ * Send our per-block hashes of a frame whose hash didn't match the server's,
+ * so that it only sends back the blocks that differ. Servers older than
+ * protocol 7 get a plain savestate request instead.
+ */
+static bool netplay_cmd_request_savestate_blocks(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   size_t i;
+   uint32_t *payload;
+   struct netplay_connection *connection = &netplay->connections[0];
+
+   if (     (netplay->connections_size == 0)
+       || (!(connection->flags & NETPLAY_CONN_FLAG_ACTIVE))
+       ||   (connection->mode  < NETPLAY_CONNECTION_CONNECTED))
+      return false;
+   if (connection->netplay_protocol < 7 || !netplay->block_count)
+      return netplay_cmd_request_savestate(netplay);
+   if (netplay->savestate_request_outstanding)
+      return true;
+
+   /* The request is 12 bytes plus 8 per block; the compression
+    * buffer is normally twice the state size, which fits it. */
+   if (netplay->zbuffer_size <
+         (3 + 2 * netplay->block_count) * sizeof(uint32_t))
+      return netplay_cmd_request_savestate(netplay);
+
+   netplay_hash_state_blocks(netplay, delta->state);
+
+   payload    = (uint32_t*)netplay->zbuffer;
+   payload[0] = htonl(delta->frame);
+   payload[1] = htonl(NETPLAY_STATE_BLOCK_SIZE);
+   payload[2] = htonl((uint32_t)netplay->block_count);
+   for (i = 0; i < netplay->block_count; i++)
+   {
+      payload[3 + 2 * i] = htonl((uint32_t)(netplay->block_hashes[i] >> 32));
+      payload[4 + 2 * i] = htonl((uint32_t)netplay->block_hashes[i]);
+   }
+
+   netplay->savestate_request_outstanding = true;
+   return netplay_send_raw_cmd(netplay, connection,
+      NETPLAY_CMD_REQUEST_SAVESTATE_BLOCKS, payload,
+      (3 + 2 * netplay->block_count) * sizeof(uint32_t));
+}
+
 /**
  * netplay_cmd_stall
  *
@@ -3171,19 +3033,15 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
    if (netplay->is_server)
    {
       if (netplay->check_frames && (delta->frame % netplay->check_frames) == 0)
-      {
-         delta->crc = netplay->state_size ?
-            netplay_delta_frame_crc(netplay, delta) : 0;
          netplay_cmd_crc(netplay, delta);
-      }
    }
    else
    {
-      if (netplay->crcs_valid && delta->crc)
+      if (netplay->crcs_valid && delta->crc && netplay->connections_size)
       {
          /* We have a remote CRC, so check it. */
-         uint32_t local_crc = netplay->state_size ?
-            netplay_delta_frame_crc(netplay, delta) : 0;
+         uint32_t local_crc = netplay_delta_frame_hash(netplay, delta,
+               netplay->connections[0].netplay_protocol);
 
          if (local_crc != delta->crc)
          {
@@ -3196,7 +3054,7 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
             }
 
             if (netplay->check_frames)
-               netplay_cmd_request_savestate(netplay);
+               netplay_cmd_request_savestate_blocks(netplay, delta);
             else
                RARCH_WARN("[Netplay] Netplay CRCs mismatch!\n");
          }
@@ -3661,8 +3519,9 @@ static bool netplay_sync_pre_frame(netplay_t *netplay)
          memset(serial_info.data, 0, serial_info.size);
          if (core_serialize_special(&serial_info))
          {
+            /* Our state is only a prediction until a replay finishes. */
             if (netplay->force_send_savestate && !netplay->stall &&
-                  !netplay->remote_paused)
+                  !netplay->remote_paused && !netplay->replay_pending)
             {
                /* Bring our running frame and input frames into
                 * parity so we don't send old info. */
@@ -3760,6 +3619,37 @@ process:
    return ret;
 }
 
+/**
+ * netplay_update_replay_stats
+ * @netplay              : pointer to netplay object
+ * @depth                : number of frames behind the replay started, or 0
+ * @start                : when the replay started
+ *
+ * Record this frame's replay for the ping widget.
+ */
+static void netplay_update_replay_stats(netplay_t *netplay, uint32_t depth,
+      retro_time_t start)
+{
+   retro_time_t now = cpu_features_get_time_usec();
+
+   if (now - netplay->replay_stats_start >= NETPLAY_REPLAY_STATS_PERIOD)
+   {
+      netplay->replay_depth_shown = netplay->replay_depth_peak;
+      netplay->replay_cost_shown  = netplay->replay_cost_peak;
+      netplay->replay_depth_peak  = 0;
+      netplay->replay_cost_peak   = 0;
+      netplay->replay_stats_start = now;
+   }
+
+   if (!depth)
+      return;
+
+   if (depth > netplay->replay_depth_peak)
+      netplay->replay_depth_peak = depth;
+   if (now - start > netplay->replay_cost_peak)
+      netplay->replay_cost_peak  = now - start;
+}
+
 /**
  * netplay_sync_input_post_frame
  * @netplay              : pointer to netplay object
@@ -3770,7 +3660,9 @@ process:
  */
 static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
 {
-   uint32_t lo_frame_count, hi_frame_count;
+   uint32_t lo_frame_count, hi_frame_count, limit_frame_count;
+   retro_time_t replay_start = 0;
+   uint32_t replay_depth     = 0;
    NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
 
    /* Unless we're stalling, we've just finished running a frame */
@@ -3796,6 +3688,7 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
    {
       netplay->other_frame_count = netplay->self_frame_count;
       netplay->other_ptr         = netplay->self_ptr;
+      netplay->replay_pending    = false;
 
       /* FIXME: Duplication */
       if (netplay->catch_up)
@@ -3814,6 +3707,16 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
       netplay->force_reset = false;
    }
 
+   /* A forced rewind supersedes whatever replay was under way */
+   if (netplay->force_rewind)
+      netplay->replay_pending = false;
+
+   /* States past an unfinished replay are still predicted ones,
+    * so they can't be trusted even if the input was right. */
+   limit_frame_count = netplay->replay_pending
+      ? netplay->replay_pending_frame_count
+      : netplay->run_frame_count;
+
    netplay->replay_ptr = netplay->other_ptr;
    netplay->replay_frame_count = netplay->other_frame_count;
 
@@ -3825,7 +3728,7 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
       /* Skip ahead if we predicted correctly.
        * Skip until our simulation failed. */
       while (netplay->other_frame_count < netplay->unread_frame_count &&
-             netplay->other_frame_count < netplay->run_frame_count)
+             netplay->other_frame_count < limit_frame_count)
       {
          struct delta_frame *ptr = &netplay->buffer[netplay->other_ptr];
 
@@ -3845,7 +3748,7 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
 
       if (cont)
       {
-         while (netplay->replay_frame_count < netplay->run_frame_count)
+         while (netplay->replay_frame_count < limit_frame_count)
          {
             if (netplay_resolve_input(netplay, netplay->replay_ptr, true))
                break;
@@ -3861,6 +3764,27 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
        netplay->replay_frame_count < netplay->run_frame_count)
    {
       retro_ctx_serialize_info_t serial_info;
+      uint32_t replayed = 0;
+      bool can_split    = false;
+
+      replay_start      = cpu_features_get_time_usec();
+      replay_depth      = netplay->run_frame_count
+         - netplay->replay_frame_count;
+
+      /* If this replay is likely to go over budget, keep the running
+       * state, so that we can go back to it and finish the replay over
+       * the next few frames. */
+      if (     netplay->replay_budget
+            && netplay->replay_live_state
+            && replay_depth > NETPLAY_REPLAY_MIN_FRAMES
+            && (retro_time_t)replay_depth * netplay->frame_run_time_avg
+               > netplay->replay_budget)
+      {
+         serial_info.data_const = NULL;
+         serial_info.data       = netplay->replay_live_state;
+         serial_info.size       = netplay->state_size;
+         can_split              = core_serialize_special(&serial_info);
+      }
 
       /* Replay frames. */
       netplay->is_replay = true;
@@ -3908,6 +3832,13 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
          memset(serial_info.data, 0, serial_info.size);
          core_serialize_special(&serial_info);
 
+         /* Out of time, the rest is replayed from here later. */
+         if (     can_split
+               && replayed >= NETPLAY_REPLAY_MIN_FRAMES
+               && start - replay_start >= netplay->replay_budget)
+            break;
+         replayed++;
+
          if (netplay->replay_frame_count < netplay->unread_frame_count)
             netplay_handle_frame_hash(netplay, ptr);
 
@@ -3955,20 +3886,50 @@ static void netplay_sync_input_post_frame(netplay_t *netplay, bool stalled)
       /* Average our time */
       netplay->frame_run_time_avg   = netplay->frame_run_time_sum / NETPLAY_FRAME_RUN_TIME_WINDOW;
 
-      if (netplay->unread_frame_count < netplay->run_frame_count)
+      if (netplay->replay_frame_count < netplay->run_frame_count)
       {
-         netplay->other_ptr         = netplay->unread_ptr;
-         netplay->other_frame_count = netplay->unread_frame_count;
+         /* Carry on with the predicted state until the replay catches up. */
+         serial_info.data       = NULL;
+         serial_info.data_const = netplay->replay_live_state;
+         serial_info.size       = netplay->state_size;
+         if (!core_unserialize_special(&serial_info))
+            RARCH_ERR("[Netplay] Netplay savestate loading failed: Prepare for desync!\n");
+
+         netplay->replay_pending             = true;
+         netplay->replay_pending_frame_count = netplay->replay_frame_count;
+
+         if (netplay->unread_frame_count < netplay->replay_frame_count)
+         {
+            netplay->other_ptr         = netplay->unread_ptr;
+            netplay->other_frame_count = netplay->unread_frame_count;
+         }
+         else
+         {
+            netplay->other_ptr         = netplay->replay_ptr;
+            netplay->other_frame_count = netplay->replay_frame_count;
+         }
       }
       else
       {
-         netplay->other_ptr         = netplay->run_ptr;
-         netplay->other_frame_count = netplay->run_frame_count;
+         netplay->replay_pending    = false;
+
+         if (netplay->unread_frame_count < netplay->run_frame_count)
+         {
+            netplay->other_ptr         = netplay->unread_ptr;
+            netplay->other_frame_count = netplay->unread_frame_count;
+         }
+         else
+         {
+            netplay->other_ptr         = netplay->run_ptr;
+            netplay->other_frame_count = netplay->run_frame_count;
+         }
       }
       netplay->is_replay            = false;
       netplay->force_rewind         = false;
    }
 
+   netplay_update_replay_stats(netplay, replay_depth, replay_start);
+
    if (netplay->is_server)
    {
       uint32_t client;
@@ -4191,9 +4152,12 @@ static void netplay_hangup(netplay_t *netplay,
          MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
 
    socket_close(connection->fd);
-   connection->flags &= ~NETPLAY_CONN_FLAG_ACTIVE;
+   connection->flags &= ~(NETPLAY_CONN_FLAG_ACTIVE
+         | NETPLAY_CONN_FLAG_REF_STATE);
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+   free(connection->ref_state);
+   connection->ref_state = NULL;
 
    if (!netplay->is_server)
    {
@@ -4237,21 +4201,124 @@ static void netplay_hangup(netplay_t *netplay,
             netplay_send_raw_cmd_all(netplay, connection,
                   NETPLAY_CMD_MODE, &payload, sizeof(payload));
 
-            connection->mode         = NETPLAY_CONNECTION_NONE;
-         }
+            connection->mode         = NETPLAY_CONNECTION_NONE;
+         }
+
+         /* Mark them as not playing anymore */
+         netplay->connected_players &= ~(1L<<client_num);
+         netplay->connected_slaves  &= ~(1L<<client_num);
+         netplay->client_devices[client_num] = 0;
+         for (i = 0; i < MAX_INPUT_DEVICES; i++)
+            netplay->device_clients[i] &= ~(1L<<client_num);
+      }
+   }
+
+   /* Unpause them */
+   if (connection->flags & NETPLAY_CONN_FLAG_PAUSED)
+      remote_unpaused(netplay, connection);
+}
+
+/**
+ * netplay_send_savestate_blocks
+ * @netplay              : pointer to netplay object
+ * @connection           : connection that asked for the blocks
+ * @frame                : frame the client found a mismatch in
+ * @remote_hashes        : the client's block hashes, in network order
+ *
+ * Send a client the blocks of a frame's state whose hashes differ from
+ * ours, so that it can patch its copy and replay from there.
+ *
+ * Returns false if we can't, because the frame is no longer (or not yet)
+ * final in our buffer; a full savestate has to be sent then.
+ */
+static bool netplay_send_savestate_blocks(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t frame,
+      const uint32_t *remote_hashes)
+{
+   size_t i;
+   uint32_t header[6];
+   uint32_t rd, wn;
+   struct compression_transcoder *z;
+   size_t ptr          = netplay->run_ptr;
+   size_t gathered     = 0;
+   uint32_t count      = 0;
+   bool found          = false;
+   const uint8_t *state;
+
+   if (frame >= netplay->other_frame_count)
+      return false;
+
+   do
+   {
+      if (     netplay->buffer[ptr].used
+            && netplay->buffer[ptr].frame == frame)
+      {
+         found = true;
+         break;
+      }
+
+      ptr = PREV_PTR(ptr);
+   } while (ptr != netplay->run_ptr);
+
+   if (!found)
+      return false;
+
+   z = (connection->compression_supported == NETPLAY_COMPRESSION_ZLIB)
+      ? &netplay->compress_zlib
+      : &netplay->compress_nil;
+   if (!z->compression_backend)
+      return false;
 
-         /* Mark them as not playing anymore */
-         netplay->connected_players &= ~(1L<<client_num);
-         netplay->connected_slaves  &= ~(1L<<client_num);
-         netplay->client_devices[client_num] = 0;
-         for (i = 0; i < MAX_INPUT_DEVICES; i++)
-            netplay->device_clients[i] &= ~(1L<<client_num);
-      }
+   state = (const uint8_t*)netplay->buffer[ptr].state;
+   netplay_hash_state_blocks(netplay, state);
+
+   /* The remote hashes live in zbuffer,
+    * so they must all be read before compressing. */
+   for (i = 0; i < netplay->block_count; i++)
+   {
+      size_t offset   = i * NETPLAY_STATE_BLOCK_SIZE;
+      size_t len      = netplay->state_size - offset;
+      uint64_t remote = ((uint64_t)ntohl(remote_hashes[2 * i]) << 32)
+         | ntohl(remote_hashes[2 * i + 1]);
+
+      if (remote == netplay->block_hashes[i])
+         continue;
+
+      if (len > NETPLAY_STATE_BLOCK_SIZE)
+         len = NETPLAY_STATE_BLOCK_SIZE;
+
+      memcpy(netplay->block_buffer + gathered, state + offset, len);
+      gathered                       += len;
+      netplay->block_list[count++]    = htonl((uint32_t)i);
    }
 
-   /* Unpause them */
-   if (connection->flags & NETPLAY_CONN_FLAG_PAUSED)
-      remote_unpaused(netplay, connection);
+   z->compression_backend->set_in(z->compression_stream,
+      netplay->block_buffer, (uint32_t)gathered);
+   z->compression_backend->set_out(z->compression_stream,
+      netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+   if (!z->compression_backend->trans(z->compression_stream, true, &rd,
+         &wn, NULL))
+      return false;
+
+   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE_BLOCKS);
+   header[1] = htonl(4 * sizeof(uint32_t) + count * sizeof(uint32_t) + wn);
+   header[2] = htonl(frame);
+   header[3] = htonl((uint32_t)netplay->state_size);
+   header[4] = htonl(NETPLAY_STATE_BLOCK_SIZE);
+   header[5] = htonl(count);
+
+   if (   !netplay_send(&connection->send_packet_buffer, connection->fd,
+            header, sizeof(header))
+       || !netplay_send(&connection->send_packet_buffer, connection->fd,
+            netplay->block_list, count * sizeof(uint32_t))
+       || !netplay_send(&connection->send_packet_buffer, connection->fd,
+            netplay->zbuffer, wn))
+      netplay_hangup(netplay, connection);
+   else
+      RARCH_LOG("[Netplay] Resending %u of %u state blocks of frame %u.\n",
+            count, (unsigned)netplay->block_count, frame);
+
+   return true;
 }
 
 /**
@@ -5937,14 +6004,13 @@ static bool netplay_get_cmd(netplay_t *netplay,
             {
                /* We've already replayed up to this frame, so we can check it
                 * directly */
-               uint32_t local_crc = 0;
-               if (netplay->state_size)
-                  local_crc       = netplay_delta_frame_crc(
-                        netplay, &netplay->buffer[tmp_ptr]);
+               uint32_t local_crc = netplay_delta_frame_hash(netplay,
+                     &netplay->buffer[tmp_ptr], connection->netplay_protocol);
 
                /* Problem! */
                if (buffer[1] != local_crc)
-                  netplay_cmd_request_savestate(netplay);
+                  netplay_cmd_request_savestate_blocks(netplay,
+                        &netplay->buffer[tmp_ptr]);
             }
             /* We'll have to check it when we catch up */
             else
@@ -5958,9 +6024,209 @@ static bool netplay_get_cmd(netplay_t *netplay,
          /* Delay until next frame so we don't send the savestate after the
           * input */
          netplay->force_send_savestate = true;
+         /* The peer may have lost track of our reference state,
+          * so send it whole. */
+         connection->flags            &= ~NETPLAY_CONN_FLAG_REF_STATE;
          break;
 
+      case NETPLAY_CMD_REQUEST_SAVESTATE_BLOCKS:
+         {
+            uint32_t *payload = (uint32_t*)netplay->zbuffer;
+            NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+            if (!netplay->is_server)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_REQUEST_SAVESTATE_BLOCKS from server.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (     cmd_size < 3 * sizeof(uint32_t)
+                  || cmd_size > netplay->zbuffer_size)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_REQUEST_SAVESTATE_BLOCKS received unexpected payload size.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(payload, cmd_size)
+               return false;
+
+            /* Whatever we can't patch block by block
+             * gets a full savestate, as if it had been requested. */
+            if (     ntohl(payload[1]) != NETPLAY_STATE_BLOCK_SIZE
+                  || ntohl(payload[2]) != netplay->block_count
+                  || cmd_size != (3 + 2 * netplay->block_count)
+                        * sizeof(uint32_t)
+                  || !netplay_send_savestate_blocks(netplay, connection,
+                        ntohl(payload[0]), payload + 3))
+               netplay->force_send_savestate = true;
+            break;
+         }
+
+      case NETPLAY_CMD_LOAD_SAVESTATE_BLOCKS:
+         {
+            uint32_t i;
+            uint32_t header[4];
+            uint32_t frame, count;
+            uint32_t rd, wn;
+            size_t raw_size;
+            size_t gathered                       = 0;
+            size_t tmp_ptr                        = netplay->run_ptr;
+            bool found                            = false;
+            struct compression_transcoder *ctrans = NULL;
+            NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
+
+            if (netplay->is_server)
+            {
+               RARCH_ERR("[Netplay] NETPLAY_CMD_LOAD_SAVESTATE_BLOCKS from client.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            if (cmd_size < sizeof(header))
+            {
+               RARCH_ERR("[Netplay] Received invalid payload size for NETPLAY_CMD_LOAD_SAVESTATE_BLOCKS.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            /* Only players may load states. */
+            if (connection->mode != NETPLAY_CONNECTION_PLAYING &&
+                  connection->mode != NETPLAY_CONNECTION_SLAVE)
+            {
+               RARCH_ERR("[Netplay] Netplay state load from a spectator.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(header, sizeof(header))
+               return false;
+
+            frame = ntohl(header[0]);
+            count = ntohl(header[3]);
+
+            if (     ntohl(header[1]) != netplay->state_size
+                  || ntohl(header[2]) != NETPLAY_STATE_BLOCK_SIZE
+                  || count > netplay->block_count
+                  || cmd_size < sizeof(header) + count * sizeof(uint32_t)
+                  || cmd_size - sizeof(header) - count * sizeof(uint32_t)
+                        > netplay->zbuffer_size)
+            {
+               RARCH_ERR("[Netplay] Netplay state blocks with an unexpected layout.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            raw_size = cmd_size - sizeof(header) - count * sizeof(uint32_t);
+
+            if (count)
+            {
+               RECV(netplay->block_list, count * sizeof(uint32_t))
+                  return false;
+            }
+            if (raw_size)
+            {
+               RECV(netplay->zbuffer, raw_size)
+                  return false;
+            }
+
+            netplay->savestate_request_outstanding = false;
+
+            for (i = 0; i < count; i++)
+            {
+               size_t len;
+               netplay->block_list[i] = ntohl(netplay->block_list[i]);
+               /* Blocks must be in range and strictly increasing, so
+                * they can't add up to more than the block buffer. */
+               if (     netplay->block_list[i] >= netplay->block_count
+                     || (i && netplay->block_list[i]
+                        <= netplay->block_list[i - 1]))
+               {
+                  RARCH_ERR("[Netplay] Netplay state block out of range.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+               len       = netplay->state_size
+                  - (size_t)netplay->block_list[i] * NETPLAY_STATE_BLOCK_SIZE;
+               gathered += (len > NETPLAY_STATE_BLOCK_SIZE)
+                  ? NETPLAY_STATE_BLOCK_SIZE : len;
+               if (gathered > netplay->state_size)
+               {
+                  RARCH_ERR("[Netplay] Netplay state blocks exceed the state size.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+            }
+
+            switch (connection->compression_supported)
+            {
+               case NETPLAY_COMPRESSION_ZLIB:
+                  ctrans = &netplay->compress_zlib;
+                  break;
+               default:
+                  ctrans = &netplay->compress_nil;
+                  break;
+            }
+
+            wn = 0;
+            if (gathered)
+            {
+               ctrans->decompression_backend->set_in(
+                  ctrans->decompression_stream,
+                  netplay->zbuffer, (uint32_t)raw_size);
+               ctrans->decompression_backend->set_out(
+                  ctrans->decompression_stream,
+                  netplay->block_buffer, (uint32_t)gathered);
+               ctrans->decompression_backend->trans(
+                  ctrans->decompression_stream,
+                  true, &rd, &wn, NULL);
+            }
+
+            /* We need the frame to still be in our buffer, final, and
+             * followed by everything up to now, so it can be replayed. */
+            if (frame <= netplay->other_frame_count)
+            {
+               do
+               {
+                  if (     netplay->buffer[tmp_ptr].used
+                        && netplay->buffer[tmp_ptr].frame == frame)
+                  {
+                     found = true;
+                     break;
+                  }
+
+                  tmp_ptr = PREV_PTR(tmp_ptr);
+               } while (tmp_ptr != netplay->run_ptr);
+            }
+
+            if (!found || wn != gathered)
+            {
+               netplay_cmd_request_savestate(netplay);
+               break;
+            }
+
+            gathered = 0;
+            for (i = 0; i < count; i++)
+            {
+               size_t offset = (size_t)netplay->block_list[i]
+                  * NETPLAY_STATE_BLOCK_SIZE;
+               size_t len    = netplay->state_size - offset;
+               if (len > NETPLAY_STATE_BLOCK_SIZE)
+                  len        = NETPLAY_STATE_BLOCK_SIZE;
+
+               memcpy((uint8_t*)netplay->buffer[tmp_ptr].state + offset,
+                     netplay->block_buffer + gathered, len);
+               gathered     += len;
+            }
+
+            RARCH_LOG("[Netplay] Patched %u state blocks of frame %u.\n",
+                  count, frame);
+
+            /* Replay from the patched frame. */
+            if (count)
+            {
+               netplay->other_ptr         = tmp_ptr;
+               netplay->other_frame_count = frame;
+               netplay->force_rewind      = true;
+            }
+            break;
+         }
+
       case NETPLAY_CMD_LOAD_SAVESTATE:
+      case NETPLAY_CMD_LOAD_SAVESTATE_DELTA:
          {
             uint32_t i;
             uint32_t frame;
@@ -5968,6 +6234,10 @@ static bool netplay_get_cmd(netplay_t *netplay,
             size_t   load_ptr;
             uint32_t load_frame_count;
             uint32_t rd, wn;
+            uint32_t delta_header[3];
+            uint32_t patch_size                   = 0;
+            bool delta                            =
+               (cmd == NETPLAY_CMD_LOAD_SAVESTATE_DELTA);
             struct compression_transcoder *ctrans = NULL;
             NETPLAY_ASSERT_MODUS(NETPLAY_MODUS_INPUT_FRAME_SYNC);
 
@@ -6041,6 +6311,27 @@ static bool netplay_get_cmd(netplay_t *netplay,
             state_size     = ntohl(state_size);
             state_size_raw = cmd_size - (sizeof(frame) + sizeof(state_size));
 
+            if (delta)
+            {
+               if (state_size_raw < sizeof(delta_header))
+               {
+                  RARCH_ERR("[Netplay] Received invalid payload size for NETPLAY_CMD_LOAD_SAVESTATE_DELTA.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               RECV(delta_header, sizeof(delta_header))
+                  return false;
+               patch_size      = ntohl(delta_header[0]);
+               state_size_raw -= sizeof(delta_header);
+
+               if (     patch_size > netplay->delta_patch_size
+                     || (patch_size & 1))
+               {
+                  RARCH_ERR("[Netplay] Netplay state delta with an unexpected size.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+            }
+
             if (state_size != netplay->state_size ||
                   state_size_raw > netplay->zbuffer_size)
             {
@@ -6064,13 +6355,71 @@ static bool netplay_get_cmd(netplay_t *netplay,
             ctrans->decompression_backend->set_in(
                ctrans->decompression_stream,
                netplay->zbuffer, state_size_raw);
-            ctrans->decompression_backend->set_out(
-               ctrans->decompression_stream,
-               (uint8_t*)netplay->buffer[load_ptr].state, state_size);
+            if (delta)
+               ctrans->decompression_backend->set_out(
+                  ctrans->decompression_stream,
+                  netplay->delta_patch, patch_size);
+            else
+               ctrans->decompression_backend->set_out(
+                  ctrans->decompression_stream,
+                  (uint8_t*)netplay->buffer[load_ptr].state, state_size);
             ctrans->decompression_backend->trans(
                ctrans->decompression_stream,
                true, &rd, &wn, NULL);
 
+            if (delta)
+            {
+               uint64_t hash = ((uint64_t)ntohl(delta_header[1]) << 32)
+                  | ntohl(delta_header[2]);
+
+               if (     wn != patch_size
+                     || !netplay_delta_patch_from_net(netplay->delta_patch,
+                           patch_size, state_size))
+               {
+                  RARCH_ERR("[Netplay] Received a malformed netplay state delta.\n");
+                  return netplay_cmd_nak(netplay, connection);
+               }
+
+               /* Without the state it was made against,
+                * we need the whole thing. */
+               if (!(connection->flags & NETPLAY_CONN_FLAG_REF_STATE))
+               {
+                  netplay->savestate_request_outstanding = false;
+                  netplay_cmd_request_savestate(netplay);
+                  break;
+               }
+
+               state_manager_raw_decompress(netplay->delta_patch,
+                  patch_size, connection->ref_state, state_size);
+
+               if (XXH3_64bits(connection->ref_state, state_size) != hash)
+               {
+                  RARCH_WARN("[Netplay] Netplay state delta doesn't apply, requesting the whole state.\n");
+                  connection->flags                     &=
+                     ~NETPLAY_CONN_FLAG_REF_STATE;
+                  netplay->savestate_request_outstanding = false;
+                  netplay_cmd_request_savestate(netplay);
+                  break;
+               }
+
+               memcpy(netplay->buffer[load_ptr].state,
+                  connection->ref_state, state_size);
+            }
+            else if (connection->netplay_protocol >= 7)
+            {
+               /* Keep it as the base for later deltas. */
+               connection->flags &= ~NETPLAY_CONN_FLAG_REF_STATE;
+               if (!connection->ref_state)
+                  connection->ref_state = (uint8_t*)
+                     state_manager_raw_alloc(state_size, 0);
+               if (connection->ref_state && wn == state_size)
+               {
+                  memcpy(connection->ref_state,
+                     netplay->buffer[load_ptr].state, state_size);
+                  connection->flags |= NETPLAY_CONN_FLAG_REF_STATE;
+               }
+            }
+
             /* Force a rewind to the relevant frame. */
             netplay->force_rewind = true;
 
@@ -7018,6 +7367,35 @@ static bool netplay_init_serialization(netplay_t *netplay)
       return false;
    }
 
+   netplay->block_count     = (netplay->state_size
+         + NETPLAY_STATE_BLOCK_SIZE - 1) / NETPLAY_STATE_BLOCK_SIZE;
+   netplay->block_hashes    = (uint64_t*)calloc(netplay->block_count,
+         sizeof(*netplay->block_hashes));
+   netplay->block_list      = (uint32_t*)calloc(netplay->block_count,
+         sizeof(*netplay->block_list));
+   netplay->block_buffer    = (uint8_t*)malloc(netplay->state_size);
+   if (     !netplay->block_hashes
+         || !netplay->block_list
+         || !netplay->block_buffer)
+   {
+      netplay->block_count  = 0;
+      return false;
+   }
+
+   netplay->replay_live_state = (uint8_t*)malloc(netplay->state_size);
+   if (!netplay->replay_live_state)
+      return false;
+
+   netplay->delta_patch_size = state_manager_raw_maxsize(netplay->state_size);
+   netplay->delta_patch      = (uint8_t*)malloc(netplay->delta_patch_size);
+   netplay->delta_state      = (uint8_t*)state_manager_raw_alloc(
+         netplay->state_size, 1);
+   if (!netplay->delta_patch || !netplay->delta_state)
+   {
+      netplay->delta_patch_size = 0;
+      return false;
+   }
+
    return true;
 }
 
@@ -7147,6 +7525,8 @@ static void netplay_free(netplay_t *netplay)
          netplay_deinit_socket_buffer(&connection->send_packet_buffer);
          netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
       }
+
+      free(connection->ref_state);
    }
 
    free(netplay->connections);
@@ -7161,6 +7541,12 @@ static void netplay_free(netplay_t *netplay)
    }
 
    free(netplay->zbuffer);
+   free(netplay->block_hashes);
+   free(netplay->block_list);
+   free(netplay->block_buffer);
+   free(netplay->delta_state);
+   free(netplay->delta_patch);
+   free(netplay->replay_live_state);
 
    if (netplay->compress_nil.compression_stream)
       netplay->compress_nil.compression_backend->stream_free(
@@ -7216,6 +7602,8 @@ static netplay_t *netplay_new(const char *server, const char *mitm,
    netplay->next_announce    = -1;
    netplay->next_ping        = -1;
    netplay->simple_rand_next = 1;
+   netplay->replay_budget    = (retro_time_t)
+      config_get_ptr()->uints.netplay_replay_budget * 1000;
 
    strlcpy(netplay->nick,
       !string_is_empty(nick) ? nick : RARCH_DEFAULT_NICK,
@@ -7314,6 +7702,83 @@ failure:
    return NULL;
 }
 
+/**
+ * netplay_send_savestate_delta
+ * @netplay              : pointer to netplay object
+ * @connection           : connection holding a reference state
+ * @serial_info          : the savestate being loaded
+ * @z                    : compression backend to use
+ *
+ * Send a loaded savestate to a peer as a patch against the last savestate
+ * transferred over the connection, in the rewind buffer's format.
+ *
+ * Returns false if the patch isn't worth sending; the whole savestate has to
+ * be sent then.
+ */
+static bool netplay_send_savestate_delta(netplay_t *netplay,
+   struct netplay_connection *connection,
+   retro_ctx_serialize_info_t *serial_info,
+   struct compression_transcoder *z)
+{
+   uint32_t header[7];
+   uint32_t rd, wn;
+   uint64_t hash;
+   size_t patch_size;
+
+   /* The patch needs both states padded, so work on a copy. */
+   memcpy(netplay->delta_state, serial_info->data_const,
+      netplay->state_size);
+   patch_size = state_manager_raw_compress(netplay->delta_state,
+      connection->ref_state, netplay->state_size, netplay->delta_patch);
+
+   /* Most of the state changed. */
+   if (patch_size >= netplay->state_size)
+      return false;
+
+   netplay_delta_patch_to_net(netplay->delta_patch);
+
+   z->compression_backend->set_in(z->compression_stream,
+      netplay->delta_patch, (uint32_t)patch_size);
+   z->compression_backend->set_out(z->compression_stream,
+      netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+   if (!z->compression_backend->trans(z->compression_stream, true, &rd,
+         &wn, NULL))
+      return false;
+
+   hash      = XXH3_64bits(netplay->delta_state, netplay->state_size);
+
+   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE_DELTA);
+   header[1] = htonl(wn + 5*sizeof(uint32_t));
+   header[2] = htonl(netplay->run_frame_count);
+   header[3] = htonl((uint32_t)netplay->state_size);
+   header[4] = htonl((uint32_t)patch_size);
+   header[5] = htonl((uint32_t)(hash >> 32));
+   header[6] = htonl((uint32_t)hash);
+
+   if (   !netplay_send(&connection->send_packet_buffer,
+            connection->fd, header,
+            sizeof(header))
+       || !netplay_send(&connection->send_packet_buffer,
+          connection->fd,
+          netplay->zbuffer, wn))
+   {
+      netplay_hangup(netplay, connection);
+      return true;
+   }
+
+   /* The peer applies the patch to its own copy the same way. */
+   memcpy(connection->ref_state, netplay->delta_state, netplay->state_size);
+
+   connection->savestate_delta_bytes += sizeof(header) + wn;
+   RARCH_LOG("[Netplay] Sent savestate to %s as a %u byte delta "
+         "(%llu bytes whole, %llu bytes as deltas so far).\n",
+         connection->nick, (unsigned)(sizeof(header) + wn),
+         (unsigned long long)connection->savestate_full_bytes,
+         (unsigned long long)connection->savestate_delta_bytes);
+
+   return true;
+}
+
 /**
  * netplay_send_savestate
  * @netplay              : pointer to netplay object
@@ -7322,7 +7787,8 @@ failure:
  * @z                    : compression backend to use
  *
  * Send a loaded savestate to those connected peers using the given compression
- * scheme.
+ * scheme. Peers that hold an earlier savestate get a delta against it where
+ * possible.
  */
 static void netplay_send_savestate(netplay_t *netplay,
    retro_ctx_serialize_info_t *serial_info, uint32_t cx,
@@ -7331,27 +7797,28 @@ static void netplay_send_savestate(netplay_t *netplay,
    uint32_t header[4];
    uint32_t rd, wn;
    size_t i;
+   bool compressed = false;
+   bool can_delta  = (serial_info->size == netplay->state_size)
+      && netplay->delta_patch;
 
-   /* Compress it */
-   z->compression_backend->set_in(z->compression_stream,
-      (const uint8_t*)serial_info->data_const, (uint32_t)serial_info->size);
-   z->compression_backend->set_out(z->compression_stream,
-      netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
-   if (!z->compression_backend->trans(z->compression_stream, true, &rd,
-         &wn, NULL))
+   if (can_delta)
    {
-      /* Catastrophe! */
       for (i = 0; i < netplay->connections_size; i++)
-         netplay_hangup(netplay, &netplay->connections[i]);
-      return;
-   }
+      {
+         struct netplay_connection *connection = &netplay->connections[i];
+         if (  (!(connection->flags & NETPLAY_CONN_FLAG_ACTIVE))
+             || (!(connection->flags & NETPLAY_CONN_FLAG_REF_STATE))
+             ||  (connection->mode  < NETPLAY_CONNECTION_CONNECTED)
+             ||  (connection->compression_supported != cx))
+            continue;
 
-   /* Send it to relevant peers */
-   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE);
-   header[1] = htonl(wn + 2*sizeof(uint32_t));
-   header[2] = htonl(netplay->run_frame_count);
-   header[3] = htonl(serial_info->size);
+         if (!netplay_send_savestate_delta(netplay, connection,
+               serial_info, z))
+            connection->flags &= ~NETPLAY_CONN_FLAG_REF_STATE;
+      }
+   }
 
+   /* Send it whole to the rest */
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -7360,13 +7827,63 @@ static void netplay_send_savestate(netplay_t *netplay,
           ||  (connection->compression_supported != cx))
          continue;
 
+      if (connection->flags & NETPLAY_CONN_FLAG_REF_STATE)
+      {
+         if (can_delta)
+            continue;
+         connection->flags &= ~NETPLAY_CONN_FLAG_REF_STATE;
+      }
+
+      if (!compressed)
+      {
+         /* Compress it */
+         z->compression_backend->set_in(z->compression_stream,
+            (const uint8_t*)serial_info->data_const,
+            (uint32_t)serial_info->size);
+         z->compression_backend->set_out(z->compression_stream,
+            netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+         if (!z->compression_backend->trans(z->compression_stream, true, &rd,
+               &wn, NULL))
+         {
+            /* Catastrophe! */
+            for (i = 0; i < netplay->connections_size; i++)
+               netplay_hangup(netplay, &netplay->connections[i]);
+            return;
+         }
+
+         header[0]  = htonl(NETPLAY_CMD_LOAD_SAVESTATE);
+         header[1]  = htonl(wn + 2*sizeof(uint32_t));
+         header[2]  = htonl(netplay->run_frame_count);
+         header[3]  = htonl(serial_info->size);
+         compressed = true;
+      }
+
       if (   !netplay_send(&connection->send_packet_buffer,
                connection->fd, header,
                sizeof(header))
           || !netplay_send(&connection->send_packet_buffer,
              connection->fd,
              netplay->zbuffer, wn))
+      {
          netplay_hangup(netplay, connection);
+         continue;
+      }
+
+      connection->savestate_full_bytes += sizeof(header) + wn;
+
+      /* Later savestates can be sent as deltas against this one. */
+      if (can_delta && connection->netplay_protocol >= 7)
+      {
+         if (!connection->ref_state)
+            connection->ref_state = (uint8_t*)state_manager_raw_alloc(
+                  netplay->state_size, 0);
+         if (connection->ref_state)
+         {
+            memcpy(connection->ref_state, serial_info->data_const,
+                  netplay->state_size);
+            connection->flags |= NETPLAY_CONN_FLAG_REF_STATE;
+         }
+      }
    }
 }
 
@@ -7441,6 +7958,7 @@ static void netplay_force_future(netplay_t *netplay)
    /* Wherever we're inputting, that's where we consider our state to be loaded */
    netplay->run_ptr         = netplay->self_ptr;
    netplay->run_frame_count = netplay->self_frame_count;
+   netplay->replay_pending  = false;
 
    /* We need to ignore any intervening data from the other side,
     * and never rewind past this */
@@ -9525,7 +10043,7 @@ static void netplay_send_cmd_netpacket(netplay_t *netplay, size_t conn_idx,
    cmdbuf[2] = htonl(pkt_client_id);
 
    sbuf = &connection->send_packet_buffer;
-   need_flush = (buf_remaining(sbuf) < sizeof(cmdbuf)+len);
+   need_flush = (netplay_buf_remaining(sbuf) < sizeof(cmdbuf)+len);
 
    if (     (need_flush && !netplay_send_flush(sbuf, connection->fd, true))
          || (!netplay_send(sbuf, connection->fd, cmdbuf, sizeof(cmdbuf)))
@@ -9728,6 +10246,8 @@ static void gfx_widget_netplay_ping_iterate(void *user_data,
 #endif
    bool show_ping               = settings->bools.netplay_ping_show;
 
+   net_st->latest_replay_depth  = -1;
+
    if (!netplay || !show_ping)
    {
       net_st->latest_ping       = -1;
@@ -9748,17 +10268,27 @@ static void gfx_widget_netplay_ping_iterate(void *user_data,
       net_st->latest_ping       = netplay->connections[0].ping;
    else
       net_st->latest_ping       = -1;
+
+   /* Rollback replays, whenever there's anyone to sync with */
+   if (     netplay->modus == NETPLAY_MODUS_INPUT_FRAME_SYNC
+         && netplay->self_mode >= NETPLAY_CONNECTION_CONNECTED
+         && (!netplay->is_server || netplay->connected_players > 1))
+   {
+      net_st->latest_replay_depth = (int)netplay->replay_depth_shown;
+      net_st->latest_replay_cost  = (int)netplay->replay_cost_shown;
+   }
 }
 
 static void gfx_widget_netplay_ping_frame(void *data, void *userdata)
 {
    net_driver_state_t *net_st = &networking_driver_st;
    int ping                   = net_st->latest_ping;
+   int replay_depth           = net_st->latest_replay_depth;
 
-   if (ping >= 0)
+   if (ping >= 0 || replay_depth >= 0)
    {
-      char ping_str[16];
-      size_t ping_len;
+      char ping_str[64];
+      size_t ping_len = 0;
       int ping_width, total_width;
       video_frame_info_t     *video_info   = (video_frame_info_t*)data;
       dispgfx_widget_t       *p_dispwidget = (dispgfx_widget_t*)userdata;
@@ -9771,8 +10301,19 @@ static void gfx_widget_netplay_ping_frame(void *data, void *userdata)
       if (ping > 999)
          ping     = 999;
 
-      ping_len    = (size_t)snprintf(ping_str,
-            sizeof(ping_str), "PING: %d", ping);
+      if (ping >= 0)
+         ping_len = (size_t)snprintf(ping_str,
+               sizeof(ping_str), "PING: %d", ping);
+
+      /* Replay depth in frames, and cost in ms */
+      if (replay_depth >= 0)
+      {
+         int replay_cost = net_st->latest_replay_cost / 100;
+         ping_len   += (size_t)snprintf(ping_str + ping_len,
+               sizeof(ping_str) - ping_len, "%sROLLBACK: %d (%d.%d ms)",
+               ping_len ? "  " : "", replay_depth,
+               replay_cost / 10, replay_cost % 10);
+      }
 
       ping_width  = font_driver_get_message_width(
          font->font, ping_str, ping_len, 1.0f);
@@ -59,9 +59,19 @@
 
 #define NETPLAY_MAX_STALL_FRAMES        60
 #define NETPLAY_FRAME_RUN_TIME_WINDOW   120
+
+/* Minimum number of frames replayed per frame when a replay is spread out,
+ * so that it gains on the frames run in the meantime */
+#define NETPLAY_REPLAY_MIN_FRAMES       2
+
+/* Period over which replay statistics are gathered */
+#define NETPLAY_REPLAY_STATS_PERIOD     1000000
 #define NETPLAY_MAX_REQ_STALL_TIME      60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
 
+/* Granularity of state hashing and partial resyncs (protocol 7+) */
+#define NETPLAY_STATE_BLOCK_SIZE        4096
+
 #define PREV_PTR(x) ((x) == 0 ? netplay->buffer_size - 1 : (x) - 1)
 #define NEXT_PTR(x) ((x + 1) % netplay->buffer_size)
 
@@ -165,6 +175,16 @@ enum netplay_cmd
    /* Send a network packet from the raw packet core interface */
    NETPLAY_CMD_NETPACKET      = 0x0048,
 
+   /* Send our per-block state hashes for a frame whose hash mismatched,
+    * asking for the blocks that differ */
+   NETPLAY_CMD_REQUEST_SAVESTATE_BLOCKS = 0x0049,
+
+   /* Send the differing blocks of a frame's state */
+   NETPLAY_CMD_LOAD_SAVESTATE_BLOCKS    = 0x004A,
+
+   /* Send a savestate as a patch against the last one transferred */
+   NETPLAY_CMD_LOAD_SAVESTATE_DELTA     = 0x004B,
+
    /* Misc. commands */
 
    /* Sends multiple config requests over,
@@ -322,7 +342,8 @@ struct delta_frame
 
    uint32_t frame;
 
-   /* The CRC-32 of the serialized state if we've calculated it, else 0 */
+   /* The hash of the serialized state if we've calculated it, else 0.
+    * CRC-32 up to protocol 6, a hash of the per-block hashes after. */
    uint32_t crc;
 
    /* Have we read local input? */
@@ -364,7 +385,9 @@ enum netplay_connection_flags
    /* Is this connection allowed to play (server only)? */
    NETPLAY_CONN_FLAG_CAN_PLAY       = (1 << 2),
    /* Did we request a ping response? */
-   NETPLAY_CONN_FLAG_PING_REQUESTED = (1 << 3)
+   NETPLAY_CONN_FLAG_PING_REQUESTED = (1 << 3),
+   /* Do both sides hold ref_state? */
+   NETPLAY_CONN_FLAG_REF_STATE      = (1 << 4)
 };
 
 /* Each connection gets a connection struct */
@@ -376,6 +399,14 @@ struct netplay_connection
    /* Connection's address */
    netplay_address_t addr;
 
+   /* Savestate bytes sent to this peer, whole and as patches */
+   uint64_t savestate_full_bytes;
+   uint64_t savestate_delta_bytes;
+
+   /* The last savestate transferred over this connection,
+    * which savestate deltas are made against */
+   uint8_t *ref_state;
+
    /* Buffers for sending and receiving data */
    struct socket_buffer send_packet_buffer;
    struct socket_buffer recv_packet_buffer;
@@ -434,6 +465,12 @@ struct compression_transcoder
    void *decompression_stream;
 };
 
+/* MITM magics */
+#define MITM_SESSION_MAGIC 0x52415453 /* RATS */
+#define MITM_LINK_MAGIC    0x5241544C /* RATL */
+#define MITM_ADDR_MAGIC    0x52415441 /* RATA */
+#define MITM_PING_MAGIC    0x52415450 /* RATP */
+
 typedef struct mitm_id
 {
    uint32_t magic;
@@ -488,6 +525,17 @@ struct netplay
    retro_time_t frame_run_time_sum;
    retro_time_t frame_run_time_avg;
 
+   /* Time a replay may take per frame before the rest
+    * is left for later frames, or 0 for no limit */
+   retro_time_t replay_budget;
+
+   /* Replay statistics: the deepest replay and the most time
+    * spent replaying in one frame, over the current and the last
+    * NETPLAY_REPLAY_STATS_PERIOD */
+   retro_time_t replay_stats_start;
+   retro_time_t replay_cost_peak;
+   retro_time_t replay_cost_shown;
+
    /* When did we start falling behind? */
    retro_time_t catch_up_time;
    /* How long have we been stalled? */
@@ -522,6 +570,20 @@ struct netplay
    /* A buffer into which to compress frames for transfer */
    uint8_t *zbuffer;
 
+   /* The running state, kept while part of a replay is done */
+   uint8_t *replay_live_state;
+
+   /* Per-block hashes of the most recently hashed state */
+   uint64_t *block_hashes;
+   /* Indices of differing blocks, and those blocks gathered together */
+   uint32_t *block_list;
+   uint8_t *block_buffer;
+
+   /* Copy of the state being sent as a delta,
+    * and the uncompressed patch */
+   uint8_t *delta_state;
+   uint8_t *delta_patch;
+
    size_t connections_size;
    size_t buffer_size;
    size_t zbuffer_size;
@@ -529,6 +591,10 @@ struct netplay
    size_t packet_buffer_size;
    /* Size of savestates */
    size_t state_size;
+   /* Number of NETPLAY_STATE_BLOCK_SIZE blocks in a savestate */
+   size_t block_count;
+   /* Size of delta_patch */
+   size_t delta_patch_size;
 
    /* The frame we're currently inputting */
    size_t self_ptr;
@@ -590,6 +656,9 @@ struct netplay
    uint32_t read_frame_count[MAX_CLIENTS];
    uint32_t server_frame_count;
    uint32_t replay_frame_count;
+   uint32_t replay_pending_frame_count;
+   uint32_t replay_depth_peak;
+   uint32_t replay_depth_shown;
 
    /* Frequency with which to check CRCs */
    uint32_t check_frames;
@@ -663,6 +732,11 @@ struct netplay
    /* Are we replaying old frames? */
    bool is_replay;
 
+   /* Is a replay spread over several frames still running?
+    * If so, states from replay_pending_frame_count on
+    * are still predicted ones. */
+   bool replay_pending;
+
    /* Opposite of stalling, should we be catching up? */
    bool catch_up;
 
@@ -695,6 +769,53 @@ int16_t input_state_net(unsigned port, unsigned device,
  * NETPLAY-BUF.C
  **************************************************************/
 
+/**
+ * netplay_init_socket_buffer
+ *
+ * Initialize a new socket buffer.
+ */
+bool netplay_init_socket_buffer(struct socket_buffer *sbuf, size_t size);
+
+/**
+ * netplay_deinit_socket_buffer
+ *
+ * Free a socket buffer.
+ */
+void netplay_deinit_socket_buffer(struct socket_buffer *sbuf);
+
+/**
+ * netplay_resize_socket_buffer
+ *
+ * Grow or shrink a socket buffer, keeping any data
+ * that is still queued in it.
+ */
+bool netplay_resize_socket_buffer(
+      struct socket_buffer *sbuf, size_t newsize);
+
+/**
+ * netplay_buf_used
+ *
+ * Returns the number of bytes queued in the buffer
+ * that have not been flushed yet.
+ */
+size_t netplay_buf_used(struct socket_buffer *sbuf);
+
+/**
+ * netplay_buf_unread
+ *
+ * Returns the number of bytes received into the buffer
+ * that have not been read yet.
+ */
+size_t netplay_buf_unread(struct socket_buffer *sbuf);
+
+/**
+ * netplay_buf_remaining
+ *
+ * Returns the number of bytes that can still be queued
+ * in the buffer without overwriting unflushed data.
+ */
+size_t netplay_buf_remaining(struct socket_buffer *sbuf);
+
 /**
  * netplay_send
  *
@@ -19,7 +19,7 @@
 #define __RARCH_NETPLAY_PROTOCOL_H
 
 #define LOW_NETPLAY_PROTOCOL_VERSION  5
-#define HIGH_NETPLAY_PROTOCOL_VERSION 6
+#define HIGH_NETPLAY_PROTOCOL_VERSION 7
 
 #define NETPLAY_PROTOCOL_VERSION HIGH_NETPLAY_PROTOCOL_VERSION
 
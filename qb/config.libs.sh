@@ -171,9 +171,11 @@ check_pkgconf LIBCHECK check 0.15
 
 if [ "$OS" = 'Linux' ]; then
    check_header '' CDROM sys/ioctl.h scsi/sg.h
+   check_header '' IO_URING linux/io_uring.h
 fi
 
 check_platform 'Linux Win32' CDROM 'CD-ROM is' user
+check_platform Linux IO_URING 'io_uring is' user
 
 if [ "$OS" = 'Win32' ]; then
    add_opt DYLIB yes
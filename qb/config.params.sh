@@ -33,6 +33,7 @@ HAVE_XAUDIO=auto           # XAudio support
 HAVE_WASAPI=auto           # WASAPI support
 HAVE_WINMM=auto            # WinMM support
 HAVE_NEAREST_RESAMPLER=yes # Nearest resampler
+HAVE_POLYPHASE_RESAMPLER=yes # Polyphase resampler
 HAVE_CC_RESAMPLER=yes      # CC Resampler
 HAVE_SSL=auto              # SSL support
 C89_SSL=no
@@ -151,6 +152,7 @@ HAVE_PRESERVE_DYLIB=no     # Enable dlclose() for Valgrind support
 HAVE_PARPORT=auto          # Parallel port joypad support
 HAVE_IMAGEVIEWER=yes       # Built-in image viewer support.
 HAVE_MMAP=auto             # MMAP support
+HAVE_IO_URING=auto         # io_uring file I/O support (Linux)
 HAVE_QT=auto               # Qt companion support
 C89_QT=no
 HAVE_XSHM=no               # XShm video driver support
@@ -0,0 +1,175 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include <retro_inline.h>
+
+#include "rcap_codec.h"
+
+/* Zero runs shorter than this are cheaper to store as literals. */
+#define RCAP_ZRLE_MIN_RUN 8
+/* Longest varint for a size_t. */
+#define RCAP_VARINT_MAX   10
+
+static INLINE uint64_t rcap_load64(const uint8_t *p)
+{
+   uint64_t v;
+   memcpy(&v, p, sizeof(v));
+   return v;
+}
+
+/* Returns the first position from @pos on where @cur and @prev differ. */
+static size_t rcap_skip_equal(const uint8_t *cur, const uint8_t *prev,
+      size_t pos, size_t size)
+{
+   if (prev)
+   {
+      while (pos + 8 <= size && rcap_load64(cur + pos) == rcap_load64(prev + pos))
+         pos += 8;
+      while (pos < size && cur[pos] == prev[pos])
+         pos++;
+   }
+   else
+   {
+      while (pos + 8 <= size && !rcap_load64(cur + pos))
+         pos += 8;
+      while (pos < size && !cur[pos])
+         pos++;
+   }
+   return pos;
+}
+
+/* Returns the first position from @pos on where @cur and @prev are equal. */
+static size_t rcap_skip_diff(const uint8_t *cur, const uint8_t *prev,
+      size_t pos, size_t size)
+{
+   if (prev)
+      while (pos < size && cur[pos] != prev[pos])
+         pos++;
+   else
+      while (pos < size && cur[pos])
+         pos++;
+   return pos;
+}
+
+static INLINE uint8_t *rcap_put_varint(uint8_t *out, size_t v)
+{
+   while (v >= 0x80)
+   {
+      *out++ = (uint8_t)(v | 0x80);
+      v    >>= 7;
+   }
+   *out++ = (uint8_t)v;
+   return out;
+}
+
+static INLINE const uint8_t *rcap_get_varint(const uint8_t *in,
+      const uint8_t *end, size_t *v)
+{
+   unsigned shift = 0;
+
+   *v = 0;
+   while (in < end && shift < 7 * RCAP_VARINT_MAX)
+   {
+      uint8_t b = *in++;
+      *v       |= (size_t)(b & 0x7f) << shift;
+      if (!(b & 0x80))
+         return in;
+      shift    += 7;
+   }
+   return NULL;
+}
+
+size_t rcap_zrle_bound(size_t size)
+{
+   /* Every operation but the first skips at least RCAP_ZRLE_MIN_RUN bytes. */
+   return size + (size / RCAP_ZRLE_MIN_RUN + 1) * 2 * RCAP_VARINT_MAX;
+}
+
+size_t rcap_zrle_encode(const uint8_t *cur, const uint8_t *prev,
+      size_t size, uint8_t *out)
+{
+   uint8_t *o = out;
+   size_t pos = 0;
+
+   while (pos < size)
+   {
+      size_t i;
+      size_t zero_start = pos;
+      size_t lit_start;
+
+      pos       = rcap_skip_equal(cur, prev, pos, size);
+      lit_start = pos;
+
+      /* Extend the literals over short zero runs. */
+      while (pos < size)
+      {
+         size_t next;
+
+         pos  = rcap_skip_diff(cur, prev, pos, size);
+         if (pos >= size)
+            break;
+         next = rcap_skip_equal(cur, prev, pos, size);
+         if (next - pos >= RCAP_ZRLE_MIN_RUN || next >= size)
+            break;
+         pos  = next;
+      }
+
+      o = rcap_put_varint(o, lit_start - zero_start);
+      o = rcap_put_varint(o, pos - lit_start);
+
+      if (prev)
+         for (i = lit_start; i < pos; i++)
+            *o++ = cur[i] ^ prev[i];
+      else
+      {
+         memcpy(o, cur + lit_start, pos - lit_start);
+         o += pos - lit_start;
+      }
+   }
+
+   return (size_t)(o - out);
+}
+
+bool rcap_zrle_decode(const uint8_t *in, size_t in_size,
+      uint8_t *pic, size_t size)
+{
+   const uint8_t *end = in + in_size;
+   size_t pos         = 0;
+
+   while (in < end)
+   {
+      size_t i, zeroes, lits;
+
+      if (     !(in = rcap_get_varint(in, end, &zeroes))
+            || !(in = rcap_get_varint(in, end, &lits)))
+         return false;
+
+      if (     zeroes > size - pos
+            || lits   > size - pos - zeroes
+            || lits   > (size_t)(end - in))
+         return false;
+
+      pos += zeroes;
+      for (i = 0; i < lits; i++)
+         pic[pos + i] ^= in[i];
+      pos += lits;
+      in  += lits;
+   }
+
+   return true;
+}
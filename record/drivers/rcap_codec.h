@@ -0,0 +1,159 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RCAP_CODEC_H
+#define __RCAP_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_inline.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* RCAP is the capture format written by the "rcap" record driver.
+ * All fields are little-endian.
+ *
+ * The file starts with a RCAP_HEADER_SIZE byte header:
+ *   0  "RCAP"
+ *   4  u32 version (RCAP_VERSION)
+ *   8  u32 pixel format (enum ffemu_pix_format)
+ *   12 u32 flags (RCAP_FLAG_*)
+ *   16 u32 frames per second * 1000
+ *   20 u32 audio sample rate * 1000
+ *   24 u32 audio channels; samples are signed 16-bit, interleaved
+ *   28 u32 aspect ratio * 10000
+ *   32 u64 offset of the index chunk, 0 if the recording was cut short
+ *   40 u32 frames between keyframes
+ *   44 u32 reserved
+ *
+ * followed by chunks, each with a RCAP_CHUNK_HEADER_SIZE byte header:
+ *   0  tag
+ *   4  u32 payload size, not counting this header
+ *   8  u32 video: frame number, audio: sample frames
+ *   12 u32 codec (enum rcap_codec)
+ *   16 u32 size of the decoded picture or samples
+ *
+ * Video chunks (RCAP_TAG_KEYFRAME, RCAP_TAG_DELTA) start with u32 width
+ * and u32 height, followed by the encoded picture. Pictures are packed,
+ * with a pitch of width * pixel size, in the byte order of the host that
+ * recorded them (see RCAP_FLAG_BIG_ENDIAN).
+ * A keyframe encodes the picture itself, a delta encodes the picture
+ * XORed with the previous one, which must have had the same size.
+ * RCAP_TAG_DUPE repeats the previous picture and has no payload.
+ * RCAP_TAG_AUDIO holds raw samples.
+ *
+ * RCAP_TAG_INDEX is written last and lists every keyframe as
+ *   0  u32 frame number
+ *   4  u32 reserved
+ *   8  u64 offset of the keyframe chunk
+ *   16 u64 audio sample frames recorded before it
+ */
+#define RCAP_VERSION            1
+#define RCAP_HEADER_SIZE        48
+#define RCAP_CHUNK_HEADER_SIZE  20
+#define RCAP_INDEX_ENTRY_SIZE   24
+
+#define RCAP_TAG_KEYFRAME       "VKEY"
+#define RCAP_TAG_DELTA          "VDLT"
+#define RCAP_TAG_DUPE           "VDUP"
+#define RCAP_TAG_AUDIO          "AUDS"
+#define RCAP_TAG_INDEX          "INDX"
+
+enum rcap_flags
+{
+   RCAP_FLAG_BIG_ENDIAN = (1 << 0)
+};
+
+enum rcap_codec
+{
+   /* Stored as is. */
+   RCAP_CODEC_RAW = 0,
+   /* Runs of zero bytes, see rcap_zrle_encode(). */
+   RCAP_CODEC_ZRLE,
+   /* Zero-run output, deflated. */
+   RCAP_CODEC_ZRLE_DEFLATE
+};
+
+static INLINE void rcap_put_le32(uint8_t *p, uint32_t v)
+{
+   p[0] = (uint8_t)(v);
+   p[1] = (uint8_t)(v >>  8);
+   p[2] = (uint8_t)(v >> 16);
+   p[3] = (uint8_t)(v >> 24);
+}
+
+static INLINE void rcap_put_le64(uint8_t *p, uint64_t v)
+{
+   rcap_put_le32(p,     (uint32_t)v);
+   rcap_put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static INLINE uint32_t rcap_get_le32(const uint8_t *p)
+{
+   return (uint32_t)p[0]        | ((uint32_t)p[1] << 8)
+       | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static INLINE uint64_t rcap_get_le64(const uint8_t *p)
+{
+   return rcap_get_le32(p) | ((uint64_t)rcap_get_le32(p + 4) << 32);
+}
+
+/**
+ * rcap_zrle_bound:
+ * @size              : bytes to encode.
+ *
+ * Returns: largest possible output of rcap_zrle_encode() for @size bytes.
+ **/
+size_t rcap_zrle_bound(size_t size);
+
+/**
+ * rcap_zrle_encode:
+ * @cur               : picture to encode.
+ * @prev              : picture to XOR @cur with, or NULL for a keyframe.
+ * @size              : size of both pictures in bytes.
+ * @out               : output buffer of at least rcap_zrle_bound(@size) bytes.
+ *
+ * Encodes @cur XOR @prev as a list of operations, each a varint count
+ * of zero bytes, a varint count of literal bytes and the literals.
+ * Zero runs shorter than a few bytes are kept in the literals.
+ *
+ * Returns: bytes written to @out.
+ **/
+size_t rcap_zrle_encode(const uint8_t *cur, const uint8_t *prev,
+      size_t size, uint8_t *out);
+
+/**
+ * rcap_zrle_decode:
+ * @in                : encoded data.
+ * @in_size           : size of @in.
+ * @pic               : picture to apply the data to; the previous one
+ *                      for a delta, zeroes for a keyframe.
+ * @size              : size of @pic in bytes.
+ *
+ * XORs the data encoded by rcap_zrle_encode() into @pic.
+ *
+ * Returns: false if @in is malformed.
+ **/
+bool rcap_zrle_decode(const uint8_t *in, size_t in_size,
+      uint8_t *pic, size_t size);
+
+RETRO_END_DECLS
+
+#endif
@@ -0,0 +1,428 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_endianness.h>
+#include <streams/file_stream.h>
+#ifdef HAVE_ZLIB
+#include <streams/trans_stream.h>
+#endif
+
+#include "rcap_codec.h"
+#include "record_rcap.h"
+#include "../../verbosity.h"
+
+/* Seconds between keyframes, the granularity of seeking. */
+#define RCAP_KEYFRAME_SECONDS 5
+/* zlib's fastest level; keyframes only, deltas are mostly zero runs. */
+#define RCAP_DEFLATE_LEVEL    1
+
+/** Our private context related to a single recording. */
+typedef struct
+{
+   RFILE *file;
+   uint8_t *cur;           /**< Packed picture being recorded. */
+   uint8_t *prev;          /**< Packed picture recorded last. */
+   uint8_t *enc;           /**< Encoded picture. */
+   uint8_t *index;         /**< Index entries, as written to the file. */
+#ifdef HAVE_ZLIB
+   const struct trans_stream_backend *deflate_backend;
+   void *deflate_stream;
+   uint8_t *deflated;      /**< Deflated keyframe. */
+#endif
+   size_t pic_size;        /**< Capacity of cur and prev. */
+   size_t enc_size;        /**< Capacity of enc and deflated. */
+   size_t index_count;
+   size_t index_cap;
+   uint64_t audio_frames;  /**< Sample frames recorded so far. */
+   uint32_t frame;         /**< Video frames recorded so far. */
+   unsigned pix_size;
+   unsigned channels;
+   unsigned prev_width;    /**< Size of prev; 0 if there is none. */
+   unsigned prev_height;
+   unsigned keyframe_interval;
+   unsigned since_keyframe;
+   bool failed;
+} record_rcap_t;
+
+/**************************************/
+
+static bool rcap_write(record_rcap_t *handle, const void *data, size_t len)
+{
+   if (handle->failed)
+      return false;
+
+   if (filestream_write(handle->file, data, len) != (int64_t)len)
+   {
+      RARCH_ERR("[RCAP]: Cannot write to output file.\n");
+      handle->failed = true;
+      return false;
+   }
+   return true;
+}
+
+static bool rcap_write_chunk(record_rcap_t *handle, const char *tag,
+      uint32_t arg, enum rcap_codec codec, uint32_t decoded_size,
+      const void *prefix, size_t prefix_size,
+      const void *data, size_t size)
+{
+   uint8_t header[RCAP_CHUNK_HEADER_SIZE];
+
+   memcpy(header, tag, 4);
+   rcap_put_le32(header + 4,  (uint32_t)(prefix_size + size));
+   rcap_put_le32(header + 8,  arg);
+   rcap_put_le32(header + 12, codec);
+   rcap_put_le32(header + 16, decoded_size);
+
+   return rcap_write(handle, header, sizeof(header))
+      && (!prefix_size || rcap_write(handle, prefix, prefix_size))
+      && (!size        || rcap_write(handle, data, size));
+}
+
+static bool rcap_alloc_pictures(record_rcap_t *handle, size_t size)
+{
+   uint8_t *cur, *prev, *enc;
+   size_t enc_size = rcap_zrle_bound(size);
+
+   if (size <= handle->pic_size)
+      return true;
+
+   cur  = (uint8_t*)realloc(handle->cur, size);
+   if (cur)
+      handle->cur  = cur;
+   prev = (uint8_t*)realloc(handle->prev, size);
+   if (prev)
+      handle->prev = prev;
+   enc  = (uint8_t*)realloc(handle->enc, enc_size);
+   if (enc)
+      handle->enc  = enc;
+   if (!cur || !prev || !enc)
+      return false;
+
+#ifdef HAVE_ZLIB
+   if (handle->deflate_stream)
+   {
+      uint8_t *deflated = (uint8_t*)realloc(handle->deflated, enc_size);
+      if (!deflated)
+         return false;
+      handle->deflated  = deflated;
+   }
+#endif
+
+   handle->pic_size = size;
+   handle->enc_size = enc_size;
+   return true;
+}
+
+static bool rcap_add_index_entry(record_rcap_t *handle, int64_t offset)
+{
+   uint8_t *entry;
+
+   if (handle->index_count == handle->index_cap)
+   {
+      size_t cap     = handle->index_cap ? handle->index_cap * 2 : 256;
+      uint8_t *index = (uint8_t*)realloc(handle->index,
+            cap * RCAP_INDEX_ENTRY_SIZE);
+      if (!index)
+         return false;
+      handle->index     = index;
+      handle->index_cap = cap;
+   }
+
+   entry = handle->index + handle->index_count++ * RCAP_INDEX_ENTRY_SIZE;
+   rcap_put_le32(entry,      handle->frame);
+   rcap_put_le32(entry + 4,  0);
+   rcap_put_le64(entry + 8,  (uint64_t)offset);
+   rcap_put_le64(entry + 16, handle->audio_frames);
+   return true;
+}
+
+#ifdef HAVE_ZLIB
+/* Returns the deflated size of the encoded picture,
+ * or 0 if deflating does not make it smaller. */
+static size_t rcap_deflate(record_rcap_t *handle, size_t size)
+{
+   uint32_t rd = 0;
+   uint32_t wn = 0;
+
+   if (!handle->deflate_stream)
+      return 0;
+
+   handle->deflate_backend->set_in(handle->deflate_stream,
+         handle->enc, (uint32_t)size);
+   handle->deflate_backend->set_out(handle->deflate_stream,
+         handle->deflated, (uint32_t)handle->enc_size);
+
+   if (     !handle->deflate_backend->trans(handle->deflate_stream,
+            true, &rd, &wn, NULL)
+         || rd != size
+         || wn >= size)
+      return 0;
+   return wn;
+}
+#endif
+
+/**************************************/
+
+static void record_rcap_free(void *data)
+{
+   record_rcap_t *handle = (record_rcap_t*)data;
+   if (!handle)
+      return;
+
+   if (handle->file)
+      filestream_close(handle->file);
+#ifdef HAVE_ZLIB
+   if (handle->deflate_stream)
+      handle->deflate_backend->stream_free(handle->deflate_stream);
+   free(handle->deflated);
+#endif
+   free(handle->cur);
+   free(handle->prev);
+   free(handle->enc);
+   free(handle->index);
+   free(handle);
+}
+
+static void *record_rcap_new(const struct record_params *params)
+{
+   uint8_t header[RCAP_HEADER_SIZE] = {0};
+   uint32_t flags                   = 0;
+   record_rcap_t *handle            = (record_rcap_t*)
+      calloc(1, sizeof(*handle));
+
+   if (!handle)
+      return NULL;
+
+   switch (params->pix_fmt)
+   {
+      case FFEMU_PIX_RGB565:
+         handle->pix_size = 2;
+         break;
+      case FFEMU_PIX_BGR24:
+         handle->pix_size = 3;
+         break;
+      case FFEMU_PIX_ARGB8888:
+         handle->pix_size = 4;
+         break;
+      default:
+         goto error;
+   }
+
+   handle->channels          = params->channels;
+   handle->keyframe_interval = (unsigned)(params->fps * RCAP_KEYFRAME_SECONDS);
+   if (!handle->keyframe_interval)
+      handle->keyframe_interval = 1;
+
+#ifdef HAVE_ZLIB
+   handle->deflate_backend = trans_stream_get_zlib_deflate_backend();
+   if (     (handle->deflate_stream = handle->deflate_backend->stream_new())
+         && !handle->deflate_backend->define(handle->deflate_stream,
+            "level", RCAP_DEFLATE_LEVEL))
+   {
+      handle->deflate_backend->stream_free(handle->deflate_stream);
+      handle->deflate_stream = NULL;
+   }
+#endif
+
+   if (!rcap_alloc_pictures(handle, (size_t)params->fb_width
+            * params->fb_height * handle->pix_size))
+      goto error;
+
+   if (!(handle->file = filestream_open(params->filename,
+               RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+   {
+      RARCH_ERR("[RCAP]: Cannot create %s.\n", params->filename);
+      goto error;
+   }
+
+#if RETRO_IS_BIG_ENDIAN
+   flags |= RCAP_FLAG_BIG_ENDIAN;
+#endif
+
+   memcpy(header, "RCAP", 4);
+   rcap_put_le32(header + 4,  RCAP_VERSION);
+   rcap_put_le32(header + 8,  params->pix_fmt);
+   rcap_put_le32(header + 12, flags);
+   rcap_put_le32(header + 16, (uint32_t)(params->fps * 1000.0 + 0.5));
+   rcap_put_le32(header + 20, (uint32_t)(params->samplerate * 1000.0 + 0.5));
+   rcap_put_le32(header + 24, params->channels);
+   rcap_put_le32(header + 28, (uint32_t)(params->aspect_ratio * 10000.0f + 0.5f));
+   rcap_put_le32(header + 40, handle->keyframe_interval);
+
+   if (!rcap_write(handle, header, sizeof(header)))
+      goto error;
+
+   return handle;
+
+error:
+   record_rcap_free(handle);
+   return NULL;
+}
+
+static bool record_rcap_push_video(void *data,
+      const struct record_video_data *vid)
+{
+   unsigned y;
+   uint8_t size_prefix[8];
+   size_t size, enc_size;
+   int64_t offset;
+   bool keyframe;
+   const uint8_t *payload;
+   enum rcap_codec codec = RCAP_CODEC_ZRLE;
+   record_rcap_t *handle = (record_rcap_t*)data;
+
+   if (!handle || !vid || handle->failed)
+      return false;
+
+   if (vid->is_dupe || !vid->data)
+   {
+      if (!rcap_write_chunk(handle, RCAP_TAG_DUPE, handle->frame,
+               RCAP_CODEC_RAW, 0, NULL, 0, NULL, 0))
+         return false;
+      handle->frame++;
+      return true;
+   }
+
+   size = (size_t)vid->width * vid->height * handle->pix_size;
+   if (!rcap_alloc_pictures(handle, size))
+   {
+      handle->failed = true;
+      return false;
+   }
+
+   /* Tightly pack the frame, libretro tends to use a very large pitch. */
+   for (y = 0; y < vid->height; y++)
+      memcpy(handle->cur + y * vid->width * handle->pix_size,
+            (const uint8_t*)vid->data + (ptrdiff_t)y * vid->pitch,
+            vid->width * handle->pix_size);
+
+   keyframe = vid->width  != handle->prev_width
+      ||      vid->height != handle->prev_height
+      ||      handle->since_keyframe >= handle->keyframe_interval;
+
+   enc_size = rcap_zrle_encode(handle->cur,
+         keyframe ? NULL : handle->prev, size, handle->enc);
+   payload  = handle->enc;
+
+   if (keyframe)
+   {
+#ifdef HAVE_ZLIB
+      size_t deflated = rcap_deflate(handle, enc_size);
+      if (deflated)
+      {
+         codec    = RCAP_CODEC_ZRLE_DEFLATE;
+         payload  = handle->deflated;
+         enc_size = deflated;
+      }
+#endif
+      if (     (offset = filestream_tell(handle->file)) < 0
+            || !rcap_add_index_entry(handle, offset))
+      {
+         handle->failed = true;
+         return false;
+      }
+      handle->since_keyframe = 0;
+   }
+
+   rcap_put_le32(size_prefix,     vid->width);
+   rcap_put_le32(size_prefix + 4, vid->height);
+
+   if (!rcap_write_chunk(handle,
+            keyframe ? RCAP_TAG_KEYFRAME : RCAP_TAG_DELTA,
+            handle->frame, codec, (uint32_t)size,
+            size_prefix, sizeof(size_prefix), payload, enc_size))
+      return false;
+
+   /* The picture just recorded is the reference for the next one. */
+   {
+      uint8_t *tmp = handle->prev;
+      handle->prev = handle->cur;
+      handle->cur  = tmp;
+   }
+   handle->prev_width  = vid->width;
+   handle->prev_height = vid->height;
+   handle->since_keyframe++;
+   handle->frame++;
+   return true;
+}
+
+static bool record_rcap_push_audio(void *data,
+      const struct record_audio_data *audio_data)
+{
+   size_t size;
+   record_rcap_t *handle = (record_rcap_t*)data;
+
+   if (!handle || !audio_data || handle->failed)
+      return false;
+
+   if (!audio_data->frames)
+      return true;
+
+   size = audio_data->frames * handle->channels * sizeof(int16_t);
+   if (!rcap_write_chunk(handle, RCAP_TAG_AUDIO,
+            (uint32_t)audio_data->frames, RCAP_CODEC_RAW, (uint32_t)size,
+            NULL, 0, audio_data->data, size))
+      return false;
+
+   handle->audio_frames += audio_data->frames;
+   return true;
+}
+
+static bool record_rcap_finalize(void *data)
+{
+   int64_t offset;
+   uint8_t offset_buf[8];
+   record_rcap_t *handle = (record_rcap_t*)data;
+
+   if (!handle || !handle->file || handle->failed)
+      return false;
+
+   /* Without the index the file can still be read front to back. */
+   if (     (offset = filestream_tell(handle->file)) < 0
+         || !rcap_write_chunk(handle, RCAP_TAG_INDEX,
+            (uint32_t)handle->index_count, RCAP_CODEC_RAW,
+            (uint32_t)(handle->index_count * RCAP_INDEX_ENTRY_SIZE),
+            NULL, 0, handle->index,
+            handle->index_count * RCAP_INDEX_ENTRY_SIZE))
+      return false;
+
+   rcap_put_le64(offset_buf, (uint64_t)offset);
+   if (filestream_seek(handle->file, 32, RETRO_VFS_SEEK_POSITION_START) != 0
+         || !rcap_write(handle, offset_buf, sizeof(offset_buf)))
+      return false;
+
+   RARCH_LOG("[RCAP]: Recorded %u frames (%u keyframes), %" PRIu64
+         " audio frames.\n", handle->frame,
+         (unsigned)handle->index_count, handle->audio_frames);
+
+   filestream_close(handle->file);
+   handle->file = NULL;
+   return true;
+}
+
+const record_driver_t record_rcap = {
+   record_rcap_new,
+   record_rcap_free,
+   record_rcap_push_video,
+   record_rcap_push_audio,
+   record_rcap_finalize,
+   "rcap",
+};
@@ -33,6 +33,7 @@
 #include "record_driver.h"
 #include "drivers/record_ffmpeg.h"
 #include "drivers/record_wav.h"
+#include "drivers/record_rcap.h"
 
 static recording_state_t recording_state = {0};
 
@@ -50,6 +51,7 @@ const record_driver_t *record_drivers[] = {
    &record_ffmpeg,
 #endif
    &record_wav,
+   &record_rcap,
    &record_null,
    NULL,
 };
@@ -145,16 +147,34 @@ static void recording_driver_free_state(void)
  * @param params
  * Recording info parameters.
  *
- * Finds first suitable recording context driver and initializes.
+ * @param ident
+ * Name of the preferred recording driver.
+ *
+ * Initializes the recording driver named @ident, or if that fails,
+ * the first suitable one.
  *
  * @return true if successful, otherwise false.
  **/
 static bool record_driver_init_first(
       const record_driver_t **backend, void **data,
-      const struct record_params *params)
+      const char *ident, const struct record_params *params)
 {
    unsigned i;
 
+   for (i = 0; record_drivers[i]; i++)
+   {
+      void *handle = NULL;
+      if (     !record_drivers[i]->init
+            || !string_is_equal(record_drivers[i]->ident, ident))
+         continue;
+      if (!(handle = record_drivers[i]->init(params)))
+         break;
+
+      *backend = record_drivers[i];
+      *data    = handle;
+      return true;
+   }
+
    for (i = 0; record_drivers[i]; i++)
    {
       void *handle = NULL;
@@ -290,7 +310,15 @@ bool recording_init(void)
          if (string_is_empty(game_name))
             game_name          = runloop_st->system.info.library_name;
 
-         if (video_record_quality < RECORD_CONFIG_TYPE_RECORDING_WEBM_FAST)
+         /* The FFmpeg presets pick the container, other drivers have
+          * a format of their own. */
+         if (string_is_equal(settings->arrays.record_driver, "rcap"))
+         {
+            fill_str_dated_filename(buf, game_name,
+                     "rcap", sizeof(buf));
+            fill_pathname_join_special(output, recording_st->output_dir, buf, sizeof(output));
+         }
+         else if (video_record_quality < RECORD_CONFIG_TYPE_RECORDING_WEBM_FAST)
          {
             fill_str_dated_filename(buf, game_name,
                      "mkv", sizeof(buf));
@@ -450,7 +478,8 @@ bool recording_init(void)
 
    if (!record_driver_init_first(
             &recording_state.driver,
-            &recording_state.data, &params))
+            &recording_state.data,
+            settings->arrays.record_driver, &params))
    {
       RARCH_ERR("[Recording]: %s\n",
             msg_hash_to_str(MSG_FAILED_TO_START_RECORDING));
@@ -62,6 +62,7 @@
 #include <clamping.h>
 #include <string/stdstring.h>
 #include <dynamic/dylib.h>
+#include <file/archive_file.h>
 #include <file/config_file.h>
 #include <lists/string_list.h>
 #include <memalign.h>
@@ -5812,6 +5813,7 @@ void main_exit(void *args)
    frontend_driver_free();
 
    rtime_deinit();
+   file_archive_cache_deinit();
 
 #if defined(ANDROID)
    play_feature_delivery_deinit();
@@ -5866,6 +5868,7 @@ int rarch_main(int argc, char *argv[], void *data)
 #endif
 
    rtime_init();
+   file_archive_cache_init();
 
 #if defined(ANDROID)
    play_feature_delivery_init();
@@ -8155,6 +8158,10 @@ int retroarch_get_capabilities(enum rarch_capabilities type,
                _len += strlcpy(str_out + _len, "AVX ", str_len - _len);
             if (cpu & RETRO_SIMD_AVX2)
                _len += strlcpy(str_out + _len, "AVX2 ", str_len - _len);
+            if (cpu & RETRO_SIMD_FMA3)
+               _len += strlcpy(str_out + _len, "FMA3 ", str_len - _len);
+            if (cpu & RETRO_SIMD_AVX512F)
+               _len += strlcpy(str_out + _len, "AVX512F ", str_len - _len);
             if (cpu & RETRO_SIMD_NEON)
                _len += strlcpy(str_out + _len, "NEON ", str_len - _len);
             if (cpu & RETRO_SIMD_VFPV3)
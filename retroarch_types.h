@@ -319,6 +319,7 @@ typedef struct content_file_info
    size_t data_size;
    bool file_in_archive;
    bool persistent_data;
+   bool data_mapped;
 } content_file_info_t;
 
 typedef struct content_file_list
@@ -7151,6 +7151,11 @@ int runloop_iterate(void)
 #ifdef HAVE_PRESENCE
    presence_update(PRESENCE_GAME);
 #endif
+#ifdef HAVE_COMMAND
+   for (i = 0; i < (int)ARRAY_SIZE(input_st->command); i++)
+      if (input_st->command[i] && input_st->command[i]->num_subscriptions)
+         command_push_memory(input_st->command[i]);
+#endif
 
    /* Restores analog D-pad binds temporarily overridden. */
    for (i = 0; i < (int)max_users; i++)
@@ -19,6 +19,9 @@
 #include <string.h>
 #include <time.h>
 
+#include <retro_endianness.h>
+#include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
 #include <lists/string_list.h>
 #include <streams/interface_stream.h>
 #include <streams/file_stream.h>
@@ -52,6 +55,200 @@ struct ram_type
 
 static struct string_list *task_save_files = NULL;
 
+/* Compressed saves cannot be updated in place, so autosave
+ * appends the pages that changed to a journal next to the save
+ * file, and only recompresses the save once the journal has
+ * grown as large as the save file itself. The journal is
+ * replayed when the save is loaded, and deleted whenever the
+ * save file is rewritten.
+ *
+ * All fields are little-endian. The journal starts with
+ *   0  "RSJL"
+ *   4  u32 version (SRAM_JOURNAL_VERSION)
+ *   8  u64 size of the save data it applies to
+ *   16 u64 sram_hash() of that save data
+ * followed by one batch per autosave interval:
+ *   0  u32 number of runs
+ *   4  u32 size of the payload
+ *   8  u64 sram_hash() of the payload
+ * The payload lists each run as u32 offset, u32 size and the
+ * data. A batch is applied whole or not at all, so a journal
+ * write that was cut short leaves the save data as it was at
+ * the previous interval. */
+#define SRAM_JOURNAL_MAGIC       "RSJL"
+#define SRAM_JOURNAL_VERSION     1
+#define SRAM_JOURNAL_HEADER_SIZE 24
+#define SRAM_JOURNAL_BATCH_SIZE  16
+#define SRAM_JOURNAL_RUN_SIZE    8
+
+#define SRAM_HASH_SEED           0x9E3779B97F4A7C15ULL
+#define SRAM_HASH_PRIME          0xFF51AFD7ED558CCDULL
+
+/* Both the XOR and the multiplication by an odd constant are
+ * bijective in @h and in @w, so a change to a single word always
+ * changes the hash. */
+static INLINE uint64_t sram_hash_step(uint64_t h, uint64_t w)
+{
+   h = (h ^ w) * SRAM_HASH_PRIME;
+   return (h << 31) | (h >> 33);
+}
+
+/**
+ * sram_hash:
+ * @data            : data to hash.
+ * @len             : size of @data.
+ *
+ * Fast 64-bit hash used to detect changed SRAM pages,
+ * and to tie an autosave journal to the save it applies to.
+ * Hashes four interleaved streams of words so that the
+ * multiplications do not wait on each other.
+ *
+ * Returns: hash of @data.
+ **/
+static uint64_t sram_hash(const uint8_t *data, size_t len)
+{
+   uint64_t h0 = SRAM_HASH_SEED ^ (uint64_t)len;
+   uint64_t h1 = SRAM_HASH_SEED + 1;
+   uint64_t h2 = SRAM_HASH_SEED + 2;
+   uint64_t h3 = SRAM_HASH_SEED + 3;
+
+   for (; len >= 32; data += 32, len -= 32)
+   {
+      h0 = sram_hash_step(h0, retro_get_unaligned_64le((void*)(data     )));
+      h1 = sram_hash_step(h1, retro_get_unaligned_64le((void*)(data +  8)));
+      h2 = sram_hash_step(h2, retro_get_unaligned_64le((void*)(data + 16)));
+      h3 = sram_hash_step(h3, retro_get_unaligned_64le((void*)(data + 24)));
+   }
+
+   h0 = sram_hash_step(h0, h1);
+   h0 = sram_hash_step(h0, h2);
+   h0 = sram_hash_step(h0, h3);
+
+   for (; len >= 8; data += 8, len -= 8)
+      h0 = sram_hash_step(h0, retro_get_unaligned_64le((void*)data));
+
+   if (len)
+   {
+      uint64_t w = 0;
+      while (len--)
+         w = (w << 8) | data[len];
+      h0 = sram_hash_step(h0, w);
+   }
+
+   h0 ^= h0 >> 33;
+   h0 *= SRAM_HASH_PRIME;
+   h0 ^= h0 >> 33;
+   return h0;
+}
+
+static void sram_journal_path(char *s, const char *path, size_t len)
+{
+   strlcpy(s, path, len);
+   strlcat(s, FILE_PATH_SRM_JOURNAL_EXTENSION, len);
+}
+
+static void sram_journal_delete(const char *path)
+{
+   char journal_path[PATH_MAX_LENGTH];
+   sram_journal_path(journal_path, path, sizeof(journal_path));
+   if (path_is_valid(journal_path))
+      filestream_delete(journal_path);
+}
+
+/* Checks a journal batch, and applies it to @data if @apply is set. */
+static bool sram_journal_batch(const uint8_t *p, size_t len,
+      uint32_t runs, uint8_t *data, size_t size, bool apply)
+{
+   const uint8_t *end = p + len;
+
+   while (runs--)
+   {
+      uint32_t offset, run_size;
+
+      if ((size_t)(end - p) < SRAM_JOURNAL_RUN_SIZE)
+         return false;
+
+      offset   = retro_get_unaligned_32le((void*)p);
+      run_size = retro_get_unaligned_32le((void*)(p + 4));
+      p       += SRAM_JOURNAL_RUN_SIZE;
+
+      if (     offset   > size
+            || run_size > size - offset
+            || run_size > (size_t)(end - p))
+         return false;
+
+      if (apply)
+         memcpy(data + offset, p, run_size);
+      p       += run_size;
+   }
+
+   return p == end;
+}
+
+/**
+ * sram_journal_apply:
+ * @path            : path of the save file.
+ * @data            : save data as read from @path.
+ * @size            : size of @data.
+ *
+ * Replays the autosave journal of @path into @data, if there
+ * is one and it was written against this exact save data.
+ *
+ * Returns: number of batches applied.
+ **/
+static unsigned sram_journal_apply(const char *path,
+      uint8_t *data, size_t size)
+{
+   char journal_path[PATH_MAX_LENGTH];
+   int64_t len      = 0;
+   void *buf        = NULL;
+   unsigned batches = 0;
+   const uint8_t *p;
+   const uint8_t *end;
+
+   sram_journal_path(journal_path, path, sizeof(journal_path));
+
+   if (     !path_is_valid(journal_path)
+         || !filestream_read_file(journal_path, &buf, &len))
+      return 0;
+
+   p   = (const uint8_t*)buf;
+   end = p + len;
+
+   if (     len < SRAM_JOURNAL_HEADER_SIZE
+         || memcmp(p, SRAM_JOURNAL_MAGIC, 4)
+         || retro_get_unaligned_32le((void*)(p + 4))  != SRAM_JOURNAL_VERSION
+         || retro_get_unaligned_64le((void*)(p + 8))  != (uint64_t)size
+         || retro_get_unaligned_64le((void*)(p + 16)) != sram_hash(data, size))
+   {
+      RARCH_WARN("[SRAM]: Ignoring journal \"%s\" written for other save data.\n",
+            journal_path);
+      free(buf);
+      return 0;
+   }
+
+   for (p += SRAM_JOURNAL_HEADER_SIZE;
+         (size_t)(end - p) >= SRAM_JOURNAL_BATCH_SIZE; batches++)
+   {
+      const uint8_t *payload = p + SRAM_JOURNAL_BATCH_SIZE;
+      uint32_t runs          = retro_get_unaligned_32le((void*)p);
+      uint32_t payload_size  = retro_get_unaligned_32le((void*)(p + 4));
+
+      if (     payload_size > (size_t)(end - payload)
+            || retro_get_unaligned_64le((void*)(p + 8))
+               != sram_hash(payload, payload_size)
+            || !sram_journal_batch(payload, payload_size, runs,
+               data, size, false))
+         break;
+
+      sram_journal_batch(payload, payload_size, runs, data, size, true);
+      p = payload + payload_size;
+   }
+
+   free(buf);
+   return batches;
+}
+
 #ifdef HAVE_THREADS
 typedef struct autosave autosave_t;
 
@@ -62,6 +259,9 @@ struct autosave_st
    unsigned num;
 };
 
+/* Granularity of change detection and of in-place updates. */
+#define AUTOSAVE_PAGE_SIZE 4096
+
 enum autosave_flags
 {
    AUTOSAVE_FLAG_QUIT           = (1 << 0),
@@ -74,16 +274,288 @@ struct autosave
    const void *retro_buffer;
    const char *path;
    slock_t *lock;
+   slock_t *write_lock;     /* Held while the save file is written */
    slock_t *cond_lock;
    scond_t *cond;
    sthread_t *thread;
+   uint64_t *page_hash;
+   uint8_t *page_dirty;
+   retro_time_t start_time;
+   uint64_t base_hash;      /* sram_hash() of the save file contents */
+   uint64_t bytes_written;
+   uint64_t bytes_full;     /* What rewriting the whole file would cost */
    size_t bufsize;
+   size_t num_pages;
+   size_t dirty_pages;
+   size_t base_size;        /* Size of the (compressed) save file */
+   size_t journal_size;     /* 0 if there is no journal */
    unsigned interval;
+   unsigned writes;
    uint8_t flags;
+   /* The save file matches the buffer apart from the dirty
+    * pages, so they can be written on their own. Only changed
+    * with write_lock held, by the autosave thread and by
+    * content_save_ram_file(). */
+   bool synced;
 };
 
 static struct autosave_st autosave_state;
 
+/**
+ * autosave_write_file:
+ * @save            : pointer to autosave object
+ *
+ * Rewrites the whole save file, replacing any journal.
+ * Compressed saves are written to a temporary file first
+ * and renamed over the old one, so that the save file is
+ * never left half written.
+ *
+ * Returns: bytes written, 0 on failure.
+ **/
+static size_t autosave_write_file(autosave_t *save)
+{
+   int32_t size;
+#if defined(HAVE_ZLIB)
+   if (save->flags & AUTOSAVE_FLAG_COMPRESS_FILES)
+   {
+      char tmp_path[PATH_MAX_LENGTH];
+      strlcpy(tmp_path, save->path, sizeof(tmp_path));
+      strlcat(tmp_path, FILE_PATH_TMP_EXTENSION, sizeof(tmp_path));
+
+      if (!rzipstream_write_file(tmp_path, save->buffer, save->bufsize))
+         return 0;
+
+      /* Renaming over an existing file fails on some platforms. */
+      if (filestream_rename(tmp_path, save->path) != 0)
+      {
+         filestream_delete(save->path);
+         if (filestream_rename(tmp_path, save->path) != 0)
+         {
+            filestream_delete(tmp_path);
+            return 0;
+         }
+      }
+   }
+   else
+#endif
+   if (!filestream_write_file(save->path, save->buffer, save->bufsize))
+      return 0;
+
+   sram_journal_delete(save->path);
+
+   size               = path_get_size(save->path);
+   save->base_size    = (size > 0) ? (size_t)size : save->bufsize;
+   save->base_hash    = sram_hash((const uint8_t*)save->buffer, save->bufsize);
+   save->journal_size = 0;
+   save->synced       = true;
+
+   return save->base_size;
+}
+
+/**
+ * autosave_write_pages:
+ * @save            : pointer to autosave object
+ *
+ * Writes the dirty pages of an uncompressed save in place.
+ *
+ * Returns: bytes written, 0 on failure.
+ **/
+static size_t autosave_write_pages(autosave_t *save)
+{
+   size_t i;
+   size_t written = 0;
+   RFILE *file    = filestream_open(save->path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return 0;
+
+   if (filestream_get_size(file) != (int64_t)save->bufsize)
+   {
+      filestream_close(file);
+      return 0;
+   }
+
+   for (i = 0; i < save->num_pages; )
+   {
+      size_t start, len;
+
+      if (!save->page_dirty[i])
+      {
+         i++;
+         continue;
+      }
+
+      start = i * AUTOSAVE_PAGE_SIZE;
+      while (i < save->num_pages && save->page_dirty[i])
+         i++;
+      len   = MIN(i * AUTOSAVE_PAGE_SIZE, save->bufsize) - start;
+
+      if (     filestream_seek(file, (int64_t)start,
+               RETRO_VFS_SEEK_POSITION_START) < 0
+            || filestream_write(file, (const uint8_t*)save->buffer + start,
+               (int64_t)len) != (int64_t)len)
+      {
+         filestream_close(file);
+         return 0;
+      }
+
+      written += len;
+   }
+
+   filestream_flush(file);
+   filestream_close(file);
+
+   return written;
+}
+
+/**
+ * autosave_write_journal:
+ * @save            : pointer to autosave object
+ *
+ * Appends the dirty pages of a compressed save to its journal.
+ *
+ * Returns: bytes written, 0 if the journal would grow larger
+ * than the save file or could not be written.
+ **/
+static size_t autosave_write_journal(autosave_t *save)
+{
+   char journal_path[PATH_MAX_LENGTH];
+   uint8_t header[SRAM_JOURNAL_HEADER_SIZE];
+   size_t i;
+   size_t offset   = 0;
+   size_t written  = 0;
+   size_t len      = SRAM_JOURNAL_BATCH_SIZE;
+   uint32_t runs   = 0;
+   uint8_t *batch  = NULL;
+   uint8_t *p      = NULL;
+   RFILE *file     = NULL;
+
+   for (i = 0; i < save->num_pages; i++)
+   {
+      if (!save->page_dirty[i])
+         continue;
+      if (i == 0 || !save->page_dirty[i - 1])
+      {
+         len += SRAM_JOURNAL_RUN_SIZE;
+         runs++;
+      }
+      len   += MIN(AUTOSAVE_PAGE_SIZE, save->bufsize - i * AUTOSAVE_PAGE_SIZE);
+   }
+
+   if (save->journal_size + len > save->base_size)
+      return 0;
+
+   if (!(batch = (uint8_t*)malloc(len)))
+      return 0;
+
+   p = batch + SRAM_JOURNAL_BATCH_SIZE;
+
+   for (i = 0; i < save->num_pages; )
+   {
+      size_t start, run_size;
+
+      if (!save->page_dirty[i])
+      {
+         i++;
+         continue;
+      }
+
+      start    = i * AUTOSAVE_PAGE_SIZE;
+      while (i < save->num_pages && save->page_dirty[i])
+         i++;
+      run_size = MIN(i * AUTOSAVE_PAGE_SIZE, save->bufsize) - start;
+
+      retro_set_unaligned_32le(p,     (uint32_t)start);
+      retro_set_unaligned_32le(p + 4, (uint32_t)run_size);
+      memcpy(p + SRAM_JOURNAL_RUN_SIZE,
+            (const uint8_t*)save->buffer + start, run_size);
+      p       += SRAM_JOURNAL_RUN_SIZE + run_size;
+   }
+
+   retro_set_unaligned_32le(batch,     runs);
+   retro_set_unaligned_32le(batch + 4, (uint32_t)(len - SRAM_JOURNAL_BATCH_SIZE));
+   retro_set_unaligned_64le(batch + 8, sram_hash(
+            batch + SRAM_JOURNAL_BATCH_SIZE, len - SRAM_JOURNAL_BATCH_SIZE));
+
+   sram_journal_path(journal_path, save->path, sizeof(journal_path));
+
+   if (save->journal_size == 0)
+   {
+      memcpy(header, SRAM_JOURNAL_MAGIC, 4);
+      retro_set_unaligned_32le(header + 4,  SRAM_JOURNAL_VERSION);
+      retro_set_unaligned_64le(header + 8,  (uint64_t)save->bufsize);
+      retro_set_unaligned_64le(header + 16, save->base_hash);
+
+      if (     (file = filestream_open(journal_path,
+                  RETRO_VFS_FILE_ACCESS_WRITE,
+                  RETRO_VFS_FILE_ACCESS_HINT_NONE))
+            && filestream_write(file, header, sizeof(header))
+               == sizeof(header))
+         offset = sizeof(header);
+   }
+   /* Seek to the end of the last complete batch, overwriting
+    * whatever a failed write may have left behind. */
+   else if ((file = filestream_open(journal_path,
+               RETRO_VFS_FILE_ACCESS_READ_WRITE
+               | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE))
+         && filestream_seek(file, (int64_t)save->journal_size,
+               RETRO_VFS_SEEK_POSITION_START) >= 0)
+      offset = save->journal_size;
+
+   if (     offset
+         && filestream_write(file, batch, (int64_t)len) == (int64_t)len
+         && filestream_flush(file) == 0)
+   {
+      /* Includes the header if the journal was just created. */
+      written            = offset + len - save->journal_size;
+      save->journal_size = offset + len;
+   }
+
+   if (file)
+      filestream_close(file);
+   free(batch);
+
+   return written;
+}
+/**
+ * autosave_write:
+ * @save            : pointer to autosave object
+ *
+ * Writes the dirty pages out, in place for uncompressed saves
+ * and to the journal for compressed ones. Falls back to
+ * rewriting the whole file the first time, and whenever
+ * a partial write is not possible.
+ **/
+static void autosave_write(autosave_t *save)
+{
+   size_t written = 0;
+
+   if (save->synced)
+   {
+      if (save->flags & AUTOSAVE_FLAG_COMPRESS_FILES)
+         written = autosave_write_journal(save);
+      else
+         written = autosave_write_pages(save);
+   }
+
+   if (!written && !(written = autosave_write_file(save)))
+   {
+      /* Keep the pages dirty and try again next interval. */
+      save->synced = false;
+      return;
+   }
+
+   memset(save->page_dirty, 0, save->num_pages);
+   save->dirty_pages    = 0;
+   save->bytes_written += written;
+   save->bytes_full    += (save->flags & AUTOSAVE_FLAG_COMPRESS_FILES)
+      ? save->base_size : save->bufsize;
+   save->writes++;
+}
 
 /**
  * autosave_thread:
@@ -97,35 +569,35 @@ static void autosave_thread(void *data)
 
    for (;;)
    {
-      bool differ;
+      size_t i;
 
+      /* Only the core's buffer is read while the lock is held;
+       * changed pages are copied out and written after. */
       slock_lock(save->lock);
-      differ = memcmp(save->buffer, save->retro_buffer,
-            save->bufsize) != 0;
-      if (differ)
-         memcpy(save->buffer, save->retro_buffer, save->bufsize);
-      slock_unlock(save->lock);
-
-      if (differ)
+      for (i = 0; i < save->num_pages; i++)
       {
-         intfstream_t *file = NULL;
+         size_t offset      = i * AUTOSAVE_PAGE_SIZE;
+         size_t len         = MIN(AUTOSAVE_PAGE_SIZE, save->bufsize - offset);
+         const uint8_t *src = (const uint8_t*)save->retro_buffer + offset;
+         uint64_t hash      = sram_hash(src, len);
 
-         /* Should probably deal with this more elegantly. */
-         if (save->flags & AUTOSAVE_FLAG_COMPRESS_FILES)
-            file = intfstream_open_rzip_file(save->path,
-                  RETRO_VFS_FILE_ACCESS_WRITE);
-         else
-            file = intfstream_open_file(save->path,
-                  RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+         if (hash == save->page_hash[i])
+            continue;
 
-         if (file)
+         memcpy((uint8_t*)save->buffer + offset, src, len);
+         save->page_hash[i] = hash;
+         if (!save->page_dirty[i])
          {
-            intfstream_write(file, save->buffer, save->bufsize);
-            intfstream_flush(file);
-            intfstream_close(file);
-            free(file);
+            save->page_dirty[i] = 1;
+            save->dirty_pages++;
          }
       }
+      slock_unlock(save->lock);
+
+      slock_lock(save->write_lock);
+      if (save->dirty_pages)
+         autosave_write(save);
+      slock_unlock(save->write_lock);
 
       slock_lock(save->cond_lock);
 
@@ -164,8 +636,9 @@ static autosave_t *autosave_new(const char *path,
       const void *data, size_t size,
       unsigned interval, bool compress)
 {
+   size_t i;
    void       *buf               = NULL;
-   autosave_t *handle            = (autosave_t*)malloc(sizeof(*handle));
+   autosave_t *handle            = (autosave_t*)calloc(1, sizeof(*handle));
    if (!handle)
       return NULL;
 
@@ -176,9 +649,18 @@ static autosave_t *autosave_new(const char *path,
       handle->flags             |= AUTOSAVE_FLAG_COMPRESS_FILES;
    handle->retro_buffer          = data;
    handle->path                  = path;
-
-   if (!(buf = malloc(size)))
+   handle->num_pages             = (size + AUTOSAVE_PAGE_SIZE - 1)
+      / AUTOSAVE_PAGE_SIZE;
+   handle->page_hash             = (uint64_t*)malloc(
+         handle->num_pages * sizeof(*handle->page_hash));
+   handle->page_dirty            = (uint8_t*)calloc(handle->num_pages, 1);
+
+   if (     !handle->page_hash
+         || !handle->page_dirty
+         || !(buf = malloc(size)))
    {
+      free(handle->page_hash);
+      free(handle->page_dirty);
       free(handle);
       return NULL;
    }
@@ -187,7 +669,17 @@ static autosave_t *autosave_new(const char *path,
 
    memcpy(handle->buffer, handle->retro_buffer, handle->bufsize);
 
+   for (i = 0; i < handle->num_pages; i++)
+   {
+      size_t offset              = i * AUTOSAVE_PAGE_SIZE;
+      handle->page_hash[i]       = sram_hash(
+            (const uint8_t*)handle->buffer + offset,
+            MIN(AUTOSAVE_PAGE_SIZE, size - offset));
+   }
+
+   handle->start_time            = cpu_features_get_time_usec();
    handle->lock                  = slock_new();
+   handle->write_lock            = slock_new();
    handle->cond_lock             = slock_new();
    handle->cond                  = scond_new();
    handle->thread                = sthread_create(autosave_thread, handle);
@@ -203,6 +695,8 @@ static autosave_t *autosave_new(const char *path,
  **/
 static void autosave_free(autosave_t *handle)
 {
+   retro_time_t elapsed;
+
    slock_lock(handle->cond_lock);
    handle->flags |= AUTOSAVE_FLAG_QUIT;
    slock_unlock(handle->cond_lock);
@@ -210,9 +704,26 @@ static void autosave_free(autosave_t *handle)
    sthread_join(handle->thread);
 
    slock_free(handle->lock);
+   slock_free(handle->write_lock);
    slock_free(handle->cond_lock);
    scond_free(handle->cond);
 
+   elapsed = cpu_features_get_time_usec() - handle->start_time;
+   if (handle->writes && elapsed > 0)
+      RARCH_LOG("[SRAM]: Autosaved \"%s\" %u times, %llu bytes written "
+            "(%llu bytes/hour, %llu with whole-file rewrites).\n",
+            handle->path, handle->writes,
+            (unsigned long long)handle->bytes_written,
+            (unsigned long long)(handle->bytes_written
+               * 3600.0 * 1000000.0 / elapsed),
+            (unsigned long long)(handle->bytes_full
+               * 3600.0 * 1000000.0 / elapsed));
+
+   free(handle->page_hash);
+   free(handle->page_dirty);
+   handle->page_hash  = NULL;
+   handle->page_dirty = NULL;
+
    if (handle->buffer)
       free(handle->buffer);
    handle->buffer = NULL;
@@ -325,6 +836,26 @@ void autosave_unlock(void)
          slock_unlock(handle->lock);
    }
 }
+
+/**
+ * autosave_find:
+ * @path            : path of the save file
+ *
+ * Returns: the autosave object writing to @path, or NULL.
+ **/
+static autosave_t *autosave_find(const char *path)
+{
+   unsigned i;
+
+   for (i = 0; i < autosave_state.num; i++)
+   {
+      autosave_t *handle = autosave_state.list[i];
+      if (handle && string_is_equal(handle->path, path))
+         return handle;
+   }
+
+   return NULL;
+}
 #endif
 
 static bool content_get_memory(retro_ctx_memory_info_t *mem_info,
@@ -379,6 +910,11 @@ static bool content_load_ram_file(unsigned slot)
 
    if (rc > 0)
    {
+      unsigned batches = sram_journal_apply(ram.path, (uint8_t*)buf, (size_t)rc);
+      if (batches)
+         RARCH_LOG("[SRAM]: Applied %u autosave journal entries to \"%s\".\n",
+               batches, ram.path);
+
       if (rc > (ssize_t)mem_info.size)
       {
          RARCH_WARN("[SRAM]: SRAM is larger than implementation expects, "
@@ -462,6 +998,10 @@ static bool content_save_ram_file(unsigned slot, bool compress)
 {
    struct ram_type ram;
    retro_ctx_memory_info_t mem_info;
+   bool written       = false;
+#ifdef HAVE_THREADS
+   autosave_t *save   = NULL;
+#endif
 
    if (!content_get_memory(&mem_info, &ram, slot))
       return false;
@@ -472,20 +1012,43 @@ static bool content_save_ram_file(unsigned slot, bool compress)
          msg_hash_to_str(MSG_TO),
          ram.path);
 
-#if defined(HAVE_ZLIB)
-   if (compress)
+#ifdef HAVE_THREADS
+   /* Keep the autosave thread from copying pages or writing
+    * to the same file and its journal in the meantime. */
+   if ((save = autosave_find(ram.path)))
    {
-      if (!rzipstream_write_file(
-            ram.path, mem_info.data, mem_info.size))
-         goto fail;
+      slock_lock(save->lock);
+      slock_lock(save->write_lock);
    }
+#endif
+
+#if defined(HAVE_ZLIB)
+   if (compress)
+      written = rzipstream_write_file(
+            ram.path, mem_info.data, mem_info.size);
    else
 #endif
+      written = filestream_write_file(
+            ram.path, mem_info.data, mem_info.size);
+
+   /* The autosave journal only applies to the old file. */
+   if (written)
+      sram_journal_delete(ram.path);
+
+#ifdef HAVE_THREADS
+   if (save)
    {
-      if (!filestream_write_file(
-            ram.path, mem_info.data, mem_info.size))
-         goto fail;
+      /* The file no longer matches what the autosave
+       * wrote last, so its next write rewrites it. */
+      save->synced       = false;
+      save->journal_size = 0;
+      slock_unlock(save->write_lock);
+      slock_unlock(save->lock);
    }
+#endif
+
+   if (!written)
+      goto fail;
 
    RARCH_LOG("[SRAM]: %s \"%s\".\n",
          msg_hash_to_str(MSG_SAVED_SUCCESSFULLY_TO),
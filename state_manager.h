@@ -75,6 +75,52 @@ struct state_manager_rewind_state
 
 bool state_manager_frame_is_reversed(void);
 
+/* Raw patch format used for the rewind buffer, also used by netplay to
+ * transfer savestates as differences from an earlier one. */
+
+/**
+ * state_manager_raw_maxsize:
+ * @uncomp               : size of the savestates
+ *
+ * Returns: the maximum size of a patch between two savestates.
+ **/
+size_t state_manager_raw_maxsize(size_t uncomp);
+
+/**
+ * state_manager_raw_alloc:
+ * @len                  : size of the savestate
+ * @uniq                 : sentinel value, different for each buffer compared
+ *
+ * Allocates a savestate buffer padded for state_manager_raw_compress().
+ * Free it with free().
+ **/
+void *state_manager_raw_alloc(size_t len, uint16_t uniq);
+
+/**
+ * state_manager_raw_compress:
+ * @src                  : savestate the patch will produce
+ * @dst                  : savestate the patch will be applied to
+ * @len                  : size of the savestates
+ * @patch                : at least state_manager_raw_maxsize(len) bytes
+ *
+ * Both savestates must come from state_manager_raw_alloc(), with different
+ * sentinels.
+ *
+ * Returns: the number of bytes written to @patch.
+ **/
+size_t state_manager_raw_compress(const void *src,
+      const void *dst, size_t len, void *patch);
+
+/**
+ * state_manager_raw_decompress:
+ * @patch                : patch from state_manager_raw_compress()
+ * @patchlen             : size of the patch
+ * @data                 : the @dst savestate, turned into @src
+ * @datalen              : size of the savestate
+ **/
+void state_manager_raw_decompress(const void *patch,
+      size_t patchlen, void *data, size_t datalen);
+
 void state_manager_event_deinit(
       struct state_manager_rewind_state *rewind_st,
       struct retro_core_t *current_core);
@@ -0,0 +1,327 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *  Copyright (C) 2014-2017 - Alfred Agrell
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Raw savestate patches, used by the rewind buffer and by netplay
+ * to send savestates as differences from an earlier one. */
+
+#ifndef __STDC_LIMIT_MACROS
+#define __STDC_LIMIT_MACROS
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <compat/intrinsics.h>
+
+#include "state_manager.h"
+
+#ifndef UINT16_MAX
+#define UINT16_MAX 0xffff
+#endif
+
+#ifndef UINT32_MAX
+#define UINT32_MAX 0xffffffffu
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__) || defined(_M_IX86) || defined(_M_AMD64) || defined(_M_X64)
+#define CPU_X86
+#endif
+
+/* Other arches SIGBUS (usually) on unaligned accesses. */
+#ifndef CPU_X86
+#define NO_UNALIGNED_MEM
+#endif
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Format per frame (pseudocode): */
+#if 0
+size nextstart;
+repeat {
+   uint16 numchanged; /* everything is counted in units of uint16 */
+   if (numchanged)
+   {
+      uint16 numunchanged; /* skip these before handling numchanged */
+      uint16[numchanged] changeddata;
+   }
+   else
+   {
+      uint32 numunchanged;
+      if (!numunchanged)
+         break;
+   }
+}
+size thisstart;
+#endif
+
+/* There's no equivalent in libc, you'd think so ...
+ * std::mismatch exists, but it's not optimized at all. */
+static size_t find_change(const uint16_t *a, const uint16_t *b)
+{
+#if __SSE2__
+   const __m128i *a128 = (const __m128i*)a;
+   const __m128i *b128 = (const __m128i*)b;
+
+   for (;;)
+   {
+      __m128i v0    = _mm_loadu_si128(a128);
+      __m128i v1    = _mm_loadu_si128(b128);
+      __m128i c     = _mm_cmpeq_epi8(v0, v1);
+      uint32_t mask = _mm_movemask_epi8(c);
+
+      if (mask != 0xffff) /* Something has changed, figure out where. */
+      {
+         /* calculate the real offset to the differing byte */
+         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
+               (compat_ctz(~mask)));
+
+         /* and convert that to the uint16_t offset */
+         return (ret >> 1);
+      }
+
+      a128++;
+      b128++;
+   }
+#else
+   const uint16_t *a_org = a;
+#ifdef NO_UNALIGNED_MEM
+   while (((uintptr_t)a & (sizeof(size_t) - 1)) && *a == *b)
+   {
+      a++;
+      b++;
+   }
+   if (*a == *b)
+#endif
+   {
+      const size_t *a_big = (const size_t*)a;
+      const size_t *b_big = (const size_t*)b;
+
+      while (*a_big == *b_big)
+      {
+         a_big++;
+         b_big++;
+      }
+      a = (const uint16_t*)a_big;
+      b = (const uint16_t*)b_big;
+
+      while (*a == *b)
+      {
+         a++;
+         b++;
+      }
+   }
+   return a - a_org;
+#endif
+}
+
+static size_t find_same(const uint16_t *a, const uint16_t *b)
+{
+   const uint16_t *a_org = a;
+#ifdef NO_UNALIGNED_MEM
+   if (((uintptr_t)a & (sizeof(uint32_t) - 1)) && *a != *b)
+   {
+      a++;
+      b++;
+   }
+   if (*a != *b)
+#endif
+   {
+      /* With this, it's random whether two consecutive identical
+       * words are caught.
+       *
+       * Luckily, compression rate is the same for both cases, and
+       * three is always caught.
+       *
+       * (We prefer to miss two-word blocks, anyways; fewer iterations
+       * of the outer loop, as well as in the decompressor.) */
+      const uint32_t *a_big = (const uint32_t*)a;
+      const uint32_t *b_big = (const uint32_t*)b;
+
+      while (*a_big != *b_big)
+      {
+         a_big++;
+         b_big++;
+      }
+      a = (const uint16_t*)a_big;
+      b = (const uint16_t*)b_big;
+
+      if (a != a_org && a[-1] == b[-1])
+      {
+         a--;
+         b--;
+      }
+   }
+   return a - a_org;
+}
+
+/* Returns the maximum compressed size of a savestate.
+ * It is very likely to compress to far less. */
+size_t state_manager_raw_maxsize(size_t uncomp)
+{
+   /* bytes covered by a compressed block */
+   const int maxcblkcover = UINT16_MAX * sizeof(uint16_t);
+   /* uncompressed size, rounded to 16 bits */
+   size_t uncomp16        = (uncomp + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
+   /* number of blocks */
+   size_t maxcblks        = (uncomp + maxcblkcover - 1) / maxcblkcover;
+   return uncomp16 + maxcblks * sizeof(uint16_t) * 2 /* two u16 overhead per block */ + sizeof(uint16_t) *
+      3; /* three u16 to end it */
+}
+
+/*
+ * See state_manager_raw_compress for information about this.
+ * When you're done with it, send it to free().
+ */
+void *state_manager_raw_alloc(size_t len, uint16_t uniq)
+{
+   size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
+   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 16, 1);
+
+   if (!ret)
+      return NULL;
+
+   /* Force in a different byte at the end, so we don't need to check
+    * bounds in the innermost loop (it's expensive).
+    *
+    * There is also a large amount of data that's the same, to stop
+    * the other scan.
+    *
+    * There is also some padding at the end. This is so we don't
+    * read outside the buffer end if we're reading in large blocks;
+    *
+    * It doesn't make any difference to us, but sacrificing 16 bytes to get
+    * Valgrind happy is worth it. */
+   ret[len16/sizeof(uint16_t) + 3] = uniq;
+
+   return ret;
+}
+
+/*
+ * Takes two savestates and creates a patch that turns 'dst' into 'src'.
+ * Both 'src' and 'dst' must be returned from state_manager_raw_alloc(),
+ * with the same 'len', and different 'uniq'.
+ *
+ * 'patch' must be size 'state_manager_raw_maxsize(len)' or more.
+ * Returns the number of bytes actually written to 'patch'.
+ */
+size_t state_manager_raw_compress(const void *src,
+      const void *dst, size_t len, void *patch)
+{
+   const uint16_t  *old16 = (const uint16_t*)src;
+   const uint16_t  *new16 = (const uint16_t*)dst;
+   uint16_t *compressed16 = (uint16_t*)patch;
+   size_t          num16s = (len + sizeof(uint16_t) - 1)
+      / sizeof(uint16_t);
+
+   while (num16s)
+   {
+      size_t i, changed;
+      size_t skip = find_change(old16, new16);
+
+      if (skip >= num16s)
+         break;
+
+      old16  += skip;
+      new16  += skip;
+      num16s -= skip;
+
+      if (skip > UINT16_MAX)
+      {
+         /* This will make it scan the entire thing again,
+          * but it only hits on 8GB unchanged data anyways,
+          * and if you're doing that, you've got bigger problems. */
+         if (skip > UINT32_MAX)
+            skip         = UINT32_MAX;
+
+         *compressed16++ = 0;
+         *compressed16++ = skip;
+         *compressed16++ = skip >> 16;
+         continue;
+      }
+
+      changed         = find_same(old16, new16);
+      if (changed > UINT16_MAX)
+         changed = UINT16_MAX;
+
+      *compressed16++ = changed;
+      *compressed16++ = skip;
+
+      for (i = 0; i < changed; i++)
+         compressed16[i] = old16[i];
+
+      old16        += changed;
+      new16        += changed;
+      num16s       -= changed;
+      compressed16 += changed;
+   }
+
+   compressed16[0]  = 0;
+   compressed16[1]  = 0;
+   compressed16[2]  = 0;
+
+   return (uint8_t*)(compressed16 + 3) - (uint8_t*)patch;
+}
+
+/*
+ * Takes 'patch' from a previous call to 'state_manager_raw_compress'
+ * and applies it to 'data' ('dst' from that call),
+ * yielding 'src' in that call.
+ *
+ * If the given arguments do not match a previous call to
+ * state_manager_raw_compress(), anything at all can happen.
+ */
+void state_manager_raw_decompress(const void *patch,
+      size_t patchlen, void *data, size_t datalen)
+{
+   uint16_t         *out16 = (uint16_t*)data;
+   const uint16_t *patch16 = (const uint16_t*)patch;
+
+   for (;;)
+   {
+      uint16_t numchanged  = *(patch16++);
+
+      if (numchanged)
+      {
+         uint16_t i;
+
+         out16       += *patch16++;
+
+         /* We could do memcpy, but it seems that memcpy has a
+          * constant-per-call overhead that actually shows up.
+          *
+          * Our average size in here seems to be 8 or something.
+          * Therefore, we do something with lower overhead. */
+         for (i = 0; i < numchanged; i++)
+            out16[i]  = patch16[i];
+
+         patch16     += numchanged;
+         out16       += numchanged;
+      }
+      else
+      {
+         uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
+
+         if (!numunchanged)
+            break;
+         patch16 += 2;
+         out16   += numunchanged;
+      }
+   }
+}
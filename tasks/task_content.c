@@ -58,6 +58,14 @@
 #include <lists/dir_list.h>
 #include <vfs/vfs_implementation.h>
 #include <array/rbuf.h>
+#include <features/features_cpu.h>
+#include <memmap.h>
+
+#if defined(HAVE_MMAN)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
 
 #include <retro_miscellaneous.h>
 
@@ -102,6 +110,15 @@
 
 #define MAX_ARGS 32
 
+/* Content files at least this large are mapped into
+ * memory instead of being read in full before the
+ * core is loaded */
+#define CONTENT_FILE_MAP_MIN_SIZE (32 * 1024 * 1024)
+
+#if defined(HAVE_MMAN) && !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
 typedef struct content_stream content_stream_t;
 typedef struct content_information_ctx content_information_ctx_t;
 
@@ -268,6 +285,96 @@ bool content_file_override_set(
    return true;
 }
 
+#if defined(HAVE_MMAN) && defined(MAP_ANONYMOUS)
+/* Size of the mapping backing @data_size bytes of
+ * content: the file, rounded up to whole pages, plus
+ * at least one zeroed byte standing in for the NUL
+ * terminator that filestream_read_file() adds */
+static size_t content_file_map_size(size_t data_size)
+{
+   size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+   return (data_size + page_size) & ~(page_size - 1);
+}
+
+/**
+ * content_file_map:
+ * @path         : path of the content file.
+ * @data         : mapped content.
+ * @data_size    : size of the content file.
+ *
+ * Maps the content file into memory instead of reading it,
+ * so loading does not wait for the whole file and only
+ * the pages touched by the core are ever read.
+ * The mapping is private: cores may write to it (e.g. to
+ * byteswap a ROM), which copies the pages written to
+ * and never reaches the file.
+ *
+ * Returns: true if successful, false if the file should be
+ * read instead (too small, not a regular file, not
+ * accessible through the standard file API, ...).
+ **/
+static bool content_file_map(const char *path,
+      uint8_t **data, size_t *data_size)
+{
+   struct stat st;
+   size_t map_size = 0;
+   void *map       = MAP_FAILED;
+   int fd    = open(path, O_RDONLY);
+
+   if (fd < 0)
+      return false;
+
+   if (     fstat(fd, &st) != 0
+         || !S_ISREG(st.st_mode)
+         || st.st_size < CONTENT_FILE_MAP_MIN_SIZE
+         || (off_t)(size_t)st.st_size != st.st_size)
+      goto error;
+
+   /* Reserve the whole range, then map the file over
+    * its start; whatever follows the file reads as zero */
+   map_size = content_file_map_size((size_t)st.st_size);
+   if ((map = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+      goto error;
+
+   if (mmap(map, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+      goto error;
+
+   /* The mapping outlives the descriptor */
+   close(fd);
+
+   *data      = (uint8_t*)map;
+   *data_size = (size_t)st.st_size;
+   return true;
+
+error:
+   if (map != MAP_FAILED)
+      munmap(map, map_size);
+   close(fd);
+   return false;
+}
+#endif
+
+/* Releases content data returned by
+ * content_file_load_into_memory() */
+static void content_file_free_data(void *data, size_t data_size,
+      bool data_mapped)
+{
+   if (!data)
+      return;
+
+#if defined(HAVE_MMAN) && defined(MAP_ANONYMOUS)
+   if (data_mapped)
+   {
+      munmap(data, content_file_map_size(data_size));
+      return;
+   }
+#endif
+
+   free(data);
+}
+
 /* Frees any content data that is not flagged
  * as 'persistent'. Should be called after
  * content_file_load() */
@@ -286,10 +393,12 @@ static void content_file_list_free_transient_data(
       if (file_info->data &&
           !file_info->persistent_data)
       {
-         free((void*)file_info->data);
+         content_file_free_data(file_info->data,
+               file_info->data_size, file_info->data_mapped);
 
-         file_info->data      = NULL;
-         file_info->data_size = 0;
+         file_info->data        = NULL;
+         file_info->data_size   = 0;
+         file_info->data_mapped = false;
       }
    }
 }
@@ -344,10 +453,12 @@ static void content_file_list_free_entry(
 
    if (file_info->data)
    {
-      free((void*)file_info->data);
+      content_file_free_data(file_info->data,
+            file_info->data_size, file_info->data_mapped);
       file_info->data = NULL;
    }
    file_info->data_size       = 0;
+   file_info->data_mapped     = false;
 
    file_info->file_in_archive = false;
    file_info->persistent_data = false;
@@ -474,6 +585,7 @@ static bool content_file_list_set_info(
       const char *path,
       void *data,
       size_t data_size,
+      bool data_mapped,
       bool persistent_data,
       size_t idx)
 {
@@ -521,6 +633,7 @@ static bool content_file_list_set_info(
 
    file_info->data            = data;
    file_info->data_size       = data_size;
+   file_info->data_mapped     = data_mapped;
    file_info->persistent_data = persistent_data;
 
    /* Assign paths
@@ -658,16 +771,48 @@ static bool content_file_list_set_info(
 #define CONTENT_FILE_ATTR_GET_REQUIRED(attr)      ((attr.i & 4) != 0)
 #define CONTENT_FILE_ATTR_GET_PERSISTENT(attr)    ((attr.i & 8) != 0)
 
+#if defined(HAVE_PATCH) && defined(HAVE_MMAN) && defined(MAP_ANONYMOUS)
+/* Returns true if a soft patch may be applied to
+ * the first content file */
+static bool content_file_has_patch(
+      content_information_ctx_t *content_ctx)
+{
+   if (content_ctx->flags & CONTENT_INFO_FLAG_PATCH_IS_BLOCKED)
+      return false;
+
+   /* Indexed patches are only looked for once the
+    * first patch has been applied */
+   return (!string_is_empty(content_ctx->name_ips)
+            && path_is_valid(content_ctx->name_ips))
+       || (!string_is_empty(content_ctx->name_bps)
+            && path_is_valid(content_ctx->name_bps))
+       || (!string_is_empty(content_ctx->name_ups)
+            && path_is_valid(content_ctx->name_ups))
+       || (!string_is_empty(content_ctx->name_xdelta)
+            && path_is_valid(content_ctx->name_xdelta));
+}
+#endif
+
 /**
  * content_file_load_into_memory:
  * @content_path : path of the content file.
+ * @read_data    : the content if it has already been read from
+ *                 its archive, otherwise NULL. It is owned by
+ *                 this function from then on.
+ * @read_size    : size of @read_data.
  * @data         : buffer into which the content file will be read.
  * @data_size    : size of the resultant content buffer.
+ * @data_mapped  : true if @data is a mapping of the content file
+ *                 rather than a heap buffer.
  *
  * Reads the content file into memory. Also performs soft patching
  * (see patch_content function) if soft patching has not been
  * blocked by the user.
  *
+ * Large uncompressed files are mapped instead of read when no
+ * patch is to be applied; patches always produce a new buffer,
+ * so patched content is read as before.
+ *
  * Returns: true if successful, false on error.
  **/
 static bool content_file_load_into_memory(
@@ -675,36 +820,78 @@ static bool content_file_load_into_memory(
       content_state_t *p_content,
       const char *content_path,
       bool content_compressed,
+      void *read_data,
+      int64_t read_size,
       size_t idx,
       enum rarch_content_type first_content_type,
       uint8_t **data,
-      size_t *data_size)
+      size_t *data_size,
+      bool *data_mapped)
 {
    uint8_t *content_data = NULL;
    int64_t content_size  = 0;
+   bool content_mapped   = false;
+   retro_time_t start    = cpu_features_get_time_usec();
 
    *data                 = NULL;
    *data_size            = 0;
+   *data_mapped          = false;
 
    RARCH_LOG("[Content]: %s: \"%s\".\n",
          msg_hash_to_str(MSG_LOADING_CONTENT_FILE), content_path);
 
    /* Read content from file into memory buffer */
-#ifdef HAVE_COMPRESSION
-   if (content_compressed)
+#if defined(HAVE_MMAN) && defined(MAP_ANONYMOUS)
    {
-      if (!file_archive_compressed_read(content_path,
-            (void**)&content_data, NULL, &content_size))
-         return false;
+      size_t mapped_size = 0;
+      bool allow_map     = !content_compressed;
+#ifdef HAVE_PATCH
+      if (     allow_map
+            && (idx == 0)
+            && (first_content_type == RARCH_CONTENT_NONE)
+            && content_file_has_patch(content_ctx))
+         allow_map = false;
+#endif
+      if (allow_map && content_file_map(content_path,
+            &content_data, &mapped_size))
+      {
+         content_size   = (int64_t)mapped_size;
+         content_mapped = true;
+      }
    }
-   else
+
+   if (!content_mapped)
 #endif
-      if (!filestream_read_file(content_path,
-            (void**)&content_data, &content_size))
-         return false;
+   {
+#ifdef HAVE_COMPRESSION
+      if (content_compressed)
+      {
+         if (read_data)
+         {
+            content_data = (uint8_t*)read_data;
+            content_size = read_size;
+         }
+         else if (!file_archive_compressed_read(content_path,
+               (void**)&content_data, NULL, &content_size))
+            return false;
+      }
+      else
+#endif
+         if (!filestream_read_file(content_path,
+               (void**)&content_data, &content_size))
+            return false;
+   }
 
    if (content_size < 0)
+   {
+      free(content_data);
       return false;
+   }
+
+   RARCH_LOG("[Content]: %s %llu bytes in %llu us.\n",
+         content_mapped ? "Mapped" : "Read",
+         (unsigned long long)content_size,
+         (unsigned long long)(cpu_features_get_time_usec() - start));
 
    /* First content file is significant: attempt to do
     * soft patching, CRC checking, etc. */
@@ -717,8 +904,11 @@ static bool content_file_load_into_memory(
          bool has_patch = false;
 
 #ifdef HAVE_PATCH
-         /* Attempt to apply a patch. */
-         if (!(content_ctx->flags & CONTENT_INFO_FLAG_PATCH_IS_BLOCKED))
+         /* Attempt to apply a patch.
+          * > Mapped content has been checked for
+          *   patches already */
+         if (   !content_mapped
+             && !(content_ctx->flags & CONTENT_INFO_FLAG_PATCH_IS_BLOCKED))
             has_patch = patch_content(
                   content_ctx->flags & CONTENT_INFO_FLAG_IS_IPS_PREF,
                   content_ctx->flags & CONTENT_INFO_FLAG_IS_BPS_PREF,
@@ -728,6 +918,7 @@ static bool content_file_load_into_memory(
                   content_ctx->name_bps,
                   content_ctx->name_ups,
                   content_ctx->name_xdelta,
+                  content_ctx->directory_cache,
                   (uint8_t**)&content_data,
                   (void*)&content_size);
 #endif
@@ -759,8 +950,9 @@ static bool content_file_load_into_memory(
          p_content->rom_crc = 0;
    }
 
-   *data      = content_data;
-   *data_size = (size_t)content_size;
+   *data        = content_data;
+   *data_size   = (size_t)content_size;
+   *data_mapped = content_mapped;
 
    return true;
 }
@@ -924,6 +1116,121 @@ static void content_file_apply_overrides(
    }
 }
 
+#ifdef HAVE_COMPRESSION
+/**
+ * content_file_read_archive_members:
+ * @bufs    : content read so far, by content index.
+ * @lengths : sizes of @bufs.
+ *
+ * Reads the content files that are loaded into memory from
+ * the same archive with one file_archive_compressed_read_multi()
+ * call, so that a 7z solid block holding several of them (the
+ * discs of a set, a BIOS pack) is decoded once rather than for
+ * every file. Files that are alone in their archive, or could
+ * not be read this way, are left NULL and read one at a time.
+ **/
+static void content_file_read_archive_members(
+      content_state_t *p_content,
+      struct string_list *content,
+      content_information_ctx_t *content_ctx,
+      const struct retro_subsystem_info *special,
+      void **bufs,
+      int64_t *lengths)
+{
+   size_t i, j;
+   size_t count          = 0;
+   const char **paths    = (const char**)calloc(content->size, sizeof(*paths));
+   const char **members  = (const char**)calloc(content->size, sizeof(*members));
+   size_t *indices       = (size_t*)calloc(content->size, sizeof(*indices));
+   void **group_bufs     = (void**)calloc(content->size, sizeof(*group_bufs));
+   int64_t *group_sizes  = (int64_t*)calloc(content->size, sizeof(*group_sizes));
+
+   if (!paths || !members || !indices || !group_bufs || !group_sizes)
+      goto end;
+
+   /* Find the archive members to be loaded into memory */
+   for (i = 0; i < content->size; i++)
+   {
+      const char *content_path = NULL;
+      const char *valid_exts   = special
+            ? special->roms[i].valid_extensions
+            : content_ctx->valid_extensions;
+      bool content_compressed  = false;
+
+      content_file_get_path(content, i, valid_exts,
+            &content_path, &content_compressed);
+
+      if (     !content_compressed
+            || !path_contains_compressed_file(content_path))
+         continue;
+
+      if (p_content->content_override_list)
+         content_file_apply_overrides(p_content, content, i, content_path);
+
+      if (!CONTENT_FILE_ATTR_GET_NEED_FULLPATH(content->elems[i].attr))
+      {
+         paths[i] = content_path;
+         count++;
+      }
+   }
+
+   if (count < 2)
+      goto end;
+
+   /* Read the members of each archive together */
+   for (i = 0; i < content->size; i++)
+   {
+      char archive_path[PATH_MAX_LENGTH];
+      size_t group_size = 0;
+      size_t _len;
+
+      if (!paths[i])
+         continue;
+
+      _len = (size_t)(path_get_archive_delim(paths[i]) - paths[i]);
+
+      for (j = i; j < content->size; j++)
+      {
+         if (     paths[j]
+               && ((size_t)(path_get_archive_delim(paths[j]) - paths[j])
+                  == _len)
+               && !strncmp(paths[j], paths[i], _len))
+         {
+            members[group_size] = paths[j] + _len + 1;
+            indices[group_size] = j;
+            group_size++;
+            if (j != i)
+               paths[j] = NULL;
+         }
+      }
+
+      paths[i] = NULL;
+
+      if (group_size < 2 || _len >= sizeof(archive_path))
+         continue;
+
+      strlcpy(archive_path, content->elems[i].data, _len + 1);
+      RARCH_LOG("[Content]: Reading %u files from \"%s\" together.\n",
+            (unsigned)group_size, archive_path);
+      file_archive_compressed_read_multi(archive_path,
+            members, group_size, group_bufs, group_sizes);
+
+      for (j = 0; j < group_size; j++)
+      {
+         bufs[indices[j]]    = group_bufs[j];
+         lengths[indices[j]] = group_sizes[j];
+      }
+   }
+
+end:
+   free(paths);
+   free(members);
+   free(indices);
+   free(group_bufs);
+   free(group_sizes);
+}
+#endif
+
 /**
  * content_file_load:
  * @special          : subsystem of content to be loaded. Can be NULL.
@@ -947,16 +1254,31 @@ static bool content_file_load(
    rarch_system_info_t *sys_info              = &runloop_state_get_ptr()->system;
 #endif
    enum rarch_content_type first_content_type = RARCH_CONTENT_NONE;
+   void **archive_bufs                        = NULL;
+   int64_t *archive_lengths                   = NULL;
+
+#ifdef HAVE_COMPRESSION
+   if (     content->size > 1
+         && (archive_bufs    = (void**)calloc(content->size,
+               sizeof(*archive_bufs)))
+         && (archive_lengths = (int64_t*)calloc(content->size,
+               sizeof(*archive_lengths))))
+      content_file_read_archive_members(p_content, content, content_ctx,
+            special, archive_bufs, archive_lengths);
+#endif
 
    for (i = 0; i < content->size; i++)
    {
       const char *content_path = NULL;
       uint8_t *content_data    = NULL;
       size_t content_size      = 0;
+      bool content_mapped      = false;
       const char *valid_exts   = special
             ? special->roms[i].valid_extensions
             : content_ctx->valid_extensions;
       bool content_compressed  = false;
+      void *read_data          = NULL;
+      int64_t read_size        = 0;
 
       /* Get content path */
       content_file_get_path(content, i, valid_exts,
@@ -969,7 +1291,7 @@ static bool content_file_load(
          if (CONTENT_FILE_ATTR_GET_REQUIRED(content->elems[i].attr))
          {
             *error_enum = MSG_ERROR_LIBRETRO_CORE_REQUIRES_CONTENT;
-            return false;
+            goto error;
          }
       }
       else
@@ -988,17 +1310,26 @@ static bool content_file_load(
           * the content into memory */
          if (!CONTENT_FILE_ATTR_GET_NEED_FULLPATH(content->elems[i].attr))
          {
+            /* Content read with others from the same archive */
+            if (archive_bufs)
+            {
+               read_data       = archive_bufs[i];
+               read_size       = archive_lengths[i];
+               archive_bufs[i] = NULL;
+            }
+
             if (!content_file_load_into_memory(
                   content_ctx, p_content, content_path,
-                  content_compressed, i, first_content_type,
-                  &content_data, &content_size))
+                  content_compressed, read_data, read_size,
+                  i, first_content_type,
+                  &content_data, &content_size, &content_mapped))
             {
                char msg[128];
                snprintf(msg, sizeof(msg), "%s \"%s\"\n",
                      msg_hash_to_str(MSG_COULD_NOT_READ_CONTENT_FILE),
                      content_path);
                *error_string = strdup(msg);
-               return false;
+               goto error;
             }
          }
          else
@@ -1010,7 +1341,7 @@ static bool content_file_load(
                 !CONTENT_FILE_ATTR_GET_BLOCK_EXTRACT(content->elems[i].attr) &&
                 !content_file_extract_from_archive(content_ctx, p_content,
                      valid_exts, &content_path, error_string))
-               return false;
+               goto error;
 #endif
 #ifdef __WINRT__
             /* TODO: When support for the 'actual' VFS is added,
@@ -1079,7 +1410,7 @@ static bool content_file_load(
                         msg_hash_to_str(MSG_COULD_NOT_READ_CONTENT_FILE),
                         content_path);
                      *error_string = strdup(msg);
-                     return false;
+                     goto error;
                   }
 
                   content_path = content_file_list_append_temporary(
@@ -1113,17 +1444,19 @@ static bool content_file_load(
       /* Add current entry to content file list */
       if (!content_file_list_set_info(
             p_content->content_list,
-            content_path, content_data, content_size,
+            content_path, content_data, content_size, content_mapped,
             CONTENT_FILE_ATTR_GET_PERSISTENT(content->elems[i].attr), i))
       {
          RARCH_LOG("[Content]: Failed to process content file: \"%s\".\n", content_path);
-         if (content_data)
-            free((void*)content_data);
+         content_file_free_data(content_data, content_size, content_mapped);
          *error_enum = MSG_FAILED_TO_LOAD_CONTENT;
-         return false;
+         goto error;
       }
    }
 
+   free(archive_bufs);
+   free(archive_lengths);
+
    /* Load content into core */
    load_info.content = content;
    load_info.special = special;
@@ -1159,6 +1492,16 @@ static bool content_file_load(
 #endif
 
    return true;
+
+error:
+   if (archive_bufs)
+   {
+      for (i = 0; i < content->size; i++)
+         free(archive_bufs[i]);
+      free(archive_bufs);
+   }
+   free(archive_lengths);
+   return false;
 }
 
 static const struct retro_subsystem_info *content_file_init_subsystem(
@@ -1321,6 +1664,10 @@ static bool content_file_init(
                error_enum, error_string, special);
 
          content_file_list_free_transient_data(p_content->content_list);
+#ifdef HAVE_COMPRESSION
+         /* Decoded 7z blocks were only kept for this load */
+         file_archive_cache_flush();
+#endif
          return ret;
       }
    }
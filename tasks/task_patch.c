@@ -26,11 +26,14 @@
 
 #include <compat/msvc.h>
 #include <file/file_path.h>
+#include <lists/dir_list.h>
+#include <lists/string_list.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
 
 #include <encodings/crc32.h>
 
+#include "../file_path_special.h"
 #include "../runloop.h"
 #include "../msg_hash.h"
 #include "../verbosity.h"
@@ -40,6 +43,24 @@
 #include "../deps/xdelta3/xdelta3.h"
 #endif
 
+/* The first patch plus up to 9 indexed ones */
+#define PATCH_MAX_FILES 10
+
+/* Patched content is cached in a subdirectory of the cache
+ * directory, one file per content and set of patches:
+ *   0  "RPCH"
+ *   4  u32 version (PATCH_CACHE_VERSION)
+ *   8  u32 CRC32 of the unpatched content
+ *   12 u32 CRC32 of the patch files, in the order applied
+ *   16 u64 size of the unpatched content
+ *   24 u64 size of the patched content
+ * followed by the patched content. All fields are little-endian. */
+#define PATCH_CACHE_DIR         "patches"
+#define PATCH_CACHE_EXTENSION   "patched"
+#define PATCH_CACHE_MAGIC       "RPCH"
+#define PATCH_CACHE_VERSION     1
+#define PATCH_CACHE_HEADER_SIZE 32
+
 enum bps_mode
 {
    SOURCE_READ = 0,
@@ -100,22 +121,23 @@ struct ups_data
    unsigned target_checksum;
 };
 
+/* A patcher may apply the patch to the source buffer in place
+ * and hand it back as the target. */
 typedef enum patch_error (*patch_func_t)(const uint8_t*, uint64_t,
-      const uint8_t*, uint64_t, uint8_t**, uint64_t*);
+      uint8_t*, uint64_t, uint8_t**, uint64_t*);
 
 static uint8_t bps_read(struct bps_data *bps)
 {
-   uint8_t data         = bps->modify_data[bps->modify_offset++];
-   bps->modify_checksum = ~(encoding_crc32(
-         ~bps->modify_checksum, &data, 1));
-   return data;
+   if (bps->modify_offset < bps->modify_length)
+      return bps->modify_data[bps->modify_offset++];
+   return 0x00;
 }
 
 static uint64_t bps_decode(struct bps_data *bps)
 {
    uint64_t data = 0, shift = 1;
 
-   for (;;)
+   while (bps->modify_offset < bps->modify_length)
    {
       uint8_t x  = bps_read(bps);
       data      += (x & 0x7f) * shift;
@@ -130,7 +152,7 @@ static uint64_t bps_decode(struct bps_data *bps)
 
 static enum patch_error bps_apply_patch(
       const uint8_t *modify_data, uint64_t modify_length,
-      const uint8_t *source_data, uint64_t source_length,
+      uint8_t *source_data, uint64_t source_length,
       uint8_t **target_data, uint64_t *target_length)
 {
    size_t i;
@@ -155,9 +177,9 @@ static enum patch_error bps_apply_patch(
    bps.modify_offset          = 0;
    bps.source_offset          = 0;
    bps.target_offset          = 0;
-   bps.modify_checksum        = ~0;
+   bps.modify_checksum        = 0;
    bps.source_checksum        = 0;
-   bps.target_checksum        = ~0;
+   bps.target_checksum        = 0;
    bps.source_relative_offset = 0;
    bps.target_relative_offset = 0;
    bps.output_offset          = 0;
@@ -172,8 +194,9 @@ static enum patch_error bps_apply_patch(
    modify_target_size  = bps_decode(&bps);
    modify_markup_size  = bps_decode(&bps);
 
-   for (i = 0; i < modify_markup_size; i++)
-      bps_read(&bps);
+   if (modify_markup_size > bps.modify_length - bps.modify_offset)
+      return PATCH_PATCH_INVALID;
+   bps.modify_offset += modify_markup_size;
 
    if (modify_source_size > bps.source_length)
       return PATCH_SOURCE_TOO_SMALL;
@@ -198,24 +221,28 @@ static enum patch_error bps_apply_patch(
 
       length = (length >> 2) + 1;
 
+      if (length > bps.target_length - bps.output_offset)
+         return PATCH_PATCH_INVALID;
+
       switch (mode)
       {
          case SOURCE_READ:
-            while (length--)
-            {
-               uint8_t data = bps.source_data[bps.output_offset];
-               bps.target_data[bps.output_offset++] = data;
-               bps.target_checksum = ~(encoding_crc32(~bps.target_checksum, &data, 1));
-            }
+            if (     bps.output_offset > bps.source_length
+                  || length > bps.source_length - bps.output_offset)
+               return PATCH_PATCH_INVALID;
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.source_data + bps.output_offset, length);
+            bps.output_offset += length;
             break;
 
          case TARGET_READ:
-            while (length--)
-            {
-               uint8_t data = bps_read(&bps);
-               bps.target_data[bps.output_offset++] = data;
-               bps.target_checksum = ~(encoding_crc32(~bps.target_checksum, &data, 1));
-            }
+            if (     bps.modify_offset > bps.modify_length - 12
+                  || length > bps.modify_length - 12 - bps.modify_offset)
+               return PATCH_PATCH_INVALID;
+            memcpy(bps.target_data + bps.output_offset,
+                  bps.modify_data + bps.modify_offset, length);
+            bps.modify_offset += length;
+            bps.output_offset += length;
             break;
 
          case SOURCE_COPY:
@@ -232,41 +259,58 @@ static enum patch_error bps_apply_patch(
             if (mode == SOURCE_COPY)
             {
                bps.source_offset += offset;
-               while (length--)
-               {
-                  uint8_t data = bps.source_data[bps.source_offset++];
-                  bps.target_data[bps.output_offset++] = data;
-                  bps.target_checksum = ~(encoding_crc32(~bps.target_checksum, &data, 1));
-               }
+               if (     bps.source_offset > bps.source_length
+                     || length > bps.source_length - bps.source_offset)
+                  return PATCH_PATCH_INVALID;
+               memcpy(bps.target_data + bps.output_offset,
+                     bps.source_data + bps.source_offset, length);
+               bps.source_offset += length;
+               bps.output_offset += length;
             }
             else
             {
                bps.target_offset += offset;
-               while (length--)
+               if (bps.target_offset >= bps.output_offset)
+                  return PATCH_PATCH_INVALID;
+
+               /* Overlapping copies repeat the bytes just written */
+               if (length > bps.output_offset - bps.target_offset)
+               {
+                  while (length--)
+                     bps.target_data[bps.output_offset++] =
+                        bps.target_data[bps.target_offset++];
+               }
+               else
                {
-                  uint8_t data = bps.target_data[bps.target_offset++];
-                  bps.target_data[bps.output_offset++] = data;
-                  bps.target_checksum = ~(encoding_crc32(~bps.target_checksum, &data, 1));
+                  memcpy(bps.target_data + bps.output_offset,
+                        bps.target_data + bps.target_offset, length);
+                  bps.target_offset += length;
+                  bps.output_offset += length;
                }
-               break;
             }
             break;
          }
       }
    }
 
+   if (bps.modify_offset != bps.modify_length - 12)
+      return PATCH_PATCH_INVALID;
+
    for (i = 0; i < 32; i += 8)
       modify_source_checksum |= bps_read(&bps) << i;
    for (i = 0; i < 32; i += 8)
       modify_target_checksum |= bps_read(&bps) << i;
 
-   checksum = ~bps.modify_checksum;
+   /* The checksums cover whole buffers, so compute them in
+    * one pass each rather than per byte while patching */
+   checksum = encoding_crc32(0, bps.modify_data, bps.modify_offset);
    for (i = 0; i < 32; i += 8)
       modify_modify_checksum |= bps_read(&bps) << i;
 
    bps.source_checksum = encoding_crc32(0,
          bps.source_data, bps.source_length);
-   bps.target_checksum = ~bps.target_checksum;
+   bps.target_checksum = encoding_crc32(0,
+         bps.target_data, bps.output_offset);
 
    if (bps.source_checksum != modify_source_checksum)
       return PATCH_SOURCE_CHECKSUM_INVALID;
@@ -285,24 +329,14 @@ static enum patch_error bps_apply_patch(
 static uint8_t ups_patch_read(struct ups_data *data)
 {
    if (data && data->patch_offset < data->patch_length)
-   {
-      uint8_t n = data->patch_data[data->patch_offset++];
-      data->patch_checksum =
-         ~(encoding_crc32(~data->patch_checksum, &n, 1));
-      return n;
-   }
+      return data->patch_data[data->patch_offset++];
    return 0x00;
 }
 
 static uint8_t ups_source_read(struct ups_data *data)
 {
    if (data && data->source_offset < data->source_length)
-   {
-      uint8_t n = data->source_data[data->source_offset++];
-      data->source_checksum =
-         ~(encoding_crc32(~data->source_checksum, &n, 1));
-      return n;
-   }
+      return data->source_data[data->source_offset++];
    return 0x00;
 }
 
@@ -310,11 +344,7 @@ static void ups_target_write(struct ups_data *data, uint8_t n)
 {
 
    if (data && data->target_offset < data->target_length)
-   {
       data->target_data[data->target_offset] = n;
-      data->target_checksum =
-         ~(encoding_crc32(~data->target_checksum, &n, 1));
-   }
 
    if (data)
       data->target_offset++;
@@ -324,7 +354,7 @@ static uint64_t ups_decode(struct ups_data *data)
 {
    uint64_t offset = 0, shift = 1;
 
-   for (;;)
+   while (data->patch_offset < data->patch_length)
    {
       uint8_t x = ups_patch_read(data);
       offset   += (x & 0x7f) * shift;
@@ -339,7 +369,7 @@ static uint64_t ups_decode(struct ups_data *data)
 
 static enum patch_error ups_apply_patch(
       const uint8_t *patchdata, uint64_t patchlength,
-      const uint8_t *sourcedata, uint64_t sourcelength,
+      uint8_t *sourcedata, uint64_t sourcelength,
       uint8_t **targetdata, uint64_t *targetlength)
 {
    size_t i;
@@ -360,9 +390,9 @@ static enum patch_error ups_apply_patch(
    data.patch_offset    = 0;
    data.source_offset   = 0;
    data.target_offset   = 0;
-   data.patch_checksum  = ~0;
-   data.source_checksum = ~0;
-   data.target_checksum = ~0;
+   data.patch_checksum  = 0;
+   data.source_checksum = 0;
+   data.target_checksum = 0;
 
    if (data.patch_length < 18)
       return PATCH_PATCH_INVALID;
@@ -422,9 +452,14 @@ static enum patch_error ups_apply_patch(
    for (i = 0; i < 4; i++)
       target_read_checksum |= ups_patch_read(&data) << (i * 8);
 
-   patch_result_checksum = ~data.patch_checksum;
-   data.source_checksum  = ~data.source_checksum;
-   data.target_checksum  = ~data.target_checksum;
+   /* Every byte has been read or written exactly once by now,
+    * so each checksum covers its buffer from the start */
+   patch_result_checksum = encoding_crc32(0,
+         data.patch_data, data.patch_offset);
+   data.source_checksum  = encoding_crc32(0,
+         data.source_data, data.source_length);
+   data.target_checksum  = encoding_crc32(0,
+         data.target_data, data.target_length);
 
    for (i = 0; i < 4; i++)
       patch_read_checksum |= ups_patch_read(&data) << (i * 8);
@@ -452,12 +487,35 @@ static enum patch_error ups_apply_patch(
    return PATCH_SOURCE_INVALID;
 }
 
+/* IPS only overwrites bytes, so the source doubles as the
+ * target unless the patch grows it */
+static enum patch_error ips_init_targetdata(
+      uint8_t *sourcedata, uint64_t sourcelength,
+      uint8_t **targetdata, uint64_t extent)
+{
+   uint8_t *prov_alloc;
+
+   if (extent <= sourcelength)
+   {
+      *targetdata = sourcedata;
+      return PATCH_SUCCESS;
+   }
+
+   if (!(prov_alloc = (uint8_t*)malloc((size_t)extent)))
+      return PATCH_TARGET_ALLOC_FAILED;
+
+   memcpy(prov_alloc, sourcedata, (size_t)sourcelength);
+   memset(prov_alloc + sourcelength, 0,
+         (size_t)(extent - sourcelength));
+   *targetdata = prov_alloc;
+   return PATCH_SUCCESS;
+}
+
 static enum patch_error ips_alloc_targetdata(
       const uint8_t *patchdata, uint64_t patchlen,
-      uint64_t sourcelength,
+      uint8_t *sourcedata, uint64_t sourcelength,
       uint8_t **targetdata, uint64_t *targetlength)
 {
-   uint8_t *prov_alloc;
    uint32_t offset = 5;
    *targetlength   = sourcelength;
 
@@ -476,27 +534,18 @@ static enum patch_error ips_alloc_targetdata(
       if (address == 0x454f46) /* EOF */
       {
          if (offset == patchlen)
-         {
-            prov_alloc     = (uint8_t*)malloc((size_t)*targetlength);
-            if (!prov_alloc)
-               return PATCH_TARGET_ALLOC_FAILED;
-            free(*targetdata);
-            *targetdata    = prov_alloc;
-            return PATCH_SUCCESS;
-         }
+            return ips_init_targetdata(sourcedata, sourcelength,
+                  targetdata, *targetlength);
          else if (offset == patchlen - 3)
          {
-            uint32_t size  = patchdata[offset++] << 16;
-            size          |= patchdata[offset++] << 8;
-            size          |= patchdata[offset++] << 0;
-            *targetlength  = size;
-            prov_alloc     = (uint8_t*)malloc((size_t)*targetlength);
-
-            if (!prov_alloc)
-               return PATCH_TARGET_ALLOC_FAILED;
-            free(*targetdata);
-            *targetdata    = prov_alloc;
-            return PATCH_SUCCESS;
+            /* Records may still write past a truncated size */
+            uint64_t extent = *targetlength;
+            uint32_t size   = patchdata[offset++] << 16;
+            size           |= patchdata[offset++] << 8;
+            size           |= patchdata[offset++] << 0;
+            *targetlength   = size;
+            return ips_init_targetdata(sourcedata, sourcelength,
+                  targetdata, extent);
          }
       }
 
@@ -543,7 +592,7 @@ static enum patch_error ips_alloc_targetdata(
 
 static enum patch_error ips_apply_patch(
       const uint8_t *patchdata, uint64_t patchlen,
-      const uint8_t *sourcedata, uint64_t sourcelength,
+      uint8_t *sourcedata, uint64_t sourcelength,
       uint8_t **targetdata, uint64_t *targetlength)
 {
    uint32_t offset = 5;
@@ -556,13 +605,13 @@ static enum patch_error ips_apply_patch(
          patchdata[4] != 'H')
       return PATCH_PATCH_INVALID;
 
+   /* Validates the whole patch before the target is touched,
+    * which may be the source itself */
    if ((error_patch = ips_alloc_targetdata(
-               patchdata, patchlen, sourcelength,
+               patchdata, patchlen, sourcedata, sourcelength,
                targetdata, targetlength)) != PATCH_SUCCESS)
       return error_patch;
 
-   memcpy(*targetdata, sourcedata, (size_t)sourcelength);
-
    for (;;)
    {
       uint32_t address;
@@ -629,7 +678,7 @@ static enum patch_error ips_apply_patch(
 #if defined(HAVE_PATCH) && defined(HAVE_XDELTA)
 static enum patch_error xdelta_apply_patch(
         const uint8_t *patchdata, uint64_t patchlen,
-        const uint8_t *sourcedata, uint64_t sourcelength,
+        uint8_t *sourcedata, uint64_t sourcelength,
         uint8_t **targetdata, uint64_t *targetlength)
 {
    int ret;
@@ -698,7 +747,12 @@ static enum patch_error xdelta_apply_patch(
       }
    } while (stream.avail_in);
 
-   *targetdata = (uint8_t*)malloc(*targetlength);
+   if (!(*targetdata = (uint8_t*)malloc(*targetlength)))
+   {
+      error_patch = PATCH_TARGET_ALLOC_FAILED;
+      goto cleanup_stream;
+   }
+
    switch (ret = xd3_decode_memory(
            patchdata, patchlen,
            sourcedata, sourcelength,
@@ -709,10 +763,12 @@ static enum patch_error xdelta_apply_patch(
       case ENOSPC:
          error_patch = PATCH_TARGET_ALLOC_FAILED;
          free(*targetdata);
+         *targetdata = NULL;
          goto cleanup_stream;
       default:
          error_patch = PATCH_UNKNOWN;
          free(*targetdata);
+         *targetdata = NULL;
          goto cleanup_stream;
    }
 
@@ -723,13 +779,28 @@ cleanup_stream:
 }
 #endif
 
-static bool apply_patch_content(uint8_t **buf,
-      ssize_t *size, const char *patch_desc, const char *patch_path,
-      patch_func_t func, void *patch_data, int64_t patch_size)
+static void patch_show_notification(const char *patch_path)
 {
    settings_t *settings     = config_get_ptr();
    bool show_notification   = settings ?
          settings->bools.notification_show_patch_applied : false;
+
+   if (show_notification)
+   {
+      char msg[128];
+      const char *patch_filename = path_basename_nocompression(patch_path);
+      snprintf(msg, sizeof(msg), msg_hash_to_str(MSG_APPLYING_PATCH),
+            patch_filename ? patch_filename :
+                  msg_hash_to_str(MENU_ENUM_LABEL_VALUE_UNKNOWN));
+      runloop_msg_queue_push(msg, 1, 180, false, NULL,
+            MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+   }
+}
+
+static bool apply_patch_content(uint8_t **buf,
+      ssize_t *size, const char *patch_desc, const char *patch_path,
+      patch_func_t func, void *patch_data, int64_t patch_size)
+{
    enum patch_error err     = PATCH_UNKNOWN;
    ssize_t ret_size         = *size;
    uint8_t *ret_buf         = *buf;
@@ -742,146 +813,267 @@ static bool apply_patch_content(uint8_t **buf,
    if ((err = func((const uint8_t*)patch_data, patch_size, ret_buf,
          ret_size, &patched_content, &target_size)) == PATCH_SUCCESS)
    {
-      free(ret_buf);
+      /* Patched in place? */
+      if (patched_content != ret_buf)
+         free(ret_buf);
       *buf  = patched_content;
       *size = target_size;
 
       /* Show an OSD message */
-      if (show_notification)
-      {
-         char msg[128];
-         const char *patch_filename = path_basename_nocompression(patch_path);
-         snprintf(msg, sizeof(msg), msg_hash_to_str(MSG_APPLYING_PATCH),
-               patch_filename ? patch_filename :
-                     msg_hash_to_str(MENU_ENUM_LABEL_VALUE_UNKNOWN));
-         runloop_msg_queue_push(msg, 1, 180, false, NULL,
-               MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-      }
+      patch_show_notification(patch_path);
+      return true;
    }
-   else
-      RARCH_ERR("%s %s: %s #%u\n",
-            msg_hash_to_str(MSG_FAILED_TO_PATCH),
-            patch_desc,
-            msg_hash_to_str(MSG_ERROR),
-            (unsigned)err);
 
-   return true;
-}
+   if (patched_content != ret_buf)
+      free(patched_content);
 
-static bool try_bps_patch(bool allow_bps, const char *name_bps,
-      uint8_t **buf, ssize_t *size)
-{
-   if (     allow_bps
-         && !string_is_empty(name_bps)
-         && path_is_valid(name_bps)
-      )
-   {
-      int64_t patch_size;
-      bool ret                 = false;
-      void *patch_data         = NULL;
+   RARCH_ERR("%s %s: %s #%u\n",
+         msg_hash_to_str(MSG_FAILED_TO_PATCH),
+         patch_desc,
+         msg_hash_to_str(MSG_ERROR),
+         (unsigned)err);
 
-      if (!filestream_read_file(name_bps, &patch_data, &patch_size))
-         return false;
+   return false;
+}
 
-      if (patch_size >= 0)
-         ret = apply_patch_content(buf, size, "BPS", name_bps,
-               bps_apply_patch, patch_data, patch_size);
+static void patch_cache_put_le32(uint8_t *p, uint32_t v)
+{
+   p[0] = (uint8_t)(v);
+   p[1] = (uint8_t)(v >>  8);
+   p[2] = (uint8_t)(v >> 16);
+   p[3] = (uint8_t)(v >> 24);
+}
 
-      if (patch_data)
-         free(patch_data);
-      return ret;
-   }
+static uint32_t patch_cache_get_le32(const uint8_t *p)
+{
+   return (uint32_t)p[0]        | ((uint32_t)p[1] << 8)
+       | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
 
-   return false;
+static void patch_cache_header(uint8_t *header,
+      uint32_t content_crc, uint32_t patch_crc,
+      uint64_t content_size, uint64_t patched_size)
+{
+   memcpy(header, PATCH_CACHE_MAGIC, 4);
+   patch_cache_put_le32(header +  4, PATCH_CACHE_VERSION);
+   patch_cache_put_le32(header +  8, content_crc);
+   patch_cache_put_le32(header + 12, patch_crc);
+   patch_cache_put_le32(header + 16, (uint32_t)content_size);
+   patch_cache_put_le32(header + 20, (uint32_t)(content_size >> 32));
+   patch_cache_put_le32(header + 24, (uint32_t)patched_size);
+   patch_cache_put_le32(header + 28, (uint32_t)(patched_size >> 32));
 }
 
-static bool try_ups_patch(bool allow_ups, const char *name_ups,
+/**
+ * patch_cache_load:
+ * @path         : path of the cache entry.
+ * @content_crc  : CRC32 of the unpatched content.
+ * @patch_crc    : CRC32 of the patch files, in the order applied.
+ * @buf          : buffer of the content file, replaced on success.
+ * @size         : size   of the content file, replaced on success.
+ *
+ * Loads previously patched content in place of @buf.
+ *
+ * Returns: true if a matching cache entry was loaded.
+ **/
+static bool patch_cache_load(const char *path,
+      uint32_t content_crc, uint32_t patch_crc,
       uint8_t **buf, ssize_t *size)
 {
-   if (     allow_ups
-         && !string_is_empty(name_ups)
-         && path_is_valid(name_ups)
-      )
-   {
-      int64_t patch_size;
-      bool ret                 = false;
-      void *patch_data         = NULL;
+   uint8_t header[PATCH_CACHE_HEADER_SIZE];
+   uint8_t expected[PATCH_CACHE_HEADER_SIZE];
+   uint64_t patched_size = 0;
+   uint8_t *patched      = NULL;
+   RFILE *file           = NULL;
 
-      if (!filestream_read_file(name_ups, &patch_data, &patch_size))
-         return false;
+   if (!path_is_valid(path))
+      return false;
 
-      if (patch_size >= 0)
-         ret = apply_patch_content(buf, size, "UPS", name_ups,
-               ups_apply_patch, patch_data, patch_size);
+   if (!(file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return false;
 
-      if (patch_data)
-         free(patch_data);
-      return ret;
-   }
+   if (filestream_read(file, header, sizeof(header)) != sizeof(header))
+      goto error;
+
+   patched_size = patch_cache_get_le32(header + 24)
+      | ((uint64_t)patch_cache_get_le32(header + 28) << 32);
+   patch_cache_header(expected, content_crc, patch_crc,
+         (uint64_t)*size, patched_size);
+
+   /* Everything but the patched size has to match */
+   if (     memcmp(header, expected, sizeof(header))
+         || filestream_get_size(file)
+            != (int64_t)(sizeof(header) + patched_size))
+      goto error;
+
+   /* NUL terminated, like filestream_read_file() */
+   if (!(patched = (uint8_t*)malloc((size_t)patched_size + 1)))
+      goto error;
+
+   if (filestream_read(file, patched, patched_size)
+         != (int64_t)patched_size)
+      goto error;
+
+   patched[patched_size] = '\0';
+   filestream_close(file);
+
+   free(*buf);
+   *buf  = patched;
+   *size = (ssize_t)patched_size;
+   return true;
+
+error:
+   free(patched);
+   filestream_close(file);
    return false;
 }
 
-static bool try_ips_patch(bool allow_ips,
-      const char *name_ips, uint8_t **buf, ssize_t *size)
+/**
+ * patch_cache_store:
+ * @path         : path of the cache entry.
+ * @content_crc  : CRC32 of the unpatched content.
+ * @patch_crc    : CRC32 of the patch files, in the order applied.
+ * @content_size : size of the unpatched content.
+ * @buf          : patched content.
+ * @size         : size of the patched content.
+ *
+ * Writes a cache entry for the patched content and removes
+ * the entries of other patch sets for the same content.
+ **/
+static void patch_cache_store(const char *path,
+      uint32_t content_crc, uint32_t patch_crc,
+      uint64_t content_size, const uint8_t *buf, uint64_t size)
 {
-   if (     allow_ips
-         && !string_is_empty(name_ips)
-         && path_is_valid(name_ips)
-      )
+   size_t i;
+   size_t _len;
+   char prefix[16];
+   char dir[PATH_MAX_LENGTH];
+   char tmp[PATH_MAX_LENGTH];
+   uint8_t header[PATCH_CACHE_HEADER_SIZE];
+   struct string_list *entries = NULL;
+   RFILE *file                 = NULL;
+   bool ok                     = false;
+
+   fill_pathname_basedir(dir, path, sizeof(dir));
+   if (!path_is_directory(dir) && !path_mkdir(dir))
+      return;
+
+   _len = strlcpy(tmp, path, sizeof(tmp));
+   strlcpy(tmp + _len, FILE_PATH_TMP_EXTENSION, sizeof(tmp) - _len);
+
+   patch_cache_header(header, content_crc, patch_crc, content_size, size);
+
+   /* Written under a temporary name first, so that an
+    * interrupted write never leaves a truncated entry */
+   if ((file = filestream_open(tmp,
+         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE)))
    {
-      int64_t patch_size;
-      bool ret                 = false;
-      void *patch_data         = NULL;
+      ok = filestream_write(file, header, sizeof(header))
+            == sizeof(header)
+         && filestream_write(file, buf, size) == (int64_t)size;
+      if (filestream_close(file) != 0)
+         ok = false;
+   }
 
-      if (!filestream_read_file(name_ips, &patch_data, &patch_size))
-         return false;
+   if (!ok)
+   {
+      RARCH_WARN("[Patch]: Failed to write patched content to \"%s\".\n",
+            tmp);
+      filestream_delete(tmp);
+      return;
+   }
 
-      if (patch_size >= 0)
-         ret = apply_patch_content(buf, size, "IPS", name_ips,
-               ips_apply_patch, patch_data, patch_size);
+   filestream_delete(path);
+   if (filestream_rename(tmp, path) != 0)
+   {
+      filestream_delete(tmp);
+      return;
+   }
 
-      if (patch_data)
-         free(patch_data);
-      return ret;
+   RARCH_LOG("[Patch]: Cached patched content in \"%s\".\n", path);
+
+   /* A new patch set replaces the old one, which is not
+    * likely to be played again */
+   snprintf(prefix, sizeof(prefix), "%08x-", (unsigned)content_crc);
+   if (!(entries = dir_list_new(dir, PATCH_CACHE_EXTENSION,
+         false, false, false, false)))
+      return;
+
+   for (i = 0; i < entries->size; i++)
+   {
+      const char *entry = entries->elems[i].data;
+
+      if (     string_starts_with(path_basename(entry), prefix)
+            && !string_is_equal(entry, path))
+         filestream_delete(entry);
    }
-   return false;
+
+   string_list_free(entries);
 }
 
-static bool try_xdelta_patch(bool allow_xdelta,
-                          const char *name_xdelta, uint8_t **buf, ssize_t *size)
+typedef struct
 {
-#if defined(HAVE_PATCH) && defined(HAVE_XDELTA)
-   if (     allow_xdelta
-            && !string_is_empty(name_xdelta)
-            && path_is_valid(name_xdelta)
-           )
+   const char *desc;
+   patch_func_t func;
+   void *data;
+   int64_t size;
+   char path[PATH_MAX_LENGTH];
+} patch_file_t;
+
+static bool patch_file_load(bool allow, const char *name,
+      const char *desc, patch_func_t func, patch_file_t *file)
+{
+   if (     allow
+         && !string_is_empty(name)
+         && path_is_valid(name)
+         && filestream_read_file(name, &file->data, &file->size)
+         && file->size >= 0)
    {
-      int64_t patch_size;
-      bool ret                 = false;
-      void *patch_data         = NULL;
-
-      if (!filestream_read_file(name_xdelta, &patch_data, &patch_size))
-         return false;
+      file->desc = desc;
+      file->func = func;
+      strlcpy(file->path, name, sizeof(file->path));
+      return true;
+   }
 
-      if (patch_size >= 0)
-         ret = apply_patch_content(buf, size, "Xdelta", name_xdelta,
-                                   xdelta_apply_patch, patch_data, patch_size);
+   free(file->data);
+   file->data = NULL;
+   return false;
+}
 
-      if (patch_data)
-         free(patch_data);
-      return ret;
-    }
+static bool patch_file_find(
+      bool allow_ips, bool allow_bps, bool allow_ups, bool allow_xdelta,
+      const char *name_ips, const char *name_bps,
+      const char *name_ups, const char *name_xdelta,
+      patch_file_t *file)
+{
+   if (     patch_file_load(allow_ips, name_ips, "IPS",
+               ips_apply_patch, file)
+         || patch_file_load(allow_bps, name_bps, "BPS",
+               bps_apply_patch, file)
+         || patch_file_load(allow_ups, name_ups, "UPS",
+               ups_apply_patch, file))
+      return true;
+#if defined(HAVE_PATCH) && defined(HAVE_XDELTA)
+   if (patch_file_load(allow_xdelta, name_xdelta, "Xdelta",
+            xdelta_apply_patch, file))
+      return true;
 #endif
-    return false;
+   return false;
 }
 
 /**
  * patch_content:
+ * @dir_cache    : directory to cache patched content in, or NULL.
  * @buf          : buffer of the content file.
  * @size         : size   of the content file.
  *
  * Apply patch to the content file in-memory.
  *
+ * With @dir_cache set, the patched content is kept there keyed
+ * by the CRC32 of the content and of the patch files, and loaded
+ * instead of patching again on the next launch.
+ *
  **/
 bool patch_content(
       bool is_ips_pref,
@@ -892,14 +1084,25 @@ bool patch_content(
       const char *name_bps,
       const char *name_ups,
       const char *name_xdelta,
+      const char *dir_cache,
       uint8_t **buf,
       void *data)
 {
-   ssize_t *size     = (ssize_t*)data;
-   bool allow_ups    = !is_bps_pref && !is_ips_pref && !is_xdelta_pref;
-   bool allow_ips    = !is_ups_pref && !is_bps_pref && !is_xdelta_pref;
-   bool allow_bps    = !is_ups_pref && !is_ips_pref && !is_xdelta_pref;
-   bool allow_xdelta = !is_bps_pref && !is_ups_pref && !is_ips_pref;
+   size_t i;
+   char cache_path[PATH_MAX_LENGTH];
+   ssize_t *size        = (ssize_t*)data;
+   bool allow_ups       = !is_bps_pref && !is_ips_pref && !is_xdelta_pref;
+   bool allow_ips       = !is_ups_pref && !is_bps_pref && !is_xdelta_pref;
+   bool allow_bps       = !is_ups_pref && !is_ips_pref && !is_xdelta_pref;
+   bool allow_xdelta    = !is_bps_pref && !is_ups_pref && !is_ips_pref;
+   bool cacheable       = false;
+   bool from_cache      = false;
+   bool applied         = true;
+   size_t num_files     = 0;
+   uint32_t content_crc = 0;
+   uint32_t patch_crc   = 0;
+   uint64_t content_size;
+   patch_file_t *files;
 
    if (    (unsigned)is_ips_pref
          + (unsigned)is_bps_pref
@@ -911,13 +1114,14 @@ bool patch_content(
       return false;
    }
 
-   /* Attempt to apply first (non-indexed) patch */
-   if (     try_ips_patch(allow_ips, name_ips, buf, size)
-         || try_bps_patch(allow_bps, name_bps, buf, size)
-         || try_ups_patch(allow_ups, name_ups, buf, size)
-         || try_xdelta_patch(allow_xdelta, name_xdelta, buf, size))
+   if (!(files = (patch_file_t*)calloc(PATCH_MAX_FILES, sizeof(*files))))
+      return false;
+
+   /* Attempt to find first (non-indexed) patch */
+   if (patch_file_find(allow_ips, allow_bps, allow_ups, allow_xdelta,
+            name_ips, name_bps, name_ups, name_xdelta, &files[0]))
    {
-      /* A patch has been found. Now attempt to apply
+      /* A patch has been found. Now attempt to find
        * any additional 'indexed' patch files */
       size_t name_ips_len       = strlen(name_ips);
       size_t name_bps_len       = strlen(name_bps);
@@ -927,9 +1131,9 @@ bool patch_content(
       char *name_bps_indexed    = (char*)malloc((name_bps_len + 2) * sizeof(char));
       char *name_ups_indexed    = (char*)malloc((name_ups_len + 2) * sizeof(char));
       char *name_xdelta_indexed = (char*)malloc((name_xdelta_len + 2) * sizeof(char));
-      /* First patch already applied -> index
+      /* First patch already found -> index
        * for subsequent patches starts at 1 */
-      size_t patch_index     = 1;
+      num_files                 = 1;
 
       strlcpy(name_ips_indexed, name_ips, (name_ips_len + 1) * sizeof(char));
       strlcpy(name_bps_indexed, name_bps, (name_bps_len + 1) * sizeof(char));
@@ -943,8 +1147,8 @@ bool patch_content(
       name_ups_indexed[name_ups_len + 1] = '\0';
       name_xdelta_indexed[name_xdelta_len + 1] = '\0';
 
-      /* try to patch "*.ipsX" */
-      while (patch_index < 10)
+      /* try to find "*.ipsX" */
+      while (num_files < PATCH_MAX_FILES)
       {
          /* Add index character to end of patch
           * file path string
@@ -956,29 +1160,94 @@ bool patch_content(
           *   this with an snprintf() implementation
           *   (which will have significantly higher
           *   performance overheads) */
-         char index_char = '0' + patch_index;
+         char index_char = '0' + num_files;
 
          name_ips_indexed[name_ips_len] = index_char;
          name_bps_indexed[name_bps_len] = index_char;
          name_ups_indexed[name_ups_len] = index_char;
          name_xdelta_indexed[name_xdelta_len] = index_char;
 
-         if (     !try_ips_patch(allow_ips, name_ips_indexed, buf, size)
-               && !try_bps_patch(allow_bps, name_bps_indexed, buf, size)
-               && !try_ups_patch(allow_ups, name_ups_indexed, buf, size)
-               && !try_xdelta_patch(allow_xdelta, name_xdelta_indexed, buf, size))
+         if (!patch_file_find(allow_ips, allow_bps, allow_ups, allow_xdelta,
+                  name_ips_indexed, name_bps_indexed,
+                  name_ups_indexed, name_xdelta_indexed,
+                  &files[num_files]))
             break;
 
-         patch_index++;
+         num_files++;
       }
 
       free(name_ips_indexed);
       free(name_bps_indexed);
       free(name_ups_indexed);
       free(name_xdelta_indexed);
+   }
 
-      return true;
+   if (!num_files)
+   {
+      free(files);
+      return false;
    }
 
-   return false;
+   /* IPS patches are applied in place in a single pass,
+    * which is cheaper than reading back a cached copy */
+   if (!string_is_empty(dir_cache))
+   {
+      for (i = 0; i < num_files; i++)
+      {
+         if (files[i].func != ips_apply_patch)
+         {
+            cacheable = true;
+            break;
+         }
+      }
+   }
+
+   content_size = (uint64_t)*size;
+
+   if (cacheable)
+   {
+      char name[32];
+      char dir[PATH_MAX_LENGTH];
+
+      content_crc = encoding_crc32(0, *buf, (size_t)*size);
+      for (i = 0; i < num_files; i++)
+         patch_crc = encoding_crc32(patch_crc,
+               (const uint8_t*)files[i].data, (size_t)files[i].size);
+
+      snprintf(name, sizeof(name), "%08x-%08x." PATCH_CACHE_EXTENSION,
+            (unsigned)content_crc, (unsigned)patch_crc);
+      fill_pathname_join_special(dir, dir_cache,
+            PATCH_CACHE_DIR, sizeof(dir));
+      fill_pathname_join_special(cache_path, dir, name,
+            sizeof(cache_path));
+
+      if (patch_cache_load(cache_path, content_crc, patch_crc, buf, size))
+      {
+         RARCH_LOG("[Patch]: Loaded patched content from \"%s\".\n",
+               cache_path);
+         for (i = 0; i < num_files; i++)
+            patch_show_notification(files[i].path);
+         from_cache = true;
+      }
+   }
+
+   if (!from_cache)
+   {
+      for (i = 0; i < num_files; i++)
+         if (!apply_patch_content(buf, size, files[i].desc,
+                  files[i].path, files[i].func,
+                  files[i].data, files[i].size))
+            applied = false;
+
+      /* Only cache content that every patch applied to */
+      if (cacheable && applied)
+         patch_cache_store(cache_path, content_crc, patch_crc,
+               content_size, *buf, (uint64_t)*size);
+   }
+
+   for (i = 0; i < num_files; i++)
+      free(files[i].data);
+   free(files);
+
+   return true;
 }
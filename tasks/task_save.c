@@ -20,6 +20,7 @@
 #include <time.h>
 
 #include <compat/strl.h>
+#include <features/features_cpu.h>
 #include <lists/string_list.h>
 #include <streams/interface_stream.h>
 #include <streams/file_stream.h>
@@ -105,17 +106,29 @@ enum save_task_state_flags
    SAVE_TASK_FLAG_COMPRESS_FILES        = (1 << 7)
 };
 
-typedef struct
+enum save_state_write_status
+{
+   SAVE_STATE_WRITE_NONE = 0,
+   SAVE_STATE_WRITE_PENDING,
+   SAVE_STATE_WRITE_DONE,
+   SAVE_STATE_WRITE_FAILED
+};
+
+typedef struct save_task_state
 {
    intfstream_t *file;
    void *data;
    void *undo_data;
+   struct save_task_state *next; /* Save state writer queue */
+   retro_time_t requested;       /* When the save was requested */
    ssize_t size;
    ssize_t undo_size;
    ssize_t written;
    ssize_t bytes_read;
    int state_slot;
+   enum save_state_write_status write_status;
    uint8_t flags;
+   uint8_t compress_level;       /* zlib level if SAVE_TASK_FLAG_COMPRESS_FILES */
    char path[PATH_MAX_LENGTH];
 } save_task_state_t;
 
@@ -135,6 +148,46 @@ static struct ram_save_state_buf ram_buf;
 
 static bool save_state_in_background       = false;
 
+/* Serialized states go into one of these buffers instead of a
+ * new allocation per save. Two are enough for one state to be
+ * written out while the next one is serialized; beyond that,
+ * buffers are allocated as before. */
+#define SAVE_STATE_POOL_SIZE 2
+
+struct save_state_pool_buf
+{
+   void *data;
+   size_t capacity;
+   bool busy;
+};
+
+/* Upper bounds, in milliseconds, of the buckets of the
+ * histogram of the time from a save being requested to the
+ * state being on disk. The last bucket holds everything else. */
+static const unsigned save_state_latency_ms[] = {
+   16, 33, 66, 125, 250, 500, 1000, 2000
+};
+
+#define SAVE_STATE_LATENCY_BUCKETS (ARRAY_SIZE(save_state_latency_ms) + 1)
+
+/* Compresses and writes save states on a thread of its own,
+ * so that neither the main thread nor other tasks have to wait
+ * for it, and vice versa. */
+struct save_state_writer
+{
+   struct save_state_pool_buf pool[SAVE_STATE_POOL_SIZE];
+   unsigned latency[SAVE_STATE_LATENCY_BUCKETS];
+#ifdef HAVE_THREADS
+   slock_t *lock;
+   scond_t *cond;
+   sthread_t *thread;
+   save_task_state_t *queue;
+   bool quit;
+#endif
+};
+
+static struct save_state_writer save_writer;
+
 typedef struct rastate_size_info
 {
    size_t total_size;
@@ -296,6 +349,379 @@ static void undo_save_state_cb(retro_task_t *task,
    free(state);
 }
 
+/**
+ * save_state_buf_acquire:
+ * @len                   : size of the buffer.
+ *
+ * Returns: zeroed buffer of at least @len bytes, to be released
+ * with save_state_buf_release().
+ **/
+static void *save_state_buf_acquire(size_t len)
+{
+   unsigned i;
+   void *data = NULL;
+
+#ifdef HAVE_THREADS
+   if (!save_writer.lock)
+      return calloc(len, 1);
+   slock_lock(save_writer.lock);
+#endif
+   for (i = 0; i < SAVE_STATE_POOL_SIZE; i++)
+   {
+      struct save_state_pool_buf *buf = &save_writer.pool[i];
+
+      if (buf->busy)
+         continue;
+
+      if (buf->capacity < len)
+      {
+         free(buf->data);
+         buf->capacity = 0;
+         if (!(buf->data = malloc(len)))
+            break;
+         buf->capacity = len;
+      }
+
+      buf->busy = true;
+      data      = buf->data;
+      break;
+   }
+#ifdef HAVE_THREADS
+   slock_unlock(save_writer.lock);
+#endif
+
+   if (!data)
+      return calloc(len, 1);
+
+   /* Ensure buffer is initialised to zero
+    * > Prevents inconsistent compressed state file
+    *   sizes when core requests a larger buffer
+    *   than it needs (and leaves the excess
+    *   as uninitialised garbage) */
+   memset(data, 0, len);
+   return data;
+}
+
+static void save_state_buf_release(void *data)
+{
+   unsigned i;
+
+   if (!data)
+      return;
+
+#ifdef HAVE_THREADS
+   if (save_writer.lock)
+      slock_lock(save_writer.lock);
+#endif
+   for (i = 0; i < SAVE_STATE_POOL_SIZE; i++)
+   {
+      if (save_writer.pool[i].busy && save_writer.pool[i].data == data)
+      {
+         save_writer.pool[i].busy = false;
+         data                     = NULL;
+         break;
+      }
+   }
+#ifdef HAVE_THREADS
+   if (save_writer.lock)
+      slock_unlock(save_writer.lock);
+#endif
+
+   /* Not from the pool */
+   if (data)
+      free(data);
+}
+
+/* Flushes @path out of the OS cache and onto the disk.
+ * Windows only syncs files opened for writing, which
+ * directories can't be, and there is nothing to do for
+ * them there anyway. */
+static void content_sync_path(const char *path, bool is_dir)
+{
+   RFILE *file = filestream_open(path,
+         is_dir ? RETRO_VFS_FILE_ACCESS_READ
+         : RETRO_VFS_FILE_ACCESS_READ_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (file)
+   {
+      filestream_sync(file);
+      filestream_close(file);
+   }
+}
+
+/**
+ * content_write_state_file:
+ * @path                  : path of the state file.
+ * @data                  : serialized state.
+ * @size                  : size of @data.
+ * @compress              : whether to write an RZIP file.
+ * @level                 : zlib compression level of the RZIP file.
+ *
+ * Writes @data to a temporary file next to @path, syncs it and
+ * renames it over @path, so that a crash or power loss leaves
+ * either the old or the new state behind, never a truncated one.
+ *
+ * Returns: true if successful, false otherwise.
+ **/
+static bool content_write_state_file(const char *path,
+      const void *data, size_t size, bool compress, unsigned level)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+   char dir[PATH_MAX_LENGTH];
+#if defined(HAVE_ZLIB)
+   rzipstream_t *rzip = NULL;
+#endif
+
+   strlcpy(tmp_path, path, sizeof(tmp_path));
+   strlcat(tmp_path, FILE_PATH_TMP_EXTENSION, sizeof(tmp_path));
+
+#if defined(HAVE_ZLIB)
+   if (compress)
+   {
+      int64_t written;
+
+      if (!(rzip = rzipstream_open(tmp_path, RETRO_VFS_FILE_ACCESS_WRITE)))
+         goto error;
+      /* An invalid level leaves the default in place */
+      rzipstream_set_compression_level(rzip, level);
+      written = rzipstream_write(rzip, data, (int64_t)size);
+      if (rzipstream_close(rzip) == -1 || written != (int64_t)size)
+         goto error;
+   }
+   else
+#endif
+   if (!filestream_write_file(tmp_path, data, size))
+      goto error;
+
+   content_sync_path(tmp_path, false);
+
+   if (filestream_rename(tmp_path, path) != 0)
+   {
+      /* Renaming over an existing file fails on some platforms. */
+      filestream_delete(path);
+      if (filestream_rename(tmp_path, path) != 0)
+         goto error;
+   }
+
+   /* Make the rename itself durable. */
+   fill_pathname_basedir(dir, path, sizeof(dir));
+   content_sync_path(dir, true);
+
+   return true;
+
+error:
+   filestream_delete(tmp_path);
+   return false;
+}
+
+/* Returns milliseconds since @requested, counted in the histogram. */
+static unsigned save_state_record_latency(retro_time_t requested)
+{
+   unsigned i;
+   unsigned ms = (unsigned)((cpu_features_get_time_usec() - requested) / 1000);
+
+   for (i = 0; i < ARRAY_SIZE(save_state_latency_ms); i++)
+      if (ms < save_state_latency_ms[i])
+         break;
+   save_writer.latency[i]++;
+
+   return ms;
+}
+
+static void save_state_log_latency(void)
+{
+   char buf[256];
+   unsigned i;
+   size_t _len    = 0;
+   unsigned total = 0;
+
+   for (i = 0; i < SAVE_STATE_LATENCY_BUCKETS; i++)
+      total += save_writer.latency[i];
+
+   if (!total)
+      return;
+
+   buf[0] = '\0';
+   for (i = 0; i < SAVE_STATE_LATENCY_BUCKETS && _len < sizeof(buf); i++)
+   {
+      if (i < ARRAY_SIZE(save_state_latency_ms))
+         _len += snprintf(buf + _len, sizeof(buf) - _len, " <%ums: %u,",
+               save_state_latency_ms[i], save_writer.latency[i]);
+      else
+         _len += snprintf(buf + _len, sizeof(buf) - _len, " more: %u",
+               save_writer.latency[i]);
+   }
+
+   RARCH_LOG("[State]: Time from save to disk over %u saves:%s.\n",
+         total, buf);
+}
+
+/* Writes the state of @state and records the outcome in it. */
+static void save_state_write(save_task_state_t *state)
+{
+   bool ok = content_write_state_file(state->path, state->data,
+         (size_t)state->size,
+         (state->flags & SAVE_TASK_FLAG_COMPRESS_FILES) ? true : false,
+         state->compress_level);
+#ifdef HAVE_THREADS
+   if (save_writer.lock)
+      slock_lock(save_writer.lock);
+#endif
+   state->write_status = ok
+      ? SAVE_STATE_WRITE_DONE : SAVE_STATE_WRITE_FAILED;
+   if (ok)
+      RARCH_LOG("[State]: \"%s\" on disk %u ms after the save.\n",
+            state->path, save_state_record_latency(state->requested));
+#ifdef HAVE_THREADS
+   if (save_writer.lock)
+   {
+      scond_broadcast(save_writer.cond);
+      slock_unlock(save_writer.lock);
+   }
+#endif
+}
+
+#ifdef HAVE_THREADS
+static void save_state_writer_thread(void *data)
+{
+   slock_lock(save_writer.lock);
+
+   for (;;)
+   {
+      save_task_state_t *state;
+
+      while (!save_writer.queue && !save_writer.quit)
+         scond_wait(save_writer.cond, save_writer.lock);
+
+      /* Whatever was queued is written before quitting. */
+      if (!(state = save_writer.queue))
+         break;
+
+      save_writer.queue = state->next;
+      slock_unlock(save_writer.lock);
+
+      save_state_write(state);
+
+      slock_lock(save_writer.lock);
+   }
+
+   slock_unlock(save_writer.lock);
+}
+
+/**
+ * save_state_writer_push:
+ * @state                 : state to write.
+ *
+ * Queues @state on the save state writer. The task owning
+ * @state must stay alive until save_state_writer_poll() says
+ * it has been written.
+ *
+ * Returns: false if there is no writer thread.
+ **/
+static bool save_state_writer_push(save_task_state_t *state)
+{
+   save_task_state_t **tail;
+
+   if (!save_writer.thread)
+      return false;
+
+   slock_lock(save_writer.lock);
+   for (tail = &save_writer.queue; *tail; tail = &(*tail)->next);
+   state->next         = NULL;
+   state->write_status = SAVE_STATE_WRITE_PENDING;
+   *tail               = state;
+   scond_broadcast(save_writer.cond);
+   slock_unlock(save_writer.lock);
+
+   return true;
+}
+
+/* Returns true once @state has been written, successfully or not. */
+static bool save_state_writer_poll(save_task_state_t *state)
+{
+   bool done;
+
+   slock_lock(save_writer.lock);
+   /* Rather than spinning the task queue, wait a little
+    * when not on the main thread. */
+   if (     state->write_status == SAVE_STATE_WRITE_PENDING
+         && !task_is_on_main_thread())
+      scond_wait_timeout(save_writer.cond, save_writer.lock, 2000);
+   done = (state->write_status != SAVE_STATE_WRITE_PENDING);
+   slock_unlock(save_writer.lock);
+
+   return done;
+}
+#endif
+
+static void save_state_writer_init(void)
+{
+#ifdef HAVE_THREADS
+   if (save_writer.lock)
+      return;
+
+   save_writer.quit  = false;
+   save_writer.queue = NULL;
+
+   if (     !(save_writer.lock   = slock_new())
+         || !(save_writer.cond   = scond_new())
+         || !(save_writer.thread = sthread_create(
+               save_state_writer_thread, NULL)))
+   {
+      /* States are then written by the task itself. */
+      if (save_writer.cond)
+         scond_free(save_writer.cond);
+      if (save_writer.lock)
+         slock_free(save_writer.lock);
+      save_writer.cond = NULL;
+      save_writer.lock = NULL;
+   }
+#endif
+}
+
+/* Waits for the saves in flight, stops the writer once it
+ * has written everything queued and frees the buffer pool. */
+static void save_state_writer_deinit(void)
+{
+   unsigned i;
+
+   /* The tasks collect their writes and give the buffers back */
+   content_wait_for_save_state_task();
+
+#ifdef HAVE_THREADS
+   if (save_writer.lock)
+   {
+      slock_lock(save_writer.lock);
+      save_writer.quit = true;
+      scond_broadcast(save_writer.cond);
+      slock_unlock(save_writer.lock);
+
+      sthread_join(save_writer.thread);
+      scond_free(save_writer.cond);
+      slock_free(save_writer.lock);
+      save_writer.thread = NULL;
+      save_writer.cond   = NULL;
+      save_writer.lock   = NULL;
+   }
+#endif
+
+   for (i = 0; i < SAVE_STATE_POOL_SIZE; i++)
+   {
+      /* A buffer still in use is freed by save_state_buf_release()
+       * once it is no longer found in the pool. */
+      if (!save_writer.pool[i].busy)
+         free(save_writer.pool[i].data);
+      save_writer.pool[i].data     = NULL;
+      save_writer.pool[i].capacity = 0;
+      save_writer.pool[i].busy     = false;
+   }
+
+   save_state_log_latency();
+   memset(save_writer.latency, 0, sizeof(save_writer.latency));
+}
+
 /**
  * task_save_handler_finished:
  * @task : the task to finish
@@ -311,8 +737,11 @@ static void task_save_handler_finished(retro_task_t *task,
 
    task_set_flags(task, RETRO_TASK_FLG_FINISHED, true);
 
-   intfstream_close(state->file);
-   free(state->file);
+   if (state->file)
+   {
+      intfstream_close(state->file);
+      free(state->file);
+   }
 
    flg = task_get_flags(task);
 
@@ -329,7 +758,7 @@ static void task_save_handler_finished(retro_task_t *task,
       if (     (state->flags & SAVE_TASK_FLAG_UNDO_SAVE)
             && (state->data == undo_save_buf.data))
          undo_save_buf.data = NULL;
-      free(state->data);
+      save_state_buf_release(state->data);
       state->data = NULL;
    }
 
@@ -476,17 +905,12 @@ static void *content_get_serialized_data(size_t* serial_size)
    if ((len = content_get_rastate_size(&size, false)) == 0)
       return NULL;
 
-   /* Ensure buffer is initialised to zero
-    * > Prevents inconsistent compressed state file
-    *   sizes when core requests a larger buffer
-    *   than it needs (and leaves the excess
-    *   as uninitialised garbage) */
-   if (!(data = calloc(len, 1)))
+   if (!(data = save_state_buf_acquire(len)))
       return NULL;
 
    if (!content_write_serialized_state(data, &size, false))
    {
-      free(data);
+      save_state_buf_release(data);
       return NULL;
    }
 
@@ -498,50 +922,40 @@ static void *content_get_serialized_data(size_t* serial_size)
  * task_save_handler:
  * @task : the task being worked on
  *
- * Write a chunk of data to the save state file.
+ * Hand the save state over to the save state writer, and finish
+ * once it is on disk.
  **/
 static void task_save_handler(retro_task_t *task)
 {
-   uint8_t flg;
-   ssize_t remaining;
-   int written              = 0;
+   char *msg                = NULL;
    save_task_state_t *state = (save_task_state_t*)task->state;
 
-   if (!state->file)
+   if (state->write_status == SAVE_STATE_WRITE_NONE)
    {
-      if (state->flags & SAVE_TASK_FLAG_COMPRESS_FILES)
-         state->file   = intfstream_open_rzip_file(
-               state->path, RETRO_VFS_FILE_ACCESS_WRITE);
-      else
-         state->file   = intfstream_open_file(
-               state->path, RETRO_VFS_FILE_ACCESS_WRITE,
-               RETRO_VFS_FILE_ACCESS_HINT_NONE);
+      if (!state->data)
+      {
+         size_t size = 0;
+         state->data = content_get_serialized_data(&size);
+         state->size = (ssize_t)size;
+      }
 
-      if (!state->file)
+      if (!state->data)
+         state->write_status = SAVE_STATE_WRITE_FAILED;
+#ifdef HAVE_THREADS
+      else if (save_state_writer_push(state))
          return;
+#endif
+      else
+         save_state_write(state);
    }
 
-   if (!state->data)
-   {
-      size_t size = 0;
-      state->data = content_get_serialized_data(&size);
-      state->size = (ssize_t)size;
-   }
-
-   remaining       = MIN(state->size - state->written, SAVE_STATE_CHUNK);
-
-   if (state->data)
-   {
-      written         = (int)intfstream_write(state->file,
-         (uint8_t*)state->data + state->written, remaining);
-      state->written += written;
-   }
-
-   task_set_progress(task, (state->written / (float)state->size) * 100);
-
-   flg = task_get_flags(task);
+#ifdef HAVE_THREADS
+   if (     state->write_status == SAVE_STATE_WRITE_PENDING
+         && !save_state_writer_poll(state))
+      return;
+#endif
 
-   if (((flg & RETRO_TASK_FLG_CANCELLED) > 0) || written != remaining)
+   if (state->write_status != SAVE_STATE_WRITE_DONE)
    {
       char msg[128];
 
@@ -568,38 +982,34 @@ static void task_save_handler(retro_task_t *task)
       return;
    }
 
-   if (state->written == state->size)
-   {
-      char       *msg      = NULL;
-
-      task_free_title(task);
+   task_set_progress(task, 100);
+   task_free_title(task);
 
-      if (state->flags & SAVE_TASK_FLAG_UNDO_SAVE)
-         msg = strdup(msg_hash_to_str(MSG_RESTORED_OLD_SAVE_STATE));
-      else if (state->state_slot < 0)
-         msg = strdup(msg_hash_to_str(MSG_SAVED_STATE_TO_SLOT_AUTO));
-      else
-      {
-         char new_msg[128];
-         new_msg[0] = '\0';
+   if (state->flags & SAVE_TASK_FLAG_UNDO_SAVE)
+      msg = strdup(msg_hash_to_str(MSG_RESTORED_OLD_SAVE_STATE));
+   else if (state->state_slot < 0)
+      msg = strdup(msg_hash_to_str(MSG_SAVED_STATE_TO_SLOT_AUTO));
+   else
+   {
+      char new_msg[128];
+      new_msg[0] = '\0';
 
-         snprintf(new_msg, sizeof(new_msg),
-               msg_hash_to_str(MSG_SAVED_STATE_TO_SLOT),
-               state->state_slot);
-         msg = strdup(new_msg);
-      }
+      snprintf(new_msg, sizeof(new_msg),
+            msg_hash_to_str(MSG_SAVED_STATE_TO_SLOT),
+            state->state_slot);
+      msg = strdup(new_msg);
+   }
 
-      if (!((flg & RETRO_TASK_FLG_MUTE) > 0) && msg)
-      {
-         task_set_title(task, msg);
-         msg = NULL;
-      }
+   if (!((task_get_flags(task) & RETRO_TASK_FLG_MUTE) > 0) && msg)
+   {
+      task_set_title(task, msg);
+      msg = NULL;
+   }
 
-      task_save_handler_finished(task, state);
+   task_save_handler_finished(task, state);
 
-      if (!string_is_empty(msg))
-         free(msg);
-   }
+   if (!string_is_empty(msg))
+      free(msg);
 }
 
 /**
@@ -626,13 +1036,18 @@ static bool task_push_undo_save_state(const char *path, void *data, size_t size)
    strlcpy(state->path, path, sizeof(state->path));
    state->data                   = data;
    state->size                   = size;
+   state->requested              = cpu_features_get_time_usec();
    state->flags                 |= SAVE_TASK_FLAG_UNDO_SAVE;
    state->state_slot             = settings->ints.state_slot;
    if (video_st->frame_cache_data && (video_st->frame_cache_data == RETRO_HW_FRAME_BUFFER_VALID))
       state->flags              |= SAVE_TASK_FLAG_HAS_VALID_FB;
 #if defined(HAVE_ZLIB)
    if (settings->bools.savestate_file_compression)
+   {
       state->flags              |= SAVE_TASK_FLAG_COMPRESS_FILES;
+      state->compress_level      = (uint8_t)
+         settings->uints.savestate_file_compression_level;
+   }
 #endif
    if (!settings->bools.notification_show_save_state)
       state->flags              |= SAVE_TASK_FLAG_MUTE;
@@ -672,10 +1087,13 @@ error:
 bool content_undo_save_state(void)
 {
    if (core_info_current_supports_savestate())
+   {
+      save_state_writer_init();
       return task_push_undo_save_state(
             undo_save_buf.path,
             undo_save_buf.data,
             undo_save_buf.size);
+   }
    RARCH_LOG("[State]: %s\n",
          msg_hash_to_str(MSG_CORE_DOES_NOT_SUPPORT_SAVESTATES));
    return false;
@@ -1160,7 +1578,8 @@ static void save_state_cb(retro_task_t *task,
  *
  * Create a new task to save the content state.
  **/
-static void task_push_save_state(const char *path, void *data, size_t size, bool autosave)
+static void task_push_save_state(const char *path, void *data, size_t size,
+      bool autosave, retro_time_t requested)
 {
    settings_t     *settings        = config_get_ptr();
    retro_task_t       *task        = task_init();
@@ -1173,6 +1592,7 @@ static void task_push_save_state(const char *path, void *data, size_t size, bool
    strlcpy(state->path, path, sizeof(state->path));
    state->data                   = data;
    state->size                   = size;
+   state->requested              = requested;
    /* Don't show OSD messages if we are auto-saving */
    if (autosave)
       state->flags              |= (SAVE_TASK_FLAG_AUTOSAVE |
@@ -1190,7 +1610,11 @@ static void task_push_save_state(const char *path, void *data, size_t size, bool
       state->flags              |= SAVE_TASK_FLAG_HAS_VALID_FB;
 #if defined(HAVE_ZLIB)
    if (settings->bools.savestate_file_compression)
+   {
       state->flags              |= SAVE_TASK_FLAG_COMPRESS_FILES;
+      state->compress_level      = (uint8_t)
+         settings->uints.savestate_file_compression_level;
+   }
 #endif
    if (!settings->bools.notification_show_save_state)
       state->flags              |= SAVE_TASK_FLAG_MUTE;
@@ -1210,7 +1634,7 @@ static void task_push_save_state(const char *path, void *data, size_t size, bool
    {
       /* Another blocking task is already active. */
       if (data)
-         free(data);
+         save_state_buf_release(data);
       if (task->title)
          task_free_title(task);
       free(task);
@@ -1221,7 +1645,7 @@ static void task_push_save_state(const char *path, void *data, size_t size, bool
 
 error:
    if (data)
-      free(data);
+      save_state_buf_release(data);
    if (state)
       free(state);
    if (task)
@@ -1250,7 +1674,8 @@ static void content_load_and_save_state_cb(retro_task_t *task,
 
    content_load_state_cb(task, task_data, user_data, error);
 
-   task_push_save_state(path, data, size, autosave);
+   task_push_save_state(path, data, size, autosave,
+         load_data->requested);
 
    free(path);
 }
@@ -1266,7 +1691,8 @@ static void content_load_and_save_state_cb(retro_task_t *task,
  * and then save the content state.
  **/
 static void task_push_load_and_save_state(const char *path, void *data,
-      size_t size, bool load_to_backup_buffer, bool autosave)
+      size_t size, bool load_to_backup_buffer, bool autosave,
+      retro_time_t requested)
 {
    retro_task_t      *task         = NULL;
    settings_t        *settings     = config_get_ptr();
@@ -1289,6 +1715,7 @@ static void task_push_load_and_save_state(const char *path, void *data,
       state->flags              |= SAVE_TASK_FLAG_LOAD_TO_BACKUP_BUFF;
    state->undo_size              = size;
    state->undo_data              = data;
+   state->requested              = requested;
    /* Don't show OSD messages if we are auto-saving */
    if (autosave)
       state->flags              |= (SAVE_TASK_FLAG_AUTOSAVE |
@@ -1300,7 +1727,11 @@ static void task_push_load_and_save_state(const char *path, void *data,
       state->flags              |= SAVE_TASK_FLAG_HAS_VALID_FB;
 #if defined(HAVE_ZLIB)
    if (settings->bools.savestate_file_compression)
+   {
       state->flags              |= SAVE_TASK_FLAG_COMPRESS_FILES;
+      state->compress_level      = (uint8_t)
+         settings->uints.savestate_file_compression_level;
+   }
 #endif
    if (!settings->bools.notification_show_save_state)
       state->flags              |= SAVE_TASK_FLAG_MUTE;
@@ -1320,7 +1751,7 @@ static void task_push_load_and_save_state(const char *path, void *data,
    {
       /* Another blocking task is already active. */
       if (data)
-         free(data);
+         save_state_buf_release(data);
       if (task->title)
          task_free_title(task);
       free(task);
@@ -1339,10 +1770,12 @@ static void task_push_load_and_save_state(const char *path, void *data,
  **/
 bool content_auto_save_state(const char *path)
 {
-   settings_t *settings = config_get_ptr();
-   void *serial_data  = NULL;
+   settings_t *settings   = config_get_ptr();
+   retro_time_t requested = cpu_features_get_time_usec();
+   void *serial_data      = NULL;
    size_t serial_size;
-   intfstream_t *file = NULL;
+   bool compress          = false;
+   unsigned level         = 0;
 
    if (!core_info_current_supports_savestate())
    {
@@ -1356,35 +1789,36 @@ bool content_auto_save_state(const char *path)
    if (serial_size == 0)
       return false;
 
+   save_state_writer_init();
+
    serial_data = content_get_serialized_data(&serial_size);
    if (!serial_data)
       return false;
 
 #if defined(HAVE_ZLIB)
-   if (settings->bools.savestate_file_compression)
-      file = intfstream_open_rzip_file(path, RETRO_VFS_FILE_ACCESS_WRITE);
-   else
+   compress = settings->bools.savestate_file_compression;
+   level    = settings->uints.savestate_file_compression_level;
 #endif
-      file = intfstream_open_file(path, RETRO_VFS_FILE_ACCESS_WRITE,
-                                  RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
-   if (!file)
+   if (!content_write_state_file(path, serial_data, serial_size,
+            compress, level))
    {
-      free(serial_data);
+      save_state_buf_release(serial_data);
       return false;
    }
 
-   if (serial_size != (size_t)intfstream_write(file, serial_data, serial_size))
-   {
-      intfstream_close(file);
-      free(serial_data);
-      free(file);
-      return false;
-   }
+   save_state_buf_release(serial_data);
 
-   intfstream_close(file);
-   free(serial_data);
-   free(file);
+#ifdef HAVE_THREADS
+   if (save_writer.lock)
+      slock_lock(save_writer.lock);
+#endif
+   RARCH_LOG("[State]: \"%s\" on disk %u ms after the save.\n",
+         path, save_state_record_latency(requested));
+#ifdef HAVE_THREADS
+   if (save_writer.lock)
+      slock_unlock(save_writer.lock);
+#endif
 
 #ifdef HAVE_SCREENSHOTS
    if (settings->bools.savestate_thumbnail_enable)
@@ -1413,7 +1847,8 @@ bool content_auto_save_state(const char *path)
 bool content_save_state(const char *path, bool save_to_disk)
 {
    size_t serial_size;
-   void *data  = NULL;
+   void *data             = NULL;
+   retro_time_t requested = cpu_features_get_time_usec();
 
    if (!core_info_current_supports_savestate())
    {
@@ -1427,6 +1862,8 @@ bool content_save_state(const char *path, bool save_to_disk)
    if (serial_size == 0)
       return false;
 
+   save_state_writer_init();
+
    if (!save_state_in_background)
    {
       if (!(data = content_get_serialized_data(&serial_size)))
@@ -1453,10 +1890,11 @@ bool content_save_state(const char *path, bool save_to_disk)
          /* TODO/FIXME - Use msg_hash_to_str here */
          RARCH_LOG("[State]: %s ...\n",
                msg_hash_to_str(MSG_FILE_ALREADY_EXISTS_SAVING_TO_BACKUP_BUFFER));
-         task_push_load_and_save_state(path, data, serial_size, true, false);
+         task_push_load_and_save_state(path, data, serial_size, true, false,
+               requested);
       }
       else
-         task_push_save_state(path, data, serial_size, false);
+         task_push_save_state(path, data, serial_size, false, requested);
    }
    else
    {
@@ -1483,12 +1921,12 @@ bool content_save_state(const char *path, bool save_to_disk)
 
       if (!(undo_load_buf.data = malloc(serial_size)))
       {
-         free(data);
+         save_state_buf_release(data);
          return false;
       }
 
       memcpy(undo_load_buf.data, data, serial_size);
-      free(data);
+      save_state_buf_release(data);
       undo_load_buf.size = serial_size;
       strlcpy(undo_load_buf.path, path, sizeof(undo_load_buf.path));
    }
@@ -1589,7 +2027,11 @@ bool content_load_state(const char *path,
       state->flags             |= SAVE_TASK_FLAG_HAS_VALID_FB;
 #if defined(HAVE_ZLIB)
    if (settings->bools.savestate_file_compression)
+   {
       state->flags             |= SAVE_TASK_FLAG_COMPRESS_FILES;
+      state->compress_level     = (uint8_t)
+         settings->uints.savestate_file_compression_level;
+   }
 #endif
    if (!settings->bools.notification_show_save_state)
       state->flags             |= SAVE_TASK_FLAG_MUTE;
@@ -1665,6 +2107,8 @@ void content_reset_savestate_backups(void)
    ram_buf.state_buf.path[0] = '\0';
    ram_buf.state_buf.size    = 0;
    ram_buf.to_write_file     = false;
+
+   save_state_writer_deinit();
 }
 
 bool content_undo_load_buf_is_empty(void)
@@ -1752,6 +2196,8 @@ bool content_save_state_to_ram(void)
    if (serial_size == 0)
       return false;
 
+   save_state_writer_init();
+
    if (!save_state_in_background)
    {
       if (!(data = content_get_serialized_data(&serial_size)))
@@ -1786,12 +2232,12 @@ bool content_save_state_to_ram(void)
 
    if (!(ram_buf.state_buf.data = malloc(serial_size)))
    {
-      free(data);
+      save_state_buf_release(data);
       return false;
    }
 
    memcpy(ram_buf.state_buf.data, data, serial_size);
-   free(data);
+   save_state_buf_release(data);
    ram_buf.state_buf.size = serial_size;
    ram_buf.to_write_file  = true;
 
@@ -215,6 +215,7 @@ bool patch_content(
       const char *name_bps,
       const char *name_ups,
       const char *name_xdelta,
+      const char *dir_cache,
       uint8_t **buf,
       void *data);
 
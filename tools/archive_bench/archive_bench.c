@@ -0,0 +1,266 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures file lists, CRC32 lookups and member reads of ZIP and
+ * 7z archives with and without the archive directory cache, the
+ * calls content scanning and loading make for every member. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include "compat/getopt.h"
+#include <compat/strl.h>
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+#include <file/archive_file.h>
+#include <lists/string_list.h>
+
+struct bench_result
+{
+   retro_time_t list_usec;
+   retro_time_t crc_usec;
+   retro_time_t read_usec;
+   retro_time_t multi_usec;
+   uint32_t *crcs;
+   uint32_t *read_crcs;
+   unsigned reads;
+   bool ok;
+};
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Usage: archive_bench [-n runs] [-r reads] file.zip|file.7z...\n"
+      "    -n   File lists and CRC32 lookups per member, the\n"
+      "         fastest run is reported. Defaults to 5.\n"
+      "    -r   Members read, spread over the archive. Defaults to 16.\n");
+}
+
+static bool bench_archive(const char *path, const struct string_list *list,
+      unsigned runs, unsigned reads, struct bench_result *res)
+{
+   char member[PATH_MAX_LENGTH];
+   unsigned r;
+   size_t i;
+   retro_time_t t0;
+   size_t step        = list->size / reads ? list->size / reads : 1;
+   const char **names = (const char**)calloc(reads, sizeof(*names));
+   void **bufs        = (void**)calloc(reads, sizeof(*bufs));
+   int64_t *lengths   = (int64_t*)calloc(reads, sizeof(*lengths));
+
+   res->ok            = true;
+   res->reads         = 0;
+   res->list_usec     = 0;
+   res->crc_usec      = 0;
+   res->read_usec     = 0;
+   res->multi_usec    = 0;
+
+   if (!names || !bufs || !lengths)
+   {
+      free(names);
+      free(bufs);
+      free(lengths);
+      return false;
+   }
+
+   for (r = 0; r < runs; r++)
+   {
+      struct string_list *l;
+      retro_time_t t1, t2;
+
+      t0 = cpu_features_get_time_usec();
+      if (!(l = file_archive_get_file_list(path, NULL)))
+      {
+         res->ok = false;
+         break;
+      }
+      if (l->size != list->size)
+         res->ok = false;
+      for (i = 0; i < l->size && res->ok; i++)
+         if (strcmp(l->elems[i].data, list->elems[i].data))
+            res->ok = false;
+      string_list_free(l);
+      t1 = cpu_features_get_time_usec();
+
+      for (i = 0; i < list->size; i++)
+      {
+         snprintf(member, sizeof(member), "%s#%s", path, list->elems[i].data);
+         res->crcs[i] = file_archive_get_file_crc32(member);
+      }
+      t2 = cpu_features_get_time_usec();
+
+      if (r == 0 || t1 - t0 < res->list_usec)
+         res->list_usec = t1 - t0;
+      if (r == 0 || t2 - t1 < res->crc_usec)
+         res->crc_usec  = t2 - t1;
+   }
+
+   for (i = 0; i < list->size && res->reads < reads; i += step)
+   {
+      void *buf      = NULL;
+      int64_t len    = 0;
+      const char *name = list->elems[i].data;
+      size_t name_len  = strlen(name);
+
+      if (name[name_len - 1] == '/')
+         continue;
+
+      snprintf(member, sizeof(member), "%s#%s", path, name);
+      t0 = cpu_features_get_time_usec();
+      if (!file_archive_compressed_read(member, &buf, NULL, &len))
+         res->ok = false;
+      res->read_usec += cpu_features_get_time_usec() - t0;
+
+      names[res->reads]            = name;
+      res->read_crcs[res->reads++] = buf
+         ? encoding_crc32(0, (const uint8_t*)buf, (size_t)len) : 0;
+      free(buf);
+   }
+
+   /* The same members again, in one call */
+   t0 = cpu_features_get_time_usec();
+   if (file_archive_compressed_read_multi(path, names, res->reads,
+            bufs, lengths) != res->reads)
+      res->ok = false;
+   res->multi_usec = cpu_features_get_time_usec() - t0;
+
+   for (r = 0; r < res->reads; r++)
+   {
+      if (!bufs[r] || res->read_crcs[r] != encoding_crc32(0,
+               (const uint8_t*)bufs[r], (size_t)lengths[r]))
+         res->ok = false;
+      free(bufs[r]);
+   }
+
+   free(names);
+   free(bufs);
+   free(lengths);
+   return true;
+}
+
+static double usec_per_call(retro_time_t usec, size_t calls)
+{
+   return calls ? (double)usec / (double)calls : 0.0;
+}
+
+int main(int argc, char **argv)
+{
+   int opt;
+   int i;
+   unsigned runs   = 5;
+   unsigned reads  = 16;
+   int failed      = 0;
+
+   while ((opt = getopt(argc, argv, "n:r:")) != -1)
+   {
+      switch (opt)
+      {
+         case 'n':
+            runs  = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'r':
+            reads = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (optind >= argc || !runs || !reads)
+   {
+      usage();
+      return 1;
+   }
+
+   printf("%-24s %7s %-8s %12s %12s %12s %12s\n",
+         "archive", "members", "cache", "list usec", "crc usec",
+         "read usec", "multi usec");
+
+   for (i = optind; i < argc; i++)
+   {
+      struct bench_result res[2];
+      struct string_list *list;
+      unsigned c;
+      size_t j;
+      const char *name;
+
+      if (!(name = strrchr(argv[i], '/')))
+         name = argv[i];
+      else
+         name++;
+
+      /* Reference listing, walked without the cache */
+      file_archive_cache_deinit();
+      if (!(list = file_archive_get_file_list(argv[i], NULL)) || !list->size)
+      {
+         fprintf(stderr, "Cannot list %s\n", argv[i]);
+         string_list_free(list);
+         failed = 1;
+         continue;
+      }
+
+      for (c = 0; c < 2; c++)
+      {
+         res[c].crcs      = (uint32_t*)calloc(list->size, sizeof(uint32_t));
+         res[c].read_crcs = (uint32_t*)calloc(reads, sizeof(uint32_t));
+
+         if (c)
+            file_archive_cache_init();
+         else
+            file_archive_cache_deinit();
+
+         if (!bench_archive(argv[i], list, runs, reads, &res[c]))
+            res[c].ok = false;
+
+         printf("%-24.24s %7u %-8s %12.1f %12.1f %12.1f %12.1f%s\n",
+               name, (unsigned)list->size, c ? "on" : "off",
+               (double)res[c].list_usec,
+               usec_per_call(res[c].crc_usec, list->size),
+               usec_per_call(res[c].read_usec, res[c].reads),
+               usec_per_call(res[c].multi_usec, res[c].reads),
+               res[c].ok ? "" : " FAILED");
+      }
+
+      /* Both runs must agree on every CRC32 and member */
+      for (j = 0; j < list->size; j++)
+         if (res[0].crcs[j] != res[1].crcs[j])
+            res[1].ok = false;
+      if (res[0].reads != res[1].reads || memcmp(res[0].read_crcs,
+               res[1].read_crcs, res[0].reads * sizeof(uint32_t)))
+         res[1].ok = false;
+
+      if (!res[0].ok || !res[1].ok)
+      {
+         printf("%-24.24s results differ\n", name);
+         failed = 1;
+      }
+
+      for (c = 0; c < 2; c++)
+      {
+         free(res[c].crcs);
+         free(res[c].read_crcs);
+      }
+      string_list_free(list);
+   }
+
+   file_archive_cache_deinit();
+   return failed;
+}
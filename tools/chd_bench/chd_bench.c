@@ -0,0 +1,346 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures CHD stream reads with different hunk cache settings,
+ * for a sequential pass over a track and for two interleaved
+ * cursors, as a CD core streaming audio next to data would.
+ * Then measures how fast the whole image decompresses one hunk at
+ * a time, in batches on several threads and into memory. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include "compat/getopt.h"
+#include <features/features_cpu.h>
+#include <streams/chd_stream.h>
+#include <libchdr/chd.h>
+
+/* Hunks per chd_read_hunks() call */
+#define BATCH_HUNKS 64
+
+struct bench_config
+{
+   const char *name;
+   unsigned hunks;
+   unsigned prefetch;
+};
+
+static const struct bench_config configs[] = {
+   { "1 hunk",          1,                     0                        },
+   { "cache",           CHDSTREAM_CACHE_HUNKS, 0                        },
+   { "cache+prefetch",  CHDSTREAM_CACHE_HUNKS, CHDSTREAM_PREFETCH_HUNKS },
+};
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Usage: chd_bench [-t track] [-s sectors] [-c cpu_usec] [-j threads] file.chd\n"
+      "    -t   Track number, defaults to the primary data track.\n"
+      "    -s   Sectors read per cursor step. Defaults to 1.\n"
+      "    -c   Simulated work per sector in microseconds, which\n"
+      "         prefetching can overlap with. Defaults to 0.\n"
+      "    -j   Most threads to decompress the image on.\n"
+      "         Defaults to the number of CPU cores.\n");
+}
+
+static void spin(unsigned usec)
+{
+   retro_time_t end = cpu_features_get_time_usec() + usec;
+   while (usec && cpu_features_get_time_usec() < end);
+}
+
+/* Reads the track through one cursor, or two cursors starting at
+ * the beginning and the middle of the track taking turns. */
+static bool bench_pass(chdstream_t *stream, bool interleaved,
+      unsigned sectors, unsigned work, uint64_t *bytes)
+{
+   uint8_t *buf;
+   uint32_t frame   = chdstream_get_frame_size(stream);
+   int64_t size     = (int64_t)chdstream_get_size(stream);
+   int64_t pos[2];
+   int64_t end[2];
+   unsigned cursors = interleaved ? 2 : 1;
+   unsigned c       = 0;
+   size_t step      = (size_t)frame * sectors;
+
+   if (!(buf = (uint8_t*)malloc(step)))
+      return false;
+
+   pos[0] = 0;
+   end[0] = interleaved ? size / 2 : size;
+   pos[1] = end[0];
+   end[1] = size;
+   *bytes = 0;
+
+   while (pos[0] < end[0] || (interleaved && pos[1] < end[1]))
+   {
+      size_t len;
+      ssize_t got;
+
+      if (pos[c] >= end[c])
+      {
+         c = (c + 1) % cursors;
+         continue;
+      }
+
+      len = step;
+      if ((int64_t)len > end[c] - pos[c])
+         len = (size_t)(end[c] - pos[c]);
+
+      chdstream_seek(stream, pos[c], SEEK_SET);
+      if ((got = chdstream_read(stream, buf, len)) != (ssize_t)len)
+      {
+         free(buf);
+         return false;
+      }
+
+      spin(work * sectors);
+
+      pos[c] += len;
+      *bytes += len;
+      c       = (c + 1) % cursors;
+   }
+
+   free(buf);
+   return true;
+}
+
+static double mb_per_sec(uint64_t bytes, retro_time_t usec)
+{
+   return usec > 0 ? (double)bytes / (double)usec : 0.0;
+}
+
+static uint64_t hash_hunks(uint64_t hash, const uint8_t *data, size_t len)
+{
+   size_t i;
+   for (i = 0; i < len; i++)
+      hash = (hash ^ data[i]) * 0x100000001b3ULL;
+   return hash;
+}
+
+/* Decompresses every hunk with chd_read() if threads is 0, with
+ * chd_read_hunks() otherwise, or with chd_precache_decompressed()
+ * if precache is set, and hashes the result. */
+static bool bench_decode(const char *path, unsigned threads, bool precache,
+      uint64_t *hash, retro_time_t *usec)
+{
+   uint32_t h;
+   uint8_t *buf;
+   retro_time_t start;
+   const chd_header *header;
+   chd_file *chd = NULL;
+   bool ok       = true;
+
+   if (chd_open(path, CHD_OPEN_READ, NULL, &chd) != CHDERR_NONE)
+      return false;
+
+   header = chd_get_header(chd);
+   if (!(buf = (uint8_t*)malloc((size_t)header->hunkbytes * BATCH_HUNKS)))
+   {
+      chd_close(chd);
+      return false;
+   }
+
+   start = cpu_features_get_time_usec();
+   if (precache)
+      ok = chd_precache_decompressed(chd, threads) == CHDERR_NONE;
+   *usec = cpu_features_get_time_usec() - start;
+   *hash = 0xcbf29ce484222325ULL;
+
+   for (h = 0; ok && h < header->totalhunks; h += BATCH_HUNKS)
+   {
+      uint32_t i;
+      uint32_t count = header->totalhunks - h;
+
+      if (count > BATCH_HUNKS)
+         count = BATCH_HUNKS;
+
+      start = cpu_features_get_time_usec();
+      if (threads && !precache)
+         ok = chd_read_hunks(chd, h, count, buf, threads) == CHDERR_NONE;
+      else
+         for (i = 0; ok && i < count; i++)
+            ok = chd_read(chd, h + i,
+                  buf + (size_t)i * header->hunkbytes) == CHDERR_NONE;
+      if (!precache)
+         *usec += cpu_features_get_time_usec() - start;
+
+      *hash = hash_hunks(*hash, buf, (size_t)header->hunkbytes * count);
+   }
+
+   free(buf);
+   chd_close(chd);
+   return ok;
+}
+
+static void bench_decode_all(const char *path, unsigned max_threads,
+      int *failed)
+{
+   unsigned i, t;
+   uint64_t bytes;
+   uint64_t expected    = 0;
+   retro_time_t usec    = 0;
+   chd_file *chd        = NULL;
+   const chd_header *header;
+
+   if (chd_open(path, CHD_OPEN_READ, NULL, &chd) != CHDERR_NONE)
+   {
+      fprintf(stderr, "Cannot open %s\n", path);
+      *failed = 1;
+      return;
+   }
+
+   header = chd_get_header(chd);
+   bytes  = (uint64_t)header->totalhunks * header->hunkbytes;
+
+   printf("\nCHD v%u, %u hunks of %u bytes, codecs:",
+         header->version, header->totalhunks, header->hunkbytes);
+   for (i = 0; i < 4; i++)
+      if (header->compression[i] || i == 0)
+         printf(" %s", chd_get_codec_name(header->compression[i]));
+   printf("\n");
+   chd_close(chd);
+
+   printf("%-16s %7s %9s\n", "decode", "threads", "MB/s");
+
+   /* Plain chd_read() gives the reference hash */
+   if (!bench_decode(path, 0, false, &expected, &usec))
+   {
+      printf("%-16s %7u FAILED\n", "chd_read", 1);
+      *failed = 1;
+      return;
+   }
+   printf("%-16s %7u %9.1f\n", "chd_read", 1, mb_per_sec(bytes, usec));
+
+   for (i = 0; i < 2; i++)
+   {
+      const char *name = i ? "precache" : "chd_read_hunks";
+
+      /* 1, 2, 4... and max_threads */
+      for (t = 1; ; t = (t * 2 < max_threads) ? t * 2 : max_threads)
+      {
+         uint64_t hash = 0;
+
+         if (!bench_decode(path, t, i == 1, &hash, &usec) || hash != expected)
+         {
+            printf("%-16s %7u FAILED\n", name, t);
+            *failed = 1;
+         }
+         else
+            printf("%-16s %7u %9.1f\n", name, t, mb_per_sec(bytes, usec));
+
+         if (t >= max_threads)
+            break;
+      }
+   }
+}
+
+int main(int argc, char **argv)
+{
+   int opt;
+   unsigned i, p;
+   int32_t track     = CHDSTREAM_TRACK_PRIMARY;
+   unsigned sectors  = 1;
+   unsigned work     = 0;
+   unsigned threads  = cpu_features_get_core_amount();
+   int failed        = 0;
+
+   while ((opt = getopt(argc, argv, "t:s:c:j:")) != -1)
+   {
+      switch (opt)
+      {
+         case 't':
+            track   = (int32_t)strtol(optarg, NULL, 0);
+            break;
+         case 's':
+            sectors = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'c':
+            work    = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'j':
+            threads = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (optind != argc - 1 || !sectors || !threads)
+   {
+      usage();
+      return 1;
+   }
+
+   printf("%u CPU cores\n", cpu_features_get_core_amount());
+   printf("%-12s %-15s %9s %9s %9s %11s %9s\n",
+         "pattern", "cache", "MB/s", "hit rate", "prefetch",
+         "decompress", "us/hunk");
+
+   for (p = 0; p < 2; p++)
+   {
+      for (i = 0; i < sizeof(configs) / sizeof(configs[0]); i++)
+      {
+         chdstream_stats_t stats;
+         uint64_t bytes    = 0;
+         uint64_t lookups;
+         retro_time_t start, usec;
+         chdstream_t *stream = chdstream_open(argv[optind], track);
+
+         if (!stream)
+         {
+            fprintf(stderr, "Cannot open track %d of %s\n",
+                  (int)track, argv[optind]);
+            return 1;
+         }
+
+         chdstream_set_cache(stream, configs[i].hunks, configs[i].prefetch);
+
+         start = cpu_features_get_time_usec();
+         if (!bench_pass(stream, p == 1, sectors, work, &bytes))
+         {
+            printf("%-12s %-15s FAILED\n",
+                  p ? "interleaved" : "sequential", configs[i].name);
+            failed = 1;
+            chdstream_close(stream);
+            continue;
+         }
+         usec = cpu_features_get_time_usec() - start;
+
+         chdstream_get_stats(stream, &stats);
+         chdstream_close(stream);
+
+         lookups = stats.hits + stats.misses;
+         printf("%-12s %-15s %9.1f %8.1f%% %8.1f%% %9.1fms %9.1f\n",
+               p ? "interleaved" : "sequential", configs[i].name,
+               mb_per_sec(bytes, usec),
+               lookups ? 100.0 * stats.hits / lookups : 0.0,
+               lookups ? 100.0 * stats.prefetch_hits / lookups : 0.0,
+               stats.decompress_usec / 1000.0,
+               stats.decompressed
+               ? (double)stats.decompress_usec / stats.decompressed : 0.0);
+      }
+   }
+
+   bench_decode_all(argv[optind], threads, &failed);
+
+   return failed;
+}
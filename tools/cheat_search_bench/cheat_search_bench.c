@@ -0,0 +1,474 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cheat_search.h"
+
+#define MAX_BUFFERS 4
+
+static const char *type_names[] = {
+   "exact", "lt", "lte", "gt", "gte", "eq", "neq", "eq+", "eq-"
+};
+
+/* A core's system RAM, split over several memory descriptors.
+ * Buffer sizes are deliberately not multiples of a group's span,
+ * so groups straddling two buffers are exercised too. */
+struct memory_image
+{
+   uint8_t *buf[MAX_BUFFERS];
+   unsigned size[MAX_BUFFERS];
+   unsigned num_buffers;
+   unsigned total;
+   uint8_t *prev;
+};
+
+static double now_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static unsigned rng(unsigned *seed)
+{
+   *seed = *seed * 1103515245 + 12345;
+   return *seed >> 8;
+}
+
+/* Mostly zeroes and small counters, like real game RAM.
+ * Calling it again restores the same contents. */
+static void synth_memory(struct memory_image *img, unsigned total,
+      unsigned seed)
+{
+   unsigned i, j, off = 0;
+
+   img->num_buffers = MAX_BUFFERS;
+   img->total       = 0;
+
+   for (i = 0; i < MAX_BUFFERS; i++)
+   {
+      img->size[i] = (total / MAX_BUFFERS) & ~3U;
+      if (i < MAX_BUFFERS - 1)
+         img->size[i] += 4 * (i + 1) + 100;
+      if (!img->buf[i])
+         img->buf[i] = (uint8_t*)malloc(img->size[i]);
+      img->total  += img->size[i];
+
+      for (j = 0; j < img->size[i]; j++)
+      {
+         unsigned r = rng(&seed);
+         img->buf[i][j] = (r & 7) ? (uint8_t)(r >> 12 & 3) : (uint8_t)(r >> 12);
+      }
+   }
+
+   if (!img->prev)
+      img->prev = (uint8_t*)malloc(img->total);
+   for (i = 0; i < img->num_buffers; i++)
+   {
+      memcpy(img->prev + off, img->buf[i], img->size[i]);
+      off += img->size[i];
+   }
+}
+
+/* Changes a few bytes between searches, as a running game would */
+static void mutate_memory(struct memory_image *img, unsigned *seed)
+{
+   unsigned i, j, off = 0;
+
+   for (i = 0; i < img->num_buffers; i++)
+   {
+      memcpy(img->prev + off, img->buf[i], img->size[i]);
+      off += img->size[i];
+
+      for (j = 0; j < img->size[i] / 64; j++)
+      {
+         unsigned pos = rng(seed) % img->size[i];
+         img->buf[i][pos] += (uint8_t)(rng(seed) % 3) - 1;
+      }
+   }
+}
+
+static unsigned translate_address(const struct memory_image *img,
+      unsigned address, uint8_t **curr)
+{
+   unsigned i, offset = 0;
+
+   for (i = 0; i < img->num_buffers; i++)
+   {
+      if (address >= offset && address < offset + img->size[i])
+      {
+         *curr = img->buf[i];
+         break;
+      }
+      offset += img->size[i];
+   }
+
+   return offset;
+}
+
+/* The search as cheat_manager_search() did it before the bitset:
+ * one item at a time, a byte of match flags per address. */
+static unsigned legacy_search(const struct memory_image *img,
+      uint8_t *matches, const struct cheat_search_params *params,
+      unsigned num_matches)
+{
+   unsigned idx;
+   unsigned bits           = params->bits < 8 ? params->bits : 8;
+   unsigned bytes_per_item = params->bits < 8 ? 1 : params->bits / 8;
+   unsigned mask           = params->bits >= 32 ? 0xFFFFFFFF
+      : (1U << params->bits) - 1;
+   uint8_t *curr           = img->buf[0];
+
+   for (idx = 0; idx + bytes_per_item <= img->total; idx += bytes_per_item)
+   {
+      unsigned byte_part;
+      unsigned offset   = translate_address(img, idx, &curr);
+      unsigned curr_val = cheat_search_read(curr + idx - offset,
+            bytes_per_item, params->big_endian);
+      unsigned prev_val = cheat_search_read(img->prev + idx,
+            bytes_per_item, params->big_endian);
+
+      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
+      {
+         unsigned curr_subval = (curr_val >> (byte_part * bits)) & mask;
+         unsigned prev_subval = (prev_val >> (byte_part * bits)) & mask;
+         unsigned prev_match  = (bits < 8)
+            ? matches[idx] & (mask << (byte_part * bits))
+            : matches[idx];
+         bool match           = false;
+
+         if (!prev_match)
+            continue;
+
+         switch (params->type)
+         {
+            case CHEAT_SEARCH_TYPE_EXACT:
+               match = (curr_subval == params->value);
+               break;
+            case CHEAT_SEARCH_TYPE_LT:
+               match = (curr_subval < prev_subval);
+               break;
+            case CHEAT_SEARCH_TYPE_GT:
+               match = (curr_subval > prev_subval);
+               break;
+            case CHEAT_SEARCH_TYPE_LTE:
+               match = (curr_subval <= prev_subval);
+               break;
+            case CHEAT_SEARCH_TYPE_GTE:
+               match = (curr_subval >= prev_subval);
+               break;
+            case CHEAT_SEARCH_TYPE_EQ:
+               match = (curr_subval == prev_subval);
+               break;
+            case CHEAT_SEARCH_TYPE_NEQ:
+               match = (curr_subval != prev_subval);
+               break;
+            case CHEAT_SEARCH_TYPE_EQPLUS:
+               match = (curr_subval == prev_subval + params->value);
+               break;
+            case CHEAT_SEARCH_TYPE_EQMINUS:
+               match = (curr_subval == prev_subval - params->value);
+               break;
+         }
+
+         if (!match)
+         {
+            if (bits < 8)
+               matches[idx] &= ~(mask << (byte_part * bits)) & 0xFF;
+            else
+               memset(matches + idx, 0, bytes_per_item);
+            num_matches--;
+         }
+      }
+   }
+
+   return num_matches;
+}
+
+/* Mirrors cheat_manager_search_span() */
+static const uint8_t *search_span(const struct memory_image *img,
+      unsigned start, unsigned len, unsigned *buf, unsigned *buf_start,
+      uint8_t *scratch)
+{
+   unsigned i, pos, copied;
+
+   while (*buf + 1 < img->num_buffers
+         && start >= *buf_start + img->size[*buf])
+   {
+      *buf_start += img->size[*buf];
+      (*buf)++;
+   }
+
+   if (start + len <= *buf_start + img->size[*buf])
+      return img->buf[*buf] + (start - *buf_start);
+
+   for (i = *buf, pos = *buf_start, copied = 0;
+         copied < len && i < img->num_buffers; i++)
+   {
+      unsigned from = start + copied - pos;
+
+      if (from < img->size[i])
+      {
+         unsigned n = img->size[i] - from;
+         if (n > len - copied)
+            n = len - copied;
+         memcpy(scratch + copied, img->buf[i] + from, n);
+         copied += n;
+      }
+
+      pos += img->size[i];
+   }
+
+   return scratch;
+}
+
+/* The search as cheat_manager_search() does it now */
+static unsigned bitset_search(const struct memory_image *img,
+      uint64_t *matches, unsigned num_items,
+      const struct cheat_search_params *params, unsigned num_matches,
+      bool scalar)
+{
+   uint8_t scratch[CHEAT_SEARCH_GROUP_SIZE * 4];
+   unsigned word;
+   unsigned buf       = 0;
+   unsigned buf_start = 0;
+   unsigned num_words = num_items / CHEAT_SEARCH_GROUP_SIZE + 1;
+
+   for (word = 0; word < num_words; word++)
+   {
+      const uint8_t *curr;
+      uint64_t hits;
+      uint64_t live  = matches[word];
+      unsigned first = word * CHEAT_SEARCH_GROUP_SIZE;
+      unsigned count = num_items - first;
+      unsigned start = (unsigned)(((uint64_t)first * params->bits) / 8);
+      unsigned len;
+
+      if (!live)
+         continue;
+
+      if (count > CHEAT_SEARCH_GROUP_SIZE)
+         count = CHEAT_SEARCH_GROUP_SIZE;
+      len  = (count * params->bits + 7) / 8;
+      curr = search_span(img, start, len, &buf, &buf_start, scratch);
+      hits = scalar
+         ? cheat_search_compare_scalar(params, curr, img->prev + start, count)
+         : cheat_search_compare(params, curr, img->prev + start, count);
+
+      num_matches  -= cheat_search_count(live & ~hits);
+      matches[word] = live & hits;
+   }
+
+   return num_matches;
+}
+
+static void reset_bitset(uint64_t *matches, unsigned num_items)
+{
+   unsigned num_words = num_items / CHEAT_SEARCH_GROUP_SIZE + 1;
+
+   memset(matches, 0xFF, num_words * sizeof(uint64_t));
+   matches[num_words - 1] = ((uint64_t)1 <<
+         (num_items % CHEAT_SEARCH_GROUP_SIZE)) - 1;
+}
+
+/* Checks the bitset against the legacy byte flags, item by item */
+static bool same_matches(const uint8_t *legacy, const uint64_t *matches,
+      unsigned num_items, unsigned bits)
+{
+   unsigned item;
+
+   for (item = 0; item < num_items; item++)
+   {
+      bool a = (matches[item / 64] >> (item % 64)) & 1;
+      bool b;
+
+      if (bits < 8)
+      {
+         unsigned per_byte = 8 / bits;
+         unsigned mask     = ((1 << bits) - 1) << ((item % per_byte) * bits);
+         b                 = (legacy[item / per_byte] & mask) != 0;
+      }
+      else
+         b = legacy[item * (bits / 8)] != 0;
+
+      if (a != b)
+      {
+         fprintf(stderr, "mismatch at item %u\n", item);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: cheat_search_bench [-m megabytes] [-n steps] [-v]\n"
+      "    -m   Size of the synthetic memory image. Defaults to 32.\n"
+      "    -n   Searches per run, the first one starting from all items.\n"
+      "         Defaults to 3.\n"
+      "    -v   Also check every result against the old search.\n");
+}
+
+int main(int argc, char **argv)
+{
+   struct memory_image img;
+   uint64_t *matches;
+   uint8_t *legacy;
+   unsigned bit_size, type, be;
+   unsigned megabytes = 32;
+   unsigned steps     = 3;
+   bool verify        = false;
+   bool ok            = true;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "m:n:v")) != -1)
+   {
+      switch (opt)
+      {
+         case 'm':
+            megabytes = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'n':
+            steps = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'v':
+            verify = true;
+            break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (!megabytes || megabytes > 512 || !steps)
+   {
+      usage();
+      return 1;
+   }
+
+   memset(&img, 0, sizeof(img));
+   synth_memory(&img, megabytes << 20, 1);
+
+   matches = (uint64_t*)malloc((img.total * 8 / 64 + 1) * sizeof(uint64_t));
+   legacy  = (uint8_t*)malloc(img.total);
+   if (!matches || !legacy)
+      return 1;
+
+   printf("%u MB in %u buffers, %u searches per run\n\n",
+         img.total >> 20, img.num_buffers, steps);
+   printf("%-6s %-6s %-4s %12s %12s %12s %9s\n",
+         "size", "search", "end", "old ms", "scalar ms", "simd ms", "speedup");
+
+   for (bit_size = 0; bit_size <= 5; bit_size++)
+   {
+      for (be = 0; be < (bit_size > 3 ? 2u : 1u); be++)
+      {
+         for (type = CHEAT_SEARCH_TYPE_EXACT;
+               type <= CHEAT_SEARCH_TYPE_EQMINUS; type++)
+         {
+            struct cheat_search_params params;
+            unsigned num_items = (unsigned)(((uint64_t)img.total * 8)
+                  >> bit_size);
+            double t_old = 0, t_scalar = 0, t_simd = 0;
+            unsigned seed, step, n_old, n_scalar, n_simd;
+
+            params.type       = (enum cheat_search_type)type;
+            params.bits       = 1 << bit_size;
+            params.big_endian = be != 0;
+            params.value      = (type == CHEAT_SEARCH_TYPE_EXACT) ? 0 : 1;
+
+            /* Old search */
+            seed  = 7;
+            n_old = num_items;
+            memset(legacy, 0xFF, img.total);
+            for (step = 0; step < steps; step++)
+            {
+               double t = now_ms();
+               n_old    = legacy_search(&img, legacy, &params, n_old);
+               t_old   += now_ms() - t;
+               mutate_memory(&img, &seed);
+            }
+
+            /* Same memory contents for every variant */
+            seed = 7;
+            synth_memory(&img, megabytes << 20, 1);
+
+            n_scalar = num_items;
+            reset_bitset(matches, num_items);
+            for (step = 0; step < steps; step++)
+            {
+               double t  = now_ms();
+               n_scalar  = bitset_search(&img, matches, num_items,
+                     &params, n_scalar, true);
+               t_scalar += now_ms() - t;
+               mutate_memory(&img, &seed);
+            }
+
+            seed = 7;
+            synth_memory(&img, megabytes << 20, 1);
+
+            n_simd = num_items;
+            reset_bitset(matches, num_items);
+            for (step = 0; step < steps; step++)
+            {
+               double t = now_ms();
+               n_simd   = bitset_search(&img, matches, num_items,
+                     &params, n_simd, false);
+               t_simd  += now_ms() - t;
+               mutate_memory(&img, &seed);
+            }
+
+            if (n_simd != n_scalar || n_simd != n_old)
+            {
+               fprintf(stderr, "%u-bit %s: %u matches, scalar %u, old %u\n",
+                     params.bits, type_names[type], n_simd, n_scalar, n_old);
+               ok = false;
+            }
+            else if (verify)
+            {
+               /* Redo the old search for the final flags */
+               unsigned n = num_items;
+
+               seed = 7;
+               synth_memory(&img, megabytes << 20, 1);
+               memset(legacy, 0xFF, img.total);
+               for (step = 0; step < steps; step++)
+               {
+                  n = legacy_search(&img, legacy, &params, n);
+                  mutate_memory(&img, &seed);
+               }
+               if (!same_matches(legacy, matches, num_items, params.bits))
+                  ok = false;
+            }
+
+            printf("%-6u %-6s %-4s %12.1f %12.1f %12.1f %8.1fx\n",
+                  params.bits, type_names[type], be ? "be" : "le",
+                  t_old, t_scalar, t_simd, t_old / t_simd);
+            fflush(stdout);
+
+            seed = 7;
+            synth_memory(&img, megabytes << 20, 1);
+         }
+      }
+   }
+
+   return ok ? 0 : 1;
+}
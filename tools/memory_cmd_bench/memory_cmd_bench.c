@@ -0,0 +1,328 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures how many memory reads per second a client gets out of the
+ * network command interface, polling a set of addresses with
+ * READ_CORE_MEMORY, READ_CORE_MEMORY_BATCH or SUBSCRIBE_CORE_MEMORY. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "compat/getopt.h"
+#include <features/features_cpu.h>
+
+#define REPLY_TIMEOUT_MS 1000
+
+enum bench_mode
+{
+   BENCH_TEXT = 0,
+   BENCH_BATCH,
+   BENCH_SUBSCRIBE
+};
+
+struct bench
+{
+   struct sockaddr_in addr;
+   int fd;
+   enum bench_mode mode;
+   unsigned ranges;
+   unsigned len;
+   unsigned address;
+   unsigned stride;
+   unsigned seconds;
+   uint64_t reads;
+   uint64_t bytes;
+   uint64_t replies;
+   uint64_t timeouts;
+   uint64_t frame_gaps;
+   uint64_t errors;
+};
+
+static uint32_t get32(const uint8_t *p)
+{
+   return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16)
+        | ((uint32_t)p[2] <<  8) |  (uint32_t)p[3];
+}
+
+static void bench_send(struct bench *b, const char *msg)
+{
+   sendto(b->fd, msg, strlen(msg), 0,
+         (struct sockaddr*)&b->addr, sizeof(b->addr));
+}
+
+static ssize_t bench_recv(struct bench *b, uint8_t *buf, size_t len,
+      int timeout_ms)
+{
+   struct pollfd pfd;
+
+   pfd.fd     = b->fd;
+   pfd.events = POLLIN;
+   if (poll(&pfd, 1, timeout_ms) <= 0)
+      return -1;
+   return recv(b->fd, buf, len, 0);
+}
+
+/* Builds "<prefix> <address> <len> ..." for all ranges */
+static void bench_ranges(const struct bench *b, const char *prefix,
+      char *s, size_t len)
+{
+   unsigned i;
+   size_t _len = snprintf(s, len, "%s", prefix);
+
+   for (i = 0; i < b->ranges && _len < len; i++)
+      _len += snprintf(s + _len, len - _len, " %x %u",
+            b->address + i * b->stride, b->len);
+   if (_len < len - 1)
+   {
+      s[_len++] = '\n';
+      s[_len]   = '\0';
+   }
+}
+
+/* Checks a binary reply; returns the frame count, or -1 */
+static int64_t bench_parse_packet(struct bench *b,
+      const uint8_t *buf, ssize_t len)
+{
+   unsigned i, count;
+   const uint8_t *p   = buf + 20;
+   const uint8_t *end = buf + len;
+
+   if (len < 20 || memcmp(buf, "RMEM", 4))
+      return -1;
+
+   count = get32(buf + 16);
+   for (i = 0; i < count; i++)
+   {
+      uint32_t nbytes;
+      if (end - p < 8)
+         return -1;
+      nbytes = get32(p + 4);
+      p     += 8;
+      if ((size_t)(end - p) < nbytes)
+         return -1;
+      if (nbytes != b->len)
+         b->errors++;
+      b->bytes += nbytes;
+      p        += nbytes;
+   }
+   b->reads += count;
+
+   return ((int64_t)get32(buf + 8) << 32) | get32(buf + 12);
+}
+
+static void bench_run(struct bench *b)
+{
+   static uint8_t buf[65536];
+   char msg[4096];
+   int64_t last_frame = -1;
+   retro_time_t renew = cpu_features_get_time_usec() + 1000000;
+   retro_time_t end   = cpu_features_get_time_usec()
+      + (retro_time_t)b->seconds * 1000000;
+
+   if (b->mode == BENCH_SUBSCRIBE)
+   {
+      bench_ranges(b, "SUBSCRIBE_CORE_MEMORY 1", msg, sizeof(msg));
+      bench_send(b, msg);
+   }
+   else if (b->mode == BENCH_BATCH)
+      bench_ranges(b, "READ_CORE_MEMORY_BATCH", msg, sizeof(msg));
+
+   while (cpu_features_get_time_usec() < end)
+   {
+      ssize_t ret;
+
+      if (b->mode == BENCH_TEXT)
+      {
+         unsigned i;
+         for (i = 0; i < b->ranges; i++)
+         {
+            snprintf(msg, sizeof(msg), "READ_CORE_MEMORY %x %u\n",
+                  b->address + i * b->stride, b->len);
+            bench_send(b, msg);
+            if ((ret = bench_recv(b, buf, sizeof(buf) - 1,
+                        REPLY_TIMEOUT_MS)) <= 0)
+            {
+               b->timeouts++;
+               continue;
+            }
+            buf[ret] = '\0';
+            if (strstr((char*)buf, " -1"))
+               b->errors++;
+            b->replies++;
+            b->reads++;
+            b->bytes += b->len;
+         }
+         continue;
+      }
+
+      if (b->mode == BENCH_BATCH)
+         bench_send(b, msg);
+      /* Subscriptions expire unless they are renewed */
+      else if (b->mode == BENCH_SUBSCRIBE
+            && cpu_features_get_time_usec() >= renew)
+      {
+         bench_send(b, msg);
+         renew += 1000000;
+      }
+
+      if ((ret = bench_recv(b, buf, sizeof(buf), REPLY_TIMEOUT_MS)) <= 0)
+      {
+         b->timeouts++;
+         continue;
+      }
+
+      /* Text acknowledgement of the subscription */
+      if (ret >= 4 && !memcmp(buf, "SUBS", 4))
+      {
+         if (memmem(buf, ret, " -1", 3))
+         {
+            fprintf(stderr, "Subscription refused.\n");
+            return;
+         }
+         continue;
+      }
+
+      {
+         int64_t frame = bench_parse_packet(b, buf, ret);
+         if (frame < 0)
+         {
+            b->errors++;
+            continue;
+         }
+         if (     b->mode == BENCH_SUBSCRIBE
+               && last_frame >= 0
+               && frame != last_frame + 1)
+            b->frame_gaps++;
+         last_frame = frame;
+         b->replies++;
+      }
+   }
+
+   if (b->mode == BENCH_SUBSCRIBE)
+      bench_send(b, "UNSUBSCRIBE_CORE_MEMORY 1\n");
+}
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: memory_cmd_bench [-H host] [-P port] [-m text|batch|subscribe]\n"
+      "                      [-n ranges] [-l bytes] [-a address] [-s stride]\n"
+      "                      [-d seconds]\n"
+      "    -m   How to poll: one READ_CORE_MEMORY per range, one\n"
+      "         READ_CORE_MEMORY_BATCH per round trip, or\n"
+      "         SUBSCRIBE_CORE_MEMORY. Defaults to batch.\n"
+      "    -n   Number of ranges. Defaults to 32.\n"
+      "    -l   Bytes per range. Defaults to 2.\n"
+      "    -a   First address, in hex. Defaults to 0.\n"
+      "    -s   Distance between ranges. Defaults to 0x100.\n");
+}
+
+int main(int argc, char **argv)
+{
+   int opt;
+   double secs;
+   const char *host = "127.0.0.1";
+   unsigned port    = 55355;
+   struct bench b;
+
+   memset(&b, 0, sizeof(b));
+   b.mode    = BENCH_BATCH;
+   b.ranges  = 32;
+   b.len     = 2;
+   b.stride  = 0x100;
+   b.seconds = 5;
+
+   while ((opt = getopt(argc, argv, "H:P:m:n:l:a:s:d:")) != -1)
+   {
+      switch (opt)
+      {
+         case 'H':
+            host      = optarg;
+            break;
+         case 'P':
+            port      = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'm':
+            if (!strcmp(optarg, "text"))
+               b.mode = BENCH_TEXT;
+            else if (!strcmp(optarg, "subscribe"))
+               b.mode = BENCH_SUBSCRIBE;
+            else
+               b.mode = BENCH_BATCH;
+            break;
+         case 'n':
+            b.ranges  = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'l':
+            b.len     = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'a':
+            b.address = (unsigned)strtoul(optarg, NULL, 16);
+            break;
+         case 's':
+            b.stride  = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'd':
+            b.seconds = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (!b.ranges || !b.len || !b.seconds)
+   {
+      usage();
+      return 1;
+   }
+
+   b.addr.sin_family = AF_INET;
+   b.addr.sin_port   = htons(port);
+   if (inet_pton(AF_INET, host, &b.addr.sin_addr) != 1)
+   {
+      fprintf(stderr, "Invalid address: %s\n", host);
+      return 1;
+   }
+
+   if ((b.fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+   {
+      perror("socket");
+      return 1;
+   }
+
+   bench_run(&b);
+   close(b.fd);
+
+   secs = (double)b.seconds;
+   printf("replies/s    %10.1f\n", b.replies / secs);
+   printf("reads/s      %10.1f\n", b.reads   / secs);
+   printf("bytes/s      %10.1f\n", b.bytes   / secs);
+   printf("timeouts     %10llu\n", (unsigned long long)b.timeouts);
+   printf("short reads  %10llu\n", (unsigned long long)b.errors);
+   if (b.mode == BENCH_SUBSCRIBE)
+      printf("frame gaps   %10llu\n", (unsigned long long)b.frame_gaps);
+
+   return 0;
+}
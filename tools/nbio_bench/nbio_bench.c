@@ -0,0 +1,359 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures the nbio backends on one large file and on many
+ * small files, the way savestates, content and thumbnails
+ * are written and read. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "compat/getopt.h"
+#include <encodings/crc32.h>
+#include <features/features_cpu.h>
+#include <file/nbio.h>
+
+extern nbio_intf_t nbio_stdio;
+extern nbio_intf_t nbio_mmap_unix;
+extern nbio_intf_t nbio_linux;
+extern nbio_intf_t nbio_uring;
+
+#ifdef HAVE_IO_URING
+bool nbio_uring_supported(void);
+#endif
+
+static nbio_intf_t *backends[] = {
+   &nbio_stdio,
+   &nbio_mmap_unix,
+   &nbio_linux,
+   &nbio_uring,
+};
+
+struct bench_result
+{
+   retro_time_t large_write;
+   retro_time_t large_read;
+   retro_time_t large_bio;
+   retro_time_t small_write;
+   retro_time_t small_read;
+   bool ok;
+};
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Usage: nbio_bench [-n runs] [-s MiB] [-f files] [-k KiB] [-d]\n"
+      "                  [-b backend] [dir]\n"
+      "    -n   Runs of every workload, the fastest is reported.\n"
+      "         Defaults to 3.\n"
+      "    -s   Size of the large file. Defaults to 64.\n"
+      "    -f   Number of small files. Defaults to 1000.\n"
+      "    -k   Size of a small file. Defaults to 16.\n"
+      "    -d   Drop the page cache before reading (needs root),\n"
+      "         otherwise files are read from memory.\n"
+      "    -b   Only run this backend, nbio_stdio, nbio_mmap_unix,\n"
+      "         nbio_linux or nbio_uring.\n"
+      "    dir  Where the files are written. Defaults to the\n"
+      "         current directory.\n");
+}
+
+static void drop_caches(void)
+{
+   int fd;
+
+   sync();
+   if ((fd = open("/proc/sys/vm/drop_caches", O_WRONLY)) < 0)
+   {
+      perror("/proc/sys/vm/drop_caches");
+      exit(1);
+   }
+   if (write(fd, "3", 1) != 1)
+      perror("/proc/sys/vm/drop_caches");
+   close(fd);
+}
+
+static bool bench_write(nbio_intf_t *intf, const char *path,
+      unsigned mode, const uint8_t *data, size_t len)
+{
+   void *ptr;
+   void *handle = intf->open(path, mode);
+
+   if (!handle)
+      return false;
+
+   intf->resize(handle, len);
+   if (!(ptr = intf->get_ptr(handle, NULL)))
+   {
+      intf->free(handle);
+      return false;
+   }
+   memcpy(ptr, data, len);
+
+   intf->begin_write(handle);
+   while (!intf->iterate(handle));
+   intf->free(handle);
+   return true;
+}
+
+/* Only the read is timed, checking the data is not */
+static bool bench_read(nbio_intf_t *intf, const char *path,
+      unsigned mode, uint32_t crc, size_t len, retro_time_t *usec)
+{
+   size_t i;
+   size_t got       = 0;
+   uint8_t *ptr     = NULL;
+   bool ok          = false;
+   volatile uint8_t sum = 0;
+   retro_time_t t0  = cpu_features_get_time_usec();
+   void *handle     = intf->open(path, mode);
+
+   if (!handle)
+      return false;
+
+   intf->begin_read(handle);
+   while (!intf->iterate(handle));
+
+   /* Touch every page, mmap reads nothing before */
+   if ((ptr = (uint8_t*)intf->get_ptr(handle, &got)) && got == len)
+      for (i = 0; i < len; i += 4096)
+         sum += ptr[i];
+   *usec += cpu_features_get_time_usec() - t0;
+
+   if (ptr && got == len)
+      ok = encoding_crc32(0, ptr, len) == crc;
+
+   intf->free(handle);
+   return ok;
+}
+
+static void bench_intf(nbio_intf_t *intf, const char *dir, unsigned runs,
+      const uint8_t *large, size_t large_len, uint32_t large_crc,
+      const uint8_t *small, size_t small_len, unsigned small_files,
+      bool drop, struct bench_result *res)
+{
+   char path[4096];
+   unsigned r, i;
+   retro_time_t t0;
+   uint32_t *crcs = (uint32_t*)malloc(small_files * sizeof(uint32_t));
+
+   memset(res, 0, sizeof(*res));
+   res->ok = crcs != NULL;
+
+   /* Every small file differs in its first word */
+   for (i = 0; res->ok && i < small_files; i++)
+   {
+      uint32_t crc = encoding_crc32(0, (const uint8_t*)&i, sizeof(i));
+      crcs[i]      = encoding_crc32(crc, small + sizeof(i),
+            small_len - sizeof(i));
+   }
+
+   for (r = 0; r < runs && res->ok; r++)
+   {
+      retro_time_t t;
+
+      snprintf(path, sizeof(path), "%s/nbio_bench.large", dir);
+      t0 = cpu_features_get_time_usec();
+      if (!bench_write(intf, path, NBIO_WRITE, large, large_len))
+         res->ok = false;
+      t  = cpu_features_get_time_usec() - t0;
+      if (r == 0 || t < res->large_write)
+         res->large_write = t;
+
+      if (drop)
+         drop_caches();
+      t  = 0;
+      if (!bench_read(intf, path, NBIO_READ, large_crc, large_len, &t))
+         res->ok = false;
+      if (r == 0 || t < res->large_read)
+         res->large_read = t;
+
+      if (drop)
+         drop_caches();
+      t  = 0;
+      if (!bench_read(intf, path, BIO_READ, large_crc, large_len, &t))
+         res->ok = false;
+      if (r == 0 || t < res->large_bio)
+         res->large_bio = t;
+      unlink(path);
+
+      t0 = cpu_features_get_time_usec();
+      for (i = 0; i < small_files && res->ok; i++)
+      {
+         uint8_t *buf = (uint8_t*)small;
+         memcpy(buf, &i, sizeof(i));
+         snprintf(path, sizeof(path), "%s/nbio_bench.%u", dir, i);
+         if (!bench_write(intf, path, NBIO_WRITE, buf, small_len))
+            res->ok = false;
+      }
+      t  = cpu_features_get_time_usec() - t0;
+      if (r == 0 || t < res->small_write)
+         res->small_write = t;
+
+      if (drop)
+         drop_caches();
+      t  = 0;
+      for (i = 0; i < small_files && res->ok; i++)
+      {
+         snprintf(path, sizeof(path), "%s/nbio_bench.%u", dir, i);
+         if (!bench_read(intf, path, NBIO_READ, crcs[i], small_len, &t))
+            res->ok = false;
+      }
+      if (r == 0 || t < res->small_read)
+         res->small_read = t;
+
+      for (i = 0; i < small_files; i++)
+      {
+         snprintf(path, sizeof(path), "%s/nbio_bench.%u", dir, i);
+         unlink(path);
+      }
+   }
+
+   free(crcs);
+}
+
+static double mb_per_sec(size_t len, retro_time_t usec)
+{
+   return usec ? (double)len / (double)usec : 0.0;
+}
+
+static double usec_per_file(retro_time_t usec, unsigned files)
+{
+   return files ? (double)usec / (double)files : 0.0;
+}
+
+int main(int argc, char **argv)
+{
+   int opt;
+   unsigned i;
+   uint32_t seed      = 1;
+   uint32_t large_crc = 0;
+   unsigned runs      = 3;
+   size_t large_len   = 64;
+   unsigned files     = 1000;
+   size_t small_len   = 16;
+   bool drop          = false;
+   int failed         = 0;
+   const char *dir    = ".";
+   const char *only   = NULL;
+   uint8_t *large     = NULL;
+   uint8_t *small     = NULL;
+
+   while ((opt = getopt(argc, argv, "n:s:f:k:db:")) != -1)
+   {
+      switch (opt)
+      {
+         case 'n':
+            runs      = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 's':
+            large_len = (size_t)strtoul(optarg, NULL, 0);
+            break;
+         case 'f':
+            files     = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'k':
+            small_len = (size_t)strtoul(optarg, NULL, 0);
+            break;
+         case 'd':
+            drop      = true;
+            break;
+         case 'b':
+            only      = optarg;
+            break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (optind < argc)
+      dir = argv[optind];
+
+   if (!runs || !large_len || !files || !small_len)
+   {
+      usage();
+      return 1;
+   }
+
+   large_len *= 1024 * 1024;
+   small_len *= 1024;
+
+   if (     !(large = (uint8_t*)malloc(large_len))
+         || !(small = (uint8_t*)malloc(small_len)))
+   {
+      fprintf(stderr, "Out of memory\n");
+      free(large);
+      return 1;
+   }
+
+   for (i = 0; i < large_len; i++)
+   {
+      seed     = seed * 1103515245 + 12345;
+      large[i] = (uint8_t)(seed >> 16);
+   }
+   memcpy(small, large, small_len);
+   large_crc = encoding_crc32(0, large, large_len);
+
+   printf("%-16s %14s %14s %14s %14s %14s\n", "backend",
+         "write MB/s", "read MB/s", "bio read MB/s",
+         "small wr usec", "small rd usec");
+
+   for (i = 0; i < sizeof(backends) / sizeof(backends[0]); i++)
+   {
+      struct bench_result res;
+      nbio_intf_t *intf = backends[i];
+
+      if (only && strcmp(only, intf->ident))
+         continue;
+      if (!intf->open)
+      {
+         printf("%-16s %14s\n", intf->ident, "not built");
+         continue;
+      }
+#ifdef HAVE_IO_URING
+      if (intf == &nbio_uring && !nbio_uring_supported())
+      {
+         printf("%-16s %14s\n", intf->ident, "unsupported");
+         continue;
+      }
+#endif
+
+      bench_intf(intf, dir, runs, large, large_len, large_crc,
+            small, small_len, files, drop, &res);
+
+      printf("%-16s %14.1f %14.1f %14.1f %14.1f %14.1f%s\n",
+            intf->ident,
+            mb_per_sec(large_len, res.large_write),
+            mb_per_sec(large_len, res.large_read),
+            mb_per_sec(large_len, res.large_bio),
+            usec_per_file(res.small_write, files),
+            usec_per_file(res.small_read, files),
+            res.ok ? "" : " FAILED");
+
+      if (!res.ok)
+         failed = 1;
+   }
+
+   free(large);
+   free(small);
+   return failed;
+}
@@ -0,0 +1,916 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Headless netplay relay (tunnel) server.
+ *
+ * Speaks the same tunnel protocol RetroArch uses with its relay servers, so
+ * a host started with "Use Relay Server" pointed at this process and its
+ * clients joining through the announced session id are forwarded without
+ * either side needing a reachable port.
+ *
+ * Every room and every linked client/host pair is served from a single
+ * epoll loop; forwarded data goes through the netplay socket buffers
+ * (netplay_recv/netplay_send), so slow peers apply backpressure instead of
+ * growing memory. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "compat/getopt.h"
+#include "features/features_cpu.h"
+#include "net/net_socket.h"
+
+#include "../../network/netplay/netplay_private.h"
+
+#define RELAY_DEFAULT_BUFFER_SIZE (64 * 1024)
+#define RELAY_CHUNK_SIZE          (16 * 1024)
+#define RELAY_HASH_SIZE           4096
+#define RELAY_MAX_EVENTS          256
+
+/* All times are in microseconds */
+#define RELAY_ID_TIMEOUT          10000000 /* Identify within 10 seconds */
+#define RELAY_LINK_TIMEOUT        30000000 /* Host must link within 30 seconds */
+#define RELAY_PING_INTERVAL       10000000
+#define RELAY_PING_TIMEOUT        30000000
+#define RELAY_SCAN_INTERVAL       1000000
+
+enum relay_conn_state
+{
+   /* Connected, waiting for the first tunnel id */
+   RELAY_CONN_NEW = 0,
+   /* Host control connection; one per room */
+   RELAY_CONN_HOST,
+   /* Client waiting for the host to link to it */
+   RELAY_CONN_CLIENT,
+   /* Either end of a linked client/host pair */
+   RELAY_CONN_LINKED,
+   RELAY_CONN_CLOSED
+};
+
+struct relay_conn
+{
+   retro_time_t timeout;
+   retro_time_t ping_time;
+
+   struct socket_buffer send_buf;
+   struct socket_buffer recv_buf;
+
+   /* Session id for hosts, link id for waiting clients */
+   mitm_id_t id;
+   netplay_address_t addr;
+
+   /* The other end of a linked pair */
+   struct relay_conn *peer;
+
+   struct relay_conn *hash_next;
+   struct relay_conn *prev;
+   struct relay_conn *next;
+
+   uint32_t events;
+   int fd;
+   enum relay_conn_state state;
+   bool ping_pending;
+};
+
+/* Our fds */
+static int epoll_fd = -1, listen_fd = -1, random_fd = -1;
+
+static size_t buffer_size = RELAY_DEFAULT_BUFFER_SIZE;
+
+/* Every open connection, and the ones closed during this batch of events */
+static struct relay_conn *conns, *closed_conns;
+
+/* Hosts and waiting clients, keyed by their id */
+static struct relay_conn *id_hash[RELAY_HASH_SIZE];
+
+/* Statistics */
+static unsigned num_rooms, num_waiting, num_links;
+static uint64_t bytes_forwarded;
+
+/* Usage statement */
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: netplay_relay [options]\n"
+      "Options:\n"
+      "    -P|--port <port>:      Port to listen on. Defaults to %d.\n"
+      "    -b|--buffer <bytes>:   Socket buffer size per direction.\n"
+      "                           Defaults to %d.\n"
+      "    -s|--stats <seconds>:  Print statistics every this many seconds.\n"
+      "                           0 disables them. Defaults to 10.\n"
+      "\n", RARCH_DEFAULT_PORT, RELAY_DEFAULT_BUFFER_SIZE);
+}
+
+static unsigned relay_hash(const uint8_t *unique)
+{
+   size_t i;
+   uint32_t hash = 2166136261U;
+
+   for (i = 0; i < sizeof(((mitm_id_t*)NULL)->unique); i++)
+   {
+      hash ^= unique[i];
+      hash *= 16777619U;
+   }
+
+   return hash & (RELAY_HASH_SIZE - 1);
+}
+
+static struct relay_conn *relay_hash_find(const uint8_t *unique,
+      enum relay_conn_state state)
+{
+   struct relay_conn *conn = id_hash[relay_hash(unique)];
+
+   for (; conn; conn = conn->hash_next)
+      if (conn->state == state &&
+            !memcmp(conn->id.unique, unique, sizeof(conn->id.unique)))
+         return conn;
+
+   return NULL;
+}
+
+static void relay_hash_insert(struct relay_conn *conn)
+{
+   unsigned bucket = relay_hash(conn->id.unique);
+
+   conn->hash_next = id_hash[bucket];
+   id_hash[bucket] = conn;
+}
+
+static void relay_hash_remove(struct relay_conn *conn)
+{
+   struct relay_conn **link = &id_hash[relay_hash(conn->id.unique)];
+
+   for (; *link; link = &(*link)->hash_next)
+   {
+      if (*link == conn)
+      {
+         *link = conn->hash_next;
+         break;
+      }
+   }
+
+   conn->hash_next = NULL;
+}
+
+/**
+ * relay_new_id
+ *
+ * Generate a fresh, non-zero id that is not in use by any
+ * host or waiting client.
+ */
+static void relay_new_id(mitm_id_t *id, uint32_t magic)
+{
+   id->magic = htonl(magic);
+
+   for (;;)
+   {
+      size_t i;
+      bool zero = true;
+
+      if (random_fd < 0 ||
+            read(random_fd, id->unique, sizeof(id->unique)) !=
+               (ssize_t)sizeof(id->unique))
+         for (i = 0; i < sizeof(id->unique); i++)
+            id->unique[i] = (uint8_t)(rand() >> 7);
+
+      for (i = 0; i < sizeof(id->unique); i++)
+         if (id->unique[i])
+            zero = false;
+
+      if (!zero &&
+            !relay_hash_find(id->unique, RELAY_CONN_HOST) &&
+            !relay_hash_find(id->unique, RELAY_CONN_CLIENT))
+         break;
+   }
+}
+
+static void relay_update_events(struct relay_conn *conn)
+{
+   struct epoll_event ev;
+   uint32_t events = 0;
+
+   switch (conn->state)
+   {
+      case RELAY_CONN_NEW:
+      case RELAY_CONN_HOST:
+         events = EPOLLIN;
+         break;
+      case RELAY_CONN_CLIENT:
+         /* Don't read anything until we are linked,
+            but notice if the client gives up. */
+         events = EPOLLRDHUP;
+         break;
+      case RELAY_CONN_LINKED:
+         /* Stop reading while the other end is backed up */
+         if (netplay_buf_remaining(&conn->peer->send_buf))
+            events = EPOLLIN;
+         break;
+      default:
+         return;
+   }
+
+   if (netplay_buf_used(&conn->send_buf))
+      events |= EPOLLOUT;
+
+   if (events == conn->events)
+      return;
+
+   ev.events   = events;
+   ev.data.ptr = conn;
+   epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+   conn->events = events;
+}
+
+static void relay_close(struct relay_conn *conn)
+{
+   struct relay_conn *peer;
+
+   if (conn->state == RELAY_CONN_CLOSED)
+      return;
+
+   switch (conn->state)
+   {
+      case RELAY_CONN_HOST:
+         relay_hash_remove(conn);
+         num_rooms--;
+         break;
+      case RELAY_CONN_CLIENT:
+         relay_hash_remove(conn);
+         num_waiting--;
+         break;
+      default:
+         break;
+   }
+
+   peer        = conn->peer;
+   conn->peer  = NULL;
+   conn->state = RELAY_CONN_CLOSED;
+
+   epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+   socket_close(conn->fd);
+   conn->fd = -1;
+
+   if (conn->prev)
+      conn->prev->next = conn->next;
+   else
+      conns = conn->next;
+   if (conn->next)
+      conn->next->prev = conn->prev;
+
+   /* Can't free it yet, it may still be referenced
+      by events in the current batch. */
+   conn->prev   = NULL;
+   conn->next   = closed_conns;
+   closed_conns = conn;
+
+   /* A link is useless with only one end */
+   if (peer)
+   {
+      num_links--;
+
+      /* Give whatever is left a chance to get through */
+      netplay_send_flush(&peer->send_buf, peer->fd, false);
+
+      peer->peer = NULL;
+      relay_close(peer);
+   }
+}
+
+static void relay_free_closed(void)
+{
+   while (closed_conns)
+   {
+      struct relay_conn *conn = closed_conns;
+
+      closed_conns = conn->next;
+
+      netplay_deinit_socket_buffer(&conn->send_buf);
+      netplay_deinit_socket_buffer(&conn->recv_buf);
+      free(conn);
+   }
+}
+
+/**
+ * relay_queue
+ *
+ * Queue a tunnel message. Control connections only ever
+ * carry a handful of bytes, so one that can't keep up is
+ * assumed to be dead rather than blocked on.
+ */
+static bool relay_queue(struct relay_conn *conn, const void *buf, size_t len)
+{
+   if (netplay_buf_remaining(&conn->send_buf) < len)
+      return false;
+
+   return netplay_send(&conn->send_buf, conn->fd, buf, len) &&
+      netplay_send_flush(&conn->send_buf, conn->fd, false);
+}
+
+/**
+ * relay_forward
+ * @src : connection to read from
+ *
+ * Move whatever @src has received into its peer's send buffer,
+ * as far as the send buffer has room, and try to send it on.
+ *
+ * Returns false if either end failed.
+ */
+static bool relay_forward(struct relay_conn *src)
+{
+   static uint8_t chunk[RELAY_CHUNK_SIZE];
+   struct relay_conn *dst = src->peer;
+
+   for (;;)
+   {
+      ssize_t recvd;
+      size_t len = netplay_buf_remaining(&dst->send_buf);
+
+      if (!len)
+         break;
+      if (len > sizeof(chunk))
+         len = sizeof(chunk);
+
+      recvd = netplay_recv(&src->recv_buf, src->fd, chunk, len);
+      if (recvd < 0)
+         return false;
+      if (!recvd)
+         break;
+
+      netplay_recv_flush(&src->recv_buf);
+
+      /* Can't block, we checked for room */
+      netplay_send(&dst->send_buf, dst->fd, chunk, recvd);
+      bytes_forwarded += recvd;
+
+      /* Short read, nothing more buffered */
+      if ((size_t)recvd < len)
+         break;
+   }
+
+   return netplay_send_flush(&dst->send_buf, dst->fd, false);
+}
+
+static void relay_link(struct relay_conn *conn, struct relay_conn *client)
+{
+   relay_hash_remove(client);
+   num_waiting--;
+   num_links++;
+
+   conn->state   = RELAY_CONN_LINKED;
+   client->state = RELAY_CONN_LINKED;
+   conn->peer    = client;
+   client->peer  = conn;
+
+   /* Both ends may already have sent data past their ids */
+   if (!relay_forward(conn) || !relay_forward(client))
+   {
+      relay_close(conn);
+      return;
+   }
+
+   relay_update_events(conn);
+   relay_update_events(client);
+}
+
+/**
+ * relay_handle_new
+ *
+ * Read the tunnel id a new connection opens with and act on it:
+ * zeroed session ids open a room, non-zero ones join a room and
+ * link ids complete a link requested earlier.
+ */
+static bool relay_handle_new(struct relay_conn *conn)
+{
+   mitm_id_t id;
+   struct relay_conn *other;
+   ssize_t recvd = netplay_recv(&conn->recv_buf, conn->fd, &id, sizeof(id));
+
+   if (recvd < 0)
+      return false;
+   if ((size_t)recvd < sizeof(id))
+   {
+      netplay_recv_reset(&conn->recv_buf);
+      return true;
+   }
+   netplay_recv_flush(&conn->recv_buf);
+
+   switch (ntohl(id.magic))
+   {
+      case MITM_SESSION_MAGIC:
+      {
+         size_t i;
+
+         for (i = 0; i < sizeof(id.unique); i++)
+            if (id.unique[i])
+               break;
+
+         if (i >= sizeof(id.unique))
+         {
+            /* New room */
+            relay_new_id(&conn->id, MITM_SESSION_MAGIC);
+            if (!relay_queue(conn, &conn->id, sizeof(conn->id)))
+               return false;
+
+            conn->state        = RELAY_CONN_HOST;
+            conn->ping_time    = cpu_features_get_time_usec() +
+               RELAY_PING_INTERVAL;
+            conn->ping_pending = false;
+            relay_hash_insert(conn);
+            num_rooms++;
+            break;
+         }
+
+         /* Client joining a room */
+         other = relay_hash_find(id.unique, RELAY_CONN_HOST);
+         if (!other)
+            return false;
+
+         relay_new_id(&conn->id, MITM_LINK_MAGIC);
+         if (!relay_queue(other, &conn->id, sizeof(conn->id)))
+         {
+            relay_close(other);
+            return false;
+         }
+         relay_update_events(other);
+
+         conn->state   = RELAY_CONN_CLIENT;
+         conn->timeout = cpu_features_get_time_usec() + RELAY_LINK_TIMEOUT;
+         relay_hash_insert(conn);
+         num_waiting++;
+         break;
+      }
+      case MITM_LINK_MAGIC:
+         other = relay_hash_find(id.unique, RELAY_CONN_CLIENT);
+         if (!other)
+            return false;
+
+         relay_link(conn, other);
+         return true;
+      default:
+         return false;
+   }
+
+   relay_update_events(conn);
+
+   return true;
+}
+
+/**
+ * relay_handle_host
+ *
+ * Process what a host sends on its control connection:
+ * ping replies and requests for the address of a client.
+ */
+static bool relay_handle_host(struct relay_conn *conn)
+{
+   for (;;)
+   {
+      mitm_id_t msg;
+      ssize_t recvd = netplay_recv(&conn->recv_buf, conn->fd,
+            &msg.magic, sizeof(msg.magic));
+
+      if (recvd < 0)
+         return false;
+      if ((size_t)recvd < sizeof(msg.magic))
+      {
+         netplay_recv_reset(&conn->recv_buf);
+         return true;
+      }
+
+      switch (ntohl(msg.magic))
+      {
+         case MITM_PING_MAGIC:
+            conn->ping_pending = false;
+            break;
+         case MITM_ADDR_MAGIC:
+         {
+            struct relay_conn *client;
+
+            recvd = netplay_recv(&conn->recv_buf, conn->fd,
+                  msg.unique, sizeof(msg.unique));
+            if (recvd < 0)
+               return false;
+            if ((size_t)recvd < sizeof(msg.unique))
+            {
+               netplay_recv_reset(&conn->recv_buf);
+               return true;
+            }
+
+            /* Unknown links are ignored, the host will time them out */
+            client = relay_hash_find(msg.unique, RELAY_CONN_CLIENT);
+            if (client)
+            {
+               if (!relay_queue(conn, &msg, sizeof(msg)) ||
+                     !relay_queue(conn, &client->addr, sizeof(client->addr)))
+                  return false;
+            }
+            break;
+         }
+         default:
+            return false;
+      }
+
+      netplay_recv_flush(&conn->recv_buf);
+   }
+}
+
+static void relay_accept(void)
+{
+   for (;;)
+   {
+      struct sockaddr_storage their_addr;
+      socklen_t addr_size = sizeof(their_addr);
+      struct epoll_event ev;
+      struct relay_conn *conn;
+      int flag = 1;
+      int fd   = accept(listen_fd,
+            (struct sockaddr*)&their_addr, &addr_size);
+
+      if (fd < 0)
+         break;
+
+      if (!socket_nonblock(fd))
+      {
+         socket_close(fd);
+         continue;
+      }
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void*)&flag, sizeof(flag));
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+      conn = (struct relay_conn*)calloc(1, sizeof(*conn));
+      if (!conn)
+      {
+         socket_close(fd);
+         continue;
+      }
+
+      if (!netplay_init_socket_buffer(&conn->send_buf, buffer_size) ||
+            !netplay_init_socket_buffer(&conn->recv_buf, buffer_size))
+      {
+         netplay_deinit_socket_buffer(&conn->send_buf);
+         free(conn);
+         socket_close(fd);
+         continue;
+      }
+
+      /* Hosts are told the address in the same format RetroArch uses */
+      if (their_addr.ss_family == AF_INET)
+      {
+         struct sockaddr_in *sin = (struct sockaddr_in*)&their_addr;
+
+         conn->addr.addr[10] = 0xFF;
+         conn->addr.addr[11] = 0xFF;
+         memcpy(&conn->addr.addr[12], &sin->sin_addr, 4);
+      }
+#ifdef HAVE_INET6
+      else if (their_addr.ss_family == AF_INET6)
+      {
+         struct sockaddr_in6 *sin6 = (struct sockaddr_in6*)&their_addr;
+
+         memcpy(conn->addr.addr, &sin6->sin6_addr, sizeof(conn->addr.addr));
+      }
+#endif
+
+      conn->fd      = fd;
+      conn->state   = RELAY_CONN_NEW;
+      conn->events  = EPOLLIN;
+      conn->timeout = cpu_features_get_time_usec() + RELAY_ID_TIMEOUT;
+
+      ev.events   = conn->events;
+      ev.data.ptr = conn;
+      if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+      {
+         netplay_deinit_socket_buffer(&conn->send_buf);
+         netplay_deinit_socket_buffer(&conn->recv_buf);
+         free(conn);
+         socket_close(fd);
+         continue;
+      }
+
+      conn->next = conns;
+      if (conns)
+         conns->prev = conn;
+      conns = conn;
+   }
+}
+
+static void relay_handle_event(struct relay_conn *conn, uint32_t events)
+{
+   if (conn->state == RELAY_CONN_CLOSED)
+      return;
+
+   if (events & EPOLLERR)
+      goto error;
+
+   if (events & EPOLLOUT)
+   {
+      if (!netplay_send_flush(&conn->send_buf, conn->fd, false))
+         goto error;
+
+      /* Room freed up, pull in whatever the other end was holding back */
+      if (conn->state == RELAY_CONN_LINKED && !relay_forward(conn->peer))
+         goto error;
+   }
+
+   if (events & (EPOLLIN | EPOLLHUP))
+   {
+      switch (conn->state)
+      {
+         case RELAY_CONN_NEW:
+            if (!relay_handle_new(conn))
+               goto error;
+            break;
+         case RELAY_CONN_HOST:
+            if (!relay_handle_host(conn))
+               goto error;
+            break;
+         case RELAY_CONN_LINKED:
+            if (!relay_forward(conn))
+               goto error;
+            break;
+         default:
+            goto error;
+      }
+   }
+   /* Hung up for good, nothing more will arrive */
+   if (events & (EPOLLHUP | EPOLLRDHUP))
+      goto error;
+
+   if (conn->state == RELAY_CONN_CLOSED)
+      return;
+
+   relay_update_events(conn);
+   if (conn->peer)
+      relay_update_events(conn->peer);
+
+   return;
+
+error:
+   relay_close(conn);
+}
+
+/**
+ * relay_scan
+ *
+ * Ping hosts and drop connections that timed out.
+ */
+static void relay_scan(retro_time_t now)
+{
+   struct relay_conn *conn = conns;
+
+   while (conn)
+   {
+      struct relay_conn *next = conn->next;
+
+      switch (conn->state)
+      {
+         case RELAY_CONN_NEW:
+         case RELAY_CONN_CLIENT:
+            if (now >= conn->timeout)
+               relay_close(conn);
+            break;
+         case RELAY_CONN_HOST:
+            if (conn->ping_pending)
+            {
+               if (now >= conn->timeout)
+                  relay_close(conn);
+            }
+            else if (now >= conn->ping_time)
+            {
+               uint32_t ping = htonl(MITM_PING_MAGIC);
+
+               if (!relay_queue(conn, &ping, sizeof(ping)))
+               {
+                  relay_close(conn);
+                  break;
+               }
+
+               conn->ping_pending = true;
+               conn->ping_time    = now + RELAY_PING_INTERVAL;
+               conn->timeout      = now + RELAY_PING_TIMEOUT;
+               relay_update_events(conn);
+            }
+            break;
+         default:
+            break;
+      }
+
+      conn = next;
+   }
+}
+
+static void relay_stats(retro_time_t now, retro_time_t *last_time,
+      retro_time_t *last_cpu, uint64_t *last_bytes)
+{
+   struct rusage usage;
+   retro_time_t cpu      = 0;
+   retro_time_t elapsed  = now - *last_time;
+
+   if (!getrusage(RUSAGE_SELF, &usage))
+      cpu = (retro_time_t)usage.ru_utime.tv_sec  * 1000000 +
+                          usage.ru_utime.tv_usec +
+            (retro_time_t)usage.ru_stime.tv_sec  * 1000000 +
+                          usage.ru_stime.tv_usec;
+
+   if (elapsed > 0)
+      printf("rooms: %u, links: %u, waiting: %u, "
+            "forwarded: %.2f MB/s, cpu: %.1f%%\n",
+            num_rooms, num_links, num_waiting,
+            (double)(bytes_forwarded - *last_bytes) / elapsed,
+            (double)(cpu - *last_cpu) * 100.0 / elapsed);
+   fflush(stdout);
+
+   *last_time  = now;
+   *last_cpu   = cpu;
+   *last_bytes = bytes_forwarded;
+}
+
+static bool relay_listen(int port)
+{
+   struct addrinfo *addr = NULL;
+   int flag              = 1;
+   struct epoll_event ev;
+
+   /* Prefer a dual-stack socket, fall back to IPv4 */
+#ifdef HAVE_INET6
+   listen_fd = socket_init((void**)&addr, port, NULL,
+         SOCKET_TYPE_STREAM, AF_INET6);
+   if (listen_fd >= 0)
+   {
+      int off = 0;
+      setsockopt(listen_fd, IPPROTO_IPV6, IPV6_V6ONLY,
+            (void*)&off, sizeof(off));
+   }
+   else
+#endif
+      listen_fd = socket_init((void**)&addr, port, NULL,
+            SOCKET_TYPE_STREAM, AF_INET);
+
+   if (listen_fd < 0)
+   {
+      perror("socket");
+      return false;
+   }
+
+   setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR,
+         (void*)&flag, sizeof(flag));
+
+   if (!socket_bind(listen_fd, addr) || listen(listen_fd, 1024) < 0)
+   {
+      perror("bind");
+      freeaddrinfo_retro(addr);
+      return false;
+   }
+   freeaddrinfo_retro(addr);
+
+   if (!socket_nonblock(listen_fd))
+      return false;
+
+   ev.events   = EPOLLIN;
+   ev.data.ptr = NULL;
+
+   return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev) == 0;
+}
+
+int main(int argc, char **argv)
+{
+   struct epoll_event events[RELAY_MAX_EVENTS];
+   struct rlimit limit;
+   retro_time_t now, next_scan, next_stats, stats_time, stats_cpu = 0;
+   uint64_t stats_bytes = 0;
+   int port             = RARCH_DEFAULT_PORT;
+   int stats_interval   = 10;
+
+   const struct option opt[] = {
+      {"port",   1, NULL, 'P'},
+      {"buffer", 1, NULL, 'b'},
+      {"stats",  1, NULL, 's'},
+      {NULL,     0, NULL, 0}
+   };
+
+   for (;;)
+   {
+      int c = getopt_long(argc, argv, "P:b:s:", opt, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'P':
+            port = atoi(optarg);
+            break;
+
+         case 'b':
+            buffer_size = strtoul(optarg, NULL, 0);
+            if (buffer_size < 4096)
+               buffer_size = 4096;
+            break;
+
+         case 's':
+            stats_interval = atoi(optarg);
+            break;
+
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   signal(SIGPIPE, SIG_IGN);
+
+   /* Three sockets per room, plus one per extra client */
+   if (!getrlimit(RLIMIT_NOFILE, &limit))
+   {
+      limit.rlim_cur = limit.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &limit);
+   }
+
+   if (!network_init())
+   {
+      fprintf(stderr, "Failed to initialize networking.\n");
+      return 1;
+   }
+
+   epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+   if (epoll_fd < 0)
+   {
+      perror("epoll_create1");
+      return 1;
+   }
+
+   if (!relay_listen(port))
+      return 1;
+
+   random_fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+   srand((unsigned)cpu_features_get_time_usec() ^ (unsigned)getpid());
+
+   printf("Relaying on port %d.\n", port);
+   fflush(stdout);
+
+   now        = cpu_features_get_time_usec();
+   next_scan  = now + RELAY_SCAN_INTERVAL;
+   next_stats = now + (retro_time_t)stats_interval * 1000000;
+   stats_time = now;
+
+   for (;;)
+   {
+      int i;
+      int timeout = (next_scan > now) ?
+         (int)((next_scan - now) / 1000) + 1 : 0;
+      int count   = epoll_wait(epoll_fd, events, RELAY_MAX_EVENTS, timeout);
+
+      if (count < 0 && errno != EINTR)
+      {
+         perror("epoll_wait");
+         return 1;
+      }
+
+      for (i = 0; i < count; i++)
+      {
+         if (!events[i].data.ptr)
+            relay_accept();
+         else
+            relay_handle_event((struct relay_conn*)events[i].data.ptr,
+                  events[i].events);
+      }
+
+      now = cpu_features_get_time_usec();
+      if (now >= next_scan)
+      {
+         relay_scan(now);
+         next_scan = now + RELAY_SCAN_INTERVAL;
+      }
+
+      if (stats_interval > 0 && now >= next_stats)
+      {
+         relay_stats(now, &stats_time, &stats_cpu, &stats_bytes);
+         next_stats = now + (retro_time_t)stats_interval * 1000000;
+      }
+
+      relay_free_closed();
+   }
+
+   return 0;
+}
@@ -0,0 +1,615 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2021 - Daniel De Matteis
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Load generator for netplay_relay.
+ *
+ * Opens a number of rooms on the relay, each with a host and one linked
+ * client, and has both ends exchange netplay INPUT packets at a fixed frame
+ * rate (plus optional savestate-sized bursts). Reports throughput and relay
+ * latency, so the relay's own CPU figure can be turned into rooms per core.
+ *
+ * Unlike ranetplayer, which drives a single blocking connection through the
+ * full netplay handshake with a real RetroArch, both ends of every room are
+ * simulated here from one epoll loop. The relay forwards linked connections
+ * byte for byte, so only the tunnel handshake is performed; the packets are
+ * framed like netplay commands but never parsed as a session. */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "compat/getopt.h"
+#include "features/features_cpu.h"
+#include "net/net_socket.h"
+
+/* Only for #defines and the socket buffer */
+#include "../../network/netplay/netplay_private.h"
+
+#define LOADTEST_MAX_EVENTS 256
+
+/* Words of an INPUT packet: frame, client, input, send time (2 words) */
+#define LOADTEST_INPUT_WORDS 5
+
+enum loadtest_end
+{
+   LOADTEST_HOST = 0,
+   LOADTEST_CLIENT,
+   LOADTEST_CONTROL
+};
+
+struct loadtest_endpoint
+{
+   struct socket_buffer send_buf;
+   struct socket_buffer recv_buf;
+   uint32_t send_frame;
+   uint32_t recv_frame;
+   uint32_t events;
+   int fd;
+};
+
+struct loadtest_room
+{
+   struct loadtest_endpoint ends[2];
+   int control_fd;
+};
+
+static struct loadtest_room *rooms;
+static unsigned num_rooms = 1;
+static int epoll_fd       = -1;
+
+/* Space for netplay packets */
+static uint32_t *payload;
+static size_t payload_size;
+
+/* Statistics */
+static uint64_t msgs_recvd, inputs_recvd, bytes_recvd, latency_sum;
+static uint64_t stalls, errors;
+static retro_time_t latency_max;
+
+/* Usage statement */
+static void usage(void)
+{
+   fprintf(stderr,
+      "Use: relay_loadtest [options]\n"
+      "Options:\n"
+      "    -H|--host <address>:   Relay host. Defaults to localhost.\n"
+      "    -P|--port <port>:      Relay port. Defaults to %d.\n"
+      "    -r|--rooms <count>:    Number of rooms to open. Defaults to 1.\n"
+      "    -f|--fps <rate>:       Frames per second. Defaults to 60.\n"
+      "    -d|--duration <secs>:  Length of the run. Defaults to 10.\n"
+      "    -S|--state <bytes>:    Savestate size to send. Defaults to 0 (off).\n"
+      "    -i|--interval <frames>: Frames between savestates. Defaults to 60.\n"
+      "\n", RARCH_DEFAULT_PORT);
+}
+
+static int loadtest_connect(const char *host, int port)
+{
+   struct addrinfo *addr = NULL;
+   int flag              = 1;
+   int fd = socket_init((void**)&addr, port, host, SOCKET_TYPE_STREAM, 0);
+
+   if (fd < 0)
+      return -1;
+
+   if (socket_connect(fd, addr) < 0)
+   {
+      socket_close(fd);
+      fd = -1;
+   }
+   else
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (void*)&flag, sizeof(flag));
+
+   freeaddrinfo_retro(addr);
+
+   return fd;
+}
+
+/**
+ * loadtest_recv_control
+ *
+ * Wait for a tunnel message with the given magic on a host's
+ * control connection, answering pings on the way.
+ */
+static bool loadtest_recv_control(int fd, uint32_t magic, mitm_id_t *id)
+{
+   for (;;)
+   {
+      if (!socket_receive_all_blocking(fd, &id->magic, sizeof(id->magic)))
+         return false;
+
+      if (ntohl(id->magic) == MITM_PING_MAGIC)
+      {
+         if (!socket_send_all_blocking(fd, &id->magic,
+                  sizeof(id->magic), true))
+            return false;
+         continue;
+      }
+
+      if (ntohl(id->magic) != magic)
+         return false;
+
+      return socket_receive_all_blocking(fd, id->unique, sizeof(id->unique));
+   }
+}
+
+/**
+ * loadtest_open_room
+ *
+ * Open a room on the relay and link one client to it,
+ * following the same steps a RetroArch host does.
+ */
+static bool loadtest_open_room(struct loadtest_room *room,
+      const char *host, int port)
+{
+   mitm_id_t session = {0}, link;
+   netplay_address_t addr;
+
+   room->control_fd              = loadtest_connect(host, port);
+   room->ends[LOADTEST_CLIENT].fd = loadtest_connect(host, port);
+   room->ends[LOADTEST_HOST].fd   = loadtest_connect(host, port);
+   if (room->control_fd < 0 || room->ends[LOADTEST_CLIENT].fd < 0 ||
+         room->ends[LOADTEST_HOST].fd < 0)
+      return false;
+
+   /* Ask for a session */
+   session.magic = htonl(MITM_SESSION_MAGIC);
+   if (!socket_send_all_blocking(room->control_fd,
+            &session, sizeof(session), true) ||
+         !loadtest_recv_control(room->control_fd,
+            MITM_SESSION_MAGIC, &session))
+      return false;
+
+   /* Join it */
+   if (!socket_send_all_blocking(room->ends[LOADTEST_CLIENT].fd,
+            &session, sizeof(session), true) ||
+         !loadtest_recv_control(room->control_fd, MITM_LINK_MAGIC, &link))
+      return false;
+
+   /* Ask for the client's address */
+   link.magic = htonl(MITM_ADDR_MAGIC);
+   if (!socket_send_all_blocking(room->control_fd,
+            &link, sizeof(link), true) ||
+         !loadtest_recv_control(room->control_fd, MITM_ADDR_MAGIC, &link) ||
+         !socket_receive_all_blocking(room->control_fd, &addr, sizeof(addr)))
+      return false;
+
+   /* And link to it */
+   link.magic = htonl(MITM_LINK_MAGIC);
+   return socket_send_all_blocking(room->ends[LOADTEST_HOST].fd,
+         &link, sizeof(link), true);
+}
+
+static void loadtest_update_events(struct loadtest_endpoint *end,
+      uint64_t tag)
+{
+   struct epoll_event ev;
+   uint32_t events = EPOLLIN;
+
+   if (netplay_buf_used(&end->send_buf))
+      events |= EPOLLOUT;
+
+   if (events == end->events)
+      return;
+
+   ev.events   = events;
+   ev.data.u64 = tag;
+   epoll_ctl(epoll_fd, end->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+         end->fd, &ev);
+   end->events = events;
+}
+
+/**
+ * loadtest_send
+ *
+ * Queue a packet without ever blocking; if the relay isn't keeping up
+ * the packet is dropped and counted as a stall.
+ */
+static bool loadtest_send(struct loadtest_endpoint *end,
+      uint32_t cmd, const uint32_t *data, uint32_t size)
+{
+   uint32_t header[2];
+
+   if (netplay_buf_remaining(&end->send_buf) < sizeof(header) + size)
+   {
+      stalls++;
+      return true;
+   }
+
+   header[0] = htonl(cmd);
+   header[1] = htonl(size);
+
+   return netplay_send(&end->send_buf, end->fd, header, sizeof(header)) &&
+      netplay_send(&end->send_buf, end->fd, data, size) &&
+      netplay_send_flush(&end->send_buf, end->fd, false);
+}
+
+static bool loadtest_send_frame(struct loadtest_endpoint *end,
+      enum loadtest_end which, uint32_t state_size, unsigned state_interval)
+{
+   uint32_t input[LOADTEST_INPUT_WORDS];
+   retro_time_t now = cpu_features_get_time_usec();
+   uint32_t frame   = end->send_frame;
+
+   if (state_size && which == LOADTEST_HOST &&
+         frame % state_interval == state_interval - 1)
+   {
+      memset(payload, 0, state_size);
+      payload[0] = htonl(frame);
+      payload[1] = htonl(state_size);
+      payload[2] = htonl((uint32_t)((uint64_t)now >> 32));
+      payload[3] = htonl((uint32_t)now);
+      if (!loadtest_send(end, NETPLAY_CMD_LOAD_SAVESTATE, payload,
+               state_size))
+         return false;
+   }
+
+   /* Hold the frame back rather than leave a gap in the sequence */
+   if (netplay_buf_remaining(&end->send_buf) <
+         2 * sizeof(uint32_t) + sizeof(input))
+   {
+      stalls++;
+      return true;
+   }
+   end->send_frame++;
+
+   input[0] = htonl(frame);
+   input[1] = htonl(which == LOADTEST_HOST ? 0 : 1);
+   input[2] = htonl(frame & 0xFFFF);
+   input[3] = htonl((uint32_t)((uint64_t)now >> 32));
+   input[4] = htonl((uint32_t)now);
+
+   return loadtest_send(end, NETPLAY_CMD_INPUT, input, sizeof(input));
+}
+
+/**
+ * loadtest_recv
+ *
+ * Read every complete packet that has arrived, checking
+ * that inputs come through in order.
+ */
+static bool loadtest_recv(struct loadtest_endpoint *end)
+{
+   for (;;)
+   {
+      uint32_t header[2], cmd, size;
+      ssize_t recvd = netplay_recv(&end->recv_buf, end->fd,
+            header, sizeof(header));
+
+      if (recvd < 0)
+         return false;
+      if ((size_t)recvd < sizeof(header))
+         break;
+
+      cmd  = ntohl(header[0]);
+      size = ntohl(header[1]);
+      if (size > payload_size)
+         return false;
+
+      recvd = netplay_recv(&end->recv_buf, end->fd, payload, size);
+      if (recvd < 0)
+         return false;
+      if ((size_t)recvd < size)
+         break;
+
+      netplay_recv_flush(&end->recv_buf);
+
+      msgs_recvd++;
+      bytes_recvd += sizeof(header) + size;
+
+      if (cmd == NETPLAY_CMD_INPUT &&
+            size == LOADTEST_INPUT_WORDS * sizeof(uint32_t))
+      {
+         retro_time_t sent = ((retro_time_t)ntohl(payload[3]) << 32) |
+            ntohl(payload[4]);
+         retro_time_t latency = cpu_features_get_time_usec() - sent;
+
+         if (ntohl(payload[0]) != end->recv_frame)
+            errors++;
+         end->recv_frame = ntohl(payload[0]) + 1;
+
+         inputs_recvd++;
+         latency_sum += latency;
+         if (latency > latency_max)
+            latency_max = latency;
+      }
+   }
+
+   netplay_recv_reset(&end->recv_buf);
+
+   return true;
+}
+
+static bool loadtest_handle_control(struct loadtest_room *room)
+{
+   uint32_t magic;
+   bool error    = false;
+   ssize_t recvd = socket_receive_all_nonblocking(room->control_fd, &error,
+         &magic, sizeof(magic));
+
+   if (recvd < 0 || error)
+      return false;
+   if (!recvd)
+      return true;
+
+   /* Pings come alone and are tiny, so they always arrive whole */
+   if (recvd != sizeof(magic) || ntohl(magic) != MITM_PING_MAGIC)
+      return false;
+
+   return socket_send_all_blocking(room->control_fd, &magic,
+         sizeof(magic), true);
+}
+
+static retro_time_t loadtest_cpu_time(void)
+{
+   struct rusage usage;
+
+   if (getrusage(RUSAGE_SELF, &usage))
+      return 0;
+
+   return (retro_time_t)usage.ru_utime.tv_sec * 1000000 +
+                        usage.ru_utime.tv_usec +
+          (retro_time_t)usage.ru_stime.tv_sec * 1000000 +
+                        usage.ru_stime.tv_usec;
+}
+
+int main(int argc, char **argv)
+{
+   struct epoll_event events[LOADTEST_MAX_EVENTS];
+   struct rlimit limit;
+   retro_time_t start, end_time, next_frame, frame_time, cpu_start, elapsed;
+   unsigned i;
+   const char *host        = "localhost";
+   int port                = RARCH_DEFAULT_PORT;
+   unsigned fps            = 60;
+   unsigned duration       = 10;
+   unsigned state_interval = 60;
+   uint32_t state_size     = 0;
+   size_t buffer_size      = 64 * 1024;
+
+   const struct option opt[] = {
+      {"host",     1, NULL, 'H'},
+      {"port",     1, NULL, 'P'},
+      {"rooms",    1, NULL, 'r'},
+      {"fps",      1, NULL, 'f'},
+      {"duration", 1, NULL, 'd'},
+      {"state",    1, NULL, 'S'},
+      {"interval", 1, NULL, 'i'},
+      {NULL,       0, NULL, 0}
+   };
+
+   for (;;)
+   {
+      int c = getopt_long(argc, argv, "H:P:r:f:d:S:i:", opt, NULL);
+      if (c == -1)
+         break;
+
+      switch (c)
+      {
+         case 'H':
+            host = optarg;
+            break;
+
+         case 'P':
+            port = atoi(optarg);
+            break;
+
+         case 'r':
+            num_rooms = strtoul(optarg, NULL, 0);
+            break;
+
+         case 'f':
+            fps = strtoul(optarg, NULL, 0);
+            break;
+
+         case 'd':
+            duration = strtoul(optarg, NULL, 0);
+            break;
+
+         case 'S':
+            /* Room for the frame, size and timestamp words */
+            state_size = (strtoul(optarg, NULL, 0) + 3) & ~3U;
+            if (state_size && state_size < 4 * sizeof(uint32_t))
+               state_size = 4 * sizeof(uint32_t);
+            break;
+
+         case 'i':
+            state_interval = strtoul(optarg, NULL, 0);
+            break;
+
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (!num_rooms || !fps || !duration || !state_interval)
+   {
+      usage();
+      return 1;
+   }
+
+   signal(SIGPIPE, SIG_IGN);
+
+   /* Three sockets per room */
+   if (!getrlimit(RLIMIT_NOFILE, &limit))
+   {
+      limit.rlim_cur = limit.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &limit);
+   }
+
+   /* Allocate space for the protocol */
+   payload_size = LOADTEST_INPUT_WORDS * sizeof(uint32_t);
+   if (payload_size < state_size)
+      payload_size = state_size;
+   while (buffer_size < 2 * (payload_size + 2 * sizeof(uint32_t)))
+      buffer_size *= 2;
+
+   payload = (uint32_t*)malloc(payload_size);
+   rooms   = (struct loadtest_room*)calloc(num_rooms, sizeof(*rooms));
+   if (!payload || !rooms)
+   {
+      perror("malloc");
+      return 1;
+   }
+
+   epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+   if (epoll_fd < 0)
+   {
+      perror("epoll_create1");
+      return 1;
+   }
+
+   /* Open every room up front */
+   for (i = 0; i < num_rooms; i++)
+   {
+      struct loadtest_room *room = &rooms[i];
+      struct epoll_event ev;
+      unsigned j;
+
+      if (!loadtest_open_room(room, host, port))
+      {
+         fprintf(stderr, "Failed to open room %u.\n", i);
+         return 1;
+      }
+
+      ev.events   = EPOLLIN;
+      ev.data.u64 = ((uint64_t)i << 2) | LOADTEST_CONTROL;
+      if (!socket_nonblock(room->control_fd) ||
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, room->control_fd, &ev) < 0)
+      {
+         perror("epoll_ctl");
+         return 1;
+      }
+
+      for (j = 0; j < 2; j++)
+      {
+         struct loadtest_endpoint *end = &room->ends[j];
+
+         if (!netplay_init_socket_buffer(&end->send_buf, buffer_size) ||
+               !netplay_init_socket_buffer(&end->recv_buf, buffer_size) ||
+               !socket_nonblock(end->fd))
+         {
+            perror("socket buffer");
+            return 1;
+         }
+
+         loadtest_update_events(end, ((uint64_t)i << 2) | j);
+      }
+   }
+
+   printf("Opened %u rooms.\n", num_rooms);
+   fflush(stdout);
+
+   frame_time = 1000000 / fps;
+   start      = cpu_features_get_time_usec();
+   end_time   = start + (retro_time_t)duration * 1000000;
+   next_frame = start;
+   cpu_start  = loadtest_cpu_time();
+
+   for (;;)
+   {
+      int count, timeout;
+      retro_time_t now = cpu_features_get_time_usec();
+
+      if (now >= end_time)
+         break;
+
+      if (now >= next_frame)
+      {
+         for (i = 0; i < num_rooms; i++)
+         {
+            unsigned j;
+
+            for (j = 0; j < 2; j++)
+            {
+               struct loadtest_endpoint *end = &rooms[i].ends[j];
+
+               if (!loadtest_send_frame(end, (enum loadtest_end)j,
+                        state_size, state_interval))
+               {
+                  fprintf(stderr, "Room %u disconnected.\n", i);
+                  return 1;
+               }
+
+               loadtest_update_events(end, ((uint64_t)i << 2) | j);
+            }
+         }
+
+         next_frame += frame_time;
+         continue;
+      }
+
+      timeout = (int)((next_frame - now + 999) / 1000);
+      count   = epoll_wait(epoll_fd, events, LOADTEST_MAX_EVENTS, timeout);
+      if (count < 0 && errno != EINTR)
+      {
+         perror("epoll_wait");
+         return 1;
+      }
+
+      for (i = 0; i < (unsigned)count; i++)
+      {
+         unsigned idx               = (unsigned)(events[i].data.u64 >> 2);
+         unsigned which             = (unsigned)(events[i].data.u64 & 3);
+         struct loadtest_room *room = &rooms[idx];
+         struct loadtest_endpoint *end;
+         bool ok;
+
+         if (which == LOADTEST_CONTROL)
+            ok = loadtest_handle_control(room);
+         else
+         {
+            end = &room->ends[which];
+            ok  = true;
+
+            if (events[i].events & EPOLLOUT)
+               ok = netplay_send_flush(&end->send_buf, end->fd, false);
+            if (ok && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)))
+               ok = loadtest_recv(end);
+            if (ok)
+               loadtest_update_events(end, events[i].data.u64);
+         }
+
+         if (!ok)
+         {
+            fprintf(stderr, "Room %u disconnected.\n", idx);
+            return 1;
+         }
+      }
+   }
+
+   elapsed = cpu_features_get_time_usec() - start;
+
+   printf("rooms: %u, messages: %.0f/s, data: %.2f MB/s, "
+         "latency: %.2f ms avg, %.2f ms max, stalls: %llu, errors: %llu, "
+         "cpu: %.1f%%\n",
+         num_rooms,
+         (double)msgs_recvd * 1000000.0 / elapsed,
+         (double)bytes_recvd / elapsed,
+         inputs_recvd ? (double)latency_sum / inputs_recvd / 1000.0 : 0.0,
+         (double)latency_max / 1000.0,
+         (unsigned long long)stalls, (unsigned long long)errors,
+         (double)(loadtest_cpu_time() - cpu_start) * 100.0 / elapsed);
+
+   return errors ? 1 : 0;
+}
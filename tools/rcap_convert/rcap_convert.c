@@ -0,0 +1,527 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Decodes a RCAP capture into raw video and a WAV file,
+ * to be transcoded by any encoder that reads raw video. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "compat/getopt.h"
+
+#include "record/drivers/rcap_codec.h"
+
+#ifdef _WIN32
+#define rcap_fseek _fseeki64
+#else
+#define rcap_fseek fseeko
+#endif
+
+enum rcap_pix_format
+{
+   RCAP_PIX_RGB565 = 0,
+   RCAP_PIX_BGR24,
+   RCAP_PIX_ARGB8888
+};
+
+struct rcap_file
+{
+   FILE *f;
+   uint64_t index_offset;
+   double fps;
+   double samplerate;
+   double aspect;
+   unsigned pix_fmt;
+   unsigned pix_size;
+   unsigned channels;
+   unsigned keyframe_interval;
+   uint32_t flags;
+};
+
+struct rcap_chunk
+{
+   char tag[5];
+   uint32_t size;
+   uint32_t arg;
+   uint32_t codec;
+   uint32_t decoded_size;
+};
+
+static bool read_chunk_header(struct rcap_file *rf, struct rcap_chunk *chunk)
+{
+   uint8_t buf[RCAP_CHUNK_HEADER_SIZE];
+
+   if (fread(buf, 1, sizeof(buf), rf->f) != sizeof(buf))
+      return false;
+
+   memcpy(chunk->tag, buf, 4);
+   chunk->tag[4]       = '\0';
+   chunk->size         = rcap_get_le32(buf + 4);
+   chunk->arg          = rcap_get_le32(buf + 8);
+   chunk->codec        = rcap_get_le32(buf + 12);
+   chunk->decoded_size = rcap_get_le32(buf + 16);
+   return true;
+}
+
+static bool open_rcap(struct rcap_file *rf, const char *path)
+{
+   uint8_t header[RCAP_HEADER_SIZE];
+
+   memset(rf, 0, sizeof(*rf));
+
+   if (!(rf->f = fopen(path, "rb")))
+   {
+      fprintf(stderr, "Cannot open %s.\n", path);
+      return false;
+   }
+
+   if (     fread(header, 1, sizeof(header), rf->f) != sizeof(header)
+         || memcmp(header, "RCAP", 4)
+         || rcap_get_le32(header + 4) != RCAP_VERSION)
+   {
+      fprintf(stderr, "%s is not a RCAP v%d file.\n", path, RCAP_VERSION);
+      return false;
+   }
+
+   rf->pix_fmt           = rcap_get_le32(header + 8);
+   rf->flags             = rcap_get_le32(header + 12);
+   rf->fps               = rcap_get_le32(header + 16) / 1000.0;
+   rf->samplerate        = rcap_get_le32(header + 20) / 1000.0;
+   rf->channels          = rcap_get_le32(header + 24);
+   rf->aspect            = rcap_get_le32(header + 28) / 10000.0;
+   rf->index_offset      = rcap_get_le64(header + 32);
+   rf->keyframe_interval = rcap_get_le32(header + 40);
+
+   switch (rf->pix_fmt)
+   {
+      case RCAP_PIX_RGB565:
+         rf->pix_size = 2;
+         break;
+      case RCAP_PIX_BGR24:
+         rf->pix_size = 3;
+         break;
+      case RCAP_PIX_ARGB8888:
+         rf->pix_size = 4;
+         break;
+      default:
+         fprintf(stderr, "Unknown pixel format %u.\n", rf->pix_fmt);
+         return false;
+   }
+
+   return true;
+}
+
+/* Name of the pixel format for FFmpeg's rawvideo demuxer. */
+static const char *ffmpeg_pix_fmt(const struct rcap_file *rf)
+{
+   bool be = (rf->flags & RCAP_FLAG_BIG_ENDIAN) != 0;
+
+   switch (rf->pix_fmt)
+   {
+      case RCAP_PIX_RGB565:
+         return be ? "rgb565be" : "rgb565le";
+      case RCAP_PIX_BGR24:
+         return "bgr24";
+      default:
+         break;
+   }
+   return be ? "0rgb" : "bgr0";
+}
+
+/* Finds the keyframe to start decoding from for @first. */
+static bool seek_keyframe(struct rcap_file *rf, uint32_t first,
+      uint32_t *frame)
+{
+   uint32_t i;
+   struct rcap_chunk chunk;
+   uint64_t offset = RCAP_HEADER_SIZE;
+
+   *frame = 0;
+
+   if (first && rf->index_offset)
+   {
+      if (     !rcap_fseek(rf->f, rf->index_offset, SEEK_SET)
+            && read_chunk_header(rf, &chunk)
+            && !memcmp(chunk.tag, RCAP_TAG_INDEX, 4))
+      {
+         for (i = 0; i < chunk.arg; i++)
+         {
+            uint8_t entry[RCAP_INDEX_ENTRY_SIZE];
+
+            if (fread(entry, 1, sizeof(entry), rf->f) != sizeof(entry))
+               break;
+            if (rcap_get_le32(entry) > first)
+               break;
+
+            *frame = rcap_get_le32(entry);
+            offset = rcap_get_le64(entry + 8);
+         }
+      }
+      else
+         fprintf(stderr, "Index is damaged, decoding from the start.\n");
+   }
+
+   return !rcap_fseek(rf->f, offset, SEEK_SET);
+}
+
+/* Reads the sizes of all pictures up front, raw video needs a fixed size. */
+static void scan_sizes(struct rcap_file *rf,
+      unsigned *max_width, unsigned *max_height,
+      uint32_t *frames, uint32_t *keyframes, uint64_t *audio_frames)
+{
+   struct rcap_chunk chunk;
+
+   rcap_fseek(rf->f, RCAP_HEADER_SIZE, SEEK_SET);
+
+   while (read_chunk_header(rf, &chunk))
+   {
+      uint8_t size[8];
+      uint32_t skip = chunk.size;
+
+      if (     !memcmp(chunk.tag, RCAP_TAG_KEYFRAME, 4)
+            || !memcmp(chunk.tag, RCAP_TAG_DELTA, 4))
+      {
+         if (fread(size, 1, sizeof(size), rf->f) != sizeof(size))
+            break;
+         if (rcap_get_le32(size) > *max_width)
+            *max_width  = rcap_get_le32(size);
+         if (rcap_get_le32(size + 4) > *max_height)
+            *max_height = rcap_get_le32(size + 4);
+         if (!memcmp(chunk.tag, RCAP_TAG_KEYFRAME, 4))
+            (*keyframes)++;
+         (*frames)++;
+         skip -= sizeof(size);
+      }
+      else if (!memcmp(chunk.tag, RCAP_TAG_DUPE, 4))
+         (*frames)++;
+      else if (!memcmp(chunk.tag, RCAP_TAG_AUDIO, 4))
+         *audio_frames += chunk.arg;
+
+      if (rcap_fseek(rf->f, skip, SEEK_CUR))
+         break;
+   }
+}
+
+static void put_wav_header(FILE *f, const struct rcap_file *rf,
+      uint32_t data_size)
+{
+   uint8_t h[44];
+   unsigned block = rf->channels * 2;
+   unsigned rate  = (unsigned)(rf->samplerate + 0.5);
+
+   memcpy(h, "RIFF", 4);
+   rcap_put_le32(h + 4, 36 + data_size);
+   memcpy(h + 8, "WAVEfmt ", 8);
+   rcap_put_le32(h + 16, 16);
+   h[20] = 1;
+   h[21] = 0;
+   h[22] = (uint8_t)rf->channels;
+   h[23] = 0;
+   rcap_put_le32(h + 24, rate);
+   rcap_put_le32(h + 28, rate * block);
+   h[32] = (uint8_t)block;
+   h[33] = 0;
+   h[34] = 16;
+   h[35] = 0;
+   memcpy(h + 36, "data", 4);
+   rcap_put_le32(h + 40, data_size);
+
+   rewind(f);
+   fwrite(h, 1, sizeof(h), f);
+}
+
+static bool decode_picture(const struct rcap_chunk *chunk, uint8_t *payload,
+      uint8_t *scratch, size_t scratch_size, uint8_t *pic)
+{
+   const uint8_t *enc = payload + 8;
+   size_t enc_size    = chunk->size - 8;
+   size_t size        = chunk->decoded_size;
+
+   if (!memcmp(chunk->tag, RCAP_TAG_KEYFRAME, 4))
+      memset(pic, 0, size);
+
+   switch (chunk->codec)
+   {
+      case RCAP_CODEC_RAW:
+         if (enc_size != size)
+            return false;
+         memcpy(pic, enc, size);
+         return true;
+      case RCAP_CODEC_ZRLE:
+         return rcap_zrle_decode(enc, enc_size, pic, size);
+      case RCAP_CODEC_ZRLE_DEFLATE:
+#ifdef HAVE_ZLIB
+         {
+            uLongf len = (uLongf)scratch_size;
+            if (uncompress(scratch, &len, enc, (uLong)enc_size) != Z_OK)
+               return false;
+            return rcap_zrle_decode(scratch, len, pic, size);
+         }
+#else
+         fprintf(stderr, "Built without zlib, cannot decode keyframe.\n");
+         return false;
+#endif
+      default:
+         break;
+   }
+   return false;
+}
+
+static void usage(void)
+{
+   fprintf(stderr,
+         "Usage: rcap_convert [-i] [-s first frame] [-n frames]\n"
+         "                    [-v video.raw] [-a audio.wav] file.rcap\n"
+         "\n"
+         "  -i  Print information about the file.\n"
+         "  -s  First frame to convert, found through the keyframe index.\n"
+         "  -n  Number of frames to convert.\n"
+         "  -v  Write raw video; '-' for stdout.\n"
+         "  -a  Write audio as WAV.\n");
+}
+
+int main(int argc, char *argv[])
+{
+   int c;
+   struct rcap_file rf;
+   struct rcap_chunk chunk;
+   uint32_t frames          = 0;
+   uint32_t keyframes       = 0;
+   uint64_t total_audio     = 0;
+   unsigned max_width       = 0;
+   unsigned max_height      = 0;
+   bool info                = false;
+   const char *video_path   = NULL;
+   const char *audio_path   = NULL;
+   uint32_t first           = 0;
+   uint32_t count           = UINT32_MAX;
+   uint32_t frame           = 0;
+   uint32_t written         = 0;
+   uint32_t audio_bytes     = 0;
+   unsigned width           = 0;
+   unsigned height          = 0;
+   size_t out_size, scratch_size;
+   FILE *video              = NULL;
+   FILE *audio              = NULL;
+   uint8_t *pic             = NULL;
+   uint8_t *out             = NULL;
+   uint8_t *payload         = NULL;
+   uint8_t *scratch         = NULL;
+   size_t payload_cap       = 0;
+   int ret                  = 1;
+
+   while ((c = getopt(argc, argv, "is:n:v:a:h")) != -1)
+   {
+      switch (c)
+      {
+         case 'i':
+            info       = true;
+            break;
+         case 's':
+            first      = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+         case 'n':
+            count      = (uint32_t)strtoul(optarg, NULL, 0);
+            break;
+         case 'v':
+            video_path = optarg;
+            break;
+         case 'a':
+            audio_path = optarg;
+            break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (optind >= argc || (!info && !video_path && !audio_path))
+   {
+      usage();
+      return 1;
+   }
+
+   if (!open_rcap(&rf, argv[optind]))
+      return 1;
+
+   scan_sizes(&rf, &max_width, &max_height, &frames, &keyframes,
+         &total_audio);
+
+   if (info)
+   {
+      printf("Frames:       %u (%u keyframes, every %u frames)\n",
+            frames, keyframes, rf.keyframe_interval);
+      printf("Size:         up to %ux%u, %s\n",
+            max_width, max_height, ffmpeg_pix_fmt(&rf));
+      printf("Rate:         %.3f fps, aspect %.4f\n", rf.fps, rf.aspect);
+      printf("Audio:        %.3f Hz, %u channels, %llu sample frames\n",
+            rf.samplerate, rf.channels, (unsigned long long)total_audio);
+      printf("Index:        %s\n", rf.index_offset ? "yes"
+            : "missing, recording was cut short");
+   }
+
+   if (!video_path && !audio_path)
+      return 0;
+
+   out_size     = (size_t)max_width * max_height * rf.pix_size;
+   scratch_size = rcap_zrle_bound(out_size);
+   pic          = (uint8_t*)calloc(1, out_size + 1);
+   out          = (uint8_t*)calloc(1, out_size + 1);
+   scratch      = (uint8_t*)malloc(scratch_size + 1);
+   if (!pic || !out || !scratch)
+      goto end;
+
+   if (video_path)
+   {
+      video = strcmp(video_path, "-") ? fopen(video_path, "wb") : stdout;
+      if (!video)
+      {
+         fprintf(stderr, "Cannot create %s.\n", video_path);
+         goto end;
+      }
+   }
+
+   if (audio_path)
+   {
+      if (!(audio = fopen(audio_path, "wb")))
+      {
+         fprintf(stderr, "Cannot create %s.\n", audio_path);
+         goto end;
+      }
+      put_wav_header(audio, &rf, 0);
+   }
+
+   if (!seek_keyframe(&rf, first, &frame))
+      goto end;
+
+   while (written < count && read_chunk_header(&rf, &chunk))
+   {
+      bool is_audio = !memcmp(chunk.tag, RCAP_TAG_AUDIO, 4);
+      bool is_video = !memcmp(chunk.tag, RCAP_TAG_KEYFRAME, 4)
+         ||           !memcmp(chunk.tag, RCAP_TAG_DELTA, 4);
+
+      if (!memcmp(chunk.tag, RCAP_TAG_INDEX, 4))
+         break;
+
+      if (chunk.size > payload_cap)
+      {
+         uint8_t *tmp = (uint8_t*)realloc(payload, chunk.size);
+         if (!tmp)
+            goto end;
+         payload      = tmp;
+         payload_cap  = chunk.size;
+      }
+
+      if (fread(payload, 1, chunk.size, rf.f) != chunk.size)
+      {
+         fprintf(stderr, "Truncated chunk at frame %u.\n", frame);
+         break;
+      }
+
+      if (is_audio)
+      {
+         /* Audio before the first frame wanted belongs to skipped video. */
+         if (frame >= first && audio)
+         {
+            /* WAV samples are little-endian. */
+            if (rf.flags & RCAP_FLAG_BIG_ENDIAN)
+            {
+               uint32_t i;
+               for (i = 0; i + 1 < chunk.size; i += 2)
+               {
+                  uint8_t tmp    = payload[i];
+                  payload[i]     = payload[i + 1];
+                  payload[i + 1] = tmp;
+               }
+            }
+            fwrite(payload, 1, chunk.size, audio);
+            audio_bytes += chunk.size;
+         }
+         continue;
+      }
+
+      if (is_video)
+      {
+         unsigned w = chunk.size >= 8 ? rcap_get_le32(payload)     : 0;
+         unsigned h = chunk.size >= 8 ? rcap_get_le32(payload + 4) : 0;
+
+         if (     chunk.size < 8
+               || (size_t)w * h * rf.pix_size != chunk.decoded_size
+               || chunk.decoded_size > out_size
+               || (!memcmp(chunk.tag, RCAP_TAG_DELTA, 4)
+                  && (w != width || h != height))
+               || !decode_picture(&chunk, payload,
+                  scratch, scratch_size, pic))
+         {
+            fprintf(stderr, "Cannot decode frame %u.\n", frame);
+            goto end;
+         }
+         width  = w;
+         height = h;
+      }
+      else if (memcmp(chunk.tag, RCAP_TAG_DUPE, 4))
+         continue;
+
+      if (frame >= first)
+      {
+         if (video)
+         {
+            unsigned y;
+            size_t row = (size_t)width * rf.pix_size;
+
+            /* Smaller pictures go to the top left corner. */
+            memset(out, 0, out_size);
+            for (y = 0; y < height; y++)
+               memcpy(out + y * max_width * rf.pix_size, pic + y * row, row);
+            if (fwrite(out, 1, out_size, video) != out_size)
+            {
+               fprintf(stderr, "Cannot write video.\n");
+               goto end;
+            }
+         }
+         written++;
+      }
+      frame++;
+   }
+
+   if (audio)
+      put_wav_header(audio, &rf, audio_bytes);
+
+   fprintf(stderr, "Converted %u frames from frame %u.\n", written, first);
+   if (video)
+      fprintf(stderr, "Encode with:\n  ffmpeg -f rawvideo -pix_fmt %s"
+            " -video_size %ux%u -framerate %.3f -i %s%s%s ...\n",
+            ffmpeg_pix_fmt(&rf), max_width, max_height, rf.fps,
+            video_path, audio ? " -i " : "", audio ? audio_path : "");
+   ret = 0;
+
+end:
+   if (video && video != stdout)
+      fclose(video);
+   if (audio)
+      fclose(audio);
+   fclose(rf.f);
+   free(pic);
+   free(out);
+   free(payload);
+   free(scratch);
+   return ret;
+}
@@ -0,0 +1,199 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures how fast save states and SRAM files are written and read
+ * back through the RZIP stream, at the default and the fast
+ * compression level. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include "compat/getopt.h"
+#include <features/features_cpu.h>
+#include <file/file_path.h>
+#include <streams/rzip_stream.h>
+
+struct bench_result
+{
+   int64_t compressed;
+   retro_time_t write_usec;
+   retro_time_t read_usec;
+   bool ok;
+};
+
+static void usage(void)
+{
+   fprintf(stderr,
+      "Usage: rzip_bench [-n runs] [-o tmpfile] file...\n"
+      "    Files may be raw or RZIP compressed (.state, .srm).\n"
+      "    -n   Runs per level, the fastest is reported. Defaults to 5.\n"
+      "    -o   Scratch file. Defaults to rzip_bench.tmp.\n");
+}
+
+static bool bench_write(const char *path, const void *data, int64_t len,
+      unsigned level)
+{
+   int64_t written      = 0;
+   rzipstream_t *stream = rzipstream_open(path, RETRO_VFS_FILE_ACCESS_WRITE);
+
+   if (!stream)
+      return false;
+
+   rzipstream_set_compression_level(stream, level);
+   written = rzipstream_write(stream, data, len);
+
+   if (rzipstream_close(stream) == -1)
+      return false;
+
+   return written == len;
+}
+
+static void bench_level(const char *tmp, const void *data, int64_t len,
+      unsigned level, unsigned runs, struct bench_result *res)
+{
+   unsigned i;
+
+   memset(res, 0, sizeof(*res));
+   res->ok = true;
+
+   for (i = 0; i < runs && res->ok; i++)
+   {
+      void *buf        = NULL;
+      int64_t buf_len  = 0;
+      retro_time_t t0  = cpu_features_get_time_usec();
+      retro_time_t t1, t2;
+
+      if (!bench_write(tmp, data, len, level))
+      {
+         res->ok = false;
+         break;
+      }
+      t1 = cpu_features_get_time_usec();
+
+      if (!rzipstream_read_file(tmp, &buf, &buf_len))
+      {
+         res->ok = false;
+         break;
+      }
+      t2 = cpu_features_get_time_usec();
+
+      if (buf_len != len || memcmp(buf, data, (size_t)len))
+         res->ok = false;
+      free(buf);
+
+      if (i == 0 || t1 - t0 < res->write_usec)
+         res->write_usec = t1 - t0;
+      if (i == 0 || t2 - t1 < res->read_usec)
+         res->read_usec  = t2 - t1;
+   }
+
+   res->compressed = path_get_size(tmp);
+}
+
+static double mb_per_sec(int64_t len, retro_time_t usec)
+{
+   return usec > 0 ? (double)len / (double)usec : 0.0;
+}
+
+int main(int argc, char **argv)
+{
+   int opt;
+   int i;
+   unsigned runs   = 5;
+   const char *tmp = "rzip_bench.tmp";
+   int failed      = 0;
+
+   while ((opt = getopt(argc, argv, "n:o:")) != -1)
+   {
+      switch (opt)
+      {
+         case 'n':
+            runs = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'o':
+            tmp  = optarg;
+            break;
+         default:
+            usage();
+            return 1;
+      }
+   }
+
+   if (optind >= argc || !runs)
+   {
+      usage();
+      return 1;
+   }
+
+   printf("%u CPU cores\n", cpu_features_get_core_amount());
+   printf("%-32s %5s %10s %10s %7s %10s %10s\n",
+         "file", "level", "size", "rzip", "ratio", "write MB/s", "read MB/s");
+
+   for (i = optind; i < argc; i++)
+   {
+      unsigned l;
+      void *data     = NULL;
+      int64_t len    = 0;
+      const char *name;
+      static const unsigned levels[] = {
+         RZIP_COMPRESSION_LEVEL_DEFAULT,
+         RZIP_COMPRESSION_LEVEL_FAST
+      };
+
+      /* Decompresses RZIP files, passes others through */
+      if (!rzipstream_read_file(argv[i], &data, &len) || len <= 0)
+      {
+         fprintf(stderr, "Cannot read %s\n", argv[i]);
+         free(data);
+         failed = 1;
+         continue;
+      }
+
+      if (!(name = strrchr(argv[i], '/')))
+         name = argv[i];
+      else
+         name++;
+
+      for (l = 0; l < sizeof(levels) / sizeof(levels[0]); l++)
+      {
+         struct bench_result res;
+
+         bench_level(tmp, data, len, levels[l], runs, &res);
+
+         if (!res.ok)
+         {
+            printf("%-32.32s %5u FAILED\n", name, levels[l]);
+            failed = 1;
+            continue;
+         }
+
+         printf("%-32.32s %5u %10lld %10lld %6.1f%% %10.1f %10.1f\n",
+               name, levels[l], (long long)len, (long long)res.compressed,
+               100.0 * (double)res.compressed / (double)len,
+               mb_per_sec(len, res.write_usec),
+               mb_per_sec(len, res.read_usec));
+      }
+
+      free(data);
+   }
+
+   remove(tmp);
+   return failed;
+}
@@ -0,0 +1,449 @@
+/*  RetroArch - A frontend for libretro.
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "softfilter.h"
+
+#define MAX_KEYS 64
+
+struct filt_preset
+{
+   char dir[1024];
+   char filter[256];
+   char keys[MAX_KEYS][128];
+   char values[MAX_KEYS][128];
+   unsigned num_keys;
+};
+
+static const char *preset_lookup(struct filt_preset *preset, const char *key)
+{
+   unsigned i;
+   for (i = 0; i < preset->num_keys; i++)
+      if (!strcmp(preset->keys[i], key))
+         return preset->values[i];
+   return NULL;
+}
+
+static int cfg_get_float(void *userdata, const char *key,
+      float *value, float default_value)
+{
+   const char *v = preset_lookup((struct filt_preset*)userdata, key);
+   *value        = v ? (float)strtod(v, NULL) : default_value;
+   return v != NULL;
+}
+
+static int cfg_get_int(void *userdata, const char *key,
+      int *value, int default_value)
+{
+   const char *v = preset_lookup((struct filt_preset*)userdata, key);
+   *value        = v ? (int)strtol(v, NULL, 0) : default_value;
+   return v != NULL;
+}
+
+static int cfg_get_hex(void *userdata, const char *key,
+      unsigned *value, unsigned default_value)
+{
+   const char *v = preset_lookup((struct filt_preset*)userdata, key);
+   *value        = v ? (unsigned)strtoul(v, NULL, 16) : default_value;
+   return v != NULL;
+}
+
+static int cfg_get_float_array(void *userdata, const char *key,
+      float **values, unsigned *out_num_values,
+      const float *default_values, unsigned num_default_values)
+{
+   *values         = NULL;
+   *out_num_values = 0;
+   if (num_default_values)
+   {
+      *values = (float*)malloc(num_default_values * sizeof(float));
+      memcpy(*values, default_values, num_default_values * sizeof(float));
+      *out_num_values = num_default_values;
+   }
+   return 0;
+}
+
+static int cfg_get_int_array(void *userdata, const char *key,
+      int **values, unsigned *out_num_values,
+      const int *default_values, unsigned num_default_values)
+{
+   *values         = NULL;
+   *out_num_values = 0;
+   if (num_default_values)
+   {
+      *values = (int*)malloc(num_default_values * sizeof(int));
+      memcpy(*values, default_values, num_default_values * sizeof(int));
+      *out_num_values = num_default_values;
+   }
+   return 0;
+}
+
+static int cfg_get_string(void *userdata, const char *key,
+      char **output, const char *default_output)
+{
+   const char *v = preset_lookup((struct filt_preset*)userdata, key);
+   if (!v)
+      v = default_output;
+   *output = v ? strdup(v) : NULL;
+   return v != NULL;
+}
+
+static const struct softfilter_config bench_config = {
+   cfg_get_float,
+   cfg_get_int,
+   cfg_get_hex,
+   cfg_get_float_array,
+   cfg_get_int_array,
+   cfg_get_string,
+   free,
+};
+
+static char *trim(char *s)
+{
+   char *end;
+   while (*s == ' ' || *s == '\t')
+      s++;
+   end = s + strlen(s);
+   while (end > s && (end[-1] == ' ' || end[-1] == '\t'
+            || end[-1] == '\n' || end[-1] == '\r' || end[-1] == '"'))
+      *--end = '\0';
+   if (*s == '"')
+      s++;
+   return s;
+}
+
+static int preset_load(struct filt_preset *preset, const char *path)
+{
+   char line[512];
+   const char *slash;
+   FILE *f = fopen(path, "r");
+
+   memset(preset, 0, sizeof(*preset));
+   if (!f)
+      return 0;
+
+   if ((slash = strrchr(path, '/')))
+      snprintf(preset->dir, sizeof(preset->dir), "%.*s",
+            (int)(slash - path), path);
+   else
+      strcpy(preset->dir, ".");
+
+   while (fgets(line, sizeof(line), f))
+   {
+      char *key, *value;
+      char *eq = strchr(line, '=');
+
+      if (line[0] == '#' || !eq)
+         continue;
+
+      *eq   = '\0';
+      key   = trim(line);
+      value = trim(eq + 1);
+
+      if (!strcmp(key, "filter"))
+         snprintf(preset->filter, sizeof(preset->filter), "%s", value);
+      else if (preset->num_keys < MAX_KEYS)
+      {
+         snprintf(preset->keys[preset->num_keys],
+               sizeof(preset->keys[0]), "%s", key);
+         snprintf(preset->values[preset->num_keys],
+               sizeof(preset->values[0]), "%s", value);
+         preset->num_keys++;
+      }
+   }
+
+   fclose(f);
+   return preset->filter[0] != '\0';
+}
+
+static double now_ms(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* Synthetic frames approximate pixel art: a small palette drawn
+ * in horizontal runs, so that the edge-detecting scalers take
+ * both their 'flat' and 'edge' paths. */
+static void synth_frames(uint8_t *frames, unsigned num_frames,
+      unsigned width, unsigned height, unsigned bpp)
+{
+   static const uint32_t palette[8] = {
+      0x000000, 0xffffff, 0xd82800, 0x0058f8,
+      0xfc9838, 0x00a800, 0x6b6b6b, 0xf8d878
+   };
+   unsigned f, x, y;
+   unsigned seed = 1;
+
+   for (f = 0; f < num_frames; f++)
+   {
+      for (y = 0; y < height; y++)
+      {
+         uint32_t color = 0;
+         unsigned run   = 0;
+         for (x = 0; x < width; x++)
+         {
+            uint8_t *px = frames + ((size_t)(f * height + y) * width + x) * bpp;
+            if (!run)
+            {
+               seed  = seed * 1103515245 + 12345;
+               color = palette[(seed >> 16) & 7];
+               run   = 1 + ((seed >> 20) & 7);
+            }
+            run--;
+
+            if (bpp == 2)
+            {
+               uint16_t c = (uint16_t)(((color >> 8) & 0xf800)
+                     | ((color >> 5) & 0x07e0) | ((color >> 3) & 0x001f));
+               memcpy(px, &c, 2);
+            }
+            else
+               memcpy(px, &color, 4);
+         }
+      }
+   }
+}
+
+static uint32_t checksum(const uint8_t *data, unsigned width,
+      unsigned height, size_t pitch, unsigned bpp)
+{
+   unsigned x, y;
+   uint32_t hash = 2166136261u;
+   for (y = 0; y < height; y++)
+      for (x = 0; x < width * bpp; x++)
+         hash = (hash ^ data[y * pitch + x]) * 16777619u;
+   return hash;
+}
+
+static int bench_preset(const char *path, const uint8_t *frames,
+      unsigned num_frames, unsigned passes, unsigned width, unsigned height,
+      unsigned fmt, softfilter_simd_mask_t simd)
+{
+   struct filt_preset preset;
+   char lib_path[1400];
+   void *lib, *impl_data;
+   softfilter_get_implementation_t get_impl;
+   const struct softfilter_implementation *impl;
+   struct softfilter_work_packet *packets;
+   unsigned bpp      = fmt == SOFTFILTER_FMT_RGB565 ? 2 : 4;
+   unsigned out_w    = 0;
+   unsigned out_h    = 0;
+   unsigned threads, i, p;
+   size_t in_pitch   = (size_t)width * bpp;
+   size_t out_pitch;
+   uint8_t *output;
+   double start, elapsed;
+
+   if (!preset_load(&preset, path))
+   {
+      fprintf(stderr, "%s: not a filter preset\n", path);
+      return 0;
+   }
+
+   snprintf(lib_path, sizeof(lib_path), "%s/%s.so", preset.dir, preset.filter);
+   if (!(lib = dlopen(lib_path, RTLD_NOW | RTLD_LOCAL)))
+   {
+      fprintf(stderr, "%s: %s\n", path, dlerror());
+      return 0;
+   }
+
+   get_impl = (softfilter_get_implementation_t)
+      dlsym(lib, "softfilter_get_implementation");
+   if (!get_impl || !(impl = get_impl(simd))
+         || impl->api_version != SOFTFILTER_API_VERSION)
+   {
+      fprintf(stderr, "%s: invalid filter plugin\n", lib_path);
+      dlclose(lib);
+      return 0;
+   }
+
+   if (!(impl->query_input_formats() & fmt))
+   {
+      printf("%-40s (format not supported)\n", path);
+      dlclose(lib);
+      return 1;
+   }
+
+   impl_data = impl->create(&bench_config, fmt, fmt,
+         width, height, 1, simd, &preset);
+   if (!impl_data)
+   {
+      dlclose(lib);
+      return 0;
+   }
+
+   impl->query_output_size(impl_data, &out_w, &out_h, width, height);
+   threads   = impl->query_num_threads(impl_data);
+   out_pitch = (size_t)out_w * bpp;
+   output    = (uint8_t*)calloc(out_h, out_pitch);
+   packets   = (struct softfilter_work_packet*)
+      calloc(threads, sizeof(*packets));
+
+   start = now_ms();
+   for (p = 0; p < passes; p++)
+   {
+      unsigned f;
+      for (f = 0; f < num_frames; f++)
+      {
+         impl->get_work_packets(impl_data, packets, output, out_pitch,
+               frames + (size_t)f * height * in_pitch,
+               width, height, in_pitch);
+         for (i = 0; i < threads; i++)
+            packets[i].work(impl_data, packets[i].thread_data);
+      }
+   }
+   elapsed = now_ms() - start;
+
+   printf("%-40s %4ux%-4u -> %4ux%-4u %8.3f ms/frame  [%08x]\n",
+         path, width, height, out_w, out_h,
+         elapsed / (double)(passes * num_frames),
+         (unsigned)checksum(output, out_w, out_h, out_pitch, bpp));
+
+   impl->destroy(impl_data);
+   free(packets);
+   free(output);
+   dlclose(lib);
+   return 1;
+}
+
+static void usage(const char *argv0)
+{
+   fprintf(stderr,
+         "Usage: %s [-w width] [-h height] [-f rgb565|xrgb8888]"
+         " [-i frames.raw] [-n passes] [-s] preset.filt...\n", argv0);
+}
+
+int main(int argc, char *argv[])
+{
+   int opt;
+   size_t frame_size, line_size;
+   uint8_t *buffer, *frames;
+   unsigned width              = 320;
+   unsigned height             = 240;
+   unsigned passes             = 100;
+   unsigned num_frames         = 8;
+   unsigned fmt                = SOFTFILTER_FMT_RGB565;
+   const char *input_path      = NULL;
+   int ret                     = 0;
+   softfilter_simd_mask_t simd = 0;
+
+#if defined(__SSE2__)
+   simd |= SOFTFILTER_SIMD_SSE | SOFTFILTER_SIMD_SSE2;
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+   simd |= SOFTFILTER_SIMD_NEON;
+#endif
+
+   while ((opt = getopt(argc, argv, "w:h:f:i:n:s")) != -1)
+   {
+      switch (opt)
+      {
+         case 'w':
+            width = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'h':
+            height = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 'f':
+            if (!strcasecmp(optarg, "xrgb8888"))
+               fmt = SOFTFILTER_FMT_XRGB8888;
+            else if (!strcasecmp(optarg, "rgb565"))
+               fmt = SOFTFILTER_FMT_RGB565;
+            else
+            {
+               usage(argv[0]);
+               return 1;
+            }
+            break;
+         case 'i':
+            input_path = optarg;
+            break;
+         case 'n':
+            passes = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+         case 's':
+            simd = 0;
+            break;
+         default:
+            usage(argv[0]);
+            return 1;
+      }
+   }
+
+   if (optind >= argc || !width || !height || !passes)
+   {
+      usage(argv[0]);
+      return 1;
+   }
+
+   /* Some filters peek one line above and below the frame, as the
+    * frontend's buffers allow; pad the frame set accordingly. */
+   line_size  = (size_t)width * (fmt == SOFTFILTER_FMT_RGB565 ? 2 : 4);
+   frame_size = line_size * height;
+
+   if (input_path)
+   {
+      long len;
+      FILE *f = fopen(input_path, "rb");
+      if (!f)
+      {
+         perror(input_path);
+         return 1;
+      }
+      fseek(f, 0, SEEK_END);
+      len = ftell(f);
+      fseek(f, 0, SEEK_SET);
+      num_frames = (unsigned)(len / (long)frame_size);
+      if (!num_frames)
+      {
+         fprintf(stderr, "%s: smaller than one frame\n", input_path);
+         fclose(f);
+         return 1;
+      }
+      buffer = (uint8_t*)calloc(1, num_frames * frame_size + 2 * line_size);
+      frames = buffer + line_size;
+      if (fread(frames, frame_size, num_frames, f) != num_frames)
+      {
+         perror(input_path);
+         fclose(f);
+         free(buffer);
+         return 1;
+      }
+      fclose(f);
+   }
+   else
+   {
+      buffer = (uint8_t*)calloc(1, num_frames * frame_size + 2 * line_size);
+      frames = buffer + line_size;
+      synth_frames(frames, num_frames, width, height,
+            fmt == SOFTFILTER_FMT_RGB565 ? 2 : 4);
+   }
+
+   for (; optind < argc; optind++)
+      if (!bench_preset(argv[optind], frames, num_frames, passes,
+               width, height, fmt, simd))
+         ret = 1;
+
+   free(buffer);
+   return ret;
+}